@@ -0,0 +1,137 @@
+//
+// AllocationCounter.cpp
+//
+
+#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+using namespace DX;
+
+namespace
+{
+    std::atomic<uint64_t> g_allocations(0);
+    std::atomic<uint64_t> g_frees(0);
+    std::atomic<uint64_t> g_bytesAllocated(0);
+
+    AllocationHook g_hook = nullptr;
+    void* g_hookContext = nullptr;
+}
+
+#if defined(DX_TRACK_ALLOCATIONS)
+
+namespace
+{
+    void* CountedAllocate(size_t size)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytesAllocated.fetch_add(size, std::memory_order_relaxed);
+
+        if (AllocationHook hook = g_hook)
+        {
+            hook(size, g_hookContext);
+        }
+
+        return std::malloc(size ? size : 1);
+    }
+
+    void CountedFree(void* p) noexcept
+    {
+        if (p)
+        {
+            g_frees.fetch_add(1, std::memory_order_relaxed);
+            std::free(p);
+        }
+    }
+}
+
+void* operator new(size_t size)
+{
+    void* p = CountedAllocate(size);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* p) noexcept                              { CountedFree(p); }
+void operator delete[](void* p) noexcept                            { CountedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept       { CountedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept     { CountedFree(p); }
+void operator delete(void* p, size_t) noexcept                      { CountedFree(p); }
+void operator delete[](void* p, size_t) noexcept                    { CountedFree(p); }
+
+bool DX::IsAllocationTrackingEnabled() noexcept
+{
+    return true;
+}
+
+#else
+
+bool DX::IsAllocationTrackingEnabled() noexcept
+{
+    return false;
+}
+
+#endif
+
+AllocationCounts DX::GetAllocationCounts() noexcept
+{
+    AllocationCounts counts;
+    counts.allocations = g_allocations.load(std::memory_order_relaxed);
+    counts.frees = g_frees.load(std::memory_order_relaxed);
+    counts.bytesAllocated = g_bytesAllocated.load(std::memory_order_relaxed);
+    return counts;
+}
+
+void DX::SetAllocationHook(AllocationHook hook, void* context) noexcept
+{
+    g_hook = nullptr;
+    g_hookContext = context;
+    g_hook = hook;
+}
+
+AllocationScope::AllocationScope() noexcept :
+    m_start(GetAllocationCounts())
+{
+}
+
+uint64_t AllocationScope::GetAllocations() const noexcept
+{
+    return GetAllocationCounts().allocations - m_start.allocations;
+}
+
+uint64_t AllocationScope::GetBytesAllocated() const noexcept
+{
+    return GetAllocationCounts().bytesAllocated - m_start.bytesAllocated;
+}
+
+void AllocationScope::ExpectNoAllocations(const char* scope) const
+{
+    uint64_t allocations = GetAllocations();
+    if (allocations != 0)
+    {
+        throw std::runtime_error(std::string(scope) + ": " + std::to_string(allocations)
+            + " heap allocations (" + std::to_string(GetBytesAllocated()) + " bytes)");
+    }
+}
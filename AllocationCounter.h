@@ -0,0 +1,48 @@
+//
+// AllocationCounter.h - Global heap allocation counters, for proving that a
+// loop has stopped allocating once it reaches a steady state
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace DX
+{
+    struct AllocationCounts
+    {
+        uint64_t allocations;
+        uint64_t frees;
+        uint64_t bytesAllocated;
+    };
+
+    // Counting replaces the global operator new and delete, so it is only
+    // compiled into builds that define DX_TRACK_ALLOCATIONS (the headless and
+    // benchmark builds). Elsewhere every count stays zero.
+    bool IsAllocationTrackingEnabled() noexcept;
+    AllocationCounts GetAllocationCounts() noexcept;
+
+    // Called on every counted allocation, from whichever thread made it.
+    // Set a hook to break on or log the allocation that spoiled a steady
+    // state; pass nullptr to remove it. Not synchronized with allocating
+    // threads, so set it while the process is quiet.
+    typedef void (*AllocationHook)(size_t sizeBytes, void* context);
+    void SetAllocationHook(AllocationHook hook, void* context) noexcept;
+
+    // Allocations made since construction, on any thread.
+    class AllocationScope
+    {
+    public:
+        AllocationScope() noexcept;
+
+        uint64_t GetAllocations() const noexcept;
+        uint64_t GetBytesAllocated() const noexcept;
+
+        // Throws std::runtime_error naming the scope if anything was allocated.
+        void ExpectNoAllocations(const char* scope) const;
+
+    private:
+        AllocationCounts m_start;
+    };
+}
@@ -0,0 +1,681 @@
+//
+// AssetDatabase.cpp
+//
+
+#include "AssetDatabase.h"
+#include "BinaryFile.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const uint32_t WATCH_TIMEOUT_MILLISECONDS = 250;
+
+    // FNV-1a; only compared against the file's own previous hash.
+    uint64_t HashBytes(const std::vector<uint8_t>& bytes)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (uint8_t byte : bytes)
+        {
+            hash = (hash ^ byte) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // What the budget counts: the decoded data, not the bookkeeping.
+    uint64_t DataBytes(const AssetData& data)
+    {
+        return data.bytes.size()
+            + data.texture.pixels.size() + data.texture.surfaces.size() * sizeof(TextureSurface)
+            + data.mesh.vertices.size() * sizeof(MeshVertex) + data.mesh.indices.size() * sizeof(uint16_t)
+            + data.mesh.subsets.size() * sizeof(MeshSubset);
+    }
+}
+
+AssetDatabase::AssetDatabase(const std::string& rootDirectory) :
+    m_root(rootDirectory.empty() ? std::string(".") : rootDirectory),
+    m_budget(0),
+    m_residentBytes(0),
+    m_useClock(0),
+    m_quit(false),
+    m_stats{},
+    m_stopLoading(false)
+{
+}
+
+AssetDatabase::~AssetDatabase()
+{
+    StopWatching();
+
+    if (m_loader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopLoading = true;
+        }
+        m_loadReady.notify_one();
+        m_loader.join();
+    }
+}
+
+AssetHandle AssetDatabase::Add(AssetType type, const std::string& name)
+{
+    if (IsWatching())
+    {
+        throw std::logic_error("AssetDatabase::Add: already watching");
+    }
+
+    AssetHandle existing = Find(name);
+    if (existing)
+    {
+        return existing;
+    }
+
+    Asset asset;
+    asset.name = name;
+    asset.type = type;
+    asset.depth = 0;
+    asset.version = 1;
+    asset.residentBytes = 0;
+    asset.lastUse = 0;
+    asset.requested = false;
+
+    // Import before registering anything, so a failure leaves no trace.
+    uint64_t hash = 0;
+    if (type == AssetType::Group)
+    {
+        std::shared_ptr<AssetData> data = std::make_shared<AssetData>();
+        data->type = type;
+        data->version = 1;
+        asset.current = std::move(data);
+    }
+    else
+    {
+        std::vector<uint8_t> bytes = ReadBinaryFile(m_root + "/" + name);
+        hash = HashBytes(bytes);
+        asset.current = Import(type, name, 1, std::move(bytes));
+    }
+
+    m_assets.push_back(std::move(asset));
+    m_importedVersions.push_back(1);
+    AssetHandle handle = AssetHandle(m_assets.size());
+    Install(handle, m_assets.back().current);
+
+    if (type != AssetType::Group)
+    {
+        uint32_t source = AddSource(name, handle);
+        m_sources[source].hash = hash;
+    }
+
+    return handle;
+}
+
+void AssetDatabase::AddSourceFile(AssetHandle asset, const std::string& name)
+{
+    if (IsWatching())
+    {
+        throw std::logic_error("AssetDatabase::AddSourceFile: already watching");
+    }
+    if (asset == 0 || asset > m_assets.size())
+    {
+        throw std::runtime_error("AssetDatabase::AddSourceFile: invalid handle");
+    }
+
+    uint64_t hash = HashBytes(ReadBinaryFile(m_root + "/" + name));
+    uint32_t source = AddSource(name, asset);
+    m_sources[source].hash = hash;
+}
+
+uint32_t AssetDatabase::AddSource(const std::string& name, AssetHandle asset)
+{
+    uint32_t source = 0;
+    while (source < m_sources.size() && m_sources[source].name != name)
+    {
+        ++source;
+    }
+
+    if (source == m_sources.size())
+    {
+        m_sources.push_back(SourceFile{ name, 0, {} });
+    }
+
+    std::vector<AssetHandle>& owners = m_sources[source].assets;
+    if (std::find(owners.begin(), owners.end(), asset) == owners.end())
+    {
+        owners.push_back(asset);
+        m_assets[asset - 1].sources.push_back(source);
+    }
+    return source;
+}
+
+void AssetDatabase::AddDependency(AssetHandle dependent, AssetHandle dependency)
+{
+    if (IsWatching())
+    {
+        throw std::logic_error("AssetDatabase::AddDependency: already watching");
+    }
+    if (dependent == 0 || dependent > m_assets.size() || dependency == 0 || dependency > m_assets.size())
+    {
+        throw std::runtime_error("AssetDatabase::AddDependency: invalid handle");
+    }
+    if (dependent == dependency || DependsOn(dependency, dependent))
+    {
+        throw std::logic_error("AssetDatabase::AddDependency: cycle");
+    }
+
+    std::vector<AssetHandle>& dependencies = m_assets[dependent - 1].dependencies;
+    if (std::find(dependencies.begin(), dependencies.end(), dependency) != dependencies.end())
+    {
+        return;
+    }
+
+    dependencies.push_back(dependency);
+    m_assets[dependency - 1].dependents.push_back(dependent);
+    UpdateDepth(dependent);
+}
+
+bool AssetDatabase::DependsOn(AssetHandle asset, AssetHandle dependency) const
+{
+    for (AssetHandle direct : m_assets[asset - 1].dependencies)
+    {
+        if (direct == dependency || DependsOn(direct, dependency))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AssetDatabase::UpdateDepth(AssetHandle asset)
+{
+    Asset& entry = m_assets[asset - 1];
+
+    uint32_t depth = 0;
+    for (AssetHandle dependency : entry.dependencies)
+    {
+        depth = std::max(depth, m_assets[dependency - 1].depth + 1);
+    }
+
+    if (depth != entry.depth)
+    {
+        entry.depth = depth;
+        for (AssetHandle dependent : entry.dependents)
+        {
+            UpdateDepth(dependent);
+        }
+    }
+}
+
+AssetHandle AssetDatabase::Find(const std::string& name) const
+{
+    for (size_t i = 0; i < m_assets.size(); ++i)
+    {
+        if (m_assets[i].name == name)
+        {
+            return AssetHandle(i + 1);
+        }
+    }
+    return 0;
+}
+
+const AssetData& AssetDatabase::Get(AssetHandle asset)
+{
+    if (asset == 0 || asset > m_assets.size())
+    {
+        throw std::runtime_error("AssetDatabase::Get: invalid handle");
+    }
+
+    Asset& entry = m_assets[asset - 1];
+    if (entry.current)
+    {
+        entry.lastUse = ++m_useClock;
+        return *entry.current;
+    }
+
+    // Evicted: read it back now. Same file, same version.
+    Install(asset, Import(entry.type, entry.name, entry.version, ReadBinaryFile(m_root + "/" + entry.name)));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.residentMisses;
+    return *entry.current;
+}
+
+bool AssetDatabase::IsResident(AssetHandle asset) const
+{
+    if (asset == 0 || asset > m_assets.size())
+    {
+        throw std::runtime_error("AssetDatabase::IsResident: invalid handle");
+    }
+    return m_assets[asset - 1].current != nullptr;
+}
+
+void AssetDatabase::Request(AssetHandle asset)
+{
+    if (asset == 0 || asset > m_assets.size())
+    {
+        throw std::runtime_error("AssetDatabase::Request: invalid handle");
+    }
+
+    Asset& entry = m_assets[asset - 1];
+    if (entry.current || entry.requested)
+    {
+        return;
+    }
+    entry.requested = true;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_loader.joinable())
+        {
+            m_loader = std::thread(&AssetDatabase::LoadMain, this);
+        }
+        m_loadQueue.push_back(LoadRequest{ asset, entry.type, entry.name, entry.version });
+    }
+    m_loadReady.notify_one();
+}
+
+void AssetDatabase::LoadMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_loadReady.wait(lock, [this]() { return m_stopLoading || !m_loadQueue.empty(); });
+        if (m_stopLoading)
+        {
+            return;
+        }
+
+        LoadRequest request = std::move(m_loadQueue.front());
+        m_loadQueue.erase(m_loadQueue.begin());
+        lock.unlock();
+
+        std::shared_ptr<AssetData> data;
+        std::string error;
+        try
+        {
+            data = Import(request.type, request.name, request.version, ReadBinaryFile(m_root + "/" + request.name));
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+        }
+
+        lock.lock();
+        if (!data)
+        {
+            ++m_stats.failedImports;
+            m_lastError = error;
+        }
+
+        // A reimport already waiting is newer; it makes the asset resident anyway.
+        auto pending = std::find_if(m_pending.begin(), m_pending.end(),
+            [&](const PendingImport& import) { return import.asset == request.asset; });
+        if (pending == m_pending.end())
+        {
+            m_pending.push_back(PendingImport{ request.asset, std::move(data), Clock::now(), true });
+        }
+    }
+}
+
+void AssetDatabase::Install(AssetHandle asset, std::shared_ptr<const AssetData> data)
+{
+    Asset& entry = m_assets[asset - 1];
+    uint64_t bytes = DataBytes(*data);
+
+    m_residentBytes = m_residentBytes - entry.residentBytes + bytes;
+    entry.residentBytes = bytes;
+    entry.version = data->version;
+    entry.current = std::move(data);
+    entry.lastUse = ++m_useClock;
+    entry.requested = false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.residentBytes = m_residentBytes;
+}
+
+void AssetDatabase::Trim()
+{
+    if (m_budget == 0)
+    {
+        return;
+    }
+
+    uint32_t evictions = 0;
+    while (m_residentBytes > m_budget)
+    {
+        // A handful of assets; scanning for the oldest beats keeping a list.
+        Asset* oldest = nullptr;
+        for (Asset& entry : m_assets)
+        {
+            if (entry.current && entry.residentBytes != 0 && (!oldest || entry.lastUse < oldest->lastUse))
+            {
+                oldest = &entry;
+            }
+        }
+        if (!oldest)
+        {
+            break;
+        }
+
+        m_residentBytes -= oldest->residentBytes;
+        oldest->residentBytes = 0;
+        oldest->current.reset();
+        ++evictions;
+    }
+
+    if (evictions != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.evictions += evictions;
+        m_stats.residentBytes = m_residentBytes;
+    }
+}
+
+std::shared_ptr<AssetData> AssetDatabase::Import(AssetType type, const std::string& name, uint32_t version, std::vector<uint8_t> bytes) const
+{
+    std::shared_ptr<AssetData> data = std::make_shared<AssetData>();
+    data->type = type;
+    data->version = version;
+
+    try
+    {
+        switch (type)
+        {
+        case AssetType::Texture:
+            data->texture = IsDecodableImage(bytes.data(), bytes.size())
+                ? LoadImageFromMemory(bytes.data(), bytes.size())
+                : LoadDDSFromMemory(bytes.data(), bytes.size());
+            if (data->texture.desc.mipLevels == 1 && !IsBlockCompressed(data->texture.desc.format))
+            {
+                data->texture = GenerateMips(data->texture, MipOptions{ MipFilter::Box, true, 0.f, 0 });
+            }
+            break;
+
+        case AssetType::Mesh:
+            data->mesh = LoadSDKMESHFromMemory(bytes.data(), bytes.size());
+            break;
+
+        default:
+            data->bytes = std::move(bytes);
+            break;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        throw std::runtime_error(name + ": " + e.what());
+    }
+
+    return data;
+}
+
+void AssetDatabase::CheckSources(const std::vector<uint32_t>& sources, Clock::time_point noticed)
+{
+    // Hash every file first: an asset built from two changed files is
+    // reimported once.
+    std::vector<AssetHandle> stale;
+    uint32_t unchanged = 0;
+    std::string error;
+
+    for (uint32_t index : sources)
+    {
+        SourceFile& source = m_sources[index];
+        uint64_t hash;
+        try
+        {
+            hash = HashBytes(ReadBinaryFile(m_root + "/" + source.name));
+        }
+        catch (const std::exception& e)
+        {
+            error = e.what();
+            continue;
+        }
+
+        if (hash == source.hash)
+        {
+            ++unchanged;
+            continue;
+        }
+
+        source.hash = hash;
+        for (AssetHandle asset : source.assets)
+        {
+            if (std::find(stale.begin(), stale.end(), asset) == stale.end())
+            {
+                stale.push_back(asset);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.unchangedWrites += unchanged;
+        if (!error.empty())
+        {
+            m_lastError = error;
+        }
+    }
+
+    for (AssetHandle handle : stale)
+    {
+        const Asset& asset = m_assets[handle - 1];
+        auto start = Clock::now();
+
+        std::shared_ptr<AssetData> data;
+        try
+        {
+            data = Import(asset.type, asset.name, m_importedVersions[handle - 1] + 1, ReadBinaryFile(m_root + "/" + asset.name));
+        }
+        catch (const std::exception& e)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.failedImports;
+            m_lastError = e.what();
+            continue;
+        }
+        ++m_importedVersions[handle - 1];
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.lastImportNanoseconds = ElapsedNanoseconds(start);
+
+        // A newer import replaces one not yet applied, but the wait counts
+        // from the first change.
+        auto pending = std::find_if(m_pending.begin(), m_pending.end(),
+            [&](const PendingImport& import) { return import.asset == handle; });
+        if (pending != m_pending.end() && !pending->restore)
+        {
+            pending->data = std::move(data);
+        }
+        else if (pending != m_pending.end())
+        {
+            *pending = PendingImport{ handle, std::move(data), noticed, false };
+        }
+        else
+        {
+            m_pending.push_back(PendingImport{ handle, std::move(data), noticed, false });
+        }
+    }
+}
+
+void AssetDatabase::Rescan()
+{
+    if (IsWatching())
+    {
+        throw std::logic_error("AssetDatabase::Rescan: watching");
+    }
+
+    std::vector<uint32_t> sources(m_sources.size());
+    for (uint32_t i = 0; i < sources.size(); ++i)
+    {
+        sources[i] = i;
+    }
+    CheckSources(sources, Clock::now());
+}
+
+void AssetDatabase::StartWatching()
+{
+    if (IsWatching())
+    {
+        return;
+    }
+
+    m_watcher.reset(new FileWatcher(m_root));
+    m_quit = false;
+    m_thread = std::thread(&AssetDatabase::WatchMain, this);
+}
+
+void AssetDatabase::StopWatching()
+{
+    if (!IsWatching())
+    {
+        return;
+    }
+
+    m_quit = true;
+    m_watcher->Wake();
+    m_thread.join();
+    m_watcher.reset();
+}
+
+void AssetDatabase::WatchMain()
+{
+    std::vector<std::string> names;
+    std::vector<uint32_t> sources;
+
+    while (!m_quit)
+    {
+        names.clear();
+        bool changed;
+        try
+        {
+            changed = m_watcher->Wait(names, WATCH_TIMEOUT_MILLISECONDS);
+        }
+        catch (const std::exception& e)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_lastError = e.what();
+            changed = false;
+        }
+        if (!changed || m_quit)
+        {
+            continue;
+        }
+
+        Clock::time_point noticed = Clock::now();
+
+        sources.clear();
+        for (uint32_t i = 0; i < m_sources.size(); ++i)
+        {
+            if (names.empty() || std::find(names.begin(), names.end(), m_sources[i].name) != names.end())
+            {
+                sources.push_back(i);
+            }
+        }
+        CheckSources(sources, noticed);
+    }
+}
+
+bool AssetDatabase::ApplyChanges(std::vector<AssetHandle>& changed)
+{
+    changed.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_swapping.swap(m_pending);
+    }
+
+    Clock::time_point now = Clock::now();
+    uint32_t restored = 0;
+    uint64_t lastLatency = 0;
+    uint64_t maxLatency = 0;
+    for (PendingImport& import : m_swapping)
+    {
+        Asset& entry = m_assets[import.asset - 1];
+        if (import.restore)
+        {
+            // Requested data only fills a gap; a Get may have beaten it here.
+            entry.requested = false;
+            if (import.data && !entry.current)
+            {
+                Install(import.asset, std::move(import.data));
+                ++restored;
+            }
+            continue;
+        }
+
+        Install(import.asset, std::move(import.data));
+        changed.push_back(import.asset);
+
+        lastLatency = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - import.noticed).count());
+        maxLatency = std::max(maxLatency, lastLatency);
+    }
+    m_swapping.clear();
+
+    if (!changed.empty() || restored != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!changed.empty())
+        {
+            m_stats.lastLatencyNanoseconds = lastLatency;
+            m_stats.maxLatencyNanoseconds = std::max(m_stats.maxLatencyNanoseconds, maxLatency);
+            m_stats.reloads += uint32_t(changed.size());
+        }
+        m_stats.backgroundLoads += restored;
+    }
+
+    // Over budget, the oldest data goes; nothing handed out before this
+    // call is still in use.
+    Trim();
+
+    if (changed.empty())
+    {
+        return false;
+    }
+
+    // Everything downstream of a reimport changed too.
+    m_changedMarks.assign(m_assets.size(), 0);
+    for (AssetHandle asset : changed)
+    {
+        m_changedMarks[asset - 1] = 1;
+    }
+    for (size_t i = 0; i < changed.size(); ++i)
+    {
+        for (AssetHandle dependent : m_assets[changed[i] - 1].dependents)
+        {
+            if (!m_changedMarks[dependent - 1])
+            {
+                m_changedMarks[dependent - 1] = 1;
+                changed.push_back(dependent);
+            }
+        }
+    }
+
+    std::sort(changed.begin(), changed.end(), [&](AssetHandle a, AssetHandle b)
+    {
+        uint32_t depthA = m_assets[a - 1].depth;
+        uint32_t depthB = m_assets[b - 1].depth;
+        return depthA != depthB ? depthA < depthB : a < b;
+    });
+    return true;
+}
+
+AssetStats AssetDatabase::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::string AssetDatabase::GetLastError() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
@@ -0,0 +1,218 @@
+//
+// AssetDatabase.h - Imported assets with their source files, content hashes
+// and dependents, reimported in the background when their files change
+//
+
+#pragma once
+
+#include "FileWatcher.h"
+#include "MeshData.h"
+#include "TextureData.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DX
+{
+    // Zero is never a valid handle.
+    typedef uint32_t AssetHandle;
+
+    enum class AssetType : uint8_t
+    {
+        Blob,           // The file as read, e.g. compiled shaders.
+        Texture,        // DDS, BMP or PNG, parsed into a TextureData. Uncompressed files without mips get a chain.
+        Mesh,           // SDKMESH, parsed into a MeshData.
+        Group,          // No file of its own; changes when a dependency does.
+    };
+
+    // One imported version of an asset. Immutable once published.
+    struct AssetData
+    {
+        AssetType               type;
+        uint32_t                version;    // 1 for the first import, then one more per reload.
+        std::vector<uint8_t>    bytes;      // Blob only.
+        TextureData             texture;    // Texture only.
+        MeshData                mesh;       // Mesh only.
+    };
+
+    struct AssetStats
+    {
+        uint32_t reloads;                   // Versions swapped in by ApplyChanges.
+        uint32_t unchangedWrites;           // Files checked after a write or Rescan, contents the same.
+        uint32_t failedImports;             // See GetLastError; the old version stays.
+        uint64_t lastImportNanoseconds;     // Read, hash and parse of the latest reimport.
+        uint64_t lastLatencyNanoseconds;    // Change noticed to new version swapped in.
+        uint64_t maxLatencyNanoseconds;
+        uint64_t residentBytes;             // Imported data held, against the memory budget.
+        uint32_t evictions;
+        uint32_t residentMisses;            // Gets that found the asset evicted and read it on the spot.
+        uint32_t backgroundLoads;           // Evicted assets brought back by Request.
+    };
+
+    // Assets are registered up front and imported synchronously, so the
+    // data is there as soon as Add returns; reloading a device reads it
+    // from here rather than from disk. Once watching, a background thread
+    // waits on the directory, hashes whatever was written and reimports
+    // only the assets built from files whose contents actually changed.
+    //
+    // Reimports are double-buffered: the thread fills a pending version
+    // while the consumer keeps using the current one, and ApplyChanges
+    // swaps them without ever waiting on a file, so frames do not stall.
+    //
+    // With a memory budget, ApplyChanges evicts the least recently used
+    // assets' data until the rest fits. Handles stay valid: the next Get
+    // reads an evicted asset back synchronously, or Request reads it ahead
+    // of time on a background thread.
+    class AssetDatabase
+    {
+    public:
+        // Asset names are file names relative to rootDirectory.
+        explicit AssetDatabase(const std::string& rootDirectory);
+        ~AssetDatabase();
+
+        AssetDatabase(AssetDatabase const&) = delete;
+        AssetDatabase& operator=(AssetDatabase const&) = delete;
+
+        // Registers and imports name. Throws std::runtime_error if it cannot
+        // be read or parsed. Adding a name twice returns the first handle.
+        // Registration must finish before StartWatching.
+        AssetHandle Add(AssetType type, const std::string& name);
+
+        // Another file the asset is built from, e.g. the material library a
+        // mesh was converted with. Writing it reimports the asset.
+        void AddSourceFile(AssetHandle asset, const std::string& name);
+
+        // dependent is reported as changed whenever dependency is. Throws
+        // std::logic_error if that would make a cycle.
+        void AddDependency(AssetHandle dependent, AssetHandle dependency);
+
+        // Zero if name was never added.
+        AssetHandle Find(const std::string& name) const;
+
+        // The current version, read back from disk first if it was evicted;
+        // throws std::runtime_error if that fails. Stays valid until the next
+        // ApplyChanges.
+        const AssetData& Get(AssetHandle asset);
+
+        // Caps the imported data held; zero, the default, keeps everything.
+        // Applied by each ApplyChanges, never in between, so data already
+        // handed out stays valid.
+        void SetMemoryBudget(uint64_t bytes)    { m_budget = bytes; }
+        uint64_t GetMemoryBudget() const        { return m_budget; }
+
+        bool IsResident(AssetHandle asset) const;
+
+        // Reads an evicted asset back on a background thread. It is resident
+        // again after the ApplyChanges that follows the read, without being
+        // reported as changed. Does nothing if it is resident or on its way.
+        void Request(AssetHandle asset);
+
+        // Throws std::runtime_error if the directory cannot be watched.
+        void StartWatching();
+        void StopWatching();
+        bool IsWatching() const     { return m_thread.joinable(); }
+
+        // Checks every source file now, on the calling thread, and reimports
+        // what changed; for when not watching. The new versions still only
+        // appear at the next ApplyChanges.
+        void Rescan();
+
+        // Swaps in every reimport finished since the last call, then evicts
+        // down to the memory budget. Fills changed with the reimported assets
+        // followed by everything depending on them, each after its own
+        // dependencies. Returns whether anything changed.
+        bool ApplyChanges(std::vector<AssetHandle>& changed);
+
+        AssetStats GetStats() const;
+        std::string GetLastError() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct SourceFile
+        {
+            std::string                 name;
+            uint64_t                    hash;
+            std::vector<AssetHandle>    assets;     // Built from this file.
+        };
+
+        struct Asset
+        {
+            std::string                         name;
+            AssetType                           type;
+            std::vector<uint32_t>               sources;        // Into m_sources; the first is the asset's own file.
+            std::vector<AssetHandle>            dependencies;
+            std::vector<AssetHandle>            dependents;
+            std::shared_ptr<const AssetData>    current;        // Null once evicted.
+            uint32_t                            depth;          // Longest dependency chain below this asset.
+
+            // Owned by the consumer, like current.
+            uint32_t                            version;        // Of current, or of the data evicted.
+            uint64_t                            residentBytes;
+            uint64_t                            lastUse;
+            bool                                requested;
+        };
+
+        struct PendingImport
+        {
+            AssetHandle                         asset;
+            std::shared_ptr<const AssetData>    data;           // Null if a requested read failed.
+            Clock::time_point                   noticed;
+            bool                                restore;        // A Request, not a change.
+        };
+
+        struct LoadRequest
+        {
+            AssetHandle                         asset;
+            AssetType                           type;
+            std::string                         name;
+            uint32_t                            version;
+        };
+
+        uint32_t AddSource(const std::string& name, AssetHandle asset);
+        std::shared_ptr<AssetData> Import(AssetType type, const std::string& name, uint32_t version, std::vector<uint8_t> bytes) const;
+        void Install(AssetHandle asset, std::shared_ptr<const AssetData> data);
+        void Trim();
+        void CheckSources(const std::vector<uint32_t>& sources, Clock::time_point noticed);
+        bool DependsOn(AssetHandle asset, AssetHandle dependency) const;
+        void UpdateDepth(AssetHandle asset);
+        void WatchMain();
+        void LoadMain();
+
+        std::string                 m_root;
+        std::vector<Asset>          m_assets;           // Handle - 1.
+        std::vector<SourceFile>     m_sources;
+
+        // Versions handed out by imports, per asset; only the importing
+        // thread writes these once watching.
+        std::vector<uint32_t>       m_importedVersions;
+
+        std::vector<uint8_t>        m_changedMarks;     // ApplyChanges scratch.
+        std::vector<PendingImport>  m_swapping;         // Likewise; swapped with m_pending.
+
+        uint64_t                    m_budget;
+        uint64_t                    m_residentBytes;
+        uint64_t                    m_useClock;         // Stamps Asset::lastUse.
+
+        std::unique_ptr<FileWatcher>    m_watcher;
+        std::thread                     m_thread;
+        std::atomic<bool>               m_quit;
+        std::thread                     m_loader;       // Started by the first Request.
+
+        mutable std::mutex              m_mutex;        // Guards everything below.
+        std::vector<PendingImport>      m_pending;
+        AssetStats                      m_stats;
+        std::string                     m_lastError;
+        std::vector<LoadRequest>        m_loadQueue;
+        std::condition_variable         m_loadReady;
+        bool                            m_stopLoading;
+    };
+}
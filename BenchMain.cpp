@@ -0,0 +1,2338 @@
+//
+// BenchMain.cpp - Benchmark suite covering the timer, camera and matrix math,
+// asset parsing, image decoding, mip generation, environment prefiltering,
+// light clustering, particles, broadphase collision and full headless
+// frames. Writes the results as JSON, and exits non-zero if any of the
+// correctness checks made along the way fails.
+//
+// Usage: GameBench [--out results.json] [--filter text] [--repetitions N]
+//                  [--warmup N] [--assets dir] [--replay recording] [--label text]
+//                  [--save-frames dir]
+//
+
+#include "AllocationCounter.h"
+#include "AssetDatabase.h"
+#include "Benchmark.h"
+#include "BinaryFile.h"
+#include "CameraController.h"
+#include "EnvironmentPrefilter.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "GeometryCache.h"
+#include "HeadlessScene.h"
+#include "HudBatcher.h"
+#include "ImageDecoder.h"
+#include "ImageFile.h"
+#include "InputRecording.h"
+#include "LightClusterer.h"
+#include "MeshData.h"
+#include "MipGenerator.h"
+#include "NullGraphicsBackend.h"
+#include "OcclusionCuller.h"
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "RecordingGraphicsBackend.h"
+#include "RenderQueue.h"
+#include "SoftwareGraphicsBackend.h"
+#include "SweepAndPrune.h"
+#include "StepTimer.h"
+#include "TextureData.h"
+#include "TextureStreamer.h"
+#include "UploadRingAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef GAME_ASSET_DIRECTORY
+#define GAME_ASSET_DIRECTORY "."
+#endif
+
+using namespace DX;
+
+namespace
+{
+    const double STEP_SECONDS = 1.0 / 60.0;
+
+    // Frames HeadlessScene needs before every container has reached its
+    // high-water mark (the software backend's bins grow the longest).
+    const uint32_t SCENE_WARMUP_FRAMES = 600;
+
+    // Scene files copied into a scratch directory for the hot reload benchmark.
+    const char* const SCENE_ASSET_FILES[] = { "skull.sdkmesh", "roomtexture.dds", "porcelain.dds", "cubemap.dds" };
+    const char* const HOT_RELOAD_DIRECTORY = "bench_hot_reload";
+
+    // Copies of the two mipmapped scene textures for the streaming grid.
+    const char* const STREAMING_DIRECTORY = "bench_streaming";
+
+    // The software backend's render of the scene's first step from the
+    // start position at 800x600, checked in next to the assets. A frame
+    // matches it if at most REFERENCE_MAX_MISMATCHED of its pixels differ by
+    // more than REFERENCE_TOLERANCE in any channel.
+    const char* const REFERENCE_FRAME_FILE = "reference_software.png";
+
+    // Small BMPs and PNGs written outside the tree, each next to a .rgba
+    // file of its expected pixels: RGBA8, top row first, no padding.
+    const char* const IMAGE_FIXTURE_DIRECTORY = "image_fixtures";
+    const char* const IMAGE_FIXTURES[] =
+    {
+        "png_rgba8_dynamic.png", "png_rgb8_stored.png", "png_rgb8_split_idat.png", "png_rgb8_key.png",
+        "png_rgb16_key.png", "png_rgba16.png", "png_gray1.png", "png_gray2.png", "png_gray4.png",
+        "png_gray8.png", "png_gray16_key.png", "png_graya8.png", "png_graya16.png", "png_palette1.png",
+        "png_palette2.png", "png_palette4_trns.png", "png_palette8_trns.png",
+        "bmp_1bit.bmp", "bmp_4bit.bmp", "bmp_8bit_topdown.bmp", "bmp_8bit_core.bmp", "bmp_24bit.bmp",
+        "bmp_16bit_555.bmp", "bmp_16bit_565.bmp", "bmp_32bit.bmp", "bmp_32bit_v5_alpha.bmp", "bmp_32bit_v5_ragged.bmp",
+    };
+    const uint32_t REFERENCE_TOLERANCE = 8;
+    const double REFERENCE_MAX_MISMATCHED = 0.001;
+
+    // Scratch file for the command stream round trip.
+    const char* const COMMAND_STREAM_FILE = "bench_frames.dxcs";
+
+    // Game's camera settings; see HeadlessScene.cpp.
+    const CameraSettings CAMERA_SETTINGS = { Float3{ 0.f, 0.f, -6.f }, Float3{ 8.f, 6.f, 12.f }, 0.07f * 60.f, 0.004f };
+
+    struct Settings
+    {
+        BenchmarkOptions    options;
+        std::string         outputPath;
+        std::string         assetDirectory;
+        std::string         replayPath;
+        std::string         saveFramesDirectory;    // Where the software frames' reference renders go; empty saves none.
+    };
+
+    void PrintUsage()
+    {
+        printf("GameBench [--out results.json] [--filter text] [--repetitions N] [--warmup N]\n"
+               "          [--assets dir] [--replay recording] [--label text] [--save-frames dir]\n");
+    }
+
+    bool ParseArguments(int argc, char** argv, Settings& settings)
+    {
+        settings.options.warmupRepetitions = 3;
+        settings.options.repetitions = 15;
+        settings.outputPath = "bench_results.json";
+        settings.assetDirectory = GAME_ASSET_DIRECTORY;
+
+        for (int i = 1; i < argc; ++i)
+        {
+            const char* arg = argv[i];
+            const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+            if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+            {
+                PrintUsage();
+                return false;
+            }
+            if (!value)
+            {
+                fprintf(stderr, "Missing value for %s\n", arg);
+                return false;
+            }
+
+            if (!strcmp(arg, "--out"))
+                settings.outputPath = value;
+            else if (!strcmp(arg, "--filter"))
+                settings.options.filter = value;
+            else if (!strcmp(arg, "--repetitions"))
+                settings.options.repetitions = uint32_t(strtoul(value, nullptr, 10));
+            else if (!strcmp(arg, "--warmup"))
+                settings.options.warmupRepetitions = uint32_t(strtoul(value, nullptr, 10));
+            else if (!strcmp(arg, "--assets"))
+                settings.assetDirectory = value;
+            else if (!strcmp(arg, "--replay"))
+                settings.replayPath = value;
+            else if (!strcmp(arg, "--label"))
+                settings.options.label = value;
+            else if (!strcmp(arg, "--save-frames"))
+                settings.saveFramesDirectory = value;
+            else
+            {
+                fprintf(stderr, "Unknown argument %s\n", arg);
+                PrintUsage();
+                return false;
+            }
+            ++i;
+        }
+        return true;
+    }
+
+    void RunScene(HeadlessScene& scene, IGraphicsBackend& backend, uint32_t firstFrame, uint32_t frameCount)
+    {
+        for (uint32_t frame = firstFrame; frame < firstFrame + frameCount; ++frame)
+        {
+            scene.Update(frame * STEP_SECONDS);
+            scene.Render(backend);
+        }
+    }
+
+    // Point and spot lights scattered through the room, a quarter of them
+    // spots, reaching 0.5 to 2 units.
+    std::vector<DynamicLight> CreateLightField(uint32_t count)
+    {
+        std::vector<DynamicLight> lights(count);
+        uint32_t seed = 1;
+        auto next = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return float(seed >> 8) / float(1u << 24);
+        };
+        for (DynamicLight& light : lights)
+        {
+            light.position = Float3{ (next() - 0.5f) * 8.f, (next() - 0.5f) * 6.f, (next() - 0.5f) * 12.f };
+            light.range = 0.5f + next() * 1.5f;
+            light.color = Float3{ next(), next(), next() };
+            light.type = (next() < 0.25f) ? LightType::Spot : LightType::Point;
+            light.direction = Float3{ next() - 0.5f, next() - 0.5f, next() - 0.5f }.Normalized();
+            light.cosOuterAngle = 0.5f + next() * 0.45f;
+        }
+        return lights;
+    }
+
+    // A minute-long walk through the room at an uneven frame rate: forward,
+    // a look around with the mouse, a strafe and a climb.
+    InputRecording CreateWalkthrough()
+    {
+        InputRecording recording;
+        const uint32_t keys[8] = {};
+        uint64_t time = 0;
+        uint32_t seed = 1;
+
+        for (uint32_t tick = 0; tick < 3600; ++tick)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            uint64_t delta = 166667 + (seed >> 16) % 40000 - 20000;
+            time += delta;
+            recording.AddTick(delta, time, keys);
+
+            uint64_t at = time - 1000;
+            switch (tick)
+            {
+            case 60:    recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::KeyDown, CameraKey::W }); break;
+            case 240:   recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::KeyUp, CameraKey::W }); break;
+            case 300:   recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::ButtonDown, InputButton::Left }); break;
+            case 1500:  recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::ButtonUp, InputButton::Left }); break;
+            case 1600:  recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::KeyDown, CameraKey::A }); break;
+            case 1900:  recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::KeyUp, CameraKey::A }); break;
+            case 2000:  recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::KeyDown, CameraKey::Space }); break;
+            case 2100:  recording.AddEvent(InputEvent{ at, 0, 0, InputEventType::KeyUp, CameraKey::Space }); break;
+            }
+
+            if (tick > 300 && tick < 1500)
+            {
+                recording.AddEvent(InputEvent{ time - 3000, tick < 900 ? 3 : -3, (tick % 120) < 60 ? 1 : -1, InputEventType::MouseDelta, 0 });
+            }
+        }
+
+        return recording;
+    }
+
+    void BenchmarkTimer(BenchmarkRunner& runner)
+    {
+        const uint32_t calls = 100000;
+
+        StepTimer timer;
+        timer.SetFixedTimeStep(true);
+        timer.SetTargetElapsedSeconds(STEP_SECONDS);
+        uint32_t updates = 0;
+
+        // Back to back, almost every Tick finds no step due: this is the
+        // overhead the loop pays between frames.
+        runner.Run("StepTimer/Tick", calls, [&]()
+        {
+            for (uint32_t i = 0; i < calls; ++i)
+            {
+                timer.Tick([&]() { ++updates; });
+            }
+        });
+        DoNotOptimize(updates);
+
+        // One step per call, as when ticking at the step rate.
+        runner.Run("StepTimer/AdvanceOneStep", calls, [&]()
+        {
+            for (uint32_t i = 0; i < calls; ++i)
+            {
+                timer.Advance(StepTimer::TicksPerSecond / 60, [&]() { ++updates; });
+            }
+        });
+        DoNotOptimize(updates);
+    }
+
+    void BenchmarkCamera(BenchmarkRunner& runner)
+    {
+        const uint32_t steps = 10000;
+        const uint64_t stepTicks = InputQueue::TicksPerSecond / 60;
+
+        InputQueue input;
+        CameraController camera(CAMERA_SETTINGS);
+        Matrix44 view = Matrix44::Identity();
+        uint64_t time = 0;
+
+        // Per step as in Game: a mouse delta and a held key move the camera,
+        // then Render builds the view from position, pitch and yaw.
+        camera.Apply(InputEvent{ 0, 0, 0, InputEventType::ButtonDown, InputButton::Left });
+        camera.Apply(InputEvent{ 0, 0, 0, InputEventType::KeyDown, CameraKey::W });
+
+        runner.Run("Camera/StepAndView", steps, [&]()
+        {
+            for (uint32_t i = 0; i < steps; ++i)
+            {
+                input.PushMouseDelta((i & 64) ? 2 : -2, (i & 128) ? 1 : -1, time + stepTicks / 2);
+                camera.Step(input, time, time + stepTicks);
+                time += stepTicks;
+
+                Matrix44 rotation = Matrix44::CreateRotationX(camera.GetPitch()) * Matrix44::CreateRotationY(camera.GetYaw());
+                Float3 lookAt = camera.GetPosition() + rotation.TransformNormal(Float3{ 0, 0, 1 });
+                view = Matrix44::CreateLookAtRH(camera.GetPosition(), lookAt, Float3{ 0, 1, 0 });
+                DoNotOptimize(view);
+            }
+        });
+    }
+
+    void BenchmarkTransposes(BenchmarkRunner& runner)
+    {
+        const uint32_t calls = 100000;
+
+        // SetShaderParameters transposes world, view and projection for
+        // every draw before they go into the constant buffer.
+        Matrix44 world = Matrix44::CreateRotationY(0.5f) * Matrix44::CreateTranslation(0.f, -1.f, 4.5f);
+        Matrix44 view = Matrix44::CreateLookAtRH(Float3{ 0, 0, -6 }, Float3{ 0, 0, 0 }, Float3{ 0, 1, 0 });
+        Matrix44 projection = Matrix44::CreatePerspectiveFieldOfViewRH(1.2f, 4.f / 3.f, 0.01f, 100.f);
+        float constants[3][16];
+
+        runner.Run("Math/ShaderParameterTransposes", calls, [&]()
+        {
+            for (uint32_t i = 0; i < calls; ++i)
+            {
+                Matrix44 transposed[3] = { world.Transpose(), view.Transpose(), projection.Transpose() };
+                std::memcpy(constants, transposed, sizeof(constants));
+                DoNotOptimize(constants);
+                world.m[3][0] = constants[0][3];
+            }
+        });
+    }
+
+    void BenchmarkAssets(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        struct Asset
+        {
+            const char* benchmark;
+            const char* file;
+            bool        mesh;
+        };
+        const Asset assets[] =
+        {
+            { "Assets/ParseSDKMESH/skull", "skull.sdkmesh", true },
+            { "Assets/ParseDDS/cubemap", "cubemap.dds", false },
+            { "Assets/ParseDDS/porcelain", "porcelain.dds", false },
+            { "Assets/ParseDDS/roomtexture", "roomtexture.dds", false },
+        };
+
+        for (const Asset& asset : assets)
+        {
+            if (!runner.IsSelected(asset.benchmark))
+            {
+                continue;
+            }
+
+            // Parsing only; the file is read once up front.
+            std::vector<uint8_t> blob;
+            try
+            {
+                blob = ReadBinaryFile(assetDirectory + "/" + asset.file);
+            }
+            catch (const std::exception& e)
+            {
+                fprintf(stderr, "Skipping %s: %s\n", asset.benchmark, e.what());
+                continue;
+            }
+
+            BenchmarkResult* result = runner.Run(asset.benchmark, 1, [&]()
+            {
+                if (asset.mesh)
+                {
+                    MeshData mesh = LoadSDKMESHFromMemory(blob.data(), blob.size());
+                    DoNotOptimize(mesh.vertices.data());
+                }
+                else
+                {
+                    TextureData texture = LoadDDSFromMemory(blob.data(), blob.size());
+                    DoNotOptimize(texture.pixels.data());
+                }
+            });
+
+            result->AddCounter("fileBytes", double(blob.size()));
+            result->AddCounter("megabytesPerSecond", double(blob.size()) / result->medianNanoseconds * 1e3);
+        }
+    }
+
+    void BenchmarkGeometry(BenchmarkRunner& runner, JobSystem& jobs)
+    {
+        // The scene's primitives plus the finer spheres a level might add.
+        const PrimitiveKey keys[] =
+        {
+            PrimitiveKey::Box(Float3{ 20.f, 8.f, 20.f }, false, true),
+            PrimitiveKey::Sphere(),
+            PrimitiveKey::Teapot(),
+            PrimitiveKey::Sphere(1.f, 32),
+            PrimitiveKey::Sphere(1.f, 64),
+            PrimitiveKey::Teapot(1.f, 16),
+        };
+        const uint32_t keyCount = uint32_t(sizeof(keys) / sizeof(keys[0]));
+
+        GeometryCache cache;
+
+        // What device creation used to pay every time.
+        BenchmarkResult* result = runner.Run("Geometry/ColdPrefetch", keyCount, [&]()
+        {
+            cache.Clear();
+            cache.Prefetch(keys, keyCount, jobs);
+        });
+        if (result)
+        {
+            // Summed across threads, so above the wall time once jobs overlap.
+            const GeometryCacheStats& stats = cache.GetStats();
+            result->AddCounter("generationNanosecondsPerKey", double(stats.generationNanoseconds) / stats.misses);
+            result->AddCounter("residentBytes", double(stats.residentBytes));
+            result->AddCounter("threads", jobs.GetThreadCount());
+        }
+
+        // What it pays now, after the first device.
+        cache.Clear();
+        cache.Prefetch(keys, keyCount, jobs);
+        cache.ResetStats();
+        result = runner.Run("Geometry/WarmGet", keyCount, [&]()
+        {
+            for (const PrimitiveKey& key : keys)
+            {
+                DoNotOptimize(cache.Get(key).vertices.data());
+            }
+        });
+        if (result)
+        {
+            const GeometryCacheStats& stats = cache.GetStats();
+            result->AddCounter("hits", stats.hits);
+            result->AddCounter("misses", stats.misses);
+            result->AddCounter("residentBytes", double(stats.residentBytes));
+        }
+    }
+
+    // Collects the expectations of a one-off pass/fail result. Each failed
+    // one is reported to the runner as it happens; Finish adds the result,
+    // timed per check, with the number of checks and whether all passed.
+    class CheckList
+    {
+    public:
+        CheckList(BenchmarkRunner& runner, const char* name) :
+            m_runner(runner),
+            m_name(name),
+            m_checks(0),
+            m_failed(0),
+            m_start(std::chrono::steady_clock::now())
+        {
+        }
+
+        void Expect(bool condition, const char* what)
+        {
+            ++m_checks;
+            if (!condition)
+            {
+                ++m_failed;
+                m_runner.AddFailure(m_name, what);
+            }
+        }
+
+        BenchmarkResult* Finish()
+        {
+            auto elapsed = std::chrono::steady_clock::now() - m_start;
+            std::vector<double> samples(1, double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / m_checks);
+            BenchmarkResult* result = m_runner.AddResult(m_name, m_checks, samples);
+            result->AddCounter("checks", m_checks);
+            result->AddCounter("passed", m_failed == 0 ? 1 : 0);
+            return result;
+        }
+
+    private:
+        BenchmarkRunner&                        m_runner;
+        const char*                             m_name;
+        uint32_t                                m_checks;
+        uint32_t                                m_failed;
+        std::chrono::steady_clock::time_point   m_start;
+    };
+
+    // Every fixture decoded and compared byte for byte with its expected
+    // pixels. They cover what EncodeBMP and EncodePNG never write: dynamic
+    // and stored deflate blocks, split IDATs, every filter, palettes with
+    // tRNS, colour keys, sub-byte and 16-bit depths, and 1 to 32-bit BMPs
+    // with core, info and v5 headers.
+    void CheckImageFixtures(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        const char* name = "Image/Decode/Fixtures";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        CheckList checks(runner, name);
+        for (const char* fixture : IMAGE_FIXTURES)
+        {
+            const std::string path = assetDirectory + "/" + IMAGE_FIXTURE_DIRECTORY + "/" + fixture;
+            bool matches = false;
+            try
+            {
+                const std::vector<uint8_t> file = ReadBinaryFile(path);
+                const std::vector<uint8_t> expected = ReadBinaryFile(path.substr(0, path.size() - 4) + ".rgba");
+                const ImageInfo info = ReadImageInfo(file.data(), file.size());
+                std::vector<uint8_t> decoded(size_t(info.width) * info.height * 4);
+                DecodeImage(file.data(), file.size(), decoded.data(), info.width * 4);
+                matches = decoded == expected;
+            }
+            catch (const std::exception& e)
+            {
+                fprintf(stderr, "%s: %s\n", fixture, e.what());
+            }
+            checks.Expect(matches, (std::string(fixture) + " did not decode to its expected pixels").c_str());
+        }
+        checks.Finish();
+    }
+
+    void BenchmarkImageDecoding(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        // The shipped textures, decoded to RGBA8 and written back out through
+        // ImageFile, then decoded again into one reused surface. Items are
+        // pixels; matches says the decode gave back exactly what was written
+        // (BMP drops alpha, so it compares against 255 there).
+        const char* const textures[] = { "roomtexture", "porcelain" };
+        const char* const formats[] = { "BMP", "PNG" };
+
+        for (const char* texture : textures)
+        {
+            TextureData source;
+            for (uint32_t format = 0; format < 2; ++format)
+            {
+                std::string name = std::string("Image/Decode") + formats[format] + "/" + texture;
+                if (!runner.IsSelected(name.c_str()))
+                {
+                    continue;
+                }
+                if (source.pixels.empty())
+                {
+                    source = GenerateMips(LoadDDSFromFile(assetDirectory + "/" + texture + ".dds"),
+                        MipOptions{ MipFilter::Box, false, 0.f, 1 });
+                }
+
+                const uint32_t width = source.desc.width;
+                const uint32_t height = source.desc.height;
+                const uint32_t* pixels = reinterpret_cast<const uint32_t*>(source.pixels.data());
+                const std::vector<uint8_t> file = format == 0
+                    ? EncodeBMP(width, height, pixels)
+                    : EncodePNG(width, height, pixels);
+
+                std::vector<uint32_t> decoded(size_t(width) * height);
+                BenchmarkResult* result = runner.Run(name.c_str(), uint64_t(width) * height, [&]()
+                {
+                    DecodeImage(file.data(), file.size(), decoded.data(), width * 4);
+                    DoNotOptimize(decoded.data());
+                });
+
+                const uint32_t alphaMask = format == 0 ? 0xFF000000u : 0;
+                bool matches = true;
+                for (size_t i = 0; i < decoded.size(); ++i)
+                {
+                    matches = matches && decoded[i] == (pixels[i] | alphaMask);
+                }
+                result->AddCounter("fileKB", file.size() / 1024.0);
+                result->AddCounter("decodedMBPerSecond", 4e3 / result->medianNanoseconds);
+                result->AddCounter("matches", matches ? 1 : 0);
+                if (!matches)
+                {
+                    runner.AddFailure(name, "decoded pixels differ from the encoded texture");
+                }
+            }
+        }
+
+        CheckImageFixtures(runner, assetDirectory);
+    }
+
+    void BenchmarkMipGeneration(BenchmarkRunner& runner, const std::string& assetDirectory, JobSystem& jobs)
+    {
+        // Every shipped texture through every filter, items being source
+        // texels. The BC textures are decoded first, as an import would.
+        const char* const textures[] = { "roomtexture", "porcelain", "cubemap" };
+        const char* const filterNames[] = { "Box", "Kaiser", "Lanczos" };
+
+        for (const char* texture : textures)
+        {
+            std::string path = assetDirectory + "/" + texture + ".dds";
+            TextureData source;
+            for (uint32_t filter = 0; filter < 3; ++filter)
+            {
+                std::string name = std::string("Mips/") + texture + "/" + filterNames[filter];
+                if (!runner.IsSelected(name.c_str()))
+                {
+                    continue;
+                }
+                if (source.pixels.empty())
+                {
+                    source = LoadDDSFromFile(path);
+                }
+
+                const MipOptions options = { MipFilter(filter), true, 0.f, 0 };
+                const uint64_t texels = uint64_t(source.desc.width) * source.desc.height * source.desc.arraySize;
+                TextureData mips;
+                BenchmarkResult* result = runner.Run(name.c_str(), texels, [&]()
+                {
+                    mips = GenerateMips(source, options, &jobs);
+                    DoNotOptimize(mips.pixels.data());
+                });
+                result->AddCounter("sourceMBPerSecond", 4e3 / result->medianNanoseconds);
+                result->AddCounter("mipLevels", mips.desc.mipLevels);
+                result->AddCounter("threads", jobs.GetThreadCount());
+            }
+        }
+
+        // The widest filter on one thread, against the jobified run above,
+        // and the slowest path: alpha coverage kept on every level.
+        if (runner.IsSelected("Mips/cubemap/Lanczos/OneThread") || runner.IsSelected("Mips/porcelain/AlphaCoverage"))
+        {
+            TextureData cubemap = LoadDDSFromFile(assetDirectory + "/cubemap.dds");
+            TextureData mips;
+            BenchmarkResult* result = runner.Run("Mips/cubemap/Lanczos/OneThread", uint64_t(cubemap.desc.width) * cubemap.desc.height * 6, [&]()
+            {
+                mips = GenerateMips(cubemap, MipOptions{ MipFilter::Lanczos, true, 0.f, 0 });
+                DoNotOptimize(mips.pixels.data());
+            });
+            if (result)
+            {
+                result->AddCounter("sourceMBPerSecond", 4e3 / result->medianNanoseconds);
+            }
+
+            TextureData porcelain = LoadDDSFromFile(assetDirectory + "/porcelain.dds");
+            result = runner.Run("Mips/porcelain/AlphaCoverage", uint64_t(porcelain.desc.width) * porcelain.desc.height, [&]()
+            {
+                mips = GenerateMips(porcelain, MipOptions{ MipFilter::Kaiser, true, 0.5f, 0 }, &jobs);
+                DoNotOptimize(mips.pixels.data());
+            });
+            if (result)
+            {
+                result->AddCounter("sourceMBPerSecond", 4e3 / result->medianNanoseconds);
+            }
+        }
+    }
+
+    void BenchmarkEnvironment(BenchmarkRunner& runner, const std::string& assetDirectory, JobSystem& jobs)
+    {
+        // The shipped cubemap's GGX chain, items being texels filtered below
+        // mip zero, with the jobs and on one thread; then its irradiance,
+        // items being source texels.
+        const bool prefilter = runner.IsSelected("Environment/Prefilter/cubemap")
+            || runner.IsSelected("Environment/Prefilter/cubemap/OneThread");
+        const bool irradiance = runner.IsSelected("Environment/IrradianceSH/cubemap");
+        if (!prefilter && !irradiance)
+        {
+            return;
+        }
+
+        const TextureData cubemap = LoadDDSFromFile(assetDirectory + "/cubemap.dds");
+        const PrefilterOptions options = { 64, 0, true };
+
+        uint64_t filteredTexels = 0;
+        for (uint32_t size = cubemap.desc.width / 2; size > 0; size /= 2)
+        {
+            filteredTexels += uint64_t(size) * size * 6;
+        }
+
+        TextureData chain;
+        BenchmarkResult* result = runner.Run("Environment/Prefilter/cubemap", filteredTexels, [&]()
+        {
+            chain = PrefilterEnvironment(cubemap, options, &jobs);
+            DoNotOptimize(chain.pixels.data());
+        });
+        if (result)
+        {
+            result->AddCounter("samplesPerTexel", options.sampleCount);
+            result->AddCounter("mipLevels", chain.desc.mipLevels);
+            result->AddCounter("threads", jobs.GetThreadCount());
+        }
+
+        result = runner.Run("Environment/Prefilter/cubemap/OneThread", filteredTexels, [&]()
+        {
+            chain = PrefilterEnvironment(cubemap, options);
+            DoNotOptimize(chain.pixels.data());
+        });
+        if (result)
+        {
+            result->AddCounter("samplesPerTexel", options.sampleCount);
+        }
+
+        IrradianceSH sh = {};
+        result = runner.Run("Environment/IrradianceSH/cubemap", uint64_t(cubemap.desc.width) * cubemap.desc.height * 6, [&]()
+        {
+            sh = ComputeIrradianceSH(cubemap, true, &jobs);
+            DoNotOptimize(&sh);
+        });
+        if (result)
+        {
+            // The coefficients must not depend on how the rows were shared out.
+            const IrradianceSH serial = ComputeIrradianceSH(cubemap, true);
+            const Float3 average = sh.GetAverage();
+            result->AddCounter("threads", jobs.GetThreadCount());
+            result->AddCounter("deterministic", memcmp(&serial, &sh, sizeof(sh)) == 0 ? 1 : 0);
+            result->AddCounter("averageLuminance", 0.2126f * average.x + 0.7152f * average.y + 0.0722f * average.z);
+        }
+    }
+
+    void BenchmarkLightClustering(BenchmarkRunner& runner, JobSystem& jobs)
+    {
+        // Lights binned into a 16x9x24 grid under the scene's projection,
+        // seen from the middle of the room; items are lights. The busiest
+        // cluster holds about 1.7k lights at 16384, so the cap leaves room
+        // for every count and any dropped assignment is a failure.
+        const ClusterGridSettings settings = { 16, 9, 24, 0.5f, 0.f, 2048 };
+        const Matrix44 projection = Matrix44::CreatePerspectiveFieldOfViewRH(70.f * 3.14159265f / 180.f, 16.f / 9.f, 0.01f, 100.f);
+        const Matrix44 view = Matrix44::CreateLookAtRH(Float3{ 0.f, 0.5f, 5.5f }, Float3{ 0.f, 0.f, 0.f }, Float3{ 0.f, 1.f, 0.f });
+
+        const uint32_t counts[] = { 256, 1024, 4096, 16384 };
+        for (uint32_t count : counts)
+        {
+            const std::string name = "Lights/Assign/" + std::to_string(count);
+            if (!runner.IsSelected(name.c_str()))
+            {
+                continue;
+            }
+
+            const std::vector<DynamicLight> lights = CreateLightField(count);
+            LightClusterer clusterer(jobs, settings);
+            clusterer.SetProjection(projection);
+            BenchmarkResult* result = runner.Run(name.c_str(), count, [&]()
+            {
+                clusterer.Assign(view, lights.data(), count);
+                DoNotOptimize(clusterer.GetLightIndices().data());
+            });
+
+            const ClusterStats& stats = clusterer.GetStats();
+            result->AddCounter("lightsVisible", stats.lightsVisible);
+            result->AddCounter("lightsPerCluster", double(stats.assignments) / clusterer.GetClusterCount());
+            result->AddCounter("maxLightsInCluster", stats.maxLightsInCluster);
+            result->AddCounter("testsPerVisibleLight", stats.lightsVisible ? double(stats.clusterTests) / stats.lightsVisible : 0.0);
+            result->AddCounter("droppedAssignments", stats.droppedAssignments);
+            result->AddCounter("threads", jobs.GetThreadCount());
+            if (stats.droppedAssignments != 0)
+            {
+                runner.AddFailure(name, std::to_string(stats.droppedAssignments) + " light assignments dropped past the cluster cap");
+            }
+        }
+    }
+
+    void BenchmarkParticles(BenchmarkRunner& runner, JobSystem& jobs)
+    {
+        // A fountain held at about a million particles: each 60 Hz tick
+        // emits a 120th of them and about as many die, so items are live
+        // particles and tickBudgetFraction is the share of a 16.7 ms frame.
+        const char* tickName = "Particles/Tick/1M";
+        const char* additiveName = "Particles/Vertices/Additive/1M";
+        const char* sortedName = "Particles/Vertices/Sorted/1M";
+        if (!runner.IsSelected(tickName) && !runner.IsSelected(additiveName) && !runner.IsSelected(sortedName))
+        {
+            return;
+        }
+
+        const uint32_t target = 1u << 20;
+        const uint32_t emitPerTick = target / 120;
+        const float tick = 1.f / 60.f;
+        ParticleEmitter emitter = {};
+        emitter.extents = Float3{ 0.2f, 0.f, 0.2f };
+        emitter.velocity = Float3{ 0.f, 3.f, 0.f };
+        emitter.velocitySpread = Float3{ 1.f, 0.5f, 1.f };
+        emitter.lifetime = 2.f;
+        emitter.lifetimeSpread = 0.5f;
+        emitter.size = 0.01f;
+        emitter.color = Float4{ 1.f, 0.6f, 0.2f, 0.5f };
+
+        ParticleSystem particles(jobs, target + target / 4);
+        particles.SetForces(Float3{ 0.f, -2.f, 0.f }, 0.1f);
+        for (uint32_t i = 0; i < 150; ++i)
+        {
+            particles.Emit(emitter, emitPerTick);
+            particles.Update(tick);
+        }
+
+        auto addCounters = [&](BenchmarkResult* result, uint64_t items)
+        {
+            result->AddCounter("alive", particles.GetCount());
+            result->AddCounter("threads", jobs.GetThreadCount());
+            result->AddCounter("tickBudgetFraction", result->medianNanoseconds * items / (tick * 1e9));
+        };
+
+        uint64_t items = particles.GetCount();
+        BenchmarkResult* result = runner.Run(tickName, items, [&]()
+        {
+            particles.Emit(emitter, emitPerTick);
+            particles.Update(tick);
+        });
+        if (result)
+        {
+            addCounters(result, items);
+            result->AddCounter("diedPerTick", particles.GetStats().died);
+            result->AddCounter("dropped", particles.GetStats().dropped);
+        }
+
+        const Matrix44 view = Matrix44::CreateLookAtRH(Float3{ 0.f, 2.f, 8.f }, Float3{ 0.f, 2.f, 0.f }, Float3{ 0.f, 1.f, 0.f });
+        std::vector<ColorVertex> vertices(size_t(particles.GetCapacity()) * ParticleSystem::VerticesPerParticle);
+        items = particles.GetCount();
+        result = runner.Run(additiveName, items, [&]()
+        {
+            particles.WriteVertices(view, ParticleOrder::Unsorted, vertices.data());
+            DoNotOptimize(vertices.data());
+        });
+        if (result)
+        {
+            addCounters(result, items);
+        }
+
+        result = runner.Run(sortedName, items, [&]()
+        {
+            particles.WriteVertices(view, ParticleOrder::BackToFront, vertices.data());
+            DoNotOptimize(vertices.data());
+        });
+        if (result)
+        {
+            // Every quad must sit no nearer the camera than the next one.
+            uint32_t ordered = 1;
+            for (size_t i = ParticleSystem::VerticesPerParticle; i < size_t(items) * ParticleSystem::VerticesPerParticle && ordered; i += ParticleSystem::VerticesPerParticle)
+            {
+                const ColorVertex* previous = &vertices[i - ParticleSystem::VerticesPerParticle];
+                const ColorVertex* current = &vertices[i];
+                const float previousZ = (previous[0].position.z + previous[2].position.z) * 0.5f;
+                const float currentZ = (current[0].position.z + current[2].position.z) * 0.5f;
+                ordered = previousZ <= currentZ + 1e-4f ? 1 : 0;
+            }
+            addCounters(result, items);
+            result->AddCounter("ordered", ordered);
+        }
+    }
+
+    void BenchmarkBroadphase(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        // Boxes drifting and bouncing around a cube sized for about the same
+        // crowding at every count; each repetition is one 60 Hz step, moves
+        // included, and items are bodies.
+        const uint32_t counts[] = { 1000, 10000, 100000 };
+        const char* names[] = { "Broadphase/SweepAndPrune/1k", "Broadphase/SweepAndPrune/10k", "Broadphase/SweepAndPrune/100k" };
+        for (uint32_t c = 0; c < 3; ++c)
+        {
+            if (!runner.IsSelected(names[c]))
+            {
+                continue;
+            }
+
+            const uint32_t count = counts[c];
+            const float side = 2.5f * std::cbrt(float(count));
+            const float step = 1.f / 60.f;
+            uint32_t seed = 1;
+            auto next = [&seed]()
+            {
+                seed = seed * 1664525u + 1013904223u;
+                return float(seed >> 8) / float(1u << 24);
+            };
+
+            std::vector<Float3> positions(count), velocities(count), halfSizes(count);
+            SweepAndPrune broadphase;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                positions[i] = Float3{ next() * side, next() * side, next() * side };
+                velocities[i] = Float3{ next() * 2.f - 1.f, next() * 2.f - 1.f, next() * 2.f - 1.f };
+                halfSizes[i] = Float3{ 0.25f + next() * 0.5f, 0.25f + next() * 0.5f, 0.25f + next() * 0.5f };
+                broadphase.AddBody(BroadphaseBox{ positions[i] - halfSizes[i], positions[i] + halfSizes[i] });
+            }
+            broadphase.Update();
+
+            uint64_t steps = 0, added = 0, removed = 0, swaps = 0;
+            BenchmarkResult* result = runner.Run(names[c], count, [&]()
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    Float3& position = positions[i];
+                    Float3& velocity = velocities[i];
+                    position += velocity * step;
+                    velocity.x = (position.x < 0.f || position.x > side) ? -velocity.x : velocity.x;
+                    velocity.y = (position.y < 0.f || position.y > side) ? -velocity.y : velocity.y;
+                    velocity.z = (position.z < 0.f || position.z > side) ? -velocity.z : velocity.z;
+                    broadphase.SetBounds(i, BroadphaseBox{ position - halfSizes[i], position + halfSizes[i] });
+                }
+                broadphase.Update();
+
+                const BroadphaseStats& stats = broadphase.GetStats();
+                ++steps;
+                added += stats.added;
+                removed += stats.removed;
+                swaps += stats.swaps;
+            });
+
+            const BroadphaseStats& stats = broadphase.GetStats();
+            result->AddCounter("pairs", stats.pairs);
+            result->AddCounter("addedPerStep", double(added) / steps);
+            result->AddCounter("removedPerStep", double(removed) / steps);
+            result->AddCounter("swapsPerBody", double(swaps) / steps / count);
+            if (count <= 10000)
+            {
+                // The incremental pair set must match testing every pair.
+                uint32_t overlapping = 0;
+                bool found = true;
+                for (uint32_t a = 0; a < count; ++a)
+                {
+                    const BroadphaseBox& boxA = broadphase.GetBounds(a);
+                    for (uint32_t b = a + 1; b < count; ++b)
+                    {
+                        const BroadphaseBox& boxB = broadphase.GetBounds(b);
+                        if (boxA.min.x <= boxB.max.x && boxB.min.x <= boxA.max.x
+                            && boxA.min.y <= boxB.max.y && boxB.min.y <= boxA.max.y
+                            && boxA.min.z <= boxB.max.z && boxB.min.z <= boxA.max.z)
+                        {
+                            ++overlapping;
+                            found = found && broadphase.HasPair(a, b);
+                        }
+                    }
+                }
+                const bool matches = found && overlapping == stats.pairs;
+                result->AddCounter("matches", matches ? 1 : 0);
+                if (!matches)
+                {
+                    runner.AddFailure(names[c], std::to_string(overlapping) + " overlapping pairs by brute force, "
+                        + std::to_string(stats.pairs) + " in the broadphase" + (found ? "" : ", some missing"));
+                }
+            }
+        }
+
+        // The scene's skull, globe and teapot, and a box around the camera,
+        // over ten seconds of animation; items are steps.
+        if (runner.IsSelected("Broadphase/Scene"))
+        {
+            const HeadlessScene::DrawId objects[] = { HeadlessScene::DrawSkull, HeadlessScene::DrawEarth, HeadlessScene::DrawTeapot };
+            const uint32_t steps = 600;
+            const Float3 cameraExtents = { 1.5f, 1.5f, 1.5f };
+
+            NullGraphicsBackend backend;
+            HeadlessScene scene;
+            scene.CreateResources(backend, assetDirectory);
+
+            uint64_t added = 0, removed = 0;
+            BenchmarkResult* result = runner.Run("Broadphase/Scene", steps, [&]()
+            {
+                SweepAndPrune broadphase;
+                scene.Update(0.0);
+                for (HeadlessScene::DrawId id : objects)
+                {
+                    broadphase.AddBody(ComputeWorldBox(scene.GetWorld(id), scene.GetBoundsCenter(id), scene.GetBoundsExtents(id)));
+                }
+                const uint32_t camera = broadphase.AddBody(BroadphaseBox{ scene.GetCameraPosition() - cameraExtents, scene.GetCameraPosition() + cameraExtents });
+                broadphase.Update();
+
+                added = removed = 0;
+                for (uint32_t i = 1; i <= steps; ++i)
+                {
+                    scene.Update(i / 60.0);
+                    for (uint32_t body = 0; body < 3; ++body)
+                    {
+                        broadphase.SetBounds(body, ComputeWorldBox(scene.GetWorld(objects[body]), scene.GetBoundsCenter(objects[body]), scene.GetBoundsExtents(objects[body])));
+                    }
+                    broadphase.SetBounds(camera, BroadphaseBox{ scene.GetCameraPosition() - cameraExtents, scene.GetCameraPosition() + cameraExtents });
+                    broadphase.Update();
+                    added += broadphase.GetStats().added;
+                    removed += broadphase.GetStats().removed;
+                }
+            });
+            if (result)
+            {
+                result->AddCounter("pairsAdded", double(added));
+                result->AddCounter("pairsRemoved", double(removed));
+            }
+            scene.ReleaseResources(backend);
+        }
+    }
+
+    void BenchmarkRenderQueue(BenchmarkRunner& runner)
+    {
+        const char* name = "RenderQueue/SortAndExecute";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        // Synthetic draws in two layers of four passes, over 16 shaders and
+        // 64 materials at random depths, submitted in random order; items
+        // are commands.
+        const uint32_t commandCount = 10000;
+        std::vector<uint64_t> keys(commandCount);
+        uint32_t seed = 1;
+        for (uint64_t& key : keys)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            const uint32_t bits = seed;
+            seed = seed * 1664525u + 1013904223u;
+            key = RenderKey::Make(bits >> 31, (bits >> 29) & 3, (bits >> 25) & 15, (bits >> 19) & 63, seed);
+        }
+
+        RenderQueue queue;
+        queue.Reserve(commandCount);
+        NullRenderCommandExecutor executor;
+        BenchmarkResult* result = runner.Run(name, commandCount, [&]()
+        {
+            queue.Reset();
+            for (uint32_t i = 0; i < commandCount; ++i)
+            {
+                queue.Submit(keys[i], i);
+            }
+            queue.Sort();
+            executor = NullRenderCommandExecutor();
+            queue.Execute(executor);
+        });
+
+        const RenderQueueStats& stats = queue.GetStats();
+        result->AddCounter("sortNanosecondsPerCommand", double(stats.sortNanoseconds) / commandCount);
+        result->AddCounter("radixPasses", stats.radixPasses);
+        result->AddCounter("passChanges", stats.passChanges);
+        result->AddCounter("shaderChanges", stats.shaderChanges);
+        result->AddCounter("materialChanges", stats.materialChanges);
+        result->AddCounter("redundantChangesSkipped", stats.redundantChangesSkipped);
+
+        const RenderCommand* commands = queue.GetCommands();
+        for (uint32_t i = 1; i < commandCount; ++i)
+        {
+            if (commands[i - 1].key > commands[i].key)
+            {
+                runner.AddFailure(name, "commands out of key order after Sort");
+                break;
+            }
+        }
+        if (executor.drawCalls != commandCount || executor.passCalls != stats.passChanges
+            || executor.shaderCalls != stats.shaderChanges || executor.materialCalls != stats.materialChanges)
+        {
+            runner.AddFailure(name, "executor calls do not match the queue's stats");
+        }
+    }
+
+    bool operator==(const BackendStats& a, const BackendStats& b)
+    {
+        return a.drawCalls == b.drawCalls && a.trianglesSubmitted == b.trianglesSubmitted
+            && a.pipelineBinds == b.pipelineBinds && a.bufferBinds == b.bufferBinds
+            && a.textureBinds == b.textureBinds && a.bufferUpdates == b.bufferUpdates
+            && a.bytesUploaded == b.bytesUploaded;
+    }
+
+    void BenchmarkCommandStream(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        const char* name = "CommandStream/Replay";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        // The scene's resources and a few frames recorded through a null
+        // backend, then replayed into a fresh one; items are frames.
+        const uint32_t frames = 10;
+        NullGraphicsBackend live;
+        uint64_t streamBytes = 0;
+        {
+            RecordingGraphicsBackend recorder(live, COMMAND_STREAM_FILE);
+            HeadlessScene scene;
+            scene.CreateResources(recorder, assetDirectory);
+            RunScene(scene, recorder, 0, frames);
+            scene.ReleaseResources(recorder);
+            recorder.Flush();
+            streamBytes = recorder.GetBytesWritten();
+        }
+
+        uint32_t replayedFrames = 0, replayedBackendFrames = 0, replayedResources = 0;
+        BackendStats replayedStats = {};
+        BenchmarkResult* result = runner.Run(name, frames, [&]()
+        {
+            NullGraphicsBackend replayed;
+            replayedFrames = ReplayCommandStream(COMMAND_STREAM_FILE, replayed);
+            replayedBackendFrames = replayed.GetFrameCount();
+            replayedResources = replayed.GetLiveResourceCount();
+            replayedStats = replayed.GetTotalStats();
+        }, 5);
+        std::remove(COMMAND_STREAM_FILE);
+
+        result->AddCounter("streamBytes", double(streamBytes));
+        result->AddCounter("drawCalls", live.GetTotalStats().drawCalls);
+        result->AddCounter("bytesUploaded", double(live.GetTotalStats().bytesUploaded));
+
+        // The stream must reproduce every call the live frames made.
+        if (replayedFrames != frames || replayedBackendFrames != live.GetFrameCount())
+        {
+            runner.AddFailure(name, "replayed " + std::to_string(replayedFrames) + " frames of " + std::to_string(frames));
+        }
+        if (!(replayedStats == live.GetTotalStats()))
+        {
+            runner.AddFailure(name, "replayed draw, bind or upload counts differ from the live frames");
+        }
+        if (replayedResources != 0 || live.GetLiveResourceCount() != 0)
+        {
+            runner.AddFailure(name, "resources left alive after the scene released them");
+        }
+    }
+
+    struct ReferenceComparison
+    {
+        uint32_t mismatchedPixels;
+        uint32_t maxDifference;
+    };
+
+    // Renders the scene's first step into backend, saves it to
+    // saveDirectory if one is given, and compares it against the reference
+    // frame. Call before the scene has been updated.
+    ReferenceComparison CheckReferenceFrame(BenchmarkRunner& runner, const char* name, HeadlessScene& scene,
+        SoftwareGraphicsBackend& backend, const std::string& assetDirectory, const std::string& saveDirectory)
+    {
+        scene.Update(STEP_SECONDS);
+        scene.Render(backend);
+        backend.Flush();
+
+        const uint32_t width = backend.GetWidth(), height = backend.GetHeight();
+        std::vector<uint32_t> pixels(size_t(width) * height);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            memcpy(&pixels[size_t(y) * width], backend.GetColorBuffer() + size_t(y) * backend.GetPitch(), width * sizeof(uint32_t));
+        }
+        if (!saveDirectory.empty())
+        {
+            std::string file = name;
+            std::replace(file.begin(), file.end(), '/', '_');
+            SavePNGToFile(saveDirectory + "/" + file + ".png", width, height, pixels.data());
+        }
+
+        const TextureData reference = LoadImageFromFile(assetDirectory + "/" + REFERENCE_FRAME_FILE);
+        if (reference.desc.width != width || reference.desc.height != height)
+        {
+            runner.AddFailure(name, "frame size differs from the reference frame");
+            return ReferenceComparison{ width * height, 255 };
+        }
+
+        const TextureSurface& surface = reference.GetSurface(0, 0);
+        uint32_t mismatched = 0, maxDifference = 0;
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* expected = reference.GetSurfacePixels(0, 0) + size_t(y) * surface.rowPitch;
+            const uint8_t* actual = reinterpret_cast<const uint8_t*>(&pixels[size_t(y) * width]);
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint32_t difference = 0;
+                for (uint32_t channel = 0; channel < 3; ++channel)
+                {
+                    const int delta = int(actual[x * 4 + channel]) - int(expected[x * 4 + channel]);
+                    difference = std::max(difference, uint32_t(delta < 0 ? -delta : delta));
+                }
+                maxDifference = std::max(maxDifference, difference);
+                mismatched += difference > REFERENCE_TOLERANCE ? 1 : 0;
+            }
+        }
+
+        if (mismatched > REFERENCE_MAX_MISMATCHED * width * height)
+        {
+            runner.AddFailure(name, std::to_string(mismatched) + " pixels differ from " + REFERENCE_FRAME_FILE);
+        }
+        return ReferenceComparison{ mismatched, maxDifference };
+    }
+
+    void BenchmarkFrames(BenchmarkRunner& runner, const std::string& assetDirectory, const std::string& saveDirectory, JobSystem& jobs)
+    {
+        const uint32_t nullFrames = 60;
+        const uint32_t softwareFrames = 5;
+
+        if (runner.IsSelected("Frame/NullBackend"))
+        {
+            NullGraphicsBackend backend;
+            HeadlessScene scene;
+            scene.CreateResources(backend, assetDirectory);
+            RunScene(scene, backend, 0, SCENE_WARMUP_FRAMES);
+
+            uint32_t frame = SCENE_WARMUP_FRAMES;
+            BenchmarkResult* result = runner.Run("Frame/NullBackend", nullFrames, [&]()
+            {
+                RunScene(scene, backend, frame, nullFrames);
+                frame += nullFrames;
+            });
+
+            const RenderQueueStats& queue = scene.GetQueueStats();
+            result->AddCounter("drawCalls", double(backend.GetFrameStats().drawCalls));
+            result->AddCounter("framesPerSecond", 1e9 / result->medianNanoseconds);
+            result->AddCounter("queueCommands", queue.commands);
+            result->AddCounter("queueSortNanoseconds", double(queue.sortNanoseconds));
+            result->AddCounter("passChanges", queue.passChanges);
+            result->AddCounter("shaderChanges", queue.shaderChanges);
+            result->AddCounter("materialChanges", queue.materialChanges);
+            result->AddCounter("frameArenaHighWaterBytes", double(scene.GetFrameArena().GetHighWaterBytes()));
+            result->AddCounter("frameArenaOverflows", scene.GetFrameArena().GetOverflowCount());
+            scene.ReleaseResources(backend);
+        }
+
+        // Software rasterizer at the game's default 800x600, with and
+        // without props culled behind the globe.
+        for (int occlusion = 0; occlusion < 2; ++occlusion)
+        {
+            const char* name = occlusion ? "Frame/SoftwareOcclusion" : "Frame/Software";
+            if (!runner.IsSelected(name))
+            {
+                continue;
+            }
+
+            SoftwareGraphicsBackend backend(jobs);
+            OcclusionCuller culler(jobs);
+            HeadlessScene scene;
+            scene.CreateResources(backend, assetDirectory);
+            if (occlusion)
+            {
+                scene.SetOcclusionCuller(&culler);
+            }
+            const ReferenceComparison reference = CheckReferenceFrame(runner, name, scene, backend, assetDirectory, saveDirectory);
+            RunScene(scene, backend, 1, softwareFrames);
+
+            uint32_t frame = softwareFrames + 1;
+            BenchmarkResult* result = runner.Run(name, softwareFrames, [&]()
+            {
+                RunScene(scene, backend, frame, softwareFrames);
+                frame += softwareFrames;
+            }, 5);
+
+            const SoftwareRasterStats& raster = backend.GetRasterStats();
+            result->AddCounter("framesPerSecond", 1e9 / result->medianNanoseconds);
+            result->AddCounter("trianglesBinned", raster.trianglesBinned);
+            result->AddCounter("pixelsShaded", double(raster.pixelsShaded));
+            result->AddCounter("submittedDraws", scene.GetSubmittedDrawCount());
+            result->AddCounter("referenceMismatchedPixels", reference.mismatchedPixels);
+            result->AddCounter("referenceMaxDifference", reference.maxDifference);
+            if (occlusion)
+            {
+                result->AddCounter("occludeesCulled", culler.GetStats().occludeesCulled);
+                result->AddCounter("occlusionRasterMilliseconds", culler.GetStats().rasterNanoseconds / 1e6);
+            }
+            scene.ReleaseResources(backend);
+        }
+    }
+
+    struct PipelineContext
+    {
+        HeadlessScene*          scene;
+        IGraphicsBackend*       backend;
+        HeadlessScene::State    states[FramePipeline::SlotCount];
+        uint64_t                presentNanoseconds;     // Slept after each render, as a blocking Present.
+    };
+
+    void RenderPipelineSlot(void* context, uint32_t slot)
+    {
+        PipelineContext* pipeline = static_cast<PipelineContext*>(context);
+        pipeline->scene->Render(*pipeline->backend, pipeline->states[slot]);
+        if (pipeline->presentNanoseconds)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(pipeline->presentNanoseconds));
+        }
+    }
+
+    // Frames through a FramePipeline, rendering inline or on its own thread
+    // as Game's RENDER_THREAD switch does. Each Update spins for
+    // updateNanoseconds on top of the scene's own work; items are frames.
+    BenchmarkResult* RunPipeline(BenchmarkRunner& runner, const char* name, IGraphicsBackend& backend,
+        const std::string& assetDirectory, bool threaded, uint32_t frames, uint64_t updateNanoseconds, uint64_t presentNanoseconds)
+    {
+        HeadlessScene scene;
+        scene.CreateResources(backend, assetDirectory);
+        PipelineContext context = { &scene, &backend, {}, presentNanoseconds };
+        FramePipeline pipeline(&RenderPipelineSlot, &context, threaded);
+
+        uint32_t frame = 0;
+        BenchmarkResult* result = runner.Run(name, frames, [&]()
+        {
+            for (uint32_t i = 0; i < frames; ++i, ++frame)
+            {
+                uint32_t slot = pipeline.BeginWrite();
+                const auto updateEnd = std::chrono::steady_clock::now() + std::chrono::nanoseconds(updateNanoseconds);
+                scene.Update(frame * STEP_SECONDS);
+                while (std::chrono::steady_clock::now() < updateEnd)
+                {
+                }
+                context.states[slot] = scene.GetState();
+                pipeline.Publish();
+            }
+            pipeline.Flush();
+        }, 5);
+
+        FramePipelineStats stats = pipeline.GetStats();
+        result->AddCounter("frameMilliseconds", result->medianNanoseconds / 1e6);
+        result->AddCounter("updateWaitMilliseconds", stats.updateWaitNanoseconds / 1e6);
+        result->AddCounter("renderWaitMilliseconds", stats.renderWaitNanoseconds / 1e6);
+        scene.ReleaseResources(backend);
+        return result;
+    }
+
+    void BenchmarkPipeline(BenchmarkRunner& runner, const std::string& assetDirectory, JobSystem& jobs)
+    {
+        // The software rasterizer's render dominates and nothing blocks, so
+        // overlapping it with a near-free Update needs a spare core.
+        for (int threaded = 0; threaded < 2; ++threaded)
+        {
+            const char* name = threaded ? "FramePipeline/Pipelined" : "FramePipeline/Serial";
+            if (runner.IsSelected(name))
+            {
+                SoftwareGraphicsBackend backend(jobs);
+                RunPipeline(runner, name, backend, assetDirectory, threaded != 0, 5, 0, 0);
+            }
+        }
+
+        // The case the pipeline is for: a 4 ms Update and an 8 ms blocking
+        // Present on the null backend. Serial frames take both; pipelined
+        // ones hide the Update behind the Present, even on one core, and
+        // report the serial frame time next to their own.
+        const uint64_t updateNanoseconds = 4000000, presentNanoseconds = 8000000;
+        double serialMilliseconds = 0;
+        for (int threaded = 0; threaded < 2; ++threaded)
+        {
+            const char* name = threaded ? "FramePipeline/BlockingPresent/Pipelined" : "FramePipeline/BlockingPresent/Serial";
+            if (!runner.IsSelected(name))
+            {
+                continue;
+            }
+
+            NullGraphicsBackend backend;
+            BenchmarkResult* result = RunPipeline(runner, name, backend, assetDirectory, threaded != 0, 30,
+                updateNanoseconds, presentNanoseconds);
+            const double frameMilliseconds = result->medianNanoseconds / 1e6;
+            if (!threaded)
+            {
+                serialMilliseconds = frameMilliseconds;
+            }
+            else if (serialMilliseconds > 0)
+            {
+                result->AddCounter("serialFrameMilliseconds", serialMilliseconds);
+                result->AddCounter("speedup", serialMilliseconds / frameMilliseconds);
+            }
+        }
+    }
+
+    void BenchmarkReplay(BenchmarkRunner& runner, const std::string& assetDirectory, const std::string& replayPath)
+    {
+        if (!runner.IsSelected("Replay/Walkthrough"))
+        {
+            return;
+        }
+
+        // A recording from Game (-record) if given, else the built-in walk.
+        InputRecording recording = replayPath.empty() ? CreateWalkthrough() : LoadInputRecordingFromFile(replayPath);
+
+        NullGraphicsBackend backend;
+        HeadlessScene scene;
+        scene.CreateResources(backend, assetDirectory);
+
+        uint32_t frames = 0;
+        BenchmarkResult* result = runner.Run("Replay/Walkthrough", recording.ticks.size(), [&]()
+        {
+            frames = ReplayRecording(scene, backend, recording);
+        }, 5);
+
+        result->AddCounter("ticks", double(recording.ticks.size()));
+        result->AddCounter("framesRendered", frames);
+        scene.ReleaseResources(backend);
+    }
+
+    void BenchmarkSubsystems(BenchmarkRunner& runner)
+    {
+        {
+            const uint32_t framesPerRepetition = 1000;
+            const uint32_t allocationsPerFrame = 64;
+
+            // Constant-buffer sized allocations, three frames in flight and
+            // the oldest retired as each new one closes.
+            UploadRingAllocator ring(4 * 1024 * 1024, 3);
+            uint64_t fence = 0;
+
+            BenchmarkResult* result = runner.Run("UploadRing/Allocate", uint64_t(framesPerRepetition) * allocationsPerFrame, [&]()
+            {
+                for (uint32_t frame = 0; frame < framesPerRepetition; ++frame)
+                {
+                    for (uint32_t i = 0; i < allocationsPerFrame; ++i)
+                    {
+                        DoNotOptimize(ring.Allocate(192));
+                    }
+                    if (ring.GetFramesInFlight() == 3)
+                    {
+                        ring.Retire(ring.GetOldestFence());
+                    }
+                    ring.EndFrame(++fence);
+                }
+            });
+            if (result)
+            {
+                // Three frames of 64 allocations fit many times over; a
+                // refusal means the timing measured the failure path.
+                result->AddCounter("failedAllocations", double(ring.GetStats().failures));
+                result->AddCounter("wraps", double(ring.GetStats().wraps));
+                if (ring.GetStats().failures != 0)
+                {
+                    runner.AddFailure("UploadRing/Allocate", "allocations refused with space free");
+                }
+            }
+        }
+
+        {
+            const uint32_t elementCount = 10000;
+
+            HudBatcher hud;
+            ColorVertex quad[4];
+            const uint16_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                quad[i] = ColorVertex{ Float3{ float(i & 1), float(i >> 1), 0.f }, Float4{ 1.f, 1.f, 1.f, 1.f } };
+            }
+            for (uint32_t i = 0; i < elementCount; ++i)
+            {
+                hud.AddElement(i % 3, 1 + (i % 2), i % 5, quad, 4, indices, 6);
+            }
+
+            uint32_t element = 0;
+            BenchmarkResult* result = runner.Run("HudBatcher/Rebuild10k", 1, [&]()
+            {
+                hud.UpdateElement(HudElementHandle(1 + element++ % elementCount), quad, 4);
+                hud.Build();
+            });
+            if (result)
+            {
+                result->AddCounter("batches", hud.GetStats().batches);
+                result->AddCounter("vertices", hud.GetStats().vertices);
+            }
+        }
+
+        {
+            const uint32_t scopes = 1000000;
+
+            for (int enabled = 1; enabled >= 0; --enabled)
+            {
+                Profiler::SetEnabled(enabled != 0);
+                runner.Run(enabled ? "Profiler/ScopeEnabled" : "Profiler/ScopeDisabled", scopes, [&]()
+                {
+                    for (uint32_t i = 0; i < scopes; ++i)
+                    {
+                        DX_PROFILE_SCOPE("Bench");
+                    }
+                });
+            }
+            Profiler::SetEnabled(true);
+        }
+    }
+
+    // Pass/fail checks of the upload ring's bookkeeping, without a device.
+    void CheckUploadRing(BenchmarkRunner& runner)
+    {
+        const char* name = "UploadRing/Checks";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        CheckList checks(runner, name);
+        auto expect = [&](bool condition, const char* what) { checks.Expect(condition, what); };
+
+        // Random sizes over many frames, retired two frames late: every
+        // range must be aligned, inside the ring and clear of every range
+        // still in flight.
+        {
+            struct Range { uint64_t fence; uint32_t begin, end; };
+            UploadRingAllocator ring(64 * 1024, 3);
+            std::vector<Range> live;
+            uint32_t seed = 1;
+            uint64_t fence = 0, refused = 0;
+            bool aligned = true, inside = true, disjoint = true;
+            for (uint32_t frame = 0; frame < 2000; ++frame)
+            {
+                for (uint32_t i = 0; i < 8; ++i)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    const uint32_t size = 1 + (seed >> 8) % 6000;
+                    const uint32_t offset = ring.Allocate(size);
+                    if (offset == UploadRingAllocator::InvalidOffset)
+                    {
+                        ++refused;
+                        continue;
+                    }
+                    const uint32_t end = offset + size;
+                    aligned = aligned && offset % 256 == 0;
+                    inside = inside && end <= ring.GetCapacity();
+                    for (const Range& range : live)
+                    {
+                        disjoint = disjoint && (end <= range.begin || offset >= range.end);
+                    }
+                    live.push_back(Range{ fence + 1, offset, end });
+                }
+                ring.EndFrame(++fence);
+                if (fence > 2)
+                {
+                    ring.Retire(fence - 2);
+                    live.erase(std::remove_if(live.begin(), live.end(), [&](const Range& range) { return range.fence <= fence - 2; }), live.end());
+                }
+            }
+            expect(aligned, "offset not aligned to 256");
+            expect(inside, "range past the end of the ring");
+            expect(disjoint, "range overlaps one still in flight");
+            expect(refused > 0 && refused < 2000 * 8, "random frames never or always refused");
+            ring.Retire(fence);
+            expect(ring.GetUsedBytes() == 0, "bytes still used after retiring every frame");
+        }
+
+        // A 1 KB ring, four 256-byte slots.
+        {
+            UploadRingAllocator ring(1024, 3);
+            expect(ring.Allocate(512) == 0, "first allocation not at 0");
+            ring.EndFrame(1);
+            expect(ring.Allocate(256) == 512, "second frame not after the first");
+            ring.EndFrame(2);
+
+            // [512, 768) is in flight and [0, 512) belongs to fence 1: the
+            // tail end is too small and the start not yet free.
+            expect(ring.Allocate(512) == UploadRingAllocator::InvalidOffset, "wrapped over an unretired frame");
+            ring.Retire(1);
+            expect(ring.GetUsedBytes() == 256, "retire did not release the oldest frame");
+
+            // Wrapping skips [768, 1024); the frame that wrapped pays for it.
+            expect(ring.Allocate(512) == 0, "did not wrap to 0 once the start was free");
+            expect(ring.GetUsedBytes() == 1024 && ring.GetStats().wraps == 1, "wrap padding not charged");
+            ring.EndFrame(3);
+            expect(ring.Allocate(256) == UploadRingAllocator::InvalidOffset, "allocated from a full ring");
+
+            // Retiring fence 2 moves the tail to 768, freeing [512, 768) only.
+            ring.Retire(2);
+            expect(ring.GetUsedBytes() == 768, "wrap padding released with the wrong frame");
+            expect(ring.Allocate(256) == 512, "tail did not move back after retire");
+            expect(ring.Allocate(256) == UploadRingAllocator::InvalidOffset, "allocated past the tail");
+            ring.EndFrame(4);
+            ring.Retire(4);
+            expect(ring.GetUsedBytes() == 0 && ring.GetFramesInFlight() == 0, "bytes or frames left after retiring all");
+
+            // The head was at 768; an empty ring starts over.
+            expect(ring.Allocate(768) == 0, "empty ring did not restart at 0");
+        }
+
+        // One frame more than allowed in flight throws.
+        {
+            UploadRingAllocator ring(1024, 2);
+            ring.EndFrame(1);
+            ring.EndFrame(2);
+            bool threw = false;
+            try
+            {
+                ring.EndFrame(3);
+            }
+            catch (const std::runtime_error&)
+            {
+                threw = true;
+            }
+            expect(threw, "EndFrame past maxFramesInFlight did not throw");
+        }
+
+        checks.Finish();
+    }
+
+    // Pass/fail checks of the frame arena: alignment, chaining past its
+    // capacity, folding on Reset, and the render queue sorting the same
+    // with its scratch taken from one.
+    void CheckFrameArena(BenchmarkRunner& runner)
+    {
+        const char* name = "FrameArena/Checks";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        CheckList checks(runner, name);
+
+        // Odd sizes at every alignment up to 256, from a 1 KB arena: each
+        // block is aligned, keeps its bytes while later ones chain, and the
+        // frame's peak fits in one block after Reset.
+        {
+            FrameArena arena(1024);
+            std::vector<std::pair<uint8_t*, size_t>> blocks;
+            bool aligned = true;
+            for (uint32_t i = 0; i < 64; ++i)
+            {
+                const size_t alignment = size_t(1) << (i % 9);
+                const size_t size = 1 + (i * 37) % 200;
+                uint8_t* block = static_cast<uint8_t*>(arena.Allocate(size, alignment));
+                aligned = aligned && (reinterpret_cast<uintptr_t>(block) & (alignment - 1)) == 0;
+                memset(block, int(i), size);
+                blocks.push_back(std::make_pair(block, size));
+            }
+            checks.Expect(aligned, "arena allocation misaligned");
+
+            bool intact = true;
+            for (uint32_t i = 0; i < blocks.size(); ++i)
+            {
+                for (size_t b = 0; b < blocks[i].second; ++b)
+                {
+                    intact = intact && blocks[i].first[b] == uint8_t(i);
+                }
+            }
+            const uint32_t overflows = arena.GetOverflowCount();
+            checks.Expect(intact, "arena allocations overlap");
+            checks.Expect(overflows > 0 && arena.GetCapacity() > 1024, "frame past the capacity did not chain a block");
+            checks.Expect(arena.GetHighWaterBytes() >= arena.GetUsedBytes() && arena.GetUsedBytes() > 1024, "arena usage not tracked");
+
+            arena.Reset();
+            checks.Expect(arena.GetUsedBytes() == 0 && arena.GetCapacity() >= arena.GetHighWaterBytes(), "Reset did not fold the blocks");
+            for (uint32_t i = 0; i < 64; ++i)
+            {
+                arena.Allocate(1 + (i * 37) % 200, size_t(1) << (i % 9));
+            }
+            checks.Expect(arena.GetOverflowCount() == overflows, "the same frame overflowed again after Reset");
+        }
+
+        // Random keys take all eight passes; keys differing only in the low
+        // byte take one, which ends in the arena's scratch and copies back.
+        {
+            FrameArena arena(256);
+            for (uint32_t lowByteOnly = 0; lowByteOnly < 2; ++lowByteOnly)
+            {
+                RenderQueue kept, arenaSorted;
+                uint32_t seed = 7;
+                for (uint32_t i = 0; i < 1000; ++i)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    const uint64_t key = lowByteOnly ? (seed >> 24) : (uint64_t(seed) << 32 | (seed * 2654435761u));
+                    kept.Submit(key, i);
+                    arenaSorted.Submit(key, i);
+                }
+
+                arena.Reset();
+                kept.Sort();
+                arenaSorted.Sort(arena);
+
+                bool same = kept.GetStats().radixPasses == arenaSorted.GetStats().radixPasses;
+                for (size_t i = 0; same && i < kept.GetCommandCount(); ++i)
+                {
+                    same = kept.GetCommands()[i].key == arenaSorted.GetCommands()[i].key
+                        && kept.GetCommands()[i].drawId == arenaSorted.GetCommands()[i].drawId;
+                }
+                checks.Expect(same, lowByteOnly ? "arena sort with one pass differs" : "arena sort with every pass differs");
+                checks.Expect(arenaSorted.GetStats().radixPasses == (lowByteOnly ? 1u : 8u), "unexpected radix pass count");
+            }
+        }
+
+        checks.Finish();
+    }
+
+    // Input checked with synthetic events: a tap shorter than a step moves
+    // the camera by the tap's length, mouse look only turns while the left
+    // button is held, a full queue drops and counts, and the ring keeps
+    // order between two threads.
+    void CheckInput(BenchmarkRunner& runner)
+    {
+        const char* name = "Input/Checks";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        CheckList checks(runner, name);
+        const uint64_t stepTicks = InputQueue::TicksPerSecond / 60;
+
+        // W held for the second quarter of one step, from the middle of the
+        // room (Game's start sits against the wall the bounds clamp to).
+        {
+            CameraSettings settings = CAMERA_SETTINGS;
+            settings.startPosition = Float3{ 0.f, 0.f, 0.f };
+            InputQueue input;
+            CameraController camera(settings);
+            input.PushKey(CameraKey::W, true, stepTicks / 4);
+            input.PushKey(CameraKey::W, false, stepTicks / 2);
+            camera.Step(input, 0, stepTicks);
+
+            const float expected = settings.moveSpeed * float(double(stepTicks / 4) / InputQueue::TicksPerSecond);
+            const Float3 moved = camera.GetPosition();
+            checks.Expect(std::fabs(moved.z - expected) < 1e-5f && moved.x == 0 && moved.y == 0, "quarter-step tap moved the wrong distance");
+            checks.Expect(camera.GetEventsConsumed() == 2 && !camera.IsKeyDown(CameraKey::W), "tap events not consumed");
+        }
+
+        // Deltas turn the camera only between button down and up or focus loss.
+        {
+            CameraController camera(CAMERA_SETTINGS);
+            camera.Apply(InputEvent{ 0, 10, 5, InputEventType::MouseDelta, 0 });
+            checks.Expect(camera.GetYaw() == 0 && camera.GetPitch() == 0, "mouse turned the camera without the button");
+            camera.Apply(InputEvent{ 0, 0, 0, InputEventType::ButtonDown, InputButton::Left });
+            camera.Apply(InputEvent{ 0, 10, 5, InputEventType::MouseDelta, 0 });
+            checks.Expect(camera.GetYaw() == -10 * CAMERA_SETTINGS.rotationGain && camera.GetPitch() == -5 * CAMERA_SETTINGS.rotationGain,
+                "mouse look turned the wrong amount");
+            camera.Apply(InputEvent{ 0, 0, 0, InputEventType::FocusLost, 0 });
+            const float yaw = camera.GetYaw();
+            camera.Apply(InputEvent{ 0, 10, 5, InputEventType::MouseDelta, 0 });
+            checks.Expect(!camera.IsLooking() && camera.GetYaw() == yaw, "mouse look survived focus loss");
+        }
+
+        // Eight slots: the next four pushes are dropped and counted, and
+        // the first eight come out in order.
+        {
+            InputQueue input(8);
+            uint32_t accepted = 0;
+            for (int32_t i = 0; i < 12; ++i)
+            {
+                accepted += input.PushMouseDelta(i, 0, uint64_t(i)) ? 1 : 0;
+            }
+            checks.Expect(accepted == 8 && input.GetDroppedCount() == 4, "full queue did not drop and count");
+
+            int32_t next = 0;
+            bool ordered = true;
+            input.ConsumeUntil(~0ull, [&](const InputEvent& event) { ordered = ordered && event.dx == next++; });
+            checks.Expect(ordered && next == 8, "queued events out of order");
+        }
+
+        // A producer thread pushing a counter through a small ring while
+        // this thread pops: every value arrives, in order.
+        {
+            const uint32_t count = 200000;
+            SpscQueue<uint32_t> queue(256);
+            std::thread producer([&]()
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    while (!queue.TryPush(i))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+
+            uint32_t expected = 0;
+            bool ordered = true;
+            while (expected < count)
+            {
+                uint32_t value;
+                if (queue.TryPop(value))
+                {
+                    ordered = ordered && value == expected;
+                    ++expected;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+            producer.join();
+            checks.Expect(ordered, "values crossed threads out of order");
+        }
+
+        checks.Finish();
+    }
+
+    // Pass/fail checks of input recording: a session survives the file
+    // format unchanged, and replaying it puts the camera exactly where the
+    // live session left it.
+    void CheckReplay(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        const char* name = "Replay/Checks";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        CheckList checks(runner, name);
+
+        // A live session as Game::Tick runs it, on an input clock far from
+        // zero, recorded as Game::RecordInput records it. The first tick
+        // comes 8 ms in but its timer delta is the 100 ms load clamp, so it
+        // runs six steps, and W goes down as it begins.
+        const uint64_t origin = 1000 * InputQueue::TicksPerSecond;
+        StepTimer timer;
+        timer.SetFixedTimeStep(true);
+        timer.SetTargetElapsedSeconds(STEP_SECONDS);
+        InputQueue input;
+        CameraController camera(CAMERA_SETTINGS);
+        InputRecording recording;
+        uint64_t now = origin + InputQueue::TicksPerSecond / 125;
+        uint64_t inputTime = origin;
+        uint32_t keys[8] = {};
+        uint32_t seed = 1;
+
+        for (uint32_t tick = 0; tick < 240; ++tick)
+        {
+            uint64_t delta = StepTimer::TicksPerSecond / 10;
+            if (tick != 0)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                delta = 166667 + (seed >> 16) % 40000 - 20000;
+                now += delta;
+            }
+
+            auto push = [&](const InputEvent& event)
+            {
+                input.Push(event);
+                InputEvent recorded = event;
+                recorded.time -= origin;
+                recording.AddEvent(recorded);
+            };
+
+            keys[CameraKey::W >> 5] = (tick < 30) ? 1u << (CameraKey::W & 31) : 0;
+            recording.AddTick(0, now - origin, keys);
+            switch (tick)
+            {
+            case 0:     push(InputEvent{ now, 0, 0, InputEventType::KeyDown, CameraKey::W }); break;
+            case 30:    push(InputEvent{ now - 1000, 0, 0, InputEventType::KeyUp, CameraKey::W }); break;
+            case 40:    push(InputEvent{ now - 1000, 0, 0, InputEventType::ButtonDown, InputButton::Left }); break;
+            case 120:   push(InputEvent{ now - 1000, 0, 0, InputEventType::ButtonUp, InputButton::Left }); break;
+            case 150:   push(InputEvent{ now - 1000, 0, 0, InputEventType::KeyDown, CameraKey::A }); break;
+            case 200:   push(InputEvent{ now - 1000, 0, 0, InputEventType::KeyUp, CameraKey::A }); break;
+            }
+            if (tick > 40 && tick < 120)
+            {
+                push(InputEvent{ now - 3000, 3, (tick % 20) < 10 ? 1 : -1, InputEventType::MouseDelta, 0 });
+            }
+
+            timer.Advance(delta, [&]()
+            {
+                uint64_t stepStart = inputTime;
+                inputTime = std::min(inputTime + timer.GetElapsedTicks(), now);
+                camera.Step(input, stepStart, inputTime);
+            });
+            recording.ticks.back().timeDelta = timer.GetLastTickDelta();
+            inputTime = std::max(inputTime, now - timer.GetElapsedTicks());
+        }
+
+        const std::vector<uint8_t> blob = SaveInputRecordingToMemory(recording);
+        const InputRecording loaded = LoadInputRecordingFromMemory(blob.data(), blob.size());
+        bool same = loaded.ticks.size() == recording.ticks.size() && loaded.events.size() == recording.events.size();
+        for (size_t i = 0; same && i < loaded.ticks.size(); ++i)
+        {
+            const RecordedTick& a = loaded.ticks[i];
+            const RecordedTick& b = recording.ticks[i];
+            same = a.timeDelta == b.timeDelta && a.inputTime == b.inputTime && memcmp(a.keys, b.keys, sizeof(a.keys)) == 0
+                && a.firstEvent == b.firstEvent && a.eventCount == b.eventCount;
+        }
+        for (size_t i = 0; same && i < loaded.events.size(); ++i)
+        {
+            const InputEvent& a = loaded.events[i];
+            const InputEvent& b = recording.events[i];
+            same = a.time == b.time && a.dx == b.dx && a.dy == b.dy && a.type == b.type && a.code == b.code;
+        }
+        checks.Expect(same, "recording changed through the file format");
+
+        NullGraphicsBackend backend;
+        HeadlessScene scene;
+        scene.CreateResources(backend, assetDirectory);
+        ReplayRecording(scene, backend, loaded);
+        const HeadlessScene::State& state = scene.GetState();
+        checks.Expect(state.cameraPosition.x == camera.GetPosition().x && state.cameraPosition.y == camera.GetPosition().y
+            && state.cameraPosition.z == camera.GetPosition().z && state.pitch == camera.GetPitch() && state.yaw == camera.GetYaw(),
+            "replay left the camera somewhere other than the live session");
+        scene.ReleaseResources(backend);
+
+        checks.Finish();
+    }
+
+    void BenchmarkPacer(BenchmarkRunner& runner)
+    {
+        const uint32_t frames = 30;
+
+        // Paced 60 Hz frames doing nothing else: the time is the frame
+        // interval, and the counters say how close and how cheaply.
+        FramePacer pacer(FramePacer::TicksPerSecond / 60);
+        std::clock_t cpuStart = std::clock();
+        auto wallStart = std::chrono::steady_clock::now();
+
+        BenchmarkResult* result = runner.Run("FramePacer/60Hz", frames, [&]()
+        {
+            for (uint32_t i = 0; i < frames; ++i)
+            {
+                pacer.Schedule(FramePacer::TicksPerSecond);
+                pacer.Wait();
+            }
+        }, 3);
+
+        if (result)
+        {
+            double cpuSeconds = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+            double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+            const FramePacerStats& stats = pacer.GetStats();
+            result->AddCounter("cpuPercent", 100.0 * cpuSeconds / wallSeconds);
+            result->AddCounter("meanLatenessMicroseconds", stats.frames ? stats.totalLatenessNanoseconds / 1e3 / stats.frames : 0.0);
+            result->AddCounter("maxLatenessMicroseconds", stats.maxLatenessNanoseconds / 1e3);
+        }
+    }
+
+    void MakeDirectory(const char* path)
+    {
+#if defined(_WIN32)
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+    }
+
+    void RemoveScratchDirectory(const char* path)
+    {
+#if defined(_WIN32)
+        _rmdir(path);
+#else
+        rmdir(path);
+#endif
+    }
+
+    void BenchmarkHotReload(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        if (!runner.IsSelected("Assets/HotReload"))
+        {
+            return;
+        }
+
+        MakeDirectory(HOT_RELOAD_DIRECTORY);
+        const std::string scratch = std::string(HOT_RELOAD_DIRECTORY) + "/";
+        for (const char* file : SCENE_ASSET_FILES)
+        {
+            std::vector<uint8_t> blob = ReadBinaryFile(assetDirectory + "/" + file);
+            WriteBinaryFile(scratch + file, blob.data(), blob.size());
+        }
+
+        NullGraphicsBackend backend;
+        HeadlessScene scene;
+        AssetDatabase assets(HOT_RELOAD_DIRECTORY);
+        scene.CreateResources(backend, assets);
+        assets.StartWatching();
+
+        // Each repetition saves porcelain.dds with one texel changed, as an
+        // editor would, and spins the frame loop's side of the handoff
+        // until the scene has the new texture: save to swapped in.
+        std::vector<uint8_t> texture = ReadBinaryFile(scratch + "porcelain.dds");
+        std::vector<AssetHandle> changed;
+
+        BenchmarkResult* result = runner.Run("Assets/HotReload", 1, [&]()
+        {
+            texture.back() ^= 0xFF;
+            WriteBinaryFile(scratch + "porcelain.dds", texture.data(), texture.size());
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!assets.ApplyChanges(changed))
+            {
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    throw std::runtime_error("Assets/HotReload: no reload within 5 s: " + assets.GetLastError());
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            scene.ReloadAssets(backend, assets, changed);
+        }, 10);
+
+        AssetStats stats = assets.GetStats();
+        result->AddCounter("reloads", stats.reloads);
+        result->AddCounter("lastImportMicroseconds", stats.lastImportNanoseconds / 1e3);
+        result->AddCounter("maxNoticedToSwapMicroseconds", stats.maxLatencyNanoseconds / 1e3);
+
+        assets.StopWatching();
+        scene.ReleaseResources(backend);
+        for (const char* file : SCENE_ASSET_FILES)
+        {
+            std::remove((scratch + file).c_str());
+        }
+        RemoveScratchDirectory(HOT_RELOAD_DIRECTORY);
+    }
+
+    // A lost device rebuilt from the asset database: everything resident,
+    // a budget a little under the scene, and nothing resident at all, the
+    // last being what recovery cost before the database kept anything.
+    void BenchmarkDeviceRecovery(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        struct Variant
+        {
+            const char* name;
+            int         budgetPercent;  // Of the scene's data; negative for no budget.
+        };
+        const Variant variants[] =
+        {
+            { "Assets/DeviceRecovery/Resident", -1 },
+            { "Assets/DeviceRecovery/TightBudget", 90 },
+            { "Assets/DeviceRecovery/FromDisk", 0 },
+        };
+
+        for (const Variant& variant : variants)
+        {
+            if (!runner.IsSelected(variant.name))
+            {
+                continue;
+            }
+
+            NullGraphicsBackend backend;
+            HeadlessScene scene;
+            AssetDatabase assets(assetDirectory);
+            scene.CreateResources(backend, assets);
+
+            const uint64_t sceneBytes = assets.GetStats().residentBytes;
+            // A zero budget means none, so nothing resident takes one byte.
+            const uint64_t budget = variant.budgetPercent < 0 ? 0 : std::max<uint64_t>(sceneBytes * variant.budgetPercent / 100, 1);
+            assets.SetMemoryBudget(budget);
+
+            // The frame loop's ApplyChanges trims to the budget between losses.
+            std::vector<AssetHandle> changed;
+            assets.ApplyChanges(changed);
+            const uint32_t missesBefore = assets.GetStats().residentMisses;
+            uint32_t recoveries = 0;
+
+            BenchmarkResult* result = runner.Run(variant.name, 1, [&]()
+            {
+                scene.ReleaseResources(backend);
+                scene.CreateResources(backend, assets);
+                assets.ApplyChanges(changed);
+                ++recoveries;
+            });
+
+            AssetStats stats = assets.GetStats();
+            result->AddCounter("sceneBytes", double(sceneBytes));
+            result->AddCounter("budgetBytes", double(budget));
+            result->AddCounter("residentBytes", double(stats.residentBytes));
+            result->AddCounter("diskReadsPerRecovery", double(stats.residentMisses - missesBefore) / recoveries);
+            scene.ReleaseResources(backend);
+        }
+
+        if (runner.IsSelected("Assets/BackgroundRestore"))
+        {
+            NullGraphicsBackend backend;
+            HeadlessScene scene;
+            AssetDatabase assets(assetDirectory);
+            scene.CreateResources(backend, assets);
+            scene.ReleaseResources(backend);
+
+            const AssetHandle handles[] =
+            {
+                assets.Find("skull.sdkmesh"), assets.Find("roomtexture.dds"),
+                assets.Find("porcelain.dds"), assets.Find("cubemap.dds"),
+            };
+            std::vector<AssetHandle> changed;
+
+            // Evict everything, then time Request to all of it resident
+            // again, polling ApplyChanges as the frame loop would.
+            BenchmarkResult* result = runner.Run("Assets/BackgroundRestore", 1, [&]()
+            {
+                assets.SetMemoryBudget(1);
+                assets.ApplyChanges(changed);
+                assets.SetMemoryBudget(0);
+
+                for (AssetHandle handle : handles)
+                {
+                    assets.Request(handle);
+                }
+
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                for (AssetHandle handle : handles)
+                {
+                    while (!assets.IsResident(handle))
+                    {
+                        if (std::chrono::steady_clock::now() > deadline)
+                        {
+                            throw std::runtime_error("Assets/BackgroundRestore: nothing within 5 s: " + assets.GetLastError());
+                        }
+                        std::this_thread::sleep_for(std::chrono::microseconds(50));
+                        assets.ApplyChanges(changed);
+                    }
+                }
+            }, 10);
+
+            AssetStats stats = assets.GetStats();
+            result->AddCounter("backgroundLoads", stats.backgroundLoads);
+            result->AddCounter("residentBytes", double(stats.residentBytes));
+        }
+    }
+
+    // The scripted camera for the streaming benchmarks: a closed loop,
+    // period frames long, between radius and a tenth of it from the
+    // origin, looking at the origin.
+    void StreamingCameraPath(uint32_t frame, uint32_t period, float radius, Float3& position, float& pitch, float& yaw)
+    {
+        const float Pi = 3.14159265359f;
+        float angle = 2 * Pi * float(frame % period) / float(period);
+        float distance = radius * (0.55f + 0.45f * std::cos(angle * 3));
+        position = Float3{ distance * std::sin(angle), 0.5f * std::sin(angle * 2), distance * std::cos(angle) };
+        yaw = angle + Pi;
+        pitch = 0;
+    }
+
+    void BenchmarkTextureStreaming(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        // The scene's own textures, at a small output so the teapot's
+        // mips change along the path. The cubemap has no mips and stays
+        // whole. Each frame waits for the reader, so the loads and drops are
+        // the same however it is scheduled and include its reads.
+        if (runner.IsSelected("TextureStreaming/ScenePath"))
+        {
+            const uint32_t frames = 120;
+
+            NullGraphicsBackend backend;
+            TextureStreamer streamer(assetDirectory, 0);
+            HeadlessScene scene;
+            scene.SetTextureStreamer(&streamer);
+            scene.SetOutputSize(320, 180);
+            scene.CreateResources(backend, assetDirectory);
+
+            uint32_t frame = 0;
+            uint64_t peakResident = 0;
+            BenchmarkResult* result = runner.Run("TextureStreaming/ScenePath", frames, [&]()
+            {
+                for (uint32_t i = 0; i < frames; ++i, ++frame)
+                {
+                    Float3 position;
+                    float pitch, yaw;
+                    StreamingCameraPath(frame, 600, 5.5f, position, pitch, yaw);
+                    scene.Update(frame * STEP_SECONDS);
+                    scene.MoveCamera(position, pitch, yaw);
+                    scene.Render(backend);
+                    streamer.WaitForLoads();
+                    peakResident = std::max(peakResident, streamer.GetStats().residentBytes);
+                }
+            });
+
+            const TextureStreamingStats& stats = streamer.GetStats();
+            result->AddCounter("peakResidentBytes", double(peakResident));
+            result->AddCounter("loadsCompleted", stats.loadsCompleted);
+            result->AddCounter("mipDrops", stats.mipDrops);
+            result->AddCounter("bytesRead", double(stats.bytesRead));
+            if (stats.loadsCompleted == 0 || stats.mipDrops == 0)
+            {
+                runner.AddFailure("TextureStreaming/ScenePath", "the path must both stream mips in and drop them");
+            }
+            scene.ReleaseResources(backend);
+        }
+
+        // Hundreds of materials: a grid of textured spheres, the camera
+        // flying through it, under a budget of an eighth of the full mips.
+        if (runner.IsSelected("TextureStreaming/Grid256"))
+        {
+            const uint32_t gridSide = 16;
+            const uint32_t textureCount = gridSide * gridSide;
+            const uint32_t frames = 60;
+            const float spacing = 4.f;
+
+            MakeDirectory(STREAMING_DIRECTORY);
+            const std::string scratch = std::string(STREAMING_DIRECTORY) + "/";
+            const std::vector<uint8_t> sources[2] =
+            {
+                ReadBinaryFile(assetDirectory + "/roomtexture.dds"),
+                ReadBinaryFile(assetDirectory + "/porcelain.dds"),
+            };
+
+            std::vector<std::string> names;
+            for (uint32_t i = 0; i < textureCount; ++i)
+            {
+                char name[32];
+                snprintf(name, sizeof(name), "grid%03u.dds", i);
+                names.push_back(name);
+                WriteBinaryFile(scratch + name, sources[i % 2].data(), sources[i % 2].size());
+            }
+
+            NullGraphicsBackend backend;
+            TextureStreamer streamer(STREAMING_DIRECTORY, 0);
+            std::vector<StreamedTextureHandle> handles;
+            std::vector<Float3> centers;
+            uint64_t fullBytes = 0;
+            for (uint32_t i = 0; i < textureCount; ++i)
+            {
+                handles.push_back(streamer.Add(names[i]));
+                centers.push_back(Float3{ (float(i % gridSide) - gridSide / 2.f) * spacing, 0.f, (float(i / gridSide) - gridSide / 2.f) * spacing });
+                fullBytes += sources[i % 2].size() - 128;     // Pixels after the magic and header.
+            }
+            const uint64_t budget = fullBytes / 8;
+            streamer.SetBudget(budget);
+
+            uint32_t frame = 0;
+            uint64_t peakResident = 0;
+            uint64_t belowDesired = 0;
+            BenchmarkResult* result = runner.Run("TextureStreaming/Grid256", frames, [&]()
+            {
+                for (uint32_t i = 0; i < frames; ++i, ++frame)
+                {
+                    Float3 position;
+                    float pitch, yaw;
+                    StreamingCameraPath(frame, 1200, spacing * gridSide / 2, position, pitch, yaw);
+                    for (uint32_t t = 0; t < textureCount; ++t)
+                    {
+                        streamer.AddUsage(handles[t], centers[t], 1.f);
+                    }
+                    streamer.Update(backend, StreamingView{ position, 1.42814801f, 720 });   // 70 degrees, as the scene.
+                    peakResident = std::max(peakResident, streamer.GetStats().residentBytes);
+                    belowDesired += streamer.GetStats().texturesBelowDesired;
+                }
+            });
+
+            const TextureStreamingStats& stats = streamer.GetStats();
+            result->AddCounter("textures", textureCount);
+            result->AddCounter("budgetBytes", double(budget));
+            result->AddCounter("peakResidentBytes", double(peakResident));
+            result->AddCounter("lastWantedBytes", double(stats.wantedBytes));
+            result->AddCounter("meanTexturesBelowDesired", double(belowDesired) / frame);
+            result->AddCounter("loadsCompleted", stats.loadsCompleted);
+            result->AddCounter("loadsDiscarded", stats.loadsDiscarded);
+            result->AddCounter("mipDrops", stats.mipDrops);
+            result->AddCounter("bytesRead", double(stats.bytesRead));
+
+            streamer.ReleaseResources(backend);
+            for (const std::string& name : names)
+            {
+                std::remove((scratch + name).c_str());
+            }
+            RemoveScratchDirectory(STREAMING_DIRECTORY);
+        }
+    }
+
+    void BenchmarkOcclusionPath(BenchmarkRunner& runner, const std::string& assetDirectory, JobSystem& jobs)
+    {
+        const char* name = "Occlusion/CameraPath";
+        if (!runner.IsSelected(name))
+        {
+            return;
+        }
+
+        // The camera circles the globe close in and level with it, looking
+        // through its centre, so the teapot's orbit and the skull pass
+        // behind it; items are frames. Culling works the same whatever the
+        // backend, so a null one keeps the frames cheap. A repetition is two
+        // of the teapot's 361-step orbits, so every one sees the same frames.
+        const uint32_t frames = 722;
+        const float Pi = 3.14159265359f;
+        const Float3 globe = { 0.f, -2.f, 0.f };
+
+        NullGraphicsBackend backend;
+        OcclusionCuller culler(jobs);
+        HeadlessScene scene;
+        scene.CreateResources(backend, assetDirectory);
+        scene.SetOcclusionCuller(&culler);
+
+        uint64_t rasterNanoseconds = 0, tested = 0, culled = 0;
+        uint32_t framesCulling = 0;
+        BenchmarkResult* result = runner.Run(name, frames, [&]()
+        {
+            rasterNanoseconds = tested = culled = 0;
+            framesCulling = 0;
+            for (uint32_t frame = 0; frame < frames; ++frame)
+            {
+                const float angle = 2 * Pi * float(frame) / float(frames);
+                scene.Update(frame * STEP_SECONDS);
+                scene.MoveCamera(globe + Float3{ 0.8f * std::sin(angle), 0.f, 0.8f * std::cos(angle) }, 0.f, angle + Pi);
+                scene.Render(backend);
+
+                const OcclusionStats& stats = culler.GetStats();
+                rasterNanoseconds += stats.rasterNanoseconds;
+                tested += stats.occludeesTested;
+                culled += stats.occludeesCulled;
+                framesCulling += stats.occludeesCulled ? 1 : 0;
+            }
+        }, 5);
+
+        result->AddCounter("occluderRasterMillisecondsPerFrame", rasterNanoseconds / 1e6 / frames);
+        result->AddCounter("percentCulled", tested ? 100.0 * culled / tested : 0.0);
+        result->AddCounter("framesCulling", framesCulling);
+        if (culled == 0)
+        {
+            runner.AddFailure(name, "nothing was culled along the path");
+        }
+        scene.ReleaseResources(backend);
+    }
+
+    void CheckZeroAllocationFrames(BenchmarkRunner& runner, const std::string& assetDirectory)
+    {
+        const uint32_t checkedFrames = 120;
+
+        if (!runner.IsSelected("Frame/ZeroAllocation"))
+        {
+            return;
+        }
+
+        NullGraphicsBackend backend;
+        HeadlessScene scene;
+        scene.CreateResources(backend, assetDirectory);
+
+        // One pass, not a timing: the counters carry the result.
+        bool passed = true;
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            ExpectZeroAllocationFrames(scene, backend, SCENE_WARMUP_FRAMES, checkedFrames);
+        }
+        catch (const std::exception& e)
+        {
+            fprintf(stderr, "%s\n", e.what());
+            passed = false;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        std::vector<double> samples(1, double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / (SCENE_WARMUP_FRAMES + checkedFrames));
+        BenchmarkResult* result = runner.AddResult("Frame/ZeroAllocation", SCENE_WARMUP_FRAMES + checkedFrames, samples);
+        result->AddCounter("trackingEnabled", IsAllocationTrackingEnabled() ? 1 : 0);
+        result->AddCounter("passed", passed ? 1 : 0);
+        scene.ReleaseResources(backend);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Settings settings;
+    if (!ParseArguments(argc, argv, settings))
+    {
+        return 2;
+    }
+
+    try
+    {
+        Profiler::SetThreadName("Main");
+        JobSystem jobs;
+
+        BenchmarkRunner runner(settings.options);
+        runner.SetVerbose(true);
+
+        BenchmarkTimer(runner);
+        BenchmarkCamera(runner);
+        BenchmarkTransposes(runner);
+        BenchmarkAssets(runner, settings.assetDirectory);
+        BenchmarkHotReload(runner, settings.assetDirectory);
+        BenchmarkDeviceRecovery(runner, settings.assetDirectory);
+        BenchmarkTextureStreaming(runner, settings.assetDirectory);
+        BenchmarkSubsystems(runner);
+        CheckUploadRing(runner);
+        CheckFrameArena(runner);
+        CheckInput(runner);
+        CheckReplay(runner, settings.assetDirectory);
+        BenchmarkGeometry(runner, jobs);
+        BenchmarkImageDecoding(runner, settings.assetDirectory);
+        BenchmarkMipGeneration(runner, settings.assetDirectory, jobs);
+        BenchmarkEnvironment(runner, settings.assetDirectory, jobs);
+        BenchmarkLightClustering(runner, jobs);
+        BenchmarkParticles(runner, jobs);
+        BenchmarkBroadphase(runner, settings.assetDirectory);
+        BenchmarkRenderQueue(runner);
+        BenchmarkCommandStream(runner, settings.assetDirectory);
+        BenchmarkFrames(runner, settings.assetDirectory, settings.saveFramesDirectory, jobs);
+        BenchmarkOcclusionPath(runner, settings.assetDirectory, jobs);
+        BenchmarkPipeline(runner, settings.assetDirectory, jobs);
+        BenchmarkReplay(runner, settings.assetDirectory, settings.replayPath);
+        BenchmarkPacer(runner);
+        CheckZeroAllocationFrames(runner, settings.assetDirectory);
+
+        runner.WriteJson(settings.outputPath);
+        printf("Wrote %s\n", settings.outputPath.c_str());
+        if (!runner.GetFailures().empty())
+        {
+            fprintf(stderr, "GameBench: %u check(s) failed\n", unsigned(runner.GetFailures().size()));
+            return 1;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "GameBench: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
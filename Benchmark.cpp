@@ -0,0 +1,216 @@
+//
+// Benchmark.cpp
+//
+
+#include "Benchmark.h"
+#include "BinaryFile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+
+using namespace DX;
+
+namespace
+{
+    double Median(std::vector<double> values)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+
+        size_t middle = values.size() / 2;
+        std::nth_element(values.begin(), values.begin() + middle, values.end());
+        double upper = values[middle];
+        if (values.size() % 2 != 0)
+        {
+            return upper;
+        }
+
+        double lower = *std::max_element(values.begin(), values.begin() + middle);
+        return (lower + upper) * 0.5;
+    }
+
+    void AppendEscaped(std::string& out, const std::string& text)
+    {
+        out += '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                out += escape;
+            }
+            else
+            {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    void AppendNumber(std::string& out, double value)
+    {
+        // JSON has no NaN or infinity.
+        if (!std::isfinite(value))
+        {
+            out += "null";
+            return;
+        }
+
+        char number[32];
+        snprintf(number, sizeof(number), "%.6g", value);
+        out += number;
+    }
+
+    const char* CompilerName()
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc";
+#else
+        return "unknown";
+#endif
+    }
+}
+
+BenchmarkRunner::BenchmarkRunner(const BenchmarkOptions& options) :
+    m_options(options),
+    m_verbose(false)
+{
+    if (m_options.repetitions == 0)
+    {
+        m_options.repetitions = 1;
+    }
+}
+
+bool BenchmarkRunner::IsSelected(const char* name) const
+{
+    return m_options.filter.empty() || std::string(name).find(m_options.filter) != std::string::npos;
+}
+
+BenchmarkResult* BenchmarkRunner::AddResult(const char* name, uint64_t itemsPerRepetition, std::vector<double>& samples)
+{
+    BenchmarkResult result = {};
+    result.name = name;
+    result.itemsPerRepetition = itemsPerRepetition;
+    result.repetitions = uint32_t(samples.size());
+
+    if (!samples.empty())
+    {
+        result.medianNanoseconds = Median(samples);
+        result.minNanoseconds = *std::min_element(samples.begin(), samples.end());
+        result.maxNanoseconds = *std::max_element(samples.begin(), samples.end());
+
+        for (double& sample : samples)
+        {
+            sample = std::fabs(sample - result.medianNanoseconds);
+        }
+        result.madNanoseconds = Median(samples);
+    }
+
+    m_results.push_back(std::move(result));
+
+    if (m_verbose)
+    {
+        const BenchmarkResult& added = m_results.back();
+        printf("%-36s %14.1f ns  +- %10.1f  (%u x %llu items)\n", added.name.c_str(), added.medianNanoseconds,
+            added.madNanoseconds, added.repetitions, static_cast<unsigned long long>(added.itemsPerRepetition));
+        fflush(stdout);
+    }
+
+    return &m_results.back();
+}
+
+void BenchmarkRunner::AddFailure(const std::string& benchmarkName, const std::string& message)
+{
+    m_failures.push_back(benchmarkName + ": " + message);
+    fprintf(stderr, "FAILED %s\n", m_failures.back().c_str());
+}
+
+std::string BenchmarkRunner::ToJson() const
+{
+    char timestamp[32] = "";
+    std::time_t now = std::time(nullptr);
+    std::tm utc = {};
+#if defined(_WIN32)
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    std::string out;
+    out += "{\n  \"schema\": 1,\n  \"label\": ";
+    AppendEscaped(out, m_options.label);
+    out += ",\n  \"timestamp\": ";
+    AppendEscaped(out, timestamp);
+    out += ",\n  \"compiler\": ";
+    AppendEscaped(out, CompilerName());
+#if defined(NDEBUG)
+    out += ",\n  \"optimized\": true";
+#else
+    out += ",\n  \"optimized\": false";
+#endif
+    out += ",\n  \"hardwareThreads\": " + std::to_string(std::thread::hardware_concurrency());
+    out += ",\n  \"warmupRepetitions\": " + std::to_string(m_options.warmupRepetitions);
+    out += ",\n  \"repetitions\": " + std::to_string(m_options.repetitions);
+    out += ",\n  \"unit\": \"ns/item\",\n  \"benchmarks\": [";
+
+    bool first = true;
+    for (const BenchmarkResult& result : m_results)
+    {
+        out += first ? "\n    {" : ",\n    {";
+        first = false;
+
+        out += "\"name\": ";
+        AppendEscaped(out, result.name);
+        out += ", \"items\": " + std::to_string(result.itemsPerRepetition);
+        out += ", \"repetitions\": " + std::to_string(result.repetitions);
+        out += ", \"median\": ";
+        AppendNumber(out, result.medianNanoseconds);
+        out += ", \"mad\": ";
+        AppendNumber(out, result.madNanoseconds);
+        out += ", \"min\": ";
+        AppendNumber(out, result.minNanoseconds);
+        out += ", \"max\": ";
+        AppendNumber(out, result.maxNanoseconds);
+
+        out += ", \"counters\": {";
+        for (size_t i = 0; i < result.counters.size(); ++i)
+        {
+            out += i ? ", " : "";
+            AppendEscaped(out, result.counters[i].first);
+            out += ": ";
+            AppendNumber(out, result.counters[i].second);
+        }
+        out += "}}";
+    }
+
+    out += "\n  ],\n  \"failures\": [";
+    for (size_t i = 0; i < m_failures.size(); ++i)
+    {
+        out += i ? ",\n    " : "\n    ";
+        AppendEscaped(out, m_failures[i]);
+    }
+    out += m_failures.empty() ? "]\n}\n" : "\n  ]\n}\n";
+    return out;
+}
+
+void BenchmarkRunner::WriteJson(const std::string& path) const
+{
+    std::string json = ToJson();
+    WriteBinaryFile(path, json.data(), json.size());
+}
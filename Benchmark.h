@@ -0,0 +1,136 @@
+//
+// Benchmark.h - Minimal benchmark harness: untimed warmup, repeated timed
+// runs, a median/MAD summary per benchmark and JSON output
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace DX
+{
+    struct BenchmarkOptions
+    {
+        uint32_t    warmupRepetitions;
+        uint32_t    repetitions;
+        std::string filter;         // Only names containing this run; empty runs all.
+        std::string label;          // Free text stored with the results, e.g. a commit.
+    };
+
+    struct BenchmarkResult
+    {
+        std::string name;
+        uint64_t    itemsPerRepetition;
+        uint32_t    repetitions;
+
+        // Nanoseconds per item over the timed repetitions. The median and the
+        // median absolute deviation are what to compare between runs; unlike
+        // the mean and standard deviation, one preempted repetition barely
+        // moves them.
+        double      medianNanoseconds;
+        double      madNanoseconds;
+        double      minNanoseconds;
+        double      maxNanoseconds;
+
+        // Anything else the benchmark measured, under its own units.
+        std::vector<std::pair<std::string, double>> counters;
+
+        void AddCounter(const char* counterName, double value)  { counters.emplace_back(counterName, value); }
+    };
+
+    // Every benchmark goes through the same methodology: the body runs
+    // warmupRepetitions times untimed, to fill caches and grow containers to
+    // their high-water mark, then repetitions times timed, each timing
+    // divided by the items the body processes per call.
+    class BenchmarkRunner
+    {
+    public:
+        explicit BenchmarkRunner(const BenchmarkOptions& options);
+
+        BenchmarkRunner(BenchmarkRunner const&) = delete;
+        BenchmarkRunner& operator=(BenchmarkRunner const&) = delete;
+
+        bool IsSelected(const char* name) const;
+
+        // Times body(), which processes itemsPerRepetition items per call.
+        // maxRepetitions caps the repetitions for slow bodies; zero uses the
+        // options. Returns null if the filter skips the benchmark; otherwise
+        // the result, which stays valid for the runner's lifetime.
+        template <typename Body>
+        BenchmarkResult* Run(const char* name, uint64_t itemsPerRepetition, Body&& body, uint32_t maxRepetitions = 0)
+        {
+            if (!IsSelected(name))
+            {
+                return nullptr;
+            }
+
+            uint32_t repetitions = m_options.repetitions;
+            uint32_t warmup = m_options.warmupRepetitions;
+            if (maxRepetitions != 0 && maxRepetitions < repetitions)
+            {
+                repetitions = maxRepetitions;
+                warmup = warmup < 1 ? warmup : 1;
+            }
+
+            for (uint32_t i = 0; i < warmup; ++i)
+            {
+                body();
+            }
+
+            std::vector<double> samples;
+            samples.reserve(repetitions);
+            for (uint32_t i = 0; i < repetitions; ++i)
+            {
+                auto start = std::chrono::steady_clock::now();
+                body();
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                samples.push_back(double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / double(itemsPerRepetition));
+            }
+
+            return AddResult(name, itemsPerRepetition, samples);
+        }
+
+        // A result measured some other way, e.g. a one-off pass/fail check.
+        BenchmarkResult* AddResult(const char* name, uint64_t itemsPerRepetition, std::vector<double>& samples);
+
+        const std::deque<BenchmarkResult>& GetResults() const   { return m_results; }
+
+        // Records a correctness check that did not hold. Failures are
+        // printed, listed in the JSON, and make the run fail as a whole.
+        void AddFailure(const std::string& benchmarkName, const std::string& message);
+        const std::vector<std::string>& GetFailures() const     { return m_failures; }
+
+        // Prints one line per result as it is added.
+        void SetVerbose(bool verbose)                           { m_verbose = verbose; }
+
+        std::string ToJson() const;
+
+        // Throws std::runtime_error if the file cannot be written.
+        void WriteJson(const std::string& path) const;
+
+    private:
+        BenchmarkOptions                m_options;
+        std::deque<BenchmarkResult>     m_results;
+        std::vector<std::string>        m_failures;
+        bool                            m_verbose;
+    };
+
+    // Keeps the compiler from discarding a value the benchmark computes but
+    // never otherwise uses.
+    template <typename T>
+    inline void DoNotOptimize(const T& value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        const volatile char* sink = reinterpret_cast<const volatile char*>(&value);
+        (void)*sink;
+#endif
+    }
+}
@@ -0,0 +1,47 @@
+//
+// BinaryFile.h - Portable helper for loading whole binary files from disk
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    // Narrow-path counterpart of ReadData for code that also builds off Windows.
+    inline std::vector<uint8_t> ReadBinaryFile(const std::string& path)
+    {
+        std::ifstream inFile(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!inFile)
+            throw std::runtime_error("ReadBinaryFile: " + path);
+
+        std::streampos len = inFile.tellg();
+        if (!inFile)
+            throw std::runtime_error("ReadBinaryFile: " + path);
+
+        std::vector<uint8_t> blob;
+        blob.resize(size_t(len));
+
+        inFile.seekg(0, std::ios::beg);
+        inFile.read(reinterpret_cast<char*>(blob.data()), len);
+        if (!inFile)
+            throw std::runtime_error("ReadBinaryFile: " + path);
+
+        return blob;
+    }
+
+    inline void WriteBinaryFile(const std::string& path, const void* data, size_t size)
+    {
+        std::ofstream outFile(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            throw std::runtime_error("WriteBinaryFile: " + path);
+
+        outFile.write(static_cast<const char*>(data), std::streamsize(size));
+        if (!outFile)
+            throw std::runtime_error("WriteBinaryFile: " + path);
+    }
+}
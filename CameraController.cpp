@@ -0,0 +1,136 @@
+//
+// CameraController.cpp
+//
+
+#include "CameraController.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace DX;
+
+namespace
+{
+    const float Pi = 3.14159265f;
+}
+
+CameraController::CameraController(const CameraSettings& settings) :
+    m_settings(settings),
+    m_eventsConsumed(0)
+{
+    Reset();
+}
+
+void CameraController::Reset()
+{
+    m_position = m_settings.startPosition;
+    m_pitch = 0;
+    m_yaw = 0;
+    m_looking = false;
+    std::memset(m_keys, 0, sizeof(m_keys));
+}
+
+void CameraController::Step(InputQueue& input, uint64_t stepStart, uint64_t stepEnd)
+{
+    uint64_t cursor = stepStart;
+
+    m_eventsConsumed += input.ConsumeUntil(stepEnd, [&](const InputEvent& event)
+    {
+        uint64_t time = std::max(event.time, cursor);
+        Move(time - cursor);
+        cursor = time;
+        Apply(event);
+    });
+
+    if (stepEnd > cursor)
+    {
+        Move(stepEnd - cursor);
+    }
+}
+
+void CameraController::Apply(const InputEvent& event)
+{
+    switch (event.type)
+    {
+    case InputEventType::KeyDown:
+        m_keys[event.code >> 5] |= 1u << (event.code & 31);
+        break;
+
+    case InputEventType::KeyUp:
+        m_keys[event.code >> 5] &= ~(1u << (event.code & 31));
+        break;
+
+    case InputEventType::ButtonDown:
+    case InputEventType::ButtonUp:
+        if (event.code == InputButton::Left)
+        {
+            m_looking = (event.type == InputEventType::ButtonDown);
+        }
+        break;
+
+    case InputEventType::MouseDelta:
+        if (m_looking)
+        {
+            m_pitch -= float(event.dy) * m_settings.rotationGain;
+            m_yaw -= float(event.dx) * m_settings.rotationGain;
+
+            // Stop just short of straight up or down to avoid gimbal lock,
+            // and keep the yaw in a sane range by wrapping.
+            const float limit = Pi / 2.0f - 0.01f;
+            m_pitch = std::max(-limit, std::min(+limit, m_pitch));
+
+            if (m_yaw > Pi)
+            {
+                m_yaw -= Pi * 2.0f;
+            }
+            else if (m_yaw < -Pi)
+            {
+                m_yaw += Pi * 2.0f;
+            }
+        }
+        break;
+
+    case InputEventType::FocusLost:
+        m_looking = false;
+        std::memset(m_keys, 0, sizeof(m_keys));
+        break;
+    }
+}
+
+void CameraController::Move(uint64_t ticks)
+{
+    if (ticks == 0)
+    {
+        return;
+    }
+
+    Float3 move = { 0, 0, 0 };
+
+    if (IsKeyDown(CameraKey::Up) || IsKeyDown(CameraKey::W))
+        move.z += 1.f;
+    if (IsKeyDown(CameraKey::Down) || IsKeyDown(CameraKey::S))
+        move.z -= 1.f;
+    if (IsKeyDown(CameraKey::Left) || IsKeyDown(CameraKey::A))
+        move.x += 1.f;
+    if (IsKeyDown(CameraKey::Right) || IsKeyDown(CameraKey::D))
+        move.x -= 1.f;
+    if (IsKeyDown(CameraKey::PageUp) || IsKeyDown(CameraKey::Space))
+        move.y += 1.f;
+    if (IsKeyDown(CameraKey::PageDown) || IsKeyDown(CameraKey::X))
+        move.y -= 1.f;
+
+    if (move.x == 0 && move.y == 0 && move.z == 0)
+    {
+        return;
+    }
+
+    // Yaw-pitch rotation as Quaternion::CreateFromYawPitchRoll(yaw, pitch, 0).
+    Matrix44 rotation = Matrix44::CreateRotationX(m_pitch) * Matrix44::CreateRotationY(m_yaw);
+    float seconds = float(double(ticks) / InputQueue::TicksPerSecond);
+    m_position += rotation.TransformNormal(move) * (m_settings.moveSpeed * seconds);
+
+    Float3 half = m_settings.bounds * 0.5f - Float3{ 0.1f, 0.1f, 0.1f };
+    m_position.x = std::max(-half.x, std::min(half.x, m_position.x));
+    m_position.y = std::max(-half.y, std::min(half.y, m_position.y));
+    m_position.z = std::max(-half.z, std::min(half.z, m_position.z));
+}
@@ -0,0 +1,79 @@
+//
+// CameraController.h - Fly camera driven by timestamped input events, moved
+// piecewise between events within each simulation step
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "InputQueue.h"
+
+namespace DX
+{
+    // Win32 virtual-key codes of the keys the camera responds to.
+    namespace CameraKey
+    {
+        const uint8_t Space = 0x20;
+        const uint8_t PageUp = 0x21;
+        const uint8_t PageDown = 0x22;
+        const uint8_t Left = 0x25;
+        const uint8_t Up = 0x26;
+        const uint8_t Right = 0x27;
+        const uint8_t Down = 0x28;
+        const uint8_t A = 'A';
+        const uint8_t D = 'D';
+        const uint8_t S = 'S';
+        const uint8_t W = 'W';
+        const uint8_t X = 'X';
+    }
+
+    struct CameraSettings
+    {
+        Float3  startPosition;
+        Float3  bounds;             // Full size of the box the camera stays inside, centred on the origin.
+        float   moveSpeed;          // Units per second along each held axis.
+        float   rotationGain;       // Radians per mouse count.
+    };
+
+    // Same controls as the original per-step polling: arrows/WASD move,
+    // Space/PageUp and X/PageDown rise and fall, and dragging with the left
+    // button looks around. Within a step, movement is integrated over the
+    // exact intervals each key was held and every mouse delta turns the
+    // camera at the moment it arrived, so a tap shorter than a step moves
+    // the camera by that tap's length rather than a whole step or nothing.
+    class CameraController
+    {
+    public:
+        explicit CameraController(const CameraSettings& settings);
+
+        // Back to the start position, looking down +z.
+        void Reset();
+
+        // Takes every event stamped up to stepEnd and advances the camera
+        // from stepStart to stepEnd. Events stamped before stepStart (late
+        // arrivals) take effect at stepStart.
+        void Step(InputQueue& input, uint64_t stepStart, uint64_t stepEnd);
+
+        // Applies one event immediately, without moving.
+        void Apply(const InputEvent& event);
+
+        const Float3& GetPosition() const   { return m_position; }
+        float GetPitch() const              { return m_pitch; }
+        float GetYaw() const                { return m_yaw; }
+        bool IsLooking() const              { return m_looking; }
+        bool IsKeyDown(uint8_t key) const   { return (m_keys[key >> 5] & (1u << (key & 31))) != 0; }
+
+        uint32_t GetEventsConsumed() const  { return m_eventsConsumed; }
+
+    private:
+        void Move(uint64_t ticks);
+
+        CameraSettings  m_settings;
+        Float3          m_position;
+        float           m_pitch;
+        float           m_yaw;
+        bool            m_looking;
+        uint32_t        m_keys[8];          // One bit per virtual-key code.
+        uint32_t        m_eventsConsumed;
+    };
+}
@@ -0,0 +1,317 @@
+//
+// CpuMath.h - Minimal portable vector and matrix types for code that has to
+// run without DirectXMath (headless backends, tools and benchmarks)
+//
+
+#pragma once
+
+#include <cmath>
+
+namespace DX
+{
+    // Conventions follow DirectXMath/SimpleMath: row vectors, v' = v * M,
+    // translation in the fourth row and right-handed view/projection helpers.
+
+    struct Float2
+    {
+        float x, y;
+    };
+
+    struct Float3
+    {
+        float x, y, z;
+
+        Float3 operator+(const Float3& v) const     { return Float3{ x + v.x, y + v.y, z + v.z }; }
+        Float3 operator-(const Float3& v) const     { return Float3{ x - v.x, y - v.y, z - v.z }; }
+        Float3 operator*(float s) const             { return Float3{ x * s, y * s, z * s }; }
+        Float3 operator-() const                    { return Float3{ -x, -y, -z }; }
+        Float3& operator+=(const Float3& v)         { x += v.x; y += v.y; z += v.z; return *this; }
+
+        float Dot(const Float3& v) const            { return x * v.x + y * v.y + z * v.z; }
+        Float3 Cross(const Float3& v) const         { return Float3{ y * v.z - z * v.y, z * v.x - x * v.z, x * v.y - y * v.x }; }
+        float Length() const                        { return std::sqrt(Dot(*this)); }
+
+        Float3 Normalized() const
+        {
+            float length = Length();
+            return length > 0.f ? *this * (1.f / length) : *this;
+        }
+    };
+
+    struct Float4
+    {
+        float x, y, z, w;
+    };
+
+    struct Matrix44
+    {
+        float m[4][4];
+
+        static Matrix44 Identity()
+        {
+            return Matrix44{ { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+        }
+
+        static Matrix44 CreateTranslation(float x, float y, float z)
+        {
+            Matrix44 r = Identity();
+            r.m[3][0] = x;
+            r.m[3][1] = y;
+            r.m[3][2] = z;
+            return r;
+        }
+
+        static Matrix44 CreateScale(float x, float y, float z)
+        {
+            Matrix44 r = Identity();
+            r.m[0][0] = x;
+            r.m[1][1] = y;
+            r.m[2][2] = z;
+            return r;
+        }
+
+        static Matrix44 CreateRotationX(float radians)
+        {
+            float s = std::sin(radians), c = std::cos(radians);
+            Matrix44 r = Identity();
+            r.m[1][1] = c;  r.m[1][2] = s;
+            r.m[2][1] = -s; r.m[2][2] = c;
+            return r;
+        }
+
+        static Matrix44 CreateRotationY(float radians)
+        {
+            float s = std::sin(radians), c = std::cos(radians);
+            Matrix44 r = Identity();
+            r.m[0][0] = c; r.m[0][2] = -s;
+            r.m[2][0] = s; r.m[2][2] = c;
+            return r;
+        }
+
+        static Matrix44 CreateRotationZ(float radians)
+        {
+            float s = std::sin(radians), c = std::cos(radians);
+            Matrix44 r = Identity();
+            r.m[0][0] = c;  r.m[0][1] = s;
+            r.m[1][0] = -s; r.m[1][1] = c;
+            return r;
+        }
+
+        static Matrix44 CreateLookAtRH(const Float3& eye, const Float3& target, const Float3& up)
+        {
+            Float3 z = (eye - target).Normalized();
+            Float3 x = up.Cross(z).Normalized();
+            Float3 y = z.Cross(x);
+
+            return Matrix44{ {
+                { x.x, y.x, z.x, 0 },
+                { x.y, y.y, z.y, 0 },
+                { x.z, y.z, z.z, 0 },
+                { -x.Dot(eye), -y.Dot(eye), -z.Dot(eye), 1 } } };
+        }
+
+        static Matrix44 CreatePerspectiveFieldOfViewRH(float fovY, float aspect, float nearZ, float farZ)
+        {
+            float h = 1.f / std::tan(fovY * 0.5f);
+            float w = h / aspect;
+            float range = farZ / (nearZ - farZ);
+
+            return Matrix44{ {
+                { w, 0, 0, 0 },
+                { 0, h, 0, 0 },
+                { 0, 0, range, -1 },
+                { 0, 0, range * nearZ, 0 } } };
+        }
+
+        Matrix44 operator*(const Matrix44& b) const
+        {
+            Matrix44 r;
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    r.m[i][j] = m[i][0] * b.m[0][j] + m[i][1] * b.m[1][j] + m[i][2] * b.m[2][j] + m[i][3] * b.m[3][j];
+                }
+            }
+            return r;
+        }
+
+        Matrix44 Transpose() const
+        {
+            Matrix44 r;
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    r.m[i][j] = m[j][i];
+                }
+            }
+            return r;
+        }
+
+        Float3 Translation() const                  { return Float3{ m[3][0], m[3][1], m[3][2] }; }
+
+        Float4 Transform(const Float3& p) const
+        {
+            return Float4{
+                p.x * m[0][0] + p.y * m[1][0] + p.z * m[2][0] + m[3][0],
+                p.x * m[0][1] + p.y * m[1][1] + p.z * m[2][1] + m[3][1],
+                p.x * m[0][2] + p.y * m[1][2] + p.z * m[2][2] + m[3][2],
+                p.x * m[0][3] + p.y * m[1][3] + p.z * m[2][3] + m[3][3] };
+        }
+
+        Float3 TransformNormal(const Float3& n) const
+        {
+            return Float3{
+                n.x * m[0][0] + n.y * m[1][0] + n.z * m[2][0],
+                n.x * m[0][1] + n.y * m[1][1] + n.z * m[2][1],
+                n.x * m[0][2] + n.y * m[1][2] + n.z * m[2][2] };
+        }
+
+        static Matrix44 Lerp(const Matrix44& a, const Matrix44& b, float t)
+        {
+            Matrix44 r;
+            for (int i = 0; i < 4; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    r.m[i][j] = a.m[i][j] + (b.m[i][j] - a.m[i][j]) * t;
+                }
+            }
+            return r;
+        }
+    };
+
+    struct Quaternion
+    {
+        float x, y, z, w;
+
+        // The upper 3x3 of m must be a pure rotation.
+        static Quaternion CreateFromRotationMatrix(const Matrix44& m)
+        {
+            float trace = m.m[0][0] + m.m[1][1] + m.m[2][2];
+            if (trace > 0.f)
+            {
+                float s = 0.5f / std::sqrt(trace + 1.f);
+                return Quaternion{ (m.m[1][2] - m.m[2][1]) * s, (m.m[2][0] - m.m[0][2]) * s, (m.m[0][1] - m.m[1][0]) * s, 0.25f / s };
+            }
+            if (m.m[0][0] > m.m[1][1] && m.m[0][0] > m.m[2][2])
+            {
+                float s = 2.f * std::sqrt(1.f + m.m[0][0] - m.m[1][1] - m.m[2][2]);
+                return Quaternion{ 0.25f * s, (m.m[1][0] + m.m[0][1]) / s, (m.m[2][0] + m.m[0][2]) / s, (m.m[1][2] - m.m[2][1]) / s };
+            }
+            if (m.m[1][1] > m.m[2][2])
+            {
+                float s = 2.f * std::sqrt(1.f + m.m[1][1] - m.m[0][0] - m.m[2][2]);
+                return Quaternion{ (m.m[1][0] + m.m[0][1]) / s, 0.25f * s, (m.m[2][1] + m.m[1][2]) / s, (m.m[2][0] - m.m[0][2]) / s };
+            }
+            float s = 2.f * std::sqrt(1.f + m.m[2][2] - m.m[0][0] - m.m[1][1]);
+            return Quaternion{ (m.m[2][0] + m.m[0][2]) / s, (m.m[2][1] + m.m[1][2]) / s, 0.25f * s, (m.m[0][1] - m.m[1][0]) / s };
+        }
+
+        // Shortest arc; falls back to a normalized lerp when the two are
+        // nearly parallel.
+        static Quaternion Slerp(const Quaternion& a, Quaternion b, float t)
+        {
+            float cosine = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+            if (cosine < 0.f)
+            {
+                b = Quaternion{ -b.x, -b.y, -b.z, -b.w };
+                cosine = -cosine;
+            }
+
+            float wa = 1.f - t, wb = t;
+            if (cosine < 0.9995f)
+            {
+                float angle = std::acos(cosine);
+                float inverseSine = 1.f / std::sin(angle);
+                wa = std::sin(wa * angle) * inverseSine;
+                wb = std::sin(wb * angle) * inverseSine;
+            }
+
+            Quaternion r{ a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb };
+            float length = std::sqrt(r.x * r.x + r.y * r.y + r.z * r.z + r.w * r.w);
+            return Quaternion{ r.x / length, r.y / length, r.z / length, r.w / length };
+        }
+
+        Matrix44 ToMatrix() const
+        {
+            return Matrix44{ {
+                { 1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0 },
+                { 2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0 },
+                { 2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0 },
+                { 0, 0, 0, 1 } } };
+        }
+    };
+
+    inline float Lerp(float a, float b, float t)
+    {
+        return a + (b - a) * t;
+    }
+
+    // Blends two angles in radians the short way round, so a yaw wrapping
+    // from +pi to -pi does not spin back through zero.
+    inline float LerpAngle(float a, float b, float t)
+    {
+        const float pi = 3.14159265f;
+        float delta = std::fmod(b - a + pi, 2.f * pi);
+        if (delta < 0.f)
+        {
+            delta += 2.f * pi;
+        }
+        return a + (delta - pi) * t;
+    }
+
+    // Blends two scale-rotation-translation transforms: scale and
+    // translation are lerped and rotation slerped, so a spinning object
+    // keeps its shape part way between two steps. A mirrored transform is
+    // treated as a negative x scale.
+    inline Matrix44 InterpolateTransform(const Matrix44& a, const Matrix44& b, float t)
+    {
+        Float3 scales[2];
+        Quaternion rotations[2];
+        const Matrix44* inputs[2] = { &a, &b };
+
+        for (int i = 0; i < 2; ++i)
+        {
+            const Matrix44& input = *inputs[i];
+            Float3 rows[3];
+            float scale[3];
+            for (int r = 0; r < 3; ++r)
+            {
+                rows[r] = Float3{ input.m[r][0], input.m[r][1], input.m[r][2] };
+                scale[r] = rows[r].Length();
+                if (scale[r] == 0.f)
+                {
+                    return t < 0.5f ? a : b;
+                }
+                rows[r] = rows[r] * (1.f / scale[r]);
+            }
+
+            if (rows[0].Cross(rows[1]).Dot(rows[2]) < 0.f)
+            {
+                scale[0] = -scale[0];
+                rows[0] = -rows[0];
+            }
+
+            Matrix44 rotation = Matrix44::Identity();
+            for (int r = 0; r < 3; ++r)
+            {
+                rotation.m[r][0] = rows[r].x;
+                rotation.m[r][1] = rows[r].y;
+                rotation.m[r][2] = rows[r].z;
+            }
+            scales[i] = Float3{ scale[0], scale[1], scale[2] };
+            rotations[i] = Quaternion::CreateFromRotationMatrix(rotation);
+        }
+
+        Float3 scale = scales[0] + (scales[1] - scales[0]) * t;
+        Float3 translation = a.Translation() + (b.Translation() - a.Translation()) * t;
+
+        Matrix44 r = Matrix44::CreateScale(scale.x, scale.y, scale.z) * Quaternion::Slerp(rotations[0], rotations[1], t).ToMatrix();
+        r.m[3][0] = translation.x;
+        r.m[3][1] = translation.y;
+        r.m[3][2] = translation.z;
+        return r;
+    }
+}
@@ -0,0 +1,616 @@
+//
+// D3D11GraphicsBackend.cpp
+//
+
+#include "pch.h"
+#include "D3D11GraphicsBackend.h"
+
+#include <thread>
+
+using namespace DirectX;
+using namespace DX;
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    DXGI_FORMAT ToDXGI(TextureFormat format)
+    {
+        switch (format)
+        {
+        case TextureFormat::RGBA8:  return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case TextureFormat::BGRA8:  return DXGI_FORMAT_B8G8R8A8_UNORM;
+        case TextureFormat::BC1:    return DXGI_FORMAT_BC1_UNORM;
+        case TextureFormat::BC2:    return DXGI_FORMAT_BC2_UNORM;
+        case TextureFormat::BC3:    return DXGI_FORMAT_BC3_UNORM;
+        default:                    throw std::exception("ToDXGI");
+        }
+    }
+
+    UINT ToBindFlags(BufferUsage usage)
+    {
+        switch (usage)
+        {
+        case BufferUsage::Vertex:   return D3D11_BIND_VERTEX_BUFFER;
+        case BufferUsage::Index:    return D3D11_BIND_INDEX_BUFFER;
+        default:                    return D3D11_BIND_CONSTANT_BUFFER;
+        }
+    }
+
+    XMMATRIX LoadTransposed(const float m[16])
+    {
+        return XMMatrixTranspose(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(m)));
+    }
+}
+
+D3D11GraphicsBackend::D3D11GraphicsBackend(ID3D11Device1* device, ID3D11DeviceContext1* context) :
+    m_device(device),
+    m_context(context),
+    m_renderTarget(nullptr),
+    m_depthStencil(nullptr),
+    m_currentPipeline(InvalidHandle),
+    m_constantBuffers{},
+    m_boundTextures{},
+    m_useConstantRing(false),
+    m_constantRingMapped(false),
+    m_constantRingAllocator(ConstantRingBytes, FramesInFlight),
+    m_framesSubmitted(0),
+    m_framesCompleted(0),
+    m_stats{}
+{
+    m_states = std::make_unique<CommonStates>(device);
+
+    // Binding by offset and NO_OVERWRITE maps on constant buffers both need
+    // D3D11.1 runtime support.
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    if (SUCCEEDED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+    {
+        m_useConstantRing = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+    }
+
+    if (m_useConstantRing)
+    {
+        CD3D11_BUFFER_DESC ringDesc(ConstantRingBytes, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        DX::ThrowIfFailed(device->CreateBuffer(&ringDesc, nullptr, m_constantRing.GetAddressOf()));
+
+        CD3D11_QUERY_DESC fenceDesc(D3D11_QUERY_EVENT);
+        for (auto& fence : m_frameFences)
+        {
+            DX::ThrowIfFailed(device->CreateQuery(&fenceDesc, fence.GetAddressOf()));
+        }
+    }
+}
+
+template<typename T>
+uint32_t D3D11GraphicsBackend::Allocate(std::vector<T>& pool, T&& item)
+{
+    pool.push_back(std::move(item));
+    return uint32_t(pool.size());
+}
+
+void D3D11GraphicsBackend::SetRenderTargets(ID3D11RenderTargetView* renderTarget, ID3D11DepthStencilView* depthStencil)
+{
+    m_renderTarget = renderTarget;
+    m_depthStencil = depthStencil;
+}
+
+BufferHandle D3D11GraphicsBackend::CreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+    Buffer buffer;
+    buffer.desc = desc;
+    buffer.ringBacked = m_useConstantRing && desc.usage == BufferUsage::Constant && desc.dynamic;
+    buffer.ringOffset = UploadRingAllocator::InvalidOffset;
+    buffer.ringFrame = 0;
+
+    if (buffer.ringBacked)
+    {
+        buffer.shadow.resize(desc.sizeBytes);
+        if (initialData)
+        {
+            UploadToRing(buffer, initialData, desc.sizeBytes);
+        }
+        return Allocate(m_buffers, std::move(buffer));
+    }
+
+    CD3D11_BUFFER_DESC bufferDesc(desc.sizeBytes, ToBindFlags(desc.usage),
+        desc.dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT,
+        desc.dynamic ? D3D11_CPU_ACCESS_WRITE : 0);
+
+    D3D11_SUBRESOURCE_DATA data = {};
+    data.pSysMem = initialData;
+
+    DX::ThrowIfFailed(m_device->CreateBuffer(&bufferDesc, initialData ? &data : nullptr, buffer.buffer.GetAddressOf()));
+
+    if (desc.usage == BufferUsage::Constant)
+    {
+        buffer.shadow.resize(desc.sizeBytes);
+        if (initialData)
+        {
+            memcpy(buffer.shadow.data(), initialData, desc.sizeBytes);
+        }
+    }
+
+    if (initialData)
+    {
+        m_stats.bytesUploaded += desc.sizeBytes;
+    }
+
+    return Allocate(m_buffers, std::move(buffer));
+}
+
+TextureHandle D3D11GraphicsBackend::CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData)
+{
+    // Textures are immutable, so their contents must be supplied up front.
+    if (!initialData)
+    {
+        throw std::exception("CreateTexture");
+    }
+
+    CD3D11_TEXTURE2D_DESC textureDesc(ToDXGI(desc.format), desc.width, desc.height, desc.arraySize, desc.mipLevels,
+        D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_IMMUTABLE, 0, 1, 0,
+        desc.cubemap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0);
+
+    std::vector<D3D11_SUBRESOURCE_DATA> data(desc.mipLevels * desc.arraySize);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i].pSysMem = initialData[i].data;
+        data[i].SysMemPitch = initialData[i].rowPitch;
+        data[i].SysMemSlicePitch = initialData[i].slicePitch;
+        m_stats.bytesUploaded += initialData[i].slicePitch;
+    }
+
+    ComPtr<ID3D11Texture2D> texture;
+    DX::ThrowIfFailed(m_device->CreateTexture2D(&textureDesc, data.data(), texture.GetAddressOf()));
+
+    Texture result;
+    DX::ThrowIfFailed(m_device->CreateShaderResourceView(texture.Get(), nullptr, result.view.GetAddressOf()));
+
+    return Allocate(m_textures, std::move(result));
+}
+
+PipelineHandle D3D11GraphicsBackend::CreatePipelineState(const PipelineDesc& desc)
+{
+    Pipeline pipeline;
+    pipeline.desc = desc;
+
+    switch (desc.program)
+    {
+    case ShaderProgram::VertexColor:
+    {
+        auto vertexShaderBuffer = DX::ReadData(L"ui_vs.cso");
+        DX::ThrowIfFailed(m_device->CreateVertexShader(vertexShaderBuffer.data(), vertexShaderBuffer.size(),
+            nullptr, pipeline.vertexShader.GetAddressOf()));
+        DX::ThrowIfFailed(m_device->CreateInputLayout(VertexPositionColor::InputElements, VertexPositionColor::InputElementCount,
+            vertexShaderBuffer.data(), vertexShaderBuffer.size(), pipeline.inputLayout.GetAddressOf()));
+
+        auto pixelShaderBuffer = DX::ReadData(L"ui_ps.cso");
+        DX::ThrowIfFailed(m_device->CreatePixelShader(pixelShaderBuffer.data(), pixelShaderBuffer.size(),
+            nullptr, pipeline.pixelShader.GetAddressOf()));
+        break;
+    }
+
+    case ShaderProgram::TexturedLit:
+    {
+        auto effect = std::make_unique<BasicEffect>(m_device.Get());
+        effect->SetTextureEnabled(true);
+        effect->SetPerPixelLighting(true);
+        effect->SetLightingEnabled(true);
+        effect->SetLightEnabled(0, true);
+        effect->SetLightDiffuseColor(0, Colors::White);
+        pipeline.effect = std::move(effect);
+        break;
+    }
+
+    case ShaderProgram::LitFog:
+    {
+        auto effect = std::make_unique<BasicEffect>(m_device.Get());
+        effect->EnableDefaultLighting();
+        effect->SetFogEnabled(true);
+        pipeline.effect = std::move(effect);
+        break;
+    }
+
+    case ShaderProgram::EnvironmentMap:
+    {
+        auto effect = std::make_unique<EnvironmentMapEffect>(m_device.Get());
+        effect->EnableDefaultLighting();
+        pipeline.effect = std::move(effect);
+        break;
+    }
+    }
+
+    if (pipeline.effect)
+    {
+        DX::ThrowIfFailed(CreateInputLayoutFromEffect<VertexPositionNormalTexture>(m_device.Get(), pipeline.effect.get(),
+            pipeline.inputLayout.GetAddressOf()));
+    }
+
+    return Allocate(m_pipelines, std::move(pipeline));
+}
+
+void D3D11GraphicsBackend::DestroyBuffer(BufferHandle buffer)
+{
+    if (buffer != InvalidHandle)
+    {
+        m_buffers[buffer - 1] = Buffer();
+    }
+}
+
+void D3D11GraphicsBackend::DestroyTexture(TextureHandle texture)
+{
+    if (texture != InvalidHandle)
+    {
+        m_textures[texture - 1] = Texture();
+    }
+}
+
+void D3D11GraphicsBackend::DestroyPipelineState(PipelineHandle pipeline)
+{
+    if (pipeline != InvalidHandle)
+    {
+        if (m_currentPipeline == pipeline)
+        {
+            m_currentPipeline = InvalidHandle;
+        }
+
+        m_pipelines[pipeline - 1] = Pipeline();
+    }
+}
+
+void D3D11GraphicsBackend::UploadToRing(Buffer& buffer, const void* data, uint32_t sizeBytes)
+{
+    // Reserve the whole buffer so the bound window always covers it.
+    uint32_t offset = m_constantRingAllocator.Allocate(buffer.desc.sizeBytes);
+    while (offset == UploadRingAllocator::InvalidOffset)
+    {
+        if (m_framesCompleted == m_framesSubmitted)
+        {
+            throw std::exception("UploadToRing: constant ring exhausted within one frame");
+        }
+
+        RetireFrames(true);
+        offset = m_constantRingAllocator.Allocate(buffer.desc.sizeBytes);
+    }
+
+    // The first map discards whatever the driver had; after that the fences
+    // guarantee the slice is not in use.
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    DX::ThrowIfFailed(m_context->Map(m_constantRing.Get(), 0,
+        m_constantRingMapped ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    memcpy(static_cast<uint8_t*>(mapped.pData) + offset, data, sizeBytes);
+    m_context->Unmap(m_constantRing.Get(), 0);
+
+    m_constantRingMapped = true;
+    buffer.ringOffset = offset;
+    buffer.ringFrame = m_framesSubmitted;
+    if (data != buffer.shadow.data())
+    {
+        memcpy(buffer.shadow.data(), data, sizeBytes);
+    }
+}
+
+// A slice from an earlier frame is recycled once that frame retires, so a
+// buffer that was not updated this frame is copied forward from its shadow
+// before it is bound again.
+void D3D11GraphicsBackend::RefreshConstantBuffer(Buffer& buffer)
+{
+    if (buffer.ringOffset != UploadRingAllocator::InvalidOffset && buffer.ringFrame != m_framesSubmitted)
+    {
+        UploadToRing(buffer, buffer.shadow.data(), buffer.desc.sizeBytes);
+    }
+}
+
+void D3D11GraphicsBackend::RetireFrames(bool waitForOldest)
+{
+    while (m_framesCompleted < m_framesSubmitted)
+    {
+        ID3D11Query* fence = m_frameFences[m_framesCompleted % FramesInFlight].Get();
+        HRESULT hr = m_context->GetData(fence, nullptr, 0, waitForOldest ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        DX::ThrowIfFailed(hr);
+
+        if (hr == S_FALSE)
+        {
+            if (!waitForOldest)
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        ++m_framesCompleted;
+        waitForOldest = false;
+    }
+
+    m_constantRingAllocator.Retire(m_framesCompleted);
+}
+
+void D3D11GraphicsBackend::UpdateBuffer(BufferHandle handle, const void* data, uint32_t sizeBytes)
+{
+    Buffer& buffer = m_buffers[handle - 1];
+    sizeBytes = std::min(sizeBytes, buffer.desc.sizeBytes);
+
+    if (buffer.ringBacked)
+    {
+        UploadToRing(buffer, data, sizeBytes);
+
+        // The new slice lives at a new offset, so rebind wherever it is bound.
+        for (uint32_t slot = 0; slot < MaxSlots; ++slot)
+        {
+            if (m_constantBuffers[slot] == handle)
+            {
+                BindConstantBuffer(slot, handle);
+            }
+        }
+
+        ++m_stats.bufferUpdates;
+        m_stats.bytesUploaded += sizeBytes;
+        return;
+    }
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    DX::ThrowIfFailed(m_context->Map(buffer.buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+    memcpy(mapped.pData, data, sizeBytes);
+    m_context->Unmap(buffer.buffer.Get(), 0);
+
+    if (!buffer.shadow.empty())
+    {
+        memcpy(buffer.shadow.data(), data, sizeBytes);
+    }
+
+    ++m_stats.bufferUpdates;
+    m_stats.bytesUploaded += sizeBytes;
+}
+
+void D3D11GraphicsBackend::BeginFrame()
+{
+    m_stats = BackendStats{};
+
+    if (m_useConstantRing)
+    {
+        RetireFrames(false);
+
+        // Buffers left bound from the last frame still point at its slices.
+        for (uint32_t slot = 0; slot < MaxSlots; ++slot)
+        {
+            BufferHandle handle = m_constantBuffers[slot];
+            if (handle != InvalidHandle && m_buffers[handle - 1].ringBacked)
+            {
+                RefreshConstantBuffer(m_buffers[handle - 1]);
+                BindConstantBuffer(slot, handle);
+            }
+        }
+    }
+}
+
+void D3D11GraphicsBackend::EndFrame()
+{
+    m_currentPipeline = InvalidHandle;
+
+    if (m_useConstantRing)
+    {
+        // Each fence query is reused every FramesInFlight frames.
+        while (m_framesSubmitted - m_framesCompleted >= FramesInFlight)
+        {
+            RetireFrames(true);
+        }
+
+        m_context->End(m_frameFences[m_framesSubmitted % FramesInFlight].Get());
+        ++m_framesSubmitted;
+        m_constantRingAllocator.EndFrame(m_framesSubmitted);
+    }
+}
+
+void D3D11GraphicsBackend::Clear(const float color[4], float depth)
+{
+    if (m_renderTarget)
+    {
+        m_context->ClearRenderTargetView(m_renderTarget, color);
+    }
+
+    if (m_depthStencil)
+    {
+        m_context->ClearDepthStencilView(m_depthStencil, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, depth, 0);
+    }
+
+    m_context->OMSetRenderTargets(1, &m_renderTarget, m_depthStencil);
+}
+
+void D3D11GraphicsBackend::SetViewport(uint32_t width, uint32_t height)
+{
+    CD3D11_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height));
+    m_context->RSSetViewports(1, &viewport);
+}
+
+void D3D11GraphicsBackend::SetPipelineState(PipelineHandle handle)
+{
+    Pipeline& pipeline = m_pipelines[handle - 1];
+    m_currentPipeline = handle;
+
+    switch (pipeline.desc.blend)
+    {
+    case BlendMode::Opaque:     m_context->OMSetBlendState(m_states->Opaque(), nullptr, 0xFFFFFFFF); break;
+    case BlendMode::AlphaBlend: m_context->OMSetBlendState(m_states->AlphaBlend(), nullptr, 0xFFFFFFFF); break;
+    case BlendMode::Additive:   m_context->OMSetBlendState(m_states->Additive(), nullptr, 0xFFFFFFFF); break;
+    }
+
+    switch (pipeline.desc.depth)
+    {
+    case DepthMode::None:       m_context->OMSetDepthStencilState(m_states->DepthNone(), 0); break;
+    case DepthMode::Read:       m_context->OMSetDepthStencilState(m_states->DepthRead(), 0); break;
+    case DepthMode::ReadWrite:  m_context->OMSetDepthStencilState(m_states->DepthDefault(), 0); break;
+    }
+
+    switch (pipeline.desc.cull)
+    {
+    case CullMode::None:                m_context->RSSetState(m_states->CullNone()); break;
+    case CullMode::Clockwise:           m_context->RSSetState(m_states->CullClockwise()); break;
+    case CullMode::CounterClockwise:    m_context->RSSetState(m_states->CullCounterClockwise()); break;
+    }
+
+    m_context->IASetInputLayout(pipeline.inputLayout.Get());
+    m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    if (!pipeline.effect)
+    {
+        m_context->VSSetShader(pipeline.vertexShader.Get(), nullptr, 0);
+        m_context->PSSetShader(pipeline.pixelShader.Get(), nullptr, 0);
+    }
+
+    ++m_stats.pipelineBinds;
+}
+
+void D3D11GraphicsBackend::SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes)
+{
+    ID3D11Buffer* vb = m_buffers[buffer - 1].buffer.Get();
+    UINT stride = strideBytes;
+    UINT offset = offsetBytes;
+    m_context->IASetVertexBuffers(0, 1, &vb, &stride, &offset);
+    ++m_stats.bufferBinds;
+}
+
+void D3D11GraphicsBackend::SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes)
+{
+    m_context->IASetIndexBuffer(m_buffers[buffer - 1].buffer.Get(), DXGI_FORMAT_R16_UINT, offsetBytes);
+    ++m_stats.bufferBinds;
+}
+
+void D3D11GraphicsBackend::SetConstantBuffer(uint32_t slot, BufferHandle buffer)
+{
+    if (slot < MaxSlots)
+    {
+        m_constantBuffers[slot] = buffer;
+    }
+
+    if (m_buffers[buffer - 1].ringBacked)
+    {
+        RefreshConstantBuffer(m_buffers[buffer - 1]);
+    }
+
+    BindConstantBuffer(slot, buffer);
+    ++m_stats.bufferBinds;
+}
+
+void D3D11GraphicsBackend::BindConstantBuffer(uint32_t slot, BufferHandle handle)
+{
+    const Buffer& buffer = m_buffers[handle - 1];
+
+    if (!buffer.ringBacked)
+    {
+        ID3D11Buffer* cb = buffer.buffer.Get();
+        m_context->VSSetConstantBuffers(slot, 1, &cb);
+        return;
+    }
+
+    // Offsets and sizes are in 16-byte constants; both stay multiples of 16.
+    ID3D11Buffer* cb = m_constantRing.Get();
+    UINT firstConstant = buffer.ringOffset / 16;
+    UINT numConstants = ((buffer.desc.sizeBytes + 255) & ~255u) / 16;
+
+    if (buffer.ringOffset == UploadRingAllocator::InvalidOffset)
+    {
+        cb = nullptr;
+        firstConstant = 0;
+    }
+
+    m_context->VSSetConstantBuffers1(slot, 1, &cb, &firstConstant, &numConstants);
+}
+
+void D3D11GraphicsBackend::SetTexture(uint32_t slot, TextureHandle texture)
+{
+    if (slot < MaxSlots)
+    {
+        m_boundTextures[slot] = texture;
+    }
+
+    ID3D11ShaderResourceView* view = (texture != InvalidHandle) ? m_textures[texture - 1].view.Get() : nullptr;
+    m_context->PSSetShaderResources(slot, 1, &view);
+    ++m_stats.textureBinds;
+}
+
+// DirectXTK effects own their shaders and constant buffers, so the generic
+// constant slots are read back from their CPU shadows and pushed through the
+// effect interfaces before every draw.
+void D3D11GraphicsBackend::ApplyEffect(Pipeline& pipeline)
+{
+    IEffect* effect = pipeline.effect.get();
+
+    if (m_constantBuffers[ConstantSlot::Transforms] != InvalidHandle)
+    {
+        auto transforms = reinterpret_cast<const TransformConstants*>(m_buffers[m_constantBuffers[ConstantSlot::Transforms] - 1].shadow.data());
+        auto matrices = dynamic_cast<IEffectMatrices*>(effect);
+        if (matrices)
+        {
+            matrices->SetMatrices(LoadTransposed(transforms->world), LoadTransposed(transforms->view), LoadTransposed(transforms->projection));
+        }
+    }
+
+    if (m_constantBuffers[ConstantSlot::Lighting] != InvalidHandle)
+    {
+        auto lighting = reinterpret_cast<const LightingConstants*>(m_buffers[m_constantBuffers[ConstantSlot::Lighting] - 1].shadow.data());
+        if (pipeline.desc.program == ShaderProgram::LitFog)
+        {
+            auto basic = static_cast<BasicEffect*>(effect);
+            basic->SetLightDirection(0, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(lighting->lightDirection)));
+            basic->SetFogStart(lighting->fogStart);
+            basic->SetFogEnd(lighting->fogEnd);
+            basic->SetFogColor(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(lighting->fogColor)));
+        }
+        else if (pipeline.desc.program == ShaderProgram::EnvironmentMap)
+        {
+            static_cast<EnvironmentMapEffect*>(effect)->SetFresnelFactor(lighting->fresnelFactor);
+        }
+    }
+
+    ID3D11ShaderResourceView* texture = GetNativeTexture(m_boundTextures[0]);
+    if (pipeline.desc.program == ShaderProgram::TexturedLit)
+    {
+        static_cast<BasicEffect*>(effect)->SetTexture(texture);
+    }
+    else if (pipeline.desc.program == ShaderProgram::EnvironmentMap)
+    {
+        auto environment = static_cast<EnvironmentMapEffect*>(effect);
+        environment->SetTexture(texture);
+        environment->SetEnvironmentMap(GetNativeTexture(m_boundTextures[1]));
+    }
+
+    effect->Apply(m_context.Get());
+
+    ID3D11SamplerState* samplers[] = { m_states->LinearWrap(), m_states->LinearWrap() };
+    m_context->PSSetSamplers(0, 2, samplers);
+}
+
+void D3D11GraphicsBackend::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+    if (m_currentPipeline != InvalidHandle && m_pipelines[m_currentPipeline - 1].effect)
+    {
+        ApplyEffect(m_pipelines[m_currentPipeline - 1]);
+    }
+
+    m_context->Draw(vertexCount, startVertex);
+    ++m_stats.drawCalls;
+    m_stats.trianglesSubmitted += vertexCount / 3;
+}
+
+void D3D11GraphicsBackend::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+    if (m_currentPipeline != InvalidHandle && m_pipelines[m_currentPipeline - 1].effect)
+    {
+        ApplyEffect(m_pipelines[m_currentPipeline - 1]);
+    }
+
+    m_context->DrawIndexed(indexCount, startIndex, baseVertex);
+    ++m_stats.drawCalls;
+    m_stats.trianglesSubmitted += indexCount / 3;
+}
+
+ID3D11Buffer* D3D11GraphicsBackend::GetNativeBuffer(BufferHandle buffer) const
+{
+    return (buffer != InvalidHandle) ? m_buffers[buffer - 1].buffer.Get() : nullptr;
+}
+
+ID3D11ShaderResourceView* D3D11GraphicsBackend::GetNativeTexture(TextureHandle texture) const
+{
+    return (texture != InvalidHandle) ? m_textures[texture - 1].view.Get() : nullptr;
+}
@@ -0,0 +1,124 @@
+//
+// D3D11GraphicsBackend.h - IGraphicsBackend on top of a D3D11.1 device
+//
+
+#pragma once
+
+#include "GraphicsBackend.h"
+#include "UploadRingAllocator.h"
+
+#include <vector>
+
+namespace DX
+{
+    // Dynamic constant buffers are sub-allocated from one ring buffer that is
+    // mapped with NO_OVERWRITE and bound by offset, so updating them between
+    // draws never forces the driver to rename a buffer. Each frame's slices
+    // stay reserved until an event query shows the GPU has finished it.
+    // Devices without constant buffer offsetting fall back to one
+    // WRITE_DISCARD buffer per handle.
+    class D3D11GraphicsBackend : public IGraphicsBackend
+    {
+    public:
+        D3D11GraphicsBackend(ID3D11Device1* device, ID3D11DeviceContext1* context);
+
+        D3D11GraphicsBackend(D3D11GraphicsBackend const&) = delete;
+        D3D11GraphicsBackend& operator=(D3D11GraphicsBackend const&) = delete;
+
+        // Targets used by Clear; the caller owns the views.
+        void SetRenderTargets(ID3D11RenderTargetView* renderTarget, ID3D11DepthStencilView* depthStencil);
+
+        BufferHandle CreateBuffer(const BufferDesc& desc, const void* initialData) override;
+        TextureHandle CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData) override;
+        PipelineHandle CreatePipelineState(const PipelineDesc& desc) override;
+
+        void DestroyBuffer(BufferHandle buffer) override;
+        void DestroyTexture(TextureHandle texture) override;
+        void DestroyPipelineState(PipelineHandle pipeline) override;
+
+        void UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes) override;
+
+        void BeginFrame() override;
+        void EndFrame() override;
+        void Clear(const float color[4], float depth) override;
+        void SetViewport(uint32_t width, uint32_t height) override;
+
+        void SetPipelineState(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes) override;
+        void SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes) override;
+        void SetConstantBuffer(uint32_t slot, BufferHandle buffer) override;
+        void SetTexture(uint32_t slot, TextureHandle texture) override;
+        void Draw(uint32_t vertexCount, uint32_t startVertex) override;
+        void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+
+        const BackendStats& GetFrameStats() const override     { return m_stats; }
+
+        // Escape hatches for code that still talks to D3D directly. Ring-backed
+        // constant buffers have no buffer of their own and return null.
+        ID3D11Buffer* GetNativeBuffer(BufferHandle buffer) const;
+        ID3D11ShaderResourceView* GetNativeTexture(TextureHandle texture) const;
+
+    private:
+        struct Buffer
+        {
+            Microsoft::WRL::ComPtr<ID3D11Buffer>    buffer;
+            BufferDesc                              desc;
+            std::vector<uint8_t>                    shadow;     // Constant buffers only; feeds DirectXTK effects.
+            bool                                    ringBacked;
+            uint32_t                                ringOffset; // Latest slice in the constant ring.
+            uint64_t                                ringFrame;  // Frame that slice belongs to.
+        };
+
+        struct Texture
+        {
+            Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+        };
+
+        struct Pipeline
+        {
+            PipelineDesc                                desc;
+            Microsoft::WRL::ComPtr<ID3D11VertexShader>  vertexShader;
+            Microsoft::WRL::ComPtr<ID3D11PixelShader>   pixelShader;
+            Microsoft::WRL::ComPtr<ID3D11InputLayout>   inputLayout;
+            std::unique_ptr<DirectX::IEffect>           effect;
+        };
+
+        static const uint32_t MaxSlots = 2;
+        static const uint32_t FramesInFlight = 3;
+        static const uint32_t ConstantRingBytes = 1024 * 1024;
+
+        void ApplyEffect(Pipeline& pipeline);
+        void BindConstantBuffer(uint32_t slot, BufferHandle handle);
+        void RefreshConstantBuffer(Buffer& buffer);
+        void UploadToRing(Buffer& buffer, const void* data, uint32_t sizeBytes);
+        void RetireFrames(bool waitForOldest);
+
+        template<typename T>
+        static uint32_t Allocate(std::vector<T>& pool, T&& item);
+
+        Microsoft::WRL::ComPtr<ID3D11Device1>           m_device;
+        Microsoft::WRL::ComPtr<ID3D11DeviceContext1>    m_context;
+        std::unique_ptr<DirectX::CommonStates>          m_states;
+
+        ID3D11RenderTargetView*     m_renderTarget;
+        ID3D11DepthStencilView*     m_depthStencil;
+
+        std::vector<Buffer>         m_buffers;
+        std::vector<Texture>        m_textures;
+        std::vector<Pipeline>       m_pipelines;
+
+        PipelineHandle              m_currentPipeline;
+        BufferHandle                m_constantBuffers[MaxSlots];
+        TextureHandle               m_boundTextures[MaxSlots];
+
+        bool                                    m_useConstantRing;
+        bool                                    m_constantRingMapped;
+        Microsoft::WRL::ComPtr<ID3D11Buffer>    m_constantRing;
+        UploadRingAllocator                     m_constantRingAllocator;
+        Microsoft::WRL::ComPtr<ID3D11Query>     m_frameFences[FramesInFlight];
+        uint64_t                                m_framesSubmitted;
+        uint64_t                                m_framesCompleted;
+
+        BackendStats                m_stats;
+    };
+}
@@ -0,0 +1,569 @@
+//
+// Deflate.cpp
+//
+
+#include "Deflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const uint16_t LENGTH_BASE[29] =
+    {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+    };
+    const uint8_t LENGTH_EXTRA[29] =
+    {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+    };
+    const uint16_t DISTANCE_BASE[30] =
+    {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+    };
+    const uint8_t DISTANCE_EXTRA[30] =
+    {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+    };
+
+    // Order the code length code lengths are sent in.
+    const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    const uint32_t WINDOW_SIZE = 32768;
+    const uint32_t MIN_MATCH = 3;
+    const uint32_t MAX_MATCH = 258;
+
+    uint32_t ReverseBits(uint32_t code, uint32_t length)
+    {
+        uint32_t result = 0;
+        for (uint32_t i = 0; i < length; ++i, code >>= 1)
+        {
+            result = (result << 1) | (code & 1);
+        }
+        return result;
+    }
+
+    uint32_t Adler32(const uint8_t* data, size_t size)
+    {
+        // 5552 is the most bytes that cannot overflow before the modulo.
+        uint32_t a = 1, b = 0;
+        while (size > 0)
+        {
+            size_t chunk = std::min<size_t>(size, 5552);
+            size -= chunk;
+            for (; chunk > 0; --chunk)
+            {
+                a += *data++;
+                b += a;
+            }
+            a %= 65521;
+            b %= 65521;
+        }
+        return (b << 16) | a;
+    }
+
+    // Reads the stream LSB first, 64 bits buffered. Past the end it feeds
+    // zero bytes, which are only an error if a code actually uses them.
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size) :
+            m_next(data), m_end(data + size), m_bits(0), m_count(0), m_padding(0)
+        {
+        }
+
+        void Refill()
+        {
+            while (m_count <= 56)
+            {
+                if (m_next < m_end)
+                {
+                    m_bits |= uint64_t(*m_next++) << m_count;
+                }
+                else
+                {
+                    m_padding += 8;
+                }
+                m_count += 8;
+            }
+        }
+
+        uint32_t Peek() const               { return uint32_t(m_bits); }
+
+        void Consume(uint32_t count)
+        {
+            m_bits >>= count;
+            m_count -= count;
+            if (m_count < m_padding)
+            {
+                throw std::runtime_error("ZlibDecompress: truncated stream");
+            }
+        }
+
+        uint32_t Read(uint32_t count)
+        {
+            if (m_count < count)
+            {
+                Refill();
+            }
+            uint32_t value = uint32_t(m_bits) & ((1u << count) - 1);
+            Consume(count);
+            return value;
+        }
+
+        void AlignToByte()                  { Consume(m_count & 7); }
+
+        // For stored blocks, once aligned: whole bytes, buffered ones first.
+        void ReadBytes(uint8_t* dest, size_t count)
+        {
+            for (; count > 0 && m_count >= 8; --count)
+            {
+                *dest++ = uint8_t(Read(8));
+            }
+            if (count > size_t(m_end - m_next))
+            {
+                throw std::runtime_error("ZlibDecompress: truncated stream");
+            }
+            std::memcpy(dest, m_next, count);
+            m_next += count;
+        }
+
+        // Bytes after the last one a code used, for the trailing checksum.
+        const uint8_t* GetByteAfterBits() const
+        {
+            return m_next - (m_count - m_padding) / 8;
+        }
+
+    private:
+        const uint8_t*  m_next;
+        const uint8_t*  m_end;
+        uint64_t        m_bits;
+        uint32_t        m_count;
+        uint32_t        m_padding;      // Zero bits at the top of the buffer.
+    };
+
+    // Canonical Huffman decoding: codes of up to FastBits bits resolve with
+    // one table lookup, longer ones by comparing against each length's range.
+    class Huffman
+    {
+    public:
+        static const uint32_t FastBits = 9;
+
+        void Build(const uint8_t* lengths, uint32_t count)
+        {
+            uint32_t sizes[17] = {};
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                ++sizes[lengths[i]];
+            }
+            sizes[0] = 0;
+
+            std::memset(m_fast, 0, sizeof(m_fast));
+
+            uint32_t nextCode[16];
+            uint32_t code = 0, symbols = 0;
+            for (uint32_t length = 1; length < 16; ++length)
+            {
+                nextCode[length] = code;
+                m_firstCode[length] = uint16_t(code);
+                m_firstSymbol[length] = uint16_t(symbols);
+                code += sizes[length];
+                if (sizes[length] != 0 && code - 1 >= (1u << length))
+                {
+                    throw std::runtime_error("ZlibDecompress: bad code lengths");
+                }
+                m_maxCode[length] = code << (16 - length);
+                code <<= 1;
+                symbols += sizes[length];
+            }
+            m_maxCode[16] = 0x10000;
+
+            for (uint32_t symbol = 0; symbol < count; ++symbol)
+            {
+                const uint32_t length = lengths[symbol];
+                if (length == 0)
+                {
+                    continue;
+                }
+                const uint32_t slot = nextCode[length] - m_firstCode[length] + m_firstSymbol[length];
+                m_lengths[slot] = uint8_t(length);
+                m_symbols[slot] = uint16_t(symbol);
+                if (length <= FastBits)
+                {
+                    for (uint32_t j = ReverseBits(nextCode[length], length); j < (1u << FastBits); j += 1u << length)
+                    {
+                        m_fast[j] = uint16_t((length << 9) | symbol);
+                    }
+                }
+                ++nextCode[length];
+            }
+        }
+
+        uint32_t Decode(BitReader& reader) const
+        {
+            reader.Refill();
+            const uint32_t bits = reader.Peek();
+            const uint32_t fast = m_fast[bits & ((1u << FastBits) - 1)];
+            if (fast != 0)
+            {
+                reader.Consume(fast >> 9);
+                return fast & 511;
+            }
+
+            const uint32_t code = ReverseBits(bits & 0xFFFF, 16);
+            uint32_t length = FastBits + 1;
+            while (code >= m_maxCode[length])
+            {
+                if (++length > 15)
+                {
+                    throw std::runtime_error("ZlibDecompress: bad code");
+                }
+            }
+            const uint32_t slot = (code >> (16 - length)) - m_firstCode[length] + m_firstSymbol[length];
+            if (slot >= 288 || m_lengths[slot] != length)
+            {
+                throw std::runtime_error("ZlibDecompress: bad code");
+            }
+            reader.Consume(length);
+            return m_symbols[slot];
+        }
+
+    private:
+        uint16_t m_fast[1 << FastBits];         // (length << 9) | symbol; zero if longer.
+        uint16_t m_firstCode[16];
+        uint16_t m_firstSymbol[16];
+        uint32_t m_maxCode[17];                 // One past each length's last code, left-aligned to 16 bits.
+        uint8_t  m_lengths[288];
+        uint16_t m_symbols[288];
+    };
+
+    void BuildFixedCodes(Huffman& literals, Huffman& distances)
+    {
+        uint8_t lengths[288];
+        std::memset(lengths, 8, 144);
+        std::memset(lengths + 144, 9, 112);
+        std::memset(lengths + 256, 7, 24);
+        std::memset(lengths + 280, 8, 8);
+        literals.Build(lengths, 288);
+
+        std::memset(lengths, 5, 30);
+        distances.Build(lengths, 30);
+    }
+
+    void ReadDynamicCodes(BitReader& reader, Huffman& literals, Huffman& distances)
+    {
+        const uint32_t literalCount = reader.Read(5) + 257;
+        const uint32_t distanceCount = reader.Read(5) + 1;
+        const uint32_t codeLengthCount = reader.Read(4) + 4;
+
+        uint8_t codeLengths[19] = {};
+        for (uint32_t i = 0; i < codeLengthCount; ++i)
+        {
+            codeLengths[CODE_LENGTH_ORDER[i]] = uint8_t(reader.Read(3));
+        }
+        Huffman codeLengthCode;
+        codeLengthCode.Build(codeLengths, 19);
+
+        // Literal and distance lengths run together; repeats may cross over.
+        uint8_t lengths[288 + 32];
+        uint32_t count = 0;
+        while (count < literalCount + distanceCount)
+        {
+            uint32_t symbol = codeLengthCode.Decode(reader);
+            uint32_t repeat = 1;
+            uint8_t value = uint8_t(symbol);
+            if (symbol == 16)
+            {
+                if (count == 0)
+                {
+                    throw std::runtime_error("ZlibDecompress: bad code lengths");
+                }
+                repeat = reader.Read(2) + 3;
+                value = lengths[count - 1];
+            }
+            else if (symbol == 17)
+            {
+                repeat = reader.Read(3) + 3;
+                value = 0;
+            }
+            else if (symbol == 18)
+            {
+                repeat = reader.Read(7) + 11;
+                value = 0;
+            }
+            if (count + repeat > literalCount + distanceCount)
+            {
+                throw std::runtime_error("ZlibDecompress: bad code lengths");
+            }
+            std::memset(lengths + count, value, repeat);
+            count += repeat;
+        }
+
+        literals.Build(lengths, literalCount);
+        distances.Build(lengths + literalCount, distanceCount);
+    }
+
+    // Writes LSB first, the way deflate packs everything but Huffman codes.
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& out) : m_out(out), m_bits(0), m_count(0) {}
+
+        void Write(uint32_t value, uint32_t count)
+        {
+            m_bits |= uint64_t(value) << m_count;
+            m_count += count;
+            while (m_count >= 8)
+            {
+                m_out.push_back(uint8_t(m_bits));
+                m_bits >>= 8;
+                m_count -= 8;
+            }
+        }
+
+        // Huffman codes go most significant bit first.
+        void WriteCode(uint32_t code, uint32_t length)  { Write(ReverseBits(code, length), length); }
+
+        void Flush()
+        {
+            if (m_count > 0)
+            {
+                Write(0, 8 - m_count);
+            }
+        }
+
+    private:
+        std::vector<uint8_t>&   m_out;
+        uint64_t                m_bits;
+        uint32_t                m_count;
+    };
+
+    void WriteFixedLiteral(BitWriter& writer, uint32_t symbol)
+    {
+        if (symbol < 144)
+            writer.WriteCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+            writer.WriteCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+            writer.WriteCode(symbol - 256, 7);
+        else
+            writer.WriteCode(0xC0 + symbol - 280, 8);
+    }
+
+    void WriteMatch(BitWriter& writer, uint32_t length, uint32_t distance)
+    {
+        uint32_t code = 28;
+        while (LENGTH_BASE[code] > length)
+        {
+            --code;
+        }
+        WriteFixedLiteral(writer, 257 + code);
+        writer.Write(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+        code = 29;
+        while (DISTANCE_BASE[code] > distance)
+        {
+            --code;
+        }
+        writer.WriteCode(code, 5);
+        writer.Write(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+    }
+}
+
+void DX::ZlibDecompress(const uint8_t* data, size_t size, uint8_t* dest, size_t expectedSize)
+{
+    if (size < 6 || (data[0] & 0x0F) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20))
+    {
+        throw std::runtime_error("ZlibDecompress: not a zlib stream");
+    }
+
+    BitReader reader(data + 2, size - 2);
+    Huffman literals, distances;
+    size_t written = 0;
+
+    bool last = false;
+    while (!last)
+    {
+        last = reader.Read(1) != 0;
+        const uint32_t type = reader.Read(2);
+
+        if (type == 0)
+        {
+            reader.AlignToByte();
+            const uint32_t length = reader.Read(16);
+            if ((length ^ reader.Read(16)) != 0xFFFF)
+            {
+                throw std::runtime_error("ZlibDecompress: bad stored block");
+            }
+            if (length > expectedSize - written)
+            {
+                throw std::runtime_error("ZlibDecompress: more data than expected");
+            }
+            reader.ReadBytes(dest + written, length);
+            written += length;
+            continue;
+        }
+
+        if (type == 1)
+        {
+            BuildFixedCodes(literals, distances);
+        }
+        else if (type == 2)
+        {
+            ReadDynamicCodes(reader, literals, distances);
+        }
+        else
+        {
+            throw std::runtime_error("ZlibDecompress: bad block type");
+        }
+
+        for (;;)
+        {
+            uint32_t symbol = literals.Decode(reader);
+            if (symbol < 256)
+            {
+                if (written == expectedSize)
+                {
+                    throw std::runtime_error("ZlibDecompress: more data than expected");
+                }
+                dest[written++] = uint8_t(symbol);
+                continue;
+            }
+            if (symbol == 256)
+            {
+                break;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29)
+            {
+                throw std::runtime_error("ZlibDecompress: bad length");
+            }
+            const uint32_t length = LENGTH_BASE[symbol] + reader.Read(LENGTH_EXTRA[symbol]);
+
+            const uint32_t distanceSymbol = distances.Decode(reader);
+            if (distanceSymbol >= 30)
+            {
+                throw std::runtime_error("ZlibDecompress: bad distance");
+            }
+            const uint32_t distance = DISTANCE_BASE[distanceSymbol] + reader.Read(DISTANCE_EXTRA[distanceSymbol]);
+            if (distance > written)
+            {
+                throw std::runtime_error("ZlibDecompress: bad distance");
+            }
+            if (length > expectedSize - written)
+            {
+                throw std::runtime_error("ZlibDecompress: more data than expected");
+            }
+
+            // Overlapping copies repeat the bytes just written, so go byte
+            // by byte unless the source is entirely behind.
+            uint8_t* out = dest + written;
+            const uint8_t* in = out - distance;
+            if (distance >= length)
+            {
+                std::memcpy(out, in, length);
+            }
+            else
+            {
+                for (uint32_t i = 0; i < length; ++i)
+                {
+                    out[i] = in[i];
+                }
+            }
+            written += length;
+        }
+    }
+
+    if (written != expectedSize)
+    {
+        throw std::runtime_error("ZlibDecompress: less data than expected");
+    }
+
+    reader.AlignToByte();
+    const uint8_t* trailer = reader.GetByteAfterBits();
+    if (trailer + 4 > data + size)
+    {
+        throw std::runtime_error("ZlibDecompress: truncated stream");
+    }
+    const uint32_t adler = (uint32_t(trailer[0]) << 24) | (uint32_t(trailer[1]) << 16) | (uint32_t(trailer[2]) << 8) | trailer[3];
+    if (adler != Adler32(dest, expectedSize))
+    {
+        throw std::runtime_error("ZlibDecompress: checksum mismatch");
+    }
+}
+
+std::vector<uint8_t> DX::ZlibCompress(const uint8_t* data, size_t size)
+{
+    std::vector<uint8_t> out;
+    out.reserve(size / 2 + 64);
+    out.push_back(0x78);
+    out.push_back(0x01);
+
+    BitWriter writer(out);
+    writer.Write(1, 1);     // Final block
+    writer.Write(1, 2);     // Fixed codes
+
+    // Most recent position of each three-byte hash; one candidate per hash.
+    const uint32_t hashBits = 15;
+    std::vector<uint32_t> head(size_t(1) << hashBits, ~0u);
+    auto hashAt = [&](size_t i)
+    {
+        uint32_t v = uint32_t(data[i]) | (uint32_t(data[i + 1]) << 8) | (uint32_t(data[i + 2]) << 16);
+        return (v * 2654435761u) >> (32 - hashBits);
+    };
+
+    size_t i = 0;
+    while (i < size)
+    {
+        uint32_t length = 0, distance = 0;
+        if (i + MIN_MATCH <= size)
+        {
+            const uint32_t hash = hashAt(i);
+            const uint32_t candidate = head[hash];
+            head[hash] = uint32_t(i);
+            if (candidate != ~0u && i - candidate <= WINDOW_SIZE)
+            {
+                const size_t limit = std::min<size_t>(MAX_MATCH, size - i);
+                while (length < limit && data[candidate + length] == data[i + length])
+                {
+                    ++length;
+                }
+                distance = uint32_t(i - candidate);
+            }
+        }
+
+        if (length >= MIN_MATCH)
+        {
+            WriteMatch(writer, length, distance);
+            // Remember the positions inside the match too, for later matches.
+            for (size_t j = i + 1; j < i + length && j + MIN_MATCH <= size; ++j)
+            {
+                head[hashAt(j)] = uint32_t(j);
+            }
+            i += length;
+        }
+        else
+        {
+            WriteFixedLiteral(writer, data[i]);
+            ++i;
+        }
+    }
+
+    WriteFixedLiteral(writer, 256);
+    writer.Flush();
+
+    const uint32_t adler = Adler32(data, size);
+    out.push_back(uint8_t(adler >> 24));
+    out.push_back(uint8_t(adler >> 16));
+    out.push_back(uint8_t(adler >> 8));
+    out.push_back(uint8_t(adler));
+    return out;
+}
@@ -0,0 +1,24 @@
+//
+// Deflate.h - zlib streams (RFC 1950 and 1951) for PNG files, without a
+// dependency on zlib itself
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace DX
+{
+    // Inflates a zlib stream into exactly expectedSize bytes at dest and
+    // checks its Adler-32. Throws std::runtime_error if the stream is
+    // corrupt or does not hold exactly that much.
+    void ZlibDecompress(const uint8_t* data, size_t size, uint8_t* dest, size_t expectedSize);
+
+    // Deflates with the fixed Huffman codes and greedy matching over the
+    // whole 32KB window: fast to write and to read back, though larger than
+    // zlib's dynamic codes would make it.
+    std::vector<uint8_t> ZlibCompress(const uint8_t* data, size_t size);
+}
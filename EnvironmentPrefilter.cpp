@@ -0,0 +1,625 @@
+//
+// EnvironmentPrefilter.cpp
+//
+
+#include "EnvironmentPrefilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ENVIRONMENT_PREFILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    // Rows each job works through; small levels end up as one job per face.
+    const uint32_t RowsPerJob = 16;
+
+    const float Pi = 3.14159265358979323846f;
+
+    float SrgbToLinear(float c)
+    {
+        return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSrgb(float c)
+    {
+        return (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    }
+
+    struct DecodeTable
+    {
+        float   srgb[256];
+        float   unorm[256];
+
+        DecodeTable()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                srgb[i] = SrgbToLinear(i / 255.f);
+                unorm[i] = i / 255.f;
+            }
+        }
+    };
+
+    const float* GetDecodeTable(bool srgb)
+    {
+        static const DecodeTable table;
+        return srgb ? table.srgb : table.unorm;
+    }
+
+    // Four floats per texel, RGBA, rows packed.
+    struct Image
+    {
+        uint32_t            width;
+        uint32_t            height;
+        std::vector<float>  texels;
+
+        void Resize(uint32_t w, uint32_t h)
+        {
+            width = w;
+            height = h;
+            texels.resize(size_t(w) * h * 4);
+        }
+
+        float* Row(uint32_t y)                  { return texels.data() + size_t(y) * width * 4; }
+        const float* Row(uint32_t y) const      { return texels.data() + size_t(y) * width * 4; }
+    };
+
+    // The six faces of one level, in D3D order: +X, -X, +Y, -Y, +Z, -Z.
+    struct CubeLevel
+    {
+        Image faces[6];
+    };
+
+    template <typename Body>
+    void ForEach(JobSystem* jobs, uint32_t count, const Body& body)
+    {
+        if (jobs)
+        {
+            jobs->ParallelFor(count, [&](uint32_t index, uint32_t) { body(index); });
+        }
+        else
+        {
+            for (uint32_t index = 0; index < count; ++index)
+            {
+                body(index);
+            }
+        }
+    }
+
+    void ValidateCubemap(const TextureData& cubemap, const char* caller)
+    {
+        const TextureDesc& desc = cubemap.desc;
+        if (!desc.cubemap || desc.arraySize != 6 || desc.width == 0 || desc.width != desc.height
+            || cubemap.surfaces.size() != size_t(desc.arraySize) * desc.mipLevels)
+        {
+            throw std::runtime_error(std::string(caller) + ": not a square cubemap");
+        }
+    }
+
+    // Mip zero of every face as RGBA8 and in linear light.
+    void DecodeFaces(const TextureData& cubemap, bool srgb, uint32_t* const rgba8[6], CubeLevel& level, JobSystem* jobs)
+    {
+        const float* decode = GetDecodeTable(srgb);
+        ForEach(jobs, 6, [&](uint32_t face)
+        {
+            const TextureSurface& surface = cubemap.GetSurface(face, 0);
+            DecodeSurfaceToRGBA8(cubemap.desc.format, surface.width, surface.height,
+                cubemap.GetSurfacePixels(face, 0), surface.rowPitch, rgba8[face]);
+
+            Image& image = level.faces[face];
+            image.Resize(surface.width, surface.height);
+            float* out = image.texels.data();
+            for (size_t i = 0, count = size_t(surface.width) * surface.height; i < count; ++i, out += 4)
+            {
+                const uint32_t p = rgba8[face][i];
+                out[0] = decode[p & 0xFF];
+                out[1] = decode[(p >> 8) & 0xFF];
+                out[2] = decode[(p >> 16) & 0xFF];
+                out[3] = (p >> 24) / 255.f;
+            }
+        });
+    }
+
+    // Averages 2x2 texels, the odd edge texel of an odd size repeated.
+    void Downsample(const Image& src, Image& dst)
+    {
+        dst.Resize(std::max(1u, src.width / 2), std::max(1u, src.height / 2));
+        for (uint32_t y = 0; y < dst.height; ++y)
+        {
+            const float* top = src.Row(std::min(y * 2, src.height - 1));
+            const float* bottom = src.Row(std::min(y * 2 + 1, src.height - 1));
+            float* out = dst.Row(y);
+            for (uint32_t x = 0; x < dst.width; ++x, out += 4)
+            {
+                const uint32_t x0 = std::min(x * 2, src.width - 1) * 4, x1 = std::min(x * 2 + 1, src.width - 1) * 4;
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    out[c] = ((top[x0 + c] + top[x1 + c]) + (bottom[x0 + c] + bottom[x1 + c])) * 0.25f;
+                }
+            }
+        }
+    }
+
+    // u and v run from -1 to 1 across the face, v downwards.
+    Float3 FaceDirection(uint32_t face, float u, float v)
+    {
+        switch (face)
+        {
+        case 0:     return Float3{ 1.f, -v, -u };
+        case 1:     return Float3{ -1.f, -v, u };
+        case 2:     return Float3{ u, 1.f, v };
+        case 3:     return Float3{ u, -1.f, -v };
+        case 4:     return Float3{ u, -v, 1.f };
+        default:    return Float3{ -u, -v, -1.f };
+        }
+    }
+
+    // The inverse: the face a direction lands on and where, s and t running
+    // from 0 to 1 across it.
+    uint32_t DirectionToFace(float x, float y, float z, float& s, float& t)
+    {
+        const float ax = std::abs(x), ay = std::abs(y), az = std::abs(z);
+        float u, v, major;
+        uint32_t face;
+        if (ax >= ay && ax >= az)
+        {
+            major = ax;
+            face = (x >= 0.f) ? 0 : 1;
+            u = (x >= 0.f) ? -z : z;
+            v = -y;
+        }
+        else if (ay >= az)
+        {
+            major = ay;
+            face = (y >= 0.f) ? 2 : 3;
+            u = x;
+            v = (y >= 0.f) ? z : -z;
+        }
+        else
+        {
+            major = az;
+            face = (z >= 0.f) ? 4 : 5;
+            u = (z >= 0.f) ? x : -x;
+            v = -y;
+        }
+        const float scale = 0.5f / major;
+        s = u * scale + 0.5f;
+        t = v * scale + 0.5f;
+        return face;
+    }
+
+    // Bilinear taps of a face, clamped to its edges. Seams between faces
+    // are not blended; at the mips samples are read from, that is far
+    // below the noise of the sampling itself.
+    struct BilinearTaps
+    {
+        const float*    texels[4];
+        float           weights[4];
+    };
+
+    void GetBilinearTaps(const Image& image, float s, float t, float weight, BilinearTaps& taps)
+    {
+        const float x = s * image.width - 0.5f, y = t * image.height - 0.5f;
+        const float fx = std::floor(x), fy = std::floor(y);
+        const int32_t ix = int32_t(fx), iy = int32_t(fy);
+        const int32_t maxX = int32_t(image.width) - 1, maxY = int32_t(image.height) - 1;
+        const uint32_t x0 = uint32_t(std::min(std::max(ix, 0), maxX)), x1 = uint32_t(std::min(std::max(ix + 1, 0), maxX));
+        const float* row0 = image.Row(uint32_t(std::min(std::max(iy, 0), maxY)));
+        const float* row1 = image.Row(uint32_t(std::min(std::max(iy + 1, 0), maxY)));
+
+        const float ax = x - fx, ay = y - fy;
+        taps.texels[0] = row0 + x0 * 4;
+        taps.texels[1] = row0 + x1 * 4;
+        taps.texels[2] = row1 + x0 * 4;
+        taps.texels[3] = row1 + x1 * 4;
+        taps.weights[0] = (1.f - ax) * (1.f - ay) * weight;
+        taps.weights[1] = ax * (1.f - ay) * weight;
+        taps.weights[2] = (1.f - ax) * ay * weight;
+        taps.weights[3] = ax * ay * weight;
+    }
+
+    // GGX samples around +Z for one roughness, with the view along the
+    // normal. Padded to a multiple of four with zero-weight samples.
+    struct SampleSet
+    {
+        std::vector<float>      x, y, z;
+        std::vector<float>      weights;        // N.L; zero for padding.
+        std::vector<uint32_t>   levels;         // Source mip to read.
+        float                   inverseTotal;
+    };
+
+    float RadicalInverse(uint32_t bits)
+    {
+        bits = (bits << 16) | (bits >> 16);
+        bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+        bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+        bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+        bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+        return float(bits) * 2.3283064365386963e-10f;
+    }
+
+    void BuildSampleSet(float roughness, uint32_t sampleCount, uint32_t sourceSize, uint32_t sourceLevels, SampleSet& set)
+    {
+        const float alpha = roughness * roughness;
+        const float alpha2 = alpha * alpha;
+        const float texelSolidAngle = 4.f * Pi / (6.f * sourceSize * sourceSize);
+
+        float total = 0.f;
+        for (uint32_t i = 0; i < sampleCount; ++i)
+        {
+            // Hammersley point, mapped to a half vector by the GGX distribution.
+            const float phi = 2.f * Pi * (i + 0.5f) / sampleCount;
+            const float xi = RadicalInverse(i);
+            const float cosTheta = std::sqrt((1.f - xi) / (1.f + (alpha2 - 1.f) * xi));
+            const float sinTheta = std::sqrt(std::max(0.f, 1.f - cosTheta * cosTheta));
+
+            // The half vector reflected about the normal, which is also the view.
+            const float lz = 2.f * cosTheta * cosTheta - 1.f;
+            if (lz <= 0.f)
+            {
+                continue;
+            }
+
+            // Read from the mip whose texels cover about the solid angle this
+            // sample stands for; pdf is D(h) (n.h) / (4 v.h) = D(h) / 4 here.
+            const float d = cosTheta * cosTheta * (alpha2 - 1.f) + 1.f;
+            const float pdf = alpha2 / (Pi * d * d) / 4.f;
+            const float sampleSolidAngle = 1.f / (sampleCount * pdf);
+            const float lod = std::max(0.f, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.f);
+
+            set.x.push_back(2.f * cosTheta * sinTheta * std::cos(phi));
+            set.y.push_back(2.f * cosTheta * sinTheta * std::sin(phi));
+            set.z.push_back(lz);
+            set.weights.push_back(lz);
+            set.levels.push_back(std::min(uint32_t(lod + 0.5f), sourceLevels - 1));
+            total += lz;
+        }
+        while (set.weights.size() % 4 != 0)
+        {
+            set.x.push_back(0.f);
+            set.y.push_back(0.f);
+            set.z.push_back(1.f);
+            set.weights.push_back(0.f);
+            set.levels.push_back(0);
+        }
+        set.inverseTotal = 1.f / total;
+    }
+
+    // Rows [y0, y1) of one face of an output level. Samples are rotated
+    // onto each texel's direction four at a time.
+    void FilterRows(const std::vector<CubeLevel>& source, const SampleSet& set, uint32_t face, uint32_t size,
+        uint32_t y0, uint32_t y1, float* out)
+    {
+        const uint32_t count = uint32_t(set.weights.size());
+
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            for (uint32_t x = 0; x < size; ++x, out += 4)
+            {
+                const Float3 n = FaceDirection(face, (x + 0.5f) * 2.f / size - 1.f, (y + 0.5f) * 2.f / size - 1.f).Normalized();
+                const Float3 up = (std::abs(n.z) < 0.999f) ? Float3{ 0.f, 0.f, 1.f } : Float3{ 1.f, 0.f, 0.f };
+                const Float3 tangent = up.Cross(n).Normalized();
+                const Float3 bitangent = n.Cross(tangent);
+
+#if defined(ENVIRONMENT_PREFILTER_SSE2)
+                const __m128 tx = _mm_set1_ps(tangent.x), ty = _mm_set1_ps(tangent.y), tz = _mm_set1_ps(tangent.z);
+                const __m128 bx = _mm_set1_ps(bitangent.x), by = _mm_set1_ps(bitangent.y), bz = _mm_set1_ps(bitangent.z);
+                const __m128 nx = _mm_set1_ps(n.x), ny = _mm_set1_ps(n.y), nz = _mm_set1_ps(n.z);
+                __m128 sum = _mm_setzero_ps();
+                float dx[4], dy[4], dz[4];
+                for (uint32_t i = 0; i < count; i += 4)
+                {
+                    const __m128 lx = _mm_loadu_ps(&set.x[i]), ly = _mm_loadu_ps(&set.y[i]), lz = _mm_loadu_ps(&set.z[i]);
+                    _mm_storeu_ps(dx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, lx), _mm_mul_ps(bx, ly)), _mm_mul_ps(nx, lz)));
+                    _mm_storeu_ps(dy, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ty, lx), _mm_mul_ps(by, ly)), _mm_mul_ps(ny, lz)));
+                    _mm_storeu_ps(dz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(tz, lx), _mm_mul_ps(bz, ly)), _mm_mul_ps(nz, lz)));
+
+                    for (uint32_t lane = 0; lane < 4; ++lane)
+                    {
+                        if (set.weights[i + lane] == 0.f)
+                        {
+                            continue;
+                        }
+                        float s, t;
+                        const uint32_t sampleFace = DirectionToFace(dx[lane], dy[lane], dz[lane], s, t);
+                        BilinearTaps taps;
+                        GetBilinearTaps(source[set.levels[i + lane]].faces[sampleFace], s, t, set.weights[i + lane], taps);
+                        for (uint32_t k = 0; k < 4; ++k)
+                        {
+                            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(taps.weights[k]), _mm_loadu_ps(taps.texels[k])));
+                        }
+                    }
+                }
+                _mm_storeu_ps(out, _mm_mul_ps(sum, _mm_set1_ps(set.inverseTotal)));
+#else
+                float sum[4] = {};
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    if (set.weights[i] == 0.f)
+                    {
+                        continue;
+                    }
+                    const float dx = (tangent.x * set.x[i] + bitangent.x * set.y[i]) + n.x * set.z[i];
+                    const float dy = (tangent.y * set.x[i] + bitangent.y * set.y[i]) + n.y * set.z[i];
+                    const float dz = (tangent.z * set.x[i] + bitangent.z * set.y[i]) + n.z * set.z[i];
+                    float s, t;
+                    const uint32_t sampleFace = DirectionToFace(dx, dy, dz, s, t);
+                    BilinearTaps taps;
+                    GetBilinearTaps(source[set.levels[i]].faces[sampleFace], s, t, set.weights[i], taps);
+                    for (uint32_t k = 0; k < 4; ++k)
+                    {
+                        for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            sum[c] += taps.weights[k] * taps.texels[k][c];
+                        }
+                    }
+                }
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    out[c] = sum[c] * set.inverseTotal;
+                }
+#endif
+            }
+        }
+    }
+
+    void EncodeTexels(const float* texels, size_t count, bool srgb, uint8_t* dest)
+    {
+        for (size_t i = 0; i < count; ++i, texels += 4, dest += 4)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                float v = std::min(std::max(texels[c], 0.f), 1.f);
+                if (srgb && c < 3)
+                {
+                    v = LinearToSrgb(v);
+                }
+                dest[c] = uint8_t(v * 255.f + 0.5f);
+            }
+        }
+    }
+
+    // Solid angle of the face area from the centre to (x, y), in face units.
+    float AreaElement(float x, float y)
+    {
+        return std::atan2(x * y, std::sqrt(x * x + y * y + 1.f));
+    }
+
+    // The real SH basis up to band two.
+    void EvaluateBasis(const Float3& d, float basis[9])
+    {
+        basis[0] = 0.282095f;
+        basis[1] = 0.488603f * d.y;
+        basis[2] = 0.488603f * d.z;
+        basis[3] = 0.488603f * d.x;
+        basis[4] = 1.092548f * d.x * d.y;
+        basis[5] = 1.092548f * d.y * d.z;
+        basis[6] = 0.315392f * (3.f * d.z * d.z - 1.f);
+        basis[7] = 1.092548f * d.x * d.z;
+        basis[8] = 0.546274f * (d.x * d.x - d.y * d.y);
+    }
+}
+
+float DX::GetPrefilteredRoughness(uint32_t mip, uint32_t mipLevels)
+{
+    return (mipLevels > 1) ? float(mip) / (mipLevels - 1) : 0.f;
+}
+
+float DX::GetPrefilteredMip(float roughness, uint32_t mipLevels)
+{
+    return std::min(std::max(roughness, 0.f), 1.f) * (mipLevels > 1 ? mipLevels - 1 : 0);
+}
+
+TextureData DX::PrefilterEnvironment(const TextureData& cubemap, const PrefilterOptions& options, JobSystem* jobs)
+{
+    ValidateCubemap(cubemap, "PrefilterEnvironment");
+    if (options.sampleCount == 0)
+    {
+        throw std::runtime_error("PrefilterEnvironment: no samples");
+    }
+
+    const uint32_t size = cubemap.desc.width;
+    uint32_t fullChain = 1;
+    while ((size >> fullChain) != 0)
+    {
+        ++fullChain;
+    }
+
+    TextureData result;
+    result.desc = cubemap.desc;
+    result.desc.format = TextureFormat::RGBA8;
+    result.desc.mipLevels = (options.mipLevels == 0) ? fullChain : std::min(options.mipLevels, fullChain);
+
+    size_t payload = 0;
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        for (uint32_t mip = 0; mip < result.desc.mipLevels; ++mip)
+        {
+            TextureSurface surface;
+            surface.width = surface.height = std::max(1u, size >> mip);
+            GetSurfaceInfo(TextureFormat::RGBA8, surface.width, surface.height, surface.rowPitch, surface.slicePitch);
+            surface.offset = payload;
+            payload += surface.slicePitch;
+            result.surfaces.push_back(surface);
+        }
+    }
+    result.pixels.resize(payload);
+
+    // Mip zero goes out as decoded; its linear copy, boxed down to 1x1, is
+    // what the samples read.
+    std::vector<CubeLevel> source(fullChain);
+    uint32_t* top[6];
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        top[face] = reinterpret_cast<uint32_t*>(result.pixels.data() + result.GetSurface(face, 0).offset);
+    }
+    DecodeFaces(cubemap, options.srgb, top, source[0], jobs);
+    for (uint32_t level = 1; level < fullChain; ++level)
+    {
+        ForEach(jobs, 6, [&](uint32_t face)
+        {
+            Downsample(source[level - 1].faces[face], source[level].faces[face]);
+        });
+    }
+
+    // Every band of every face of every level in one pass, so the small
+    // levels fill in around the large ones.
+    struct Band
+    {
+        uint32_t mip, face, y0, y1;
+    };
+    std::vector<SampleSet> sampleSets(result.desc.mipLevels);
+    std::vector<Image> filtered(size_t(result.desc.mipLevels) * 6);
+    std::vector<Band> bands;
+    for (uint32_t mip = 1; mip < result.desc.mipLevels; ++mip)
+    {
+        const uint32_t mipSize = std::max(1u, size >> mip);
+        BuildSampleSet(GetPrefilteredRoughness(mip, result.desc.mipLevels), options.sampleCount, size, fullChain, sampleSets[mip]);
+        for (uint32_t face = 0; face < 6; ++face)
+        {
+            filtered[mip * 6 + face].Resize(mipSize, mipSize);
+            for (uint32_t y0 = 0; y0 < mipSize; y0 += RowsPerJob)
+            {
+                bands.push_back(Band{ mip, face, y0, std::min(mipSize, y0 + RowsPerJob) });
+            }
+        }
+    }
+
+    ForEach(jobs, uint32_t(bands.size()), [&](uint32_t index)
+    {
+        const Band& band = bands[index];
+        Image& image = filtered[band.mip * 6 + band.face];
+        FilterRows(source, sampleSets[band.mip], band.face, image.width, band.y0, band.y1, image.Row(band.y0));
+        EncodeTexels(image.Row(band.y0), size_t(band.y1 - band.y0) * image.width, options.srgb,
+            result.pixels.data() + result.GetSurface(band.face, band.mip).offset + size_t(band.y0) * image.width * 4);
+    });
+
+    return result;
+}
+
+IrradianceSH DX::ComputeIrradianceSH(const TextureData& cubemap, bool srgb, JobSystem* jobs)
+{
+    ValidateCubemap(cubemap, "ComputeIrradianceSH");
+
+    const uint32_t size = cubemap.desc.width;
+    std::vector<uint32_t> decoded(size_t(size) * size * 6);
+    uint32_t* faces[6];
+    for (uint32_t face = 0; face < 6; ++face)
+    {
+        faces[face] = decoded.data() + size_t(face) * size * size;
+    }
+    CubeLevel level;
+    DecodeFaces(cubemap, srgb, faces, level, jobs);
+
+    // Every face has the same texel solid angles, from the area elements
+    // at the texel corners.
+    const float step = 2.f / size;
+    std::vector<float> corners(size_t(size + 1) * (size + 1));
+    for (uint32_t y = 0; y <= size; ++y)
+    {
+        for (uint32_t x = 0; x <= size; ++x)
+        {
+            corners[size_t(y) * (size + 1) + x] = AreaElement(x * step - 1.f, y * step - 1.f);
+        }
+    }
+
+    // Each band sums into its own slot and the slots are added in order,
+    // so any thread count gives the same coefficients.
+    const uint32_t bandsPerFace = (size + RowsPerJob - 1) / RowsPerJob;
+    std::vector<float> partials(size_t(bandsPerFace) * 6 * 9 * 4);
+    ForEach(jobs, bandsPerFace * 6, [&](uint32_t index)
+    {
+        const uint32_t face = index / bandsPerFace;
+        const uint32_t y0 = (index % bandsPerFace) * RowsPerJob, y1 = std::min(size, y0 + RowsPerJob);
+        const Image& image = level.faces[face];
+        float* partial = &partials[size_t(index) * 9 * 4];
+
+#if defined(ENVIRONMENT_PREFILTER_SSE2)
+        __m128 sums[9];
+        for (uint32_t k = 0; k < 9; ++k)
+        {
+            sums[k] = _mm_setzero_ps();
+        }
+#else
+        float sums[9][4] = {};
+#endif
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            const float* texel = image.Row(y);
+            const float* top = &corners[size_t(y) * (size + 1)];
+            const float* bottom = top + size + 1;
+            const float v = (y + 0.5f) * step - 1.f;
+            for (uint32_t x = 0; x < size; ++x, texel += 4)
+            {
+                const float solidAngle = top[x] - bottom[x] - top[x + 1] + bottom[x + 1];
+
+                float basis[9];
+                EvaluateBasis(FaceDirection(face, (x + 0.5f) * step - 1.f, v).Normalized(), basis);
+#if defined(ENVIRONMENT_PREFILTER_SSE2)
+                const __m128 radiance = _mm_mul_ps(_mm_loadu_ps(texel), _mm_set1_ps(solidAngle));
+                for (uint32_t k = 0; k < 9; ++k)
+                {
+                    sums[k] = _mm_add_ps(sums[k], _mm_mul_ps(_mm_set1_ps(basis[k]), radiance));
+                }
+#else
+                for (uint32_t k = 0; k < 9; ++k)
+                {
+                    for (uint32_t c = 0; c < 4; ++c)
+                    {
+                        sums[k][c] += basis[k] * (texel[c] * solidAngle);
+                    }
+                }
+#endif
+            }
+        }
+        for (uint32_t k = 0; k < 9; ++k)
+        {
+#if defined(ENVIRONMENT_PREFILTER_SSE2)
+            _mm_storeu_ps(partial + k * 4, sums[k]);
+#else
+            std::copy(sums[k], sums[k] + 4, partial + k * 4);
+#endif
+        }
+    });
+
+    // Convolving with the clamped cosine scales band l by A_l (pi, 2pi/3,
+    // pi/4); dividing by pi leaves reflected radiance.
+    const float bandScale[9] = { 1.f, 2.f / 3.f, 2.f / 3.f, 2.f / 3.f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+    IrradianceSH sh = {};
+    for (size_t index = 0; index < size_t(bandsPerFace) * 6; ++index)
+    {
+        const float* partial = &partials[index * 9 * 4];
+        for (uint32_t k = 0; k < 9; ++k)
+        {
+            sh.coefficients[k] += Float3{ partial[k * 4], partial[k * 4 + 1], partial[k * 4 + 2] };
+        }
+    }
+    for (uint32_t k = 0; k < 9; ++k)
+    {
+        sh.coefficients[k] = sh.coefficients[k] * bandScale[k];
+    }
+    return sh;
+}
+
+Float3 DX::EvaluateIrradiance(const IrradianceSH& sh, const Float3& normal)
+{
+    float basis[9];
+    EvaluateBasis(normal, basis);
+
+    Float3 result = sh.coefficients[0] * basis[0];
+    for (uint32_t k = 1; k < 9; ++k)
+    {
+        result += sh.coefficients[k] * basis[k];
+    }
+    return Float3{ std::max(result.x, 0.f), std::max(result.y, 0.f), std::max(result.z, 0.f) };
+}
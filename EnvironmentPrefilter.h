@@ -0,0 +1,60 @@
+//
+// EnvironmentPrefilter.h - Image-based lighting from a cubemap: a GGX
+// prefiltered mip chain for reflections and spherical-harmonics irradiance
+// for the diffuse term
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "JobSystem.h"
+#include "TextureData.h"
+
+#include <stdint.h>
+
+namespace DX
+{
+    struct PrefilterOptions
+    {
+        uint32_t    sampleCount;        // GGX samples per texel on every level below mip zero.
+        uint32_t    mipLevels;          // Zero for the full chain down to 1x1.
+        bool        srgb;               // Colour is sRGB-encoded: filtered in linear light, then re-encoded.
+    };
+
+    // Roughness a level of the prefiltered chain is convolved for: zero at
+    // mip zero, rising linearly to one at the last level.
+    float GetPrefilteredRoughness(uint32_t mip, uint32_t mipLevels);
+
+    // The level, possibly fractional, to sample for a roughness.
+    float GetPrefilteredMip(float roughness, uint32_t mipLevels);
+
+    // Convolves a cubemap with the GGX lobe of each level's roughness, for
+    // the split-sum approximation (normal, view and reflection taken as one
+    // direction). Any format LoadDDS reads goes in, RGBA8 comes out, mip
+    // zero decoded unchanged. Samples are importance-sampled and read from
+    // a box-filtered copy of the source at the mip matching their solid
+    // angle, so a few dozen per texel are enough. With jobs, faces and rows
+    // of every level are split across the workers. Throws
+    // std::runtime_error if the texture is not a cubemap.
+    TextureData PrefilterEnvironment(const TextureData& cubemap, const PrefilterOptions& options, JobSystem* jobs = nullptr);
+
+    // Diffuse lighting from every direction of a cubemap, in the first
+    // three bands of spherical harmonics (nine coefficients per channel).
+    // Already convolved with the clamped cosine and divided by pi, so
+    // EvaluateIrradiance gives the colour a white diffuse surface reflects.
+    struct IrradianceSH
+    {
+        Float3  coefficients[9];
+
+        // The same, averaged over every normal: the term a flat ambient
+        // light would use.
+        Float3 GetAverage() const   { return coefficients[0] * 0.282095f; }
+    };
+
+    // Projects mip zero of every face, each texel weighted by its solid
+    // angle, in linear light if srgb. With jobs, faces and rows are split
+    // across the workers; the result does not depend on the thread count.
+    IrradianceSH ComputeIrradianceSH(const TextureData& cubemap, bool srgb, JobSystem* jobs = nullptr);
+
+    Float3 EvaluateIrradiance(const IrradianceSH& sh, const Float3& normal);
+}
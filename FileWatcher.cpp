@@ -0,0 +1,168 @@
+//
+// FileWatcher.cpp
+//
+
+#include "FileWatcher.h"
+
+#include <chrono>
+#include <stdexcept>
+
+#if defined(__linux__)
+#define FILE_WATCHER_INOTIFY
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define FILE_WATCHER_CHANGE_NOTIFICATION
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace DX;
+
+FileWatcher::FileWatcher(const std::string& directory) :
+    m_directory(directory),
+    m_watch(-1),
+    m_wake(-1),
+    m_wakePending(false)
+{
+#if defined(FILE_WATCHER_INOTIFY)
+    int watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch < 0)
+    {
+        throw std::runtime_error("FileWatcher: inotify_init1 failed");
+    }
+
+    // Editors either rewrite a file in place (close after write) or write a
+    // temporary and rename it over the original (moved to).
+    if (inotify_add_watch(watch, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        close(watch);
+        throw std::runtime_error("FileWatcher: cannot watch " + directory);
+    }
+
+    int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake < 0)
+    {
+        close(watch);
+        throw std::runtime_error("FileWatcher: eventfd failed");
+    }
+
+    m_watch = watch;
+    m_wake = wake;
+#elif defined(FILE_WATCHER_CHANGE_NOTIFICATION)
+    HANDLE watch = FindFirstChangeNotificationA(directory.c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (watch == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("FileWatcher: cannot watch " + directory);
+    }
+
+    HANDLE wake = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (!wake)
+    {
+        FindCloseChangeNotification(watch);
+        throw std::runtime_error("FileWatcher: CreateEvent failed");
+    }
+
+    m_watch = reinterpret_cast<intptr_t>(watch);
+    m_wake = reinterpret_cast<intptr_t>(wake);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#if defined(FILE_WATCHER_INOTIFY)
+    close(int(m_watch));
+    close(int(m_wake));
+#elif defined(FILE_WATCHER_CHANGE_NOTIFICATION)
+    FindCloseChangeNotification(reinterpret_cast<HANDLE>(m_watch));
+    CloseHandle(reinterpret_cast<HANDLE>(m_wake));
+#endif
+}
+
+bool FileWatcher::Wait(std::vector<std::string>& changed, uint32_t timeoutMilliseconds)
+{
+#if defined(FILE_WATCHER_INOTIFY)
+    pollfd fds[2] = { { int(m_watch), POLLIN, 0 }, { int(m_wake), POLLIN, 0 } };
+    int ready = poll(fds, 2, int(timeoutMilliseconds));
+    if (ready < 0 && errno != EINTR)
+    {
+        throw std::runtime_error("FileWatcher: poll failed");
+    }
+    if (ready <= 0)
+    {
+        return false;
+    }
+    if (fds[1].revents & POLLIN)
+    {
+        uint64_t count;
+        ssize_t result = read(int(m_wake), &count, sizeof(count));
+        (void)result;
+        return false;
+    }
+
+    // Drain everything queued; one save often produces several events.
+    alignas(inotify_event) char buffer[4096];
+    for (;;)
+    {
+        ssize_t length = read(int(m_watch), buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            break;
+        }
+
+        for (ssize_t offset = 0; offset < length; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (!(event->mask & IN_Q_OVERFLOW) && event->len > 0)
+            {
+                changed.emplace_back(event->name);
+            }
+            offset += ssize_t(sizeof(inotify_event) + event->len);
+        }
+    }
+    return true;
+#elif defined(FILE_WATCHER_CHANGE_NOTIFICATION)
+    HANDLE handles[2] = { reinterpret_cast<HANDLE>(m_watch), reinterpret_cast<HANDLE>(m_wake) };
+    DWORD result = WaitForMultipleObjects(2, handles, FALSE, timeoutMilliseconds);
+    if (result != WAIT_OBJECT_0)
+    {
+        return false;
+    }
+
+    FindNextChangeNotification(handles[0]);
+    (void)changed;
+    return true;
+#else
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool woken = m_woken.wait_for(lock, std::chrono::milliseconds(timeoutMilliseconds), [&] { return m_wakePending; });
+    m_wakePending = false;
+    (void)changed;
+    return !woken;
+#endif
+}
+
+void FileWatcher::Wake()
+{
+#if defined(FILE_WATCHER_INOTIFY)
+    uint64_t count = 1;
+    ssize_t result = write(int(m_wake), &count, sizeof(count));
+    (void)result;
+#elif defined(FILE_WATCHER_CHANGE_NOTIFICATION)
+    SetEvent(reinterpret_cast<HANDLE>(m_wake));
+#else
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakePending = true;
+    }
+    m_woken.notify_one();
+#endif
+}
@@ -0,0 +1,51 @@
+//
+// FileWatcher.h - Reports files written in a directory: inotify on Linux,
+// change notifications on Windows and a timed rescan anywhere else
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    class FileWatcher
+    {
+    public:
+        // Watches the files directly in directory, not subdirectories.
+        // Throws std::runtime_error if the directory cannot be watched.
+        explicit FileWatcher(const std::string& directory);
+        ~FileWatcher();
+
+        FileWatcher(FileWatcher const&) = delete;
+        FileWatcher& operator=(FileWatcher const&) = delete;
+
+        // Waits up to timeoutMilliseconds for a change and appends the names
+        // of files written, created or renamed into the directory. Returns
+        // false on timeout or Wake. True with nothing appended means files
+        // changed but the platform cannot say which (Windows, the polling
+        // fallback, or an inotify queue overflow): rescan them all.
+        bool Wait(std::vector<std::string>& changed, uint32_t timeoutMilliseconds);
+
+        // Makes a Wait on another thread return false now.
+        void Wake();
+
+    private:
+        std::string                 m_directory;
+
+        // inotify and eventfd descriptors, or the change notification and
+        // wake event handles.
+        intptr_t                    m_watch;
+        intptr_t                    m_wake;
+
+        // Polling fallback.
+        std::mutex                  m_mutex;
+        std::condition_variable     m_woken;
+        bool                        m_wakePending;
+    };
+}
@@ -0,0 +1,77 @@
+//
+// FrameArena.cpp
+//
+
+#include "FrameArena.h"
+
+#include <algorithm>
+
+using namespace DX;
+
+FrameArena::FrameArena(size_t capacityBytes) :
+    m_current(0),
+    m_offset(0),
+    m_used(0),
+    m_capacity(0),
+    m_highWater(0),
+    m_overflows(0)
+{
+    AddBlock(capacityBytes ? capacityBytes : 1);
+}
+
+void FrameArena::AddBlock(size_t minimumBytes)
+{
+    Block block;
+    block.size = minimumBytes;
+    block.memory.reset(new uint8_t[minimumBytes]);
+
+    m_capacity += minimumBytes;
+    m_blocks.push_back(std::move(block));
+}
+
+void* FrameArena::Allocate(size_t sizeBytes, size_t alignment)
+{
+    for (;;)
+    {
+        Block& block = m_blocks[m_current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+        uintptr_t aligned = (base + m_offset + alignment - 1) & ~uintptr_t(alignment - 1);
+        size_t end = size_t(aligned - base) + sizeBytes;
+
+        if (end <= block.size)
+        {
+            m_used += end - m_offset;
+            m_offset = end;
+            m_highWater = std::max(m_highWater, m_used);
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        // The rest of this block is wasted; count it so the folded block
+        // after Reset is large enough for the same frame.
+        m_used += block.size - m_offset;
+
+        if (m_current + 1 == m_blocks.size())
+        {
+            AddBlock(std::max(block.size * 2, sizeBytes + alignment));
+            ++m_overflows;
+        }
+
+        ++m_current;
+        m_offset = 0;
+    }
+}
+
+void FrameArena::Reset()
+{
+    if (m_blocks.size() > 1)
+    {
+        size_t size = std::max(m_capacity, m_highWater);
+        m_blocks.clear();
+        m_capacity = 0;
+        AddBlock(size);
+    }
+
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+}
@@ -0,0 +1,75 @@
+//
+// FrameArena.h - Bump allocator reset once per frame, for transient data
+// that should not touch the heap in a steady state
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace DX
+{
+    // Hands out memory by bumping an offset and takes it all back in Reset.
+    // Nothing allocated from it is ever destroyed, so only trivially
+    // destructible types may live here.
+    //
+    // A frame that outgrows the arena chains another heap block rather than
+    // failing. The next Reset folds every block into one sized for that
+    // peak, so the arena stops allocating once the frames settle.
+    class FrameArena
+    {
+    public:
+        explicit FrameArena(size_t capacityBytes = 64 * 1024);
+
+        FrameArena(FrameArena const&) = delete;
+        FrameArena& operator=(FrameArena const&) = delete;
+
+        // alignment must be a power of two. Never returns null.
+        void* Allocate(size_t sizeBytes, size_t alignment = alignof(std::max_align_t));
+
+        // Array of count default-initialized elements; trivial types are
+        // left as the memory was.
+        template <typename T>
+        T* AllocateArray(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+            T* items = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+            for (size_t i = 0; i < count; ++i)
+            {
+                new (&items[i]) T;
+            }
+            return items;
+        }
+
+        // Invalidates everything allocated since the last Reset.
+        void Reset();
+
+        size_t GetUsedBytes() const         { return m_used; }
+        size_t GetCapacity() const          { return m_capacity; }
+        size_t GetHighWaterBytes() const    { return m_highWater; }
+        uint32_t GetOverflowCount() const   { return m_overflows; }    // Extra blocks chained, ever.
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<uint8_t[]>  memory;
+            size_t                      size;
+        };
+
+        void AddBlock(size_t minimumBytes);
+
+        std::vector<Block>  m_blocks;
+        size_t              m_current;      // Block being bumped.
+        size_t              m_offset;       // Within m_blocks[m_current].
+        size_t              m_used;         // Across all blocks, including alignment padding.
+        size_t              m_capacity;
+        size_t              m_highWater;
+        uint32_t            m_overflows;
+    };
+}
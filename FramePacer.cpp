@@ -0,0 +1,193 @@
+//
+// FramePacer.cpp
+//
+
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#define FRAME_PACER_WAITABLE_TIMER
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+
+// Windows 10 1803 and later; older versions fail the create and fall back.
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+using namespace DX;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::duration<int64_t, std::ratio<1, FramePacer::TicksPerSecond>> Ticks;
+
+    Clock::duration FromTicks(uint64_t ticks)
+    {
+        return std::chrono::duration_cast<Clock::duration>(Ticks(int64_t(ticks)));
+    }
+
+    uint64_t Nanoseconds(Clock::duration duration)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    }
+}
+
+FramePacer::FramePacer(uint64_t frameIntervalTicks, uint64_t spinTicks) :
+    m_frameInterval(frameIntervalTicks),
+    m_spinTicks(spinTicks),
+    m_suspended(false),
+    m_started(false),
+    m_waited(true),
+    m_timer(nullptr),
+    m_stats{}
+{
+#if defined(FRAME_PACER_WAITABLE_TIMER)
+    m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!m_timer)
+    {
+        // Only as fine as the system timer period, so the spin does more.
+        m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+#if defined(FRAME_PACER_WAITABLE_TIMER)
+    if (m_timer)
+    {
+        CloseHandle(m_timer);
+    }
+#endif
+}
+
+void FramePacer::Schedule(uint64_t ticksUntilUpdate)
+{
+    Clock::time_point now = Clock::now();
+    if (!m_started)
+    {
+        m_deadline = now;
+        m_started = true;
+    }
+
+    Clock::duration interval;
+    Clock::time_point next;
+    if (m_suspended)
+    {
+        interval = FromTicks(SuspendedIntervalTicks);
+        next = m_deadline + interval;
+    }
+    else
+    {
+        interval = FromTicks(m_frameInterval);
+        next = now + FromTicks(ticksUntilUpdate);
+        if (m_frameInterval != 0)
+        {
+            next = std::min(next, m_deadline + interval);
+        }
+    }
+
+    // A whole interval behind: start again from now rather than run a
+    // burst of frames with no wait between them.
+    if (next + interval < now)
+    {
+        next = now;
+    }
+
+    m_deadline = next;
+    m_waited = false;
+}
+
+bool FramePacer::Wait(bool wakeOnMessages)
+{
+    if (m_waited)
+    {
+        return true;
+    }
+
+    Clock::time_point start = Clock::now();
+    if (start >= m_deadline)
+    {
+        ++m_stats.lateFrames;
+        ++m_stats.frames;
+        m_waited = true;
+        return true;
+    }
+
+    Clock::time_point spinStart = m_deadline - FromTicks(m_spinTicks);
+    if (start < spinStart)
+    {
+        bool reached = SleepUntil(spinStart, wakeOnMessages);
+        m_stats.sleepNanoseconds += Nanoseconds(Clock::now() - start);
+        if (!reached)
+        {
+            return false;
+        }
+    }
+
+    // Yield rather than burn the core outright; other threads of the
+    // process (render, workers) may want it.
+    Clock::time_point spinBegin = Clock::now();
+    Clock::time_point now = spinBegin;
+    while (now < m_deadline)
+    {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    m_stats.spinNanoseconds += Nanoseconds(now - spinBegin);
+
+    uint64_t lateness = Nanoseconds(now - m_deadline);
+    m_stats.totalLatenessNanoseconds += lateness;
+    m_stats.maxLatenessNanoseconds = std::max(m_stats.maxLatenessNanoseconds, lateness);
+    ++m_stats.frames;
+    m_waited = true;
+    return true;
+}
+
+bool FramePacer::SleepUntil(Clock::time_point until, bool wakeOnMessages)
+{
+#if defined(FRAME_PACER_WAITABLE_TIMER)
+    Clock::duration remaining = until - Clock::now();
+    if (remaining <= Clock::duration::zero())
+    {
+        return true;
+    }
+
+    if (m_timer)
+    {
+        // Negative due times are relative, in 100ns units.
+        LARGE_INTEGER due;
+        due.QuadPart = -std::max<LONGLONG>(1, std::chrono::duration_cast<Ticks>(remaining).count());
+        if (SetWaitableTimer(m_timer, &due, 0, nullptr, nullptr, FALSE))
+        {
+            if (wakeOnMessages)
+            {
+                return MsgWaitForMultipleObjectsEx(1, &m_timer, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_OBJECT_0;
+            }
+            WaitForSingleObject(m_timer, INFINITE);
+            return true;
+        }
+    }
+
+    if (wakeOnMessages)
+    {
+        DWORD milliseconds = DWORD(std::chrono::duration_cast<std::chrono::milliseconds>(remaining).count());
+        return MsgWaitForMultipleObjectsEx(0, nullptr, milliseconds, QS_ALLINPUT, MWMO_INPUTAVAILABLE) == WAIT_TIMEOUT;
+    }
+#else
+    (void)wakeOnMessages;
+#endif
+
+    // clock_nanosleep on POSIX, which is already fine-grained.
+    std::this_thread::sleep_until(until);
+    return true;
+}
@@ -0,0 +1,82 @@
+//
+// FramePacer.h - Sleeps the main loop until the next frame is due instead of
+// letting it spin, finishing each wait with a short spin for precision
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <chrono>
+
+namespace DX
+{
+    struct FramePacerStats
+    {
+        uint64_t frames;                    // Waits that reached their deadline.
+        uint64_t lateFrames;                // Deadlines already past when the wait began.
+        uint64_t sleepNanoseconds;
+        uint64_t spinNanoseconds;
+        uint64_t totalLatenessNanoseconds;  // Wake-up time past the deadline, summed.
+        uint64_t maxLatenessNanoseconds;
+    };
+
+    // Each frame the caller schedules the next deadline, then waits for it.
+    // The wait sleeps on the platform's high-resolution timer until spinTicks
+    // before the deadline and spins the rest, so the thread is idle for most
+    // of the frame yet wakes within microseconds.
+    //
+    // Deadlines advance from the previous deadline, not from when the frame
+    // finished, so the rate does not drift; a frame that overruns by a whole
+    // interval restarts the schedule from now rather than bursting to catch up.
+    class FramePacer
+    {
+    public:
+        // Same units as StepTimer and InputQueue.
+        static const uint64_t TicksPerSecond = 10000000;
+        static const uint64_t DefaultSpinTicks = TicksPerSecond / 2000;         // 0.5ms
+        static const uint64_t SuspendedIntervalTicks = TicksPerSecond / 10;
+
+        // frameIntervalTicks caps the frame rate; zero leaves only the
+        // update deadline passed to Schedule.
+        explicit FramePacer(uint64_t frameIntervalTicks, uint64_t spinTicks = DefaultSpinTicks);
+        ~FramePacer();
+
+        FramePacer(FramePacer const&) = delete;
+        FramePacer& operator=(FramePacer const&) = delete;
+
+        void SetFrameInterval(uint64_t ticks)       { m_frameInterval = ticks; }
+
+        // While suspended (minimized or power-suspended) frames come no
+        // more often than SuspendedIntervalTicks, whatever is scheduled.
+        void SetSuspended(bool suspended)           { m_suspended = suspended; }
+        bool IsSuspended() const                    { return m_suspended; }
+
+        // Sets the next deadline: one frame interval after the last, or
+        // ticksUntilUpdate from now if the next simulation step comes first.
+        void Schedule(uint64_t ticksUntilUpdate);
+
+        // Blocks until the scheduled deadline. With wakeOnMessages (Windows
+        // only) a window message arriving first cuts the sleep short and it
+        // returns false; call again after handling it. Returns true once the
+        // deadline has passed.
+        bool Wait(bool wakeOnMessages = false);
+
+        const FramePacerStats& GetStats() const     { return m_stats; }
+        void ResetStats()                           { m_stats = FramePacerStats{}; }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        bool SleepUntil(Clock::time_point until, bool wakeOnMessages);
+
+        uint64_t            m_frameInterval;
+        uint64_t            m_spinTicks;
+        bool                m_suspended;
+        bool                m_started;
+        bool                m_waited;       // The current deadline was already reached.
+        Clock::time_point   m_deadline;
+        void*               m_timer;        // High-resolution waitable timer on Windows.
+        FramePacerStats     m_stats;
+    };
+}
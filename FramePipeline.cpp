@@ -0,0 +1,144 @@
+//
+// FramePipeline.cpp
+//
+
+#include "FramePipeline.h"
+#include "Profiler.h"
+
+#include <chrono>
+
+using namespace DX;
+
+namespace
+{
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+FramePipeline::FramePipeline(RenderFunction render, void* context, bool threaded) :
+    m_render(render),
+    m_context(context),
+    m_published(0),
+    m_rendered(0),
+    m_quit(false),
+    m_stats{}
+{
+    if (threaded)
+    {
+        m_thread = std::thread(&FramePipeline::RenderMain, this);
+    }
+}
+
+FramePipeline::~FramePipeline()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+}
+
+uint32_t FramePipeline::BeginWrite()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_published - m_rendered < SlotCount || m_error; });
+    m_stats.updateWaitNanoseconds += ElapsedNanoseconds(start);
+    RethrowRenderError();
+
+    return uint32_t(m_published % SlotCount);
+}
+
+void FramePipeline::Publish()
+{
+    if (!m_thread.joinable())
+    {
+        m_render(m_context, uint32_t(m_published % SlotCount));
+        ++m_published;
+        ++m_rendered;
+        m_stats.framesPublished = m_published;
+        m_stats.framesRendered = m_rendered;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_published;
+        m_stats.framesPublished = m_published;
+    }
+    m_wake.notify_one();
+}
+
+void FramePipeline::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_published == m_rendered || m_error; });
+    RethrowRenderError();
+}
+
+FramePipelineStats FramePipeline::GetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void FramePipeline::RethrowRenderError()
+{
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void FramePipeline::RenderMain()
+{
+    Profiler::SetThreadName("Render");
+
+    for (;;)
+    {
+        uint64_t frame;
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_published != m_rendered || m_quit; });
+            m_stats.renderWaitNanoseconds += ElapsedNanoseconds(start);
+
+            if (m_published == m_rendered)
+            {
+                return;
+            }
+            frame = m_rendered;
+        }
+
+        std::exception_ptr error;
+        try
+        {
+            m_render(m_context, uint32_t(frame % SlotCount));
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_rendered;
+            m_stats.framesRendered = m_rendered;
+            if (error && !m_error)
+            {
+                m_error = error;
+            }
+        }
+        m_done.notify_all();
+    }
+}
@@ -0,0 +1,83 @@
+//
+// FramePipeline.h - Hands each frame's scene snapshot from the update thread
+// to a render thread, so update and render of consecutive frames overlap
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace DX
+{
+    struct FramePipelineStats
+    {
+        uint64_t framesPublished;
+        uint64_t framesRendered;
+        uint64_t updateWaitNanoseconds;     // BeginWrite blocked on the render thread.
+        uint64_t renderWaitNanoseconds;     // Render thread idle, waiting for a frame.
+    };
+
+    // The caller keeps SlotCount copies of its per-frame state. Each frame
+    // it asks BeginWrite which copy to fill, fills it, and calls Publish.
+    // The render thread then calls render(context, slot) with that copy
+    // while the caller moves on to the next frame in the other one.
+    //
+    // A slot is only handed out again once the frame that last used it has
+    // rendered, so update runs at most one frame ahead of render: frame N+1
+    // is built while frame N renders, never N+2. Neither side sees the
+    // other's copy, so the state needs no locks of its own.
+    //
+    // Constructed unthreaded, Publish renders inline, which gives the
+    // serial loop through the same code for comparison.
+    class FramePipeline
+    {
+    public:
+        static const uint32_t SlotCount = 2;
+
+        typedef void (*RenderFunction)(void* context, uint32_t slot);
+
+        FramePipeline(RenderFunction render, void* context, bool threaded = true);
+
+        // Renders whatever was published, then stops the thread.
+        ~FramePipeline();
+
+        FramePipeline(FramePipeline const&) = delete;
+        FramePipeline& operator=(FramePipeline const&) = delete;
+
+        // The slot to fill for the next frame; waits while render still
+        // needs it. Rethrows anything the render thread threw since the
+        // last call.
+        uint32_t BeginWrite();
+        void Publish();
+
+        // Waits until every published frame has rendered. Call before
+        // touching anything the render function uses from this thread.
+        void Flush();
+
+        bool IsThreaded() const     { return m_thread.joinable(); }
+        FramePipelineStats GetStats();
+
+    private:
+        void RenderMain();
+        void RethrowRenderError();
+
+        RenderFunction              m_render;
+        void*                       m_context;
+
+        std::thread                 m_thread;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_wake;         // Render thread: a frame was published, or quit.
+        std::condition_variable     m_done;         // Update thread: a frame finished rendering.
+
+        uint64_t                    m_published;
+        uint64_t                    m_rendered;
+        bool                        m_quit;
+        std::exception_ptr          m_error;
+        FramePipelineStats          m_stats;
+    };
+}
@@ -4,6 +4,7 @@
 
 #include "pch.h"
 #include "Game.h"
+#include "ProceduralGeometry.h"
 
 extern void ExitGame();
 
@@ -11,6 +12,7 @@ using namespace DirectX;
 using namespace DirectX::SimpleMath;
 
 using Microsoft::WRL::ComPtr;
+using DX::RenderKey;
 
 namespace
 {
@@ -18,6 +20,100 @@ namespace
 	const XMVECTORF32 ROOM_BOUNDS = { 8.f, 6.f, 12.f, 0.f };
 	const float ROTATION_GAIN = 0.004f;
 	const float MOVEMENT_GAIN = 0.07f;
+	// Generous box around the unit teapot, including spout and handle.
+	const DX::Float3 TEAPOT_EXTENTS = { 1.f, 1.f, 1.f };
+	// Frames written by a trace capture, and how often the title summary refreshes.
+	const uint32_t TRACE_FRAMES = 120;
+	const uint64_t PROFILE_SUMMARY_INTERVAL = 30;
+
+	// Render on its own thread, one frame behind Update. False renders inline, as before.
+	const bool RENDER_THREAD = true;
+
+	// Frames blend between the 60 Hz steps, so rendering faster still shows
+	// smoother motion; past this there is nothing to gain. Vsync usually
+	// paces first.
+	const uint64_t MAX_FRAME_RATE = 240;
+
+	// Imported files kept in memory, so a lost device is rebuilt without
+	// touching the disk. Past this the least recently used are dropped and
+	// read back when next needed.
+	const uint64_t ASSET_MEMORY_BUDGET = 64ull << 20;
+
+	// Resident texture mips; past this the least visible textures are cut back.
+	const uint64_t TEXTURE_MEMORY_BUDGET = 32ull << 20;
+
+	// The porcelain glaze. EnvironmentMapEffect has no roughness input, so
+	// this picks the prefiltered level its reflections start from.
+	const float TEAPOT_ROUGHNESS = 0.25f;
+	const DX::PrefilterOptions ENVIRONMENT_PREFILTER = { 64, 0, true };
+
+	// The old per-step gains, as rates for the 60 Hz step.
+	const DX::CameraSettings CAMERA_SETTINGS =
+	{
+		DX::Float3{ START_POSITION.f[0], START_POSITION.f[1], START_POSITION.f[2] },
+		DX::Float3{ ROOM_BOUNDS.f[0], ROOM_BOUNDS.f[1], ROOM_BOUNDS.f[2] },
+		MOVEMENT_GAIN * 60.f,
+		ROTATION_GAIN,
+	};
+
+	// Primitives as CreateDevice draws them; the cache tessellates each once.
+	const DX::PrimitiveKey ROOM_PRIMITIVE = DX::PrimitiveKey::Box(
+		DX::Float3{ ROOM_BOUNDS.f[0], ROOM_BOUNDS.f[1], ROOM_BOUNDS.f[2] }, false, true);
+	const DX::PrimitiveKey EARTH_PRIMITIVE = DX::PrimitiveKey::Sphere();
+	const DX::PrimitiveKey TEAPOT_PRIMITIVE = DX::PrimitiveKey::Teapot();
+
+	static_assert(sizeof(DX::MeshVertex) == sizeof(VertexPositionNormalTexture), "MeshVertex layout mismatch");
+
+	// Generates through GeometricPrimitive's own tessellators, so cached shapes
+	// are exactly what CreateBox, CreateSphere and CreateTeapot would build.
+	void GenerateGeometricPrimitive(const DX::PrimitiveKey& key, DX::MeshData& mesh)
+	{
+		std::vector<VertexPositionNormalTexture> vertices;
+		switch (key.shape)
+		{
+		case DX::PrimitiveShape::Box:
+			GeometricPrimitive::CreateBox(vertices, mesh.indices,
+				XMFLOAT3(key.size.x, key.size.y, key.size.z), key.rhcoords, key.invertn);
+			break;
+		case DX::PrimitiveShape::Sphere:
+			GeometricPrimitive::CreateSphere(vertices, mesh.indices, key.size.x, key.tessellation, key.rhcoords, key.invertn);
+			break;
+		case DX::PrimitiveShape::Teapot:
+			GeometricPrimitive::CreateTeapot(vertices, mesh.indices, key.size.x, key.tessellation, key.rhcoords);
+			break;
+		}
+
+		mesh.vertices.resize(vertices.size());
+		memcpy(mesh.vertices.data(), vertices.data(), vertices.size() * sizeof(DX::MeshVertex));
+		mesh.subsets.assign(1, DX::MeshSubset{ 0, 0, uint32_t(mesh.indices.size()) });
+		mesh.ComputeBounds();
+	}
+
+	// Recordings keep the keyboard state as raw bits.
+	static_assert(sizeof(Keyboard::State) == sizeof(DX::RecordedTick::keys), "Keyboard::State size mismatch");
+
+	// Lerps scale and translation and slerps rotation.
+	Matrix InterpolateTransform(const Matrix& from, const Matrix& to, float t)
+	{
+		Vector3 fromScale, toScale, fromTranslation, toTranslation;
+		Quaternion fromRotation, toRotation;
+		if (!Matrix(from).Decompose(fromScale, fromRotation, fromTranslation)
+			|| !Matrix(to).Decompose(toScale, toRotation, toTranslation))
+		{
+			return t < 0.5f ? from : to;
+		}
+
+		return Matrix::CreateScale(Vector3::Lerp(fromScale, toScale, t))
+			* Matrix::CreateFromQuaternion(Quaternion::Slerp(fromRotation, toRotation, t))
+			* Matrix::CreateTranslation(Vector3::Lerp(fromTranslation, toTranslation, t));
+	}
+
+	DX::Matrix44 ToMatrix44(const Matrix& m)
+	{
+		DX::Matrix44 result;
+		memcpy(result.m, &m, sizeof(result.m));
+		return result;
+	}
 }
 
 Game::Game() noexcept :
@@ -25,14 +121,56 @@ Game::Game() noexcept :
 	m_outputWidth(800),
 	m_outputHeight(600),
 	m_featureLevel(D3D_FEATURE_LEVEL_9_1),
+	m_pacer(DX::FramePacer::TicksPerSecond / MAX_FRAME_RATE),
+	m_frame(nullptr),
+	m_showProfile(false),
+	m_captureTrace(false),
+	m_camera(CAMERA_SETTINGS),
+	m_inputTime(0),
+	m_tickKeyboard{},
+	m_replaying(false),
+	m_replayTick(0),
+	m_recordOrigin(0),
+	m_assets("."),
+	m_roomTexAsset(0),
+	m_skullAsset(0),
+	m_earthTexAsset(0),
+	m_teapotTexAsset(0),
+	m_cubemapAsset(0),
+	m_teapotMaterialAsset(0),
+	m_geometry(&GenerateGeometricPrimitive),
+	m_textureStreamer(".", TEXTURE_MEMORY_BUDGET),
+	m_roomTexStream(0),
+	m_teapotTexStream(0),
 	m_pitch(0),
-	m_yaw(0)
+	m_yaw(0),
+	m_lightPitch(0),
+	m_lightYaw(0),
+	m_earthTextureHandle(0),
+	m_fresnelFactor(0),
+	m_environmentTexture(0)
 {
 	m_cameraPos = START_POSITION.v;
 }
 
 Game::~Game()
 {
+	// Finish the frame in flight before anything it uses goes away.
+	m_pipeline.reset();
+
+	if (!m_recordPath.empty())
+	{
+		try
+		{
+			SaveRecording();
+		}
+		catch (const std::exception& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+	}
+
 	if (m_audEngine)
 	{
 		m_audEngine->Suspend();
@@ -45,9 +183,18 @@ Game::~Game()
 void Game::Initialize(HWND window, int width, int height)
 {
     m_window = window;
+	DX::Profiler::SetThreadName("Main");
     m_outputWidth = std::max(width, 1);
     m_outputHeight = std::max(height, 1);
 
+	RegisterAssets();
+
+	// Tessellate every primitive up front, in parallel. Device creation,
+	// now and after a device loss, then only uploads.
+	m_jobs = std::make_unique<DX::JobSystem>();
+	const DX::PrimitiveKey primitives[] = { ROOM_PRIMITIVE, EARTH_PRIMITIVE, TEAPOT_PRIMITIVE };
+	m_geometry.Prefetch(primitives, _countof(primitives), *m_jobs);
+
     CreateDevice();
 
     CreateResources();
@@ -55,9 +202,14 @@ void Game::Initialize(HWND window, int width, int height)
     m_timer.SetFixedTimeStep(true);
     m_timer.SetTargetElapsedSeconds(1.0 / 60);
 
+	m_occlusionCuller = std::make_unique<DX::OcclusionCuller>(*m_jobs);
+	m_earthOccluder = m_geometry.Get(EARTH_PRIMITIVE);	//the same mesh as m_earth
+
 	m_keyboard = std::make_unique<Keyboard>();
 	m_mouse = std::make_unique<Mouse>();
 	m_mouse->SetWindow(window);
+	m_inputTime = m_replaying ? 0 : DX::InputQueue::Now();
+	m_recordOrigin = m_inputTime;
 
 	AUDIO_ENGINE_FLAGS eflags = AudioEngine_Default;
 #ifdef _DEBUG
@@ -73,22 +225,197 @@ void Game::Initialize(HWND window, int width, int height)
 
 	nightVolume = 0.005f;
 	nightSlide = 0.001f;
+
+	m_pipeline = std::make_unique<DX::FramePipeline>(&Game::RenderFrame, this, RENDER_THREAD);
 }
 
 // Executes the basic game loop.
 void Game::Tick()
 {
-    m_timer.Tick([&]()
-    {
-        Update(m_timer);
-    });
+	if (m_replaying && m_replayTick == m_recording.ticks.size())
+	{
+		OutputDebugStringA("Replay finished\n");
+		ExitGame();
+		return;
+	}
 
-    Render();
+	DX::Profiler::BeginFrame();
+	{
+		DX_PROFILE_SCOPE("Tick");
+
+		// Everything the steps read from outside: the input clock, the
+		// keyboard and this tick's events, live or from the recording.
+		const uint64_t now = m_replaying ? BeginReplayTick() : BeginLiveTick();
+
+		// Each step takes the input that arrived during its own slice of wall-clock time.
+		auto step = [&]()
+		{
+			uint64_t stepStart = m_inputTime;
+			m_inputTime = std::min(m_inputTime + m_timer.GetElapsedTicks(), now);
+			m_camera.Step(m_tickInput, stepStart, m_inputTime);
+
+			CaptureFrameState(m_previousStep);
+			Update(m_timer);
+		};
+
+		if (m_replaying)
+		{
+			m_timer.Advance(m_recording.ticks[m_replayTick++].timeDelta, step);
+		}
+		else
+		{
+			m_timer.Tick(step);
+			if (!m_recordPath.empty())
+			{
+				m_recording.ticks.back().timeDelta = m_timer.GetLastTickDelta();
+			}
+		}
+
+		// Time the timer skipped (long stalls) is skipped by the input clock
+		// too. A replay's clock starts at zero, so this must not wrap when
+		// the tick began less than a step in.
+		const uint64_t elapsed = m_timer.GetElapsedTicks();
+		m_inputTime = std::max(m_inputTime, now > elapsed ? now - elapsed : 0);
+
+		// Don't try to render anything before the first Update. Otherwise hand
+		// the frame over; it renders while the next Update runs. The frame
+		// shows the scene part way between the last two 60 Hz steps, by the
+		// time left over since the latest, so motion stays smooth at any
+		// refresh rate.
+		if (m_timer.GetFrameCount() != 0)
+		{
+			uint32_t slot;
+			{
+				DX_PROFILE_SCOPE("WaitForRender");
+				slot = m_pipeline->BeginWrite();
+			}
+			WriteFrameState(m_frames[slot], float(m_timer.GetBlendFactor()));
+			m_pipeline->Publish();
+		}
+
+		// The next frame is due at the frame rate cap, or sooner if that
+		// is when the next step falls. Replays run flat out.
+		m_pacer.Schedule(m_replaying ? 0 : m_timer.GetTicksUntilNextUpdate());
+	}
+	DX::Profiler::EndFrame();
+
+	if (m_captureTrace)
+	{
+		// The render thread must not be recording while the trace is read.
+		m_captureTrace = false;
+		m_pipeline->Flush();
+		try
+		{
+			DX::Profiler::WriteChromeTrace("frame_trace.json", TRACE_FRAMES);
+		}
+		catch (const std::exception& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+	}
+
+	if (m_showProfile && DX::Profiler::GetFrameCount() % PROFILE_SUMMARY_INTERVAL == 0)
+	{
+		ShowProfileSummary();
+	}
+}
+
+// Hands the tick the events that arrived since the last one and the
+// keyboard as it stands, and records both when recording.
+uint64_t Game::BeginLiveTick()
+{
+	const uint64_t now = DX::InputQueue::Now();
+	const bool recording = !m_recordPath.empty();
+
+	m_tickKeyboard = m_keyboard->GetState();
+	if (recording)
+	{
+		uint32_t keys[8];
+		memcpy(keys, &m_tickKeyboard, sizeof(keys));
+		m_recording.AddTick(0, now - m_recordOrigin, keys);
+	}
+
+	m_input.ConsumeUntil(now, [&](const DX::InputEvent& event)
+	{
+		m_tickInput.Push(event);
+		if (recording)
+		{
+			DX::InputEvent recorded = event;
+			recorded.time -= m_recordOrigin;
+			m_recording.AddEvent(recorded);
+		}
+	});
+
+	return now;
+}
+
+// The same from the next recorded tick; live input is dropped. The input
+// clock restarts at zero with the replay, which only shifts it.
+uint64_t Game::BeginReplayTick()
+{
+	const DX::RecordedTick& tick = m_recording.ticks[m_replayTick];
+
+	m_input.ConsumeUntil(UINT64_MAX, [](const DX::InputEvent&) {});
+
+	const DX::InputEvent* events = m_recording.GetEvents(tick);
+	for (uint32_t i = 0; i < tick.eventCount; ++i)
+	{
+		m_tickInput.Push(events[i]);
+	}
+
+	memcpy(&m_tickKeyboard, tick.keys, sizeof(tick.keys));
+	return tick.inputTime;
+}
+
+void Game::RecordInput(const wchar_t* path)
+{
+	m_recordPath = path;
+	m_recording.Clear();
+}
+
+void Game::ReplayInput(const wchar_t* path)
+{
+	std::vector<uint8_t> blob = DX::ReadData(path);
+	m_recording = DX::LoadInputRecordingFromMemory(blob.data(), blob.size());
+	m_replaying = true;
+	m_replayTick = 0;
+}
+
+void Game::SaveRecording()
+{
+	std::vector<uint8_t> blob = DX::SaveInputRecordingToMemory(m_recording);
+
+	std::ofstream file(m_recordPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(blob.data()), std::streamsize(blob.size()));
+	if (!file)
+	{
+		throw std::runtime_error("SaveRecording");
+	}
+}
+
+// Puts the last frame's scopes under Tick, and their children, in the window title.
+void Game::ShowProfileSummary()
+{
+	char title[256];
+	int length = snprintf(title, sizeof(title), "Frame %.2f ms", DX::Profiler::GetLastFrameMilliseconds());
+
+	for (const DX::ProfileSummaryEntry& entry : DX::Profiler::GetLastFrameSummary())
+	{
+		if (entry.depth >= 1 && entry.depth <= 2 && length > 0 && size_t(length) < sizeof(title))
+		{
+			length += snprintf(title + length, sizeof(title) - length, " | %s %.2f ms", entry.name, entry.milliseconds);
+		}
+	}
+
+	SetWindowTextA(m_window, title);
 }
 
 // Updates the world.
 void Game::Update(DX::StepTimer const& timer)
 {
+	DX_PROFILE_SCOPE("Update");
+
     float elapsedTime = float(timer.GetElapsedSeconds());
 
     // TODO: Add your game logic here.
@@ -98,51 +425,43 @@ void Game::Update(DX::StepTimer const& timer)
 	m_hud_view = Matrix::CreateLookAt(eye, at, Vector3::UnitY);
 	m_hud_world = Matrix::Identity;
 
+	// Dragging with the left button captures the cursor; the look itself
+	// comes from the raw deltas the camera already consumed.
 	auto mouse = m_mouse->GetState();
+	m_mouse->SetMode(mouse.leftButton ? Mouse::MODE_RELATIVE : Mouse::MODE_ABSOLUTE);
 
-	if (mouse.positionMode == Mouse::MODE_RELATIVE)
+	auto kb = m_tickKeyboard;
+	m_keys.Update(kb);
+	if (kb.Escape)
 	{
-		Vector3 delta = Vector3(float(mouse.x), float(mouse.y), 0.f)
-			* ROTATION_GAIN;
-
-		m_pitch -= delta.y;
-		m_yaw -= delta.x;
-
-		// limit pitch to straight up or straight down
-		// with a little fudge-factor to avoid gimbal lock
-		float limit = XM_PI / 2.0f - 0.01f;
-		m_pitch = std::max(-limit, m_pitch);
-		m_pitch = std::min(+limit, m_pitch);
+		ExitGame();
+	}
 
-		// keep longitude in sane range by wrapping
-		if (m_yaw > XM_PI)
-		{
-			m_yaw -= XM_PI * 2.0f;
-		}
-		else if (m_yaw < -XM_PI)
+	if (m_keys.pressed.F1)
+	{
+		m_showProfile = !m_showProfile;
+		if (!m_showProfile)
 		{
-			m_yaw += XM_PI * 2.0f;
+			SetWindowTextA(m_window, "Game");
 		}
 	}
-
-	m_mouse->SetMode(mouse.leftButton ? Mouse::MODE_RELATIVE : Mouse::MODE_ABSOLUTE);
-	auto kb = m_keyboard->GetState();
-	if (kb.Escape)
+	if (m_keys.pressed.F2)
 	{
-		ExitGame();
+		m_captureTrace = true;
 	}
 
 	if (kb.Home)
 	{
-		m_cameraPos = START_POSITION.v;
-		m_pitch = m_yaw = 0;
+		m_camera.Reset();
 	}
 
-	Vector3 move = Vector3::Zero;
+	const DX::Float3& position = m_camera.GetPosition();
+	m_cameraPos = Vector3(position.x, position.y, position.z);
+	m_pitch = m_camera.GetPitch();
+	m_yaw = m_camera.GetYaw();
 
 	if (kb.Up || kb.W)
 	{
-		move.z += 1.f;
 		if (nightVolume <= 1) {
 			nightVolume += nightSlide;
 		}
@@ -152,7 +471,6 @@ void Game::Update(DX::StepTimer const& timer)
 	}
 	if (kb.Down || kb.S)
 	{
-		move.z -= 1.f;
 		if (nightVolume > 0) {
 			nightVolume -= nightSlide;
 		}
@@ -161,31 +479,6 @@ void Game::Update(DX::StepTimer const& timer)
 		}
 		
 	}
-	if (kb.Left || kb.A)
-		move.x += 1.f;
-
-	if (kb.Right || kb.D)
-		move.x -= 1.f;
-
-	if (kb.PageUp || kb.Space)
-		move.y += 1.f;
-
-	if (kb.PageDown || kb.X)
-		move.y -= 1.f;
-
-	Quaternion q = Quaternion::CreateFromYawPitchRoll(m_yaw, m_pitch, 0.f);
-
-	move = Vector3::Transform(move, q);
-
-	move *= MOVEMENT_GAIN;
-
-	m_cameraPos += move;
-
-	Vector3 halfBound = (Vector3(ROOM_BOUNDS.v) / Vector3(2.f))
-		- Vector3(0.1f, 0.1f, 0.1f);
-
-	m_cameraPos = Vector3::Min(m_cameraPos, halfBound);
-	m_cameraPos = Vector3::Max(m_cameraPos, -halfBound);
 
 	float time = float(timer.GetTotalSeconds());
 
@@ -202,7 +495,10 @@ void Game::Update(DX::StepTimer const& timer)
 	m_teapot_world = Matrix::CreateRotationZ(cosf(time) * 2.f) 
 		* SimpleMath::Matrix::CreateTranslation(2.0f, -2.0f, 0.0f)
 		* SimpleMath::Matrix::CreateRotationY(rotation * pi / 180);;
-	m_em_effect->SetFresnelFactor(cosf(time * 2.f));
+	m_fresnelFactor = cosf(time * 2.f);
+
+	// The HUD breathes by scaling through 1/cos(2t) in its world transform; its vertices never change.
+	m_hud_world = Matrix::CreateScale(1.f / cosf(time * 2.f));
 
 	if (m_retryAudio)
 	{
@@ -221,109 +517,135 @@ void Game::Update(DX::StepTimer const& timer)
 	elapsedTime;
 }
 
-// Draws the scene.
-void Game::Render()
+// Copies what Render needs out of the update-side state.
+void Game::CaptureFrameState(FrameState& frame) const
 {
-    // Don't try to render anything before the first Update.
-    if (m_timer.GetFrameCount() == 0)
-    {
-        return;
-    }
-
-    Clear();
+	frame.cameraPos = m_cameraPos;
+	frame.pitch = m_pitch;
+	frame.yaw = m_yaw;
+	frame.skullWorld = m_skull_world;
+	frame.earthWorld = m_earth_world;
+	frame.teapotWorld = m_teapot_world;
+	frame.hudWorld = m_hud_world;
+	frame.hudView = m_hud_view;
+	frame.fresnelFactor = m_fresnelFactor;
+}
 
-    // TODO: Add your rendering code here.
-	
-	float y = sinf(m_pitch);
-	float r = cosf(m_pitch);
-	float z = r * cosf(m_yaw);
-	float x = r * sinf(m_yaw);
+// Blends the state before the latest step with the current one: positions
+// and scales are lerped and orientations slerped.
+void Game::WriteFrameState(FrameState& frame, float blend) const
+{
+	FrameState current;
+	CaptureFrameState(current);
+	const FrameState& previous = m_previousStep;
+
+	frame.cameraPos = Vector3::Lerp(previous.cameraPos, current.cameraPos, blend);
+	frame.pitch = DX::Lerp(previous.pitch, current.pitch, blend);
+	frame.yaw = DX::LerpAngle(previous.yaw, current.yaw, blend);
+	frame.skullWorld = InterpolateTransform(previous.skullWorld, current.skullWorld, blend);
+	frame.earthWorld = InterpolateTransform(previous.earthWorld, current.earthWorld, blend);
+	frame.teapotWorld = InterpolateTransform(previous.teapotWorld, current.teapotWorld, blend);
+	// A bare scale that changes sign; decomposing it would read a half turn.
+	frame.hudWorld = Matrix::Lerp(previous.hudWorld, current.hudWorld, blend);
+	frame.hudView = current.hudView;
+	frame.fresnelFactor = DX::Lerp(previous.fresnelFactor, current.fresnelFactor, blend);
+}
 
-	XMVECTOR lookAt = m_cameraPos + Vector3(x, y, z);
+void Game::RenderFrame(void* context, uint32_t slot)
+{
+	Game* game = static_cast<Game*>(context);
+	game->Render(game->m_frames[slot]);
+}
 
-	XMMATRIX view = XMMatrixLookAtRH(m_cameraPos, lookAt, Vector3::Up);
+// Draws the scene. Runs on the render thread and reads only the frame
+// state and render-side members.
+void Game::Render(const FrameState& frame)
+{
+	DX_PROFILE_SCOPE("Render");
 
-	m_room->Draw(Matrix::Identity, view, m_proj, Colors::White, m_roomTex.Get());
-	m_skull->Draw(m_d3dContext.Get(), *m_states, m_skull_world, view, m_proj);
-	
-	Quaternion q = Quaternion::CreateFromYawPitchRoll(m_yaw, m_pitch, 0.f);
-	m_skull->UpdateEffects([&](IEffect* effect)
-		{
-			auto lights = dynamic_cast<IEffectLights*>(effect);
-			if (lights)
-			{
-				XMVECTOR dir = XMVector3Rotate(g_XMOne, q);
-				lights->SetLightDirection(0, dir/2.f);
-			}
-			auto fog = dynamic_cast<IEffectFog*>(effect);
-			if (fog)
-			{
-				fog->SetFogEnabled(true);
-				fog->SetFogStart(0); // assuming RH coordiantes
-				fog->SetFogEnd(12);
-				fog->SetFogColor(Colors::Green);
-			}
-		});
+	m_frame = &frame;
 
-	m_earth->Draw(m_earth_world, view, m_proj, Colors::White, m_earth_texture.Get());
+	ApplyAssetChanges();
+	UpdateTextureStreaming(frame);
 
-	m_em_effect->SetView(view);
-	m_em_effect->SetProjection(m_proj);
-	m_em_effect->SetWorld(m_teapot_world);
-	m_teapot->Draw(m_em_effect.get(), m_inputLayout.Get(), false, false, [=] {
-		auto sampler = m_states->LinearWrap();
-		m_d3dContext->PSSetSamplers(1, 1, &sampler);
-		});
+	// Material counters cover one frame.
+	m_skullMaterial.ResetStats();
+	m_teapotMaterial.ResetStats();
 
-	m_d3dContext->OMSetBlendState(m_states->Opaque(), nullptr, 0xFFFFFFFF);
-	m_d3dContext->OMSetDepthStencilState(m_states->DepthNone(), 0);
-	m_d3dContext->RSSetState(m_states->CullNone());
-	m_d3dContext->IASetInputLayout(m_inputLayout.Get());
+	// The skull light follows the camera, so only re-aim it when the camera turned.
+	if (frame.pitch != m_lightPitch || frame.yaw != m_lightYaw)
+	{
+		UpdateSkullLight(frame.pitch, frame.yaw);
+	}
+	m_teapotMaterial.SetFresnelFactor(frame.fresnelFactor);
 
-	//Arrays of geomtry data.
-	const int vCount = 12;
-	const int iCount = 12;
-	uint16_t iArray[iCount];
-	VertexPositionColor vArray[vCount];
+    Clear();
+	m_backend->BeginFrame();
 
-	for (int i = 0; i < iCount; i++) {
-		iArray[i] = i;
-	}
-	float time = float(m_timer.GetTotalSeconds());
-	float t = cosf(time*2);
-	vArray[0] = VertexPositionColor(Vector3(-0.5f, 0.5f, 0.5f)/t, Colors::GreenYellow);
-	vArray[1] = VertexPositionColor(Vector3(-1.0f, 0.75f, 0.5f)/t, Colors::Green);
-	vArray[2] = VertexPositionColor(Vector3(-0.75f, 1.f, 0.5f)/t, Colors::Green);
+    // TODO: Add your rendering code here.
+	
+	float y = sinf(frame.pitch);
+	float r = cosf(frame.pitch);
+	float z = r * cosf(frame.yaw);
+	float x = r * sinf(frame.yaw);
 
-	vArray[3] = VertexPositionColor(Vector3(0.5f, 0.5f, 0.5f)/t, Colors::GreenYellow);
-	vArray[4] = VertexPositionColor(Vector3(1.0f, 0.75f, 0.5f)/t, Colors::Green);
-	vArray[5] = VertexPositionColor(Vector3(0.75f, 1.f, 0.5f)/t, Colors::Green);
+	XMVECTOR lookAt = frame.cameraPos + Vector3(x, y, z);
 
-	vArray[6] = VertexPositionColor(Vector3(-0.5f, -0.5f, 0.5f)/t, Colors::GreenYellow);
-	vArray[7] = VertexPositionColor(Vector3(-1.0f, -0.75f, 0.5f)/t, Colors::Green);
-	vArray[8] = VertexPositionColor(Vector3(-0.75f, -1.f, 0.5f)/t, Colors::Green);
+	m_view = XMMatrixLookAtRH(frame.cameraPos, lookAt, Vector3::Up);
 
-	vArray[9] = VertexPositionColor(Vector3(0.5f, -0.5f, 0.5f)/t, Colors::GreenYellow);
-	vArray[10] = VertexPositionColor(Vector3(1.0f, -0.75f, 0.5f)/t, Colors::Green);
-	vArray[11] = VertexPositionColor(Vector3(0.75f, -1.f, 0.5f)/t, Colors::Green);
+	// Record every draw with its sort key; the HUD layer always sorts last.
+	auto depthOf = [&](const Matrix& world)
+	{
+		return RenderKey::EncodeDepth(Vector3::Distance(frame.cameraPos, world.Translation()));
+	};
 
-	m_batch->Begin();
-	//apply loaded shader
-	m_d3dContext->IASetInputLayout(m_layout);							//set the input layout for the shader to match out geometry
-	SetShaderParameters(&m_hud_world, &m_hud_view, &m_proj);			//send the world, view and projection matrices into the shader
-	m_d3dContext->VSSetShader(m_vertexShader.Get(), 0, 0);				//turn on vertex shader
-	m_d3dContext->PSSetShader(m_pixelShader.Get(), 0, 0);				//turn on pixel shader
+	// Rasterize the globe into the occlusion buffer, then test the other props against it.
+	bool skullVisible;
+	bool teapotVisible;
+	{
+		DX_PROFILE_SCOPE("Occlusion");
+		m_occlusionCuller->BeginFrame(ToMatrix44(m_view * m_proj));
+		m_occlusionCuller->AddOccluder(m_earthOccluder.vertices.data(), sizeof(DX::MeshVertex),
+			m_earthOccluder.indices.data(), uint32_t(m_earthOccluder.indices.size()), ToMatrix44(frame.earthWorld));
+		m_occlusionCuller->RasterizeOccluders();
+
+		skullVisible = m_occlusionCuller->IsVisible(ToMatrix44(frame.skullWorld),
+			DX::Float3{ m_skullBounds.Center.x, m_skullBounds.Center.y, m_skullBounds.Center.z },
+			DX::Float3{ m_skullBounds.Extents.x, m_skullBounds.Extents.y, m_skullBounds.Extents.z });
+		teapotVisible = m_occlusionCuller->IsVisible(ToMatrix44(frame.teapotWorld), DX::Float3{ 0, 0, 0 }, TEAPOT_EXTENTS);
+	}
 
-	m_batch->DrawIndexed(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, iArray, iCount, vArray, vCount);
+	m_renderQueue.Reset();
+	m_renderQueue.Submit(RenderKey::Make(LayerWorld, 0, ShaderPrimitive, MaterialRoom,
+		RenderKey::EncodeDepth(ROOM_BOUNDS[2])), DrawRoom);
+	if (skullVisible)
+	{
+		m_renderQueue.Submit(RenderKey::Make(LayerWorld, 0, ShaderSkull, MaterialSkull,
+			depthOf(frame.skullWorld)), DrawSkull);
+	}
+	m_renderQueue.Submit(RenderKey::Make(LayerWorld, 0, ShaderPrimitive, MaterialEarth,
+		depthOf(frame.earthWorld)), DrawEarth);
+	if (teapotVisible)
+	{
+		m_renderQueue.Submit(RenderKey::Make(LayerWorld, 0, ShaderEnvironmentMap, MaterialTeapot,
+			depthOf(frame.teapotWorld)), DrawTeapot);
+	}
+	m_renderQueue.Submit(RenderKey::Make(LayerHud, 0, ShaderHud, MaterialHud, 0), DrawHud);
 
-	m_batch->End();
+	m_renderQueue.Sort();
+	m_renderQueue.Execute(*this);
 
+	m_backend->EndFrame();
 	Present();
+
+	m_frame = nullptr;
 }
 
 // Helper method to clear the back buffers.
 void Game::Clear()
 {
+	DX_PROFILE_SCOPE("Clear");
+
     // Clear the views.
     m_d3dContext->ClearRenderTargetView(m_renderTargetView.Get(), Colors::CornflowerBlue);
     m_d3dContext->ClearDepthStencilView(m_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
@@ -338,6 +660,8 @@ void Game::Clear()
 // Presents the back buffer contents to the screen.
 void Game::Present()
 {
+	DX_PROFILE_SCOPE("Present");
+
     // The first argument instructs DXGI to block until VSync, putting the application
     // to sleep until the next VSync. This ensures we don't waste any cycles rendering
     // frames that will never be displayed to the screen.
@@ -369,11 +693,15 @@ void Game::OnSuspending()
 {
     // TODO: Game is being power-suspended (or minimized).
 	m_audEngine->Suspend();
+
+	// Nothing is visible; tick just often enough to keep the simulation going.
+	m_pacer.SetSuspended(true);
 }
 
 void Game::OnResuming()
 {
     m_timer.ResetElapsedTime();
+	m_pacer.SetSuspended(false);
 
     // TODO: Game is being power-resumed (or returning from minimize).
 	m_audEngine->Resume();
@@ -381,6 +709,9 @@ void Game::OnResuming()
 
 void Game::OnWindowSizeChanged(int width, int height)
 {
+	// The swap chain and projection belong to the render thread.
+	m_pipeline->Flush();
+
     m_outputWidth = std::max(width, 1);
     m_outputHeight = std::max(height, 1);
 
@@ -464,41 +795,32 @@ void Game::CreateDevice()
 
 // TODO: Initialize device dependent objects here (independent of window size).
 	
-	auto vertexShaderBuffer = DX::ReadData(L"ui_vs.cso");
-	DX::ThrowIfFailed(device->CreateVertexShader(vertexShaderBuffer.data(), vertexShaderBuffer.size(), NULL, &m_vertexShader));
-	D3D11_INPUT_ELEMENT_DESC polygonLayout[] = {
-		{ "POSITION",	0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,	D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "COLOR",		0, DXGI_FORMAT_R32G32B32A32_FLOAT,	0,	D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
-	};
-	// Get a count of the elements in the layout.
-	unsigned int numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
-	// Create the vertex input layout.
-	device->CreateInputLayout(polygonLayout, numElements, vertexShaderBuffer.data(), vertexShaderBuffer.size(), &m_layout);
-	auto pixelShaderBuffer = DX::ReadData(L"ui_ps.cso");		//Yes we are re-using the same buffer
-	device->CreatePixelShader(pixelShaderBuffer.data(), pixelShaderBuffer.size(), NULL, &m_pixelShader);
-	// Setup the description of the dynamic matrix constant buffer that is in the vertex shader.
-	m_matrixBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	m_matrixBufferDesc.ByteWidth = sizeof(MatrixBufferType);
-	m_matrixBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	m_matrixBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	m_matrixBufferDesc.MiscFlags = 0;
-	m_matrixBufferDesc.StructureByteStride = 0;
-	// Create the constant buffer pointer so we can access the vertex shader constant buffer from within this class.
-	device->CreateBuffer(&m_matrixBufferDesc, NULL, &m_matrixBuffer);
-
-	m_room = GeometricPrimitive::CreateBox(m_d3dContext.Get(),
-		XMFLOAT3(ROOM_BOUNDS[0], ROOM_BOUNDS[1], ROOM_BOUNDS[2]),
-		false, true);
+	m_backend = std::make_unique<DX::D3D11GraphicsBackend>(m_d3dDevice.Get(), m_d3dContext.Get());
+
+	// The HUD pipeline binds ui_vs/ui_ps with a position/colour layout and the
+	// opaque, depth-less, unculled state the triangles are drawn with.
+	m_hudPipeline = m_backend->CreatePipelineState(DX::PipelineDesc{
+		DX::VertexLayout::PositionColor, DX::ShaderProgram::VertexColor,
+		DX::BlendMode::Opaque, DX::DepthMode::None, DX::CullMode::None });
+	// The HUD triangles are one batcher element, uploaded once and redrawn every frame.
+	{
+		std::vector<DX::ColorVertex> hudVertices;
+		std::vector<uint16_t> hudIndices;
+		DX::CreateHudGeometry(hudVertices, hudIndices);
 
-	DX::ThrowIfFailed(
-		CreateDDSTextureFromFile(m_d3dDevice.Get(), L"roomtexture.dds",
-			nullptr, m_roomTex.ReleaseAndGetAddressOf()));
+		m_hudBatcher.Clear();
+		m_hudBatcher.AddElement(0, m_hudPipeline, DX::InvalidHandle, hudVertices.data(), uint32_t(hudVertices.size()),
+			hudIndices.data(), uint32_t(hudIndices.size()));
+	}
+	// Dynamic constant buffer holding the world, view and projection matrices for the vertex shader.
+	m_matrixBuffer = m_backend->CreateBuffer(DX::BufferDesc{
+		DX::BufferUsage::Constant, sizeof(DX::TransformConstants), 0, true }, nullptr);
+
+	m_room = CreatePrimitive(ROOM_PRIMITIVE);
 
 	m_states = std::make_unique<CommonStates>(m_d3dDevice.Get());
 	m_fxFactory = std::make_unique<EffectFactory>(m_d3dDevice.Get());
-	m_skull = Model::CreateFromSDKMESH(m_d3dDevice.Get(), L"skull.sdkmesh", *m_fxFactory);
-	m_skull_world = Matrix::Identity;
-	m_earth_world = Matrix::Identity;
+	CreateSkull();
 	
 	m_effect = std::make_unique<BasicEffect>(m_d3dDevice.Get());
 	m_effect->SetVertexColorEnabled(true);
@@ -511,9 +833,6 @@ void Game::CreateDevice()
 			VertexPositionColor::InputElementCount,
 			shaderByteCode, byteCodeLength,
 			m_inputLayout.ReleaseAndGetAddressOf()));
-	m_batch = std::make_unique<PrimitiveBatch<VertexPositionColor>>(m_d3dContext.Get());
-
-	m_earth = GeometricPrimitive::CreateSphere(m_d3dContext.Get());
 
 	m_earth_effect = std::make_unique<BasicEffect>(m_d3dDevice.Get());
 	m_earth_effect->SetTextureEnabled(true);
@@ -523,32 +842,25 @@ void Game::CreateDevice()
 	m_earth_effect->SetLightDiffuseColor(0, Colors::White);
 	m_earth_effect->SetLightDirection(0, Vector3::UnitZ);
 
-	m_earth = GeometricPrimitive::CreateSphere(m_d3dContext.Get());
+	m_earth = CreatePrimitive(EARTH_PRIMITIVE);
 	m_earth->CreateInputLayout(m_earth_effect.get(),
 		m_inputLayout.ReleaseAndGetAddressOf());
 
-	DX::ThrowIfFailed(
-		CreateWICTextureFromFile(m_d3dDevice.Get(), L"earth.bmp", nullptr,
-			m_earth_texture.ReleaseAndGetAddressOf()));
+	CreateAssetTexture(m_earthTexAsset, m_earthTextureHandle, m_earth_texture);
 
 	m_earth_effect->SetTexture(m_earth_texture.Get());
 
 
 	m_em_effect = std::make_unique<EnvironmentMapEffect>(m_d3dDevice.Get());
 	m_em_effect->EnableDefaultLighting();
+	CreateEnvironment();
 
-	m_teapot = GeometricPrimitive::CreateTeapot(m_d3dContext.Get());
+	m_teapot = CreatePrimitive(TEAPOT_PRIMITIVE);
 	m_teapot->CreateInputLayout(m_em_effect.get(),
 		m_inputLayout.ReleaseAndGetAddressOf());
-	DX::ThrowIfFailed(
-		CreateDDSTextureFromFile(m_d3dDevice.Get(), L"porcelain.dds", nullptr,
-			m_teapot_texture.ReleaseAndGetAddressOf()));
-	m_em_effect->SetTexture(m_teapot_texture.Get());
-	DX::ThrowIfFailed(
-		CreateDDSTextureFromFile(m_d3dDevice.Get(), L"cubemap.dds", nullptr,
-			m_cubemap.ReleaseAndGetAddressOf()));
-	m_em_effect->SetEnvironmentMap(m_cubemap.Get());
-	m_teapot_world = Matrix::Identity;
+	m_teapotMaterial.MarkAllDirty();
+	// The room and porcelain textures are bound by the first
+	// UpdateTextureStreaming.
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
@@ -661,17 +973,20 @@ void Game::OnDeviceLost()
 	m_room.reset();
 	m_roomTex.Reset();
 
-	m_vertexShader.Reset();
-	m_pixelShader.Reset();
+	m_hudBatcher.ReleaseResources(*m_backend);
+	m_textureStreamer.ReleaseResources(*m_backend);
+	m_earthTextureHandle = 0;
+	m_environmentTexture = 0;
+	m_backend.reset();
 
 	m_states.reset();
 	m_fxFactory.reset();
+	m_skullEffects.clear();
 	m_skull.reset();
 	m_earth.reset();
 
 	m_effect.reset();
 	m_earth_effect.reset();
-	m_batch.reset();
 	m_inputLayout.Reset();
 
 	m_earth_texture.Reset();
@@ -680,42 +995,330 @@ void Game::OnDeviceLost()
 	m_em_effect.reset();
 	m_teapot_texture.Reset();
 	m_cubemap.Reset();
+
+	auto start = std::chrono::steady_clock::now();
+	uint32_t misses = m_assets.GetStats().residentMisses;
+
     CreateDevice();
 
     CreateResources();
+
+	char message[128];
+	snprintf(message, sizeof(message), "Device recovered in %.2f ms; %u assets read back from disk\n",
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+		m_assets.GetStats().residentMisses - misses);
+	OutputDebugStringA(message);
 }
 
-void Game::SetShaderParameters(DirectX::SimpleMath::Matrix* world, DirectX::SimpleMath::Matrix* view, DirectX::SimpleMath::Matrix* projection)
+// Every file the device resources are built from. The teapot material
+// groups its two textures, so a change to either rebinds the effect after
+// the texture itself is recreated.
+void Game::RegisterAssets()
 {
+	m_assets.SetMemoryBudget(ASSET_MEMORY_BUDGET);
 
-	HRESULT result;
-	D3D11_MAPPED_SUBRESOURCE mappedResource;
-	MatrixBufferType* dataPtr;
-	unsigned int bufferNumber;
-	DirectX::SimpleMath::Matrix  tworld, tview, tproj;
-	auto context = m_d3dContext;
-	auto device = m_d3dDevice;
-	tworld = world->Transpose();
-	tview = view->Transpose();
-	tproj = projection->Transpose();
+	m_roomTexAsset = m_assets.Add(DX::AssetType::Blob, "roomtexture.dds");
+	m_skullAsset = m_assets.Add(DX::AssetType::Blob, "skull.sdkmesh");
+	m_earthTexAsset = m_assets.Add(DX::AssetType::Texture, "earth.bmp");
+	m_teapotTexAsset = m_assets.Add(DX::AssetType::Blob, "porcelain.dds");
+	m_cubemapAsset = m_assets.Add(DX::AssetType::Texture, "cubemap.dds");
 
-	// Lock the constant buffer so it can be written to.
-	result = context->Map(m_matrixBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	m_teapotMaterialAsset = m_assets.Add(DX::AssetType::Group, "teapot material");
+	m_assets.AddDependency(m_teapotMaterialAsset, m_teapotTexAsset);
+	m_assets.AddDependency(m_teapotMaterialAsset, m_cubemapAsset);
 
-	// Get a pointer to the data in the constant buffer.
-	dataPtr = (MatrixBufferType*)mappedResource.pData;
+	// The room and porcelain textures stream from their files; their
+	// database entries report edits.
+	m_roomTexStream = m_textureStreamer.Add("roomtexture.dds");
+	m_teapotTexStream = m_textureStreamer.Add("porcelain.dds");
 
-	// Copy the matrices into the constant buffer.
-	dataPtr->world = tworld;// worldMatrix;
-	dataPtr->view = tview;
-	dataPtr->projection = tproj;
+#ifdef _DEBUG
+	m_assets.StartWatching();
+#endif
+}
+
+// Creates a texture from an imported one, already decoded and given its mips
+// by the asset database. The old handle is destroyed once the new texture
+// exists, so texture keeps its old view if creation fails.
+void Game::CreateAssetTexture(DX::AssetHandle asset, DX::TextureHandle& handle, ComPtr<ID3D11ShaderResourceView>& texture)
+{
+	const DX::TextureData& data = m_assets.Get(asset).texture;
+	const std::vector<DX::TextureSubresourceData> subresources = data.GetSubresources();
+
+	const DX::TextureHandle created = m_backend->CreateTexture(data.desc, subresources.data());
+	if (handle)
+	{
+		m_backend->DestroyTexture(handle);
+	}
+	handle = created;
+	texture = m_backend->GetNativeTexture(handle);
+}
+
+// Lights the teapot from the cubemap: reflections from the GGX-prefiltered
+// chain, diffuse from its irradiance. Both are computed once per cubemap and
+// only uploaded again after a device loss.
+void Game::CreateEnvironment()
+{
+	if (m_environment.pixels.empty())
+	{
+		const DX::TextureData& cubemap = m_assets.Get(m_cubemapAsset).texture;
+		m_environment = DX::PrefilterEnvironment(cubemap, ENVIRONMENT_PREFILTER, m_jobs.get());
+		// The effects shade in the textures' own encoding, so the irradiance does too.
+		m_irradiance = DX::ComputeIrradianceSH(cubemap, false, m_jobs.get());
+	}
+
+	const std::vector<DX::TextureSubresourceData> subresources = m_environment.GetSubresources();
+	const DX::TextureHandle created = m_backend->CreateTexture(m_environment.desc, subresources.data());
+	if (m_environmentTexture)
+	{
+		m_backend->DestroyTexture(m_environmentTexture);
+	}
+	m_environmentTexture = created;
+
+	// The mips below the first are rougher still; sampled only at a distance.
+	const uint32_t mipLevels = m_environment.desc.mipLevels;
+	const UINT firstMip = std::min(UINT(DX::GetPrefilteredMip(TEAPOT_ROUGHNESS, mipLevels) + 0.5f), UINT(mipLevels - 1));
+	ComPtr<ID3D11Resource> resource;
+	m_backend->GetNativeTexture(created)->GetResource(resource.GetAddressOf());
+	CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(D3D11_SRV_DIMENSION_TEXTURECUBE, DXGI_FORMAT_R8G8B8A8_UNORM, firstMip, mipLevels - firstMip);
+	DX::ThrowIfFailed(
+		m_d3dDevice->CreateShaderResourceView(resource.Get(), &viewDesc, m_cubemap.ReleaseAndGetAddressOf()));
+	m_em_effect->SetEnvironmentMap(m_cubemap.Get());
 
-	// Unlock the constant buffer.
-	context->Unmap(m_matrixBuffer, 0);
+	// The default lights stay as the key; the environment replaces their ambient.
+	const DX::Float3 ambient = m_irradiance.GetAverage();
+	m_em_effect->SetAmbientLightColor(XMVectorSet(ambient.x, ambient.y, ambient.z, 0.f));
+}
+
+void Game::CreateSkull()
+{
+	const std::vector<uint8_t>& bytes = m_assets.Get(m_skullAsset).bytes;
+	m_skull = Model::CreateFromSDKMESH(m_d3dDevice.Get(), bytes.data(), bytes.size(), *m_fxFactory);
+	m_skullBounds = m_skull->meshes.front()->boundingBox;
+	for (auto& mesh : m_skull->meshes)
+	{
+		BoundingBox::CreateMerged(m_skullBounds, m_skullBounds, mesh->boundingBox);
+	}
+	// Resolve the light and fog interfaces of each skull effect once; Draw only
+	// writes the groups the material reports dirty.
+	m_skullEffects.clear();
+	m_skull->UpdateEffects([&](IEffect* effect)
+		{
+			m_skullEffects.push_back(SkullEffectBinding{
+				dynamic_cast<IEffectLights*>(effect), dynamic_cast<IEffectFog*>(effect) });
+		});
+	m_skullMaterial.SetFog(true, 0, 12, DX::Float4{ 0.f, 0.501960814f, 0.f, 1.f });	// Colors::Green; start assumes RH coordinates
+	m_skullMaterial.MarkAllDirty();
+	UpdateSkullLight(m_lightPitch, m_lightYaw);
+}
 
-	// Set the position of the constant buffer in the vertex shader.
-	bufferNumber = 0;
+// Uploads a cached primitive; only the first device tessellates it.
+std::unique_ptr<GeometricPrimitive> Game::CreatePrimitive(const DX::PrimitiveKey& key)
+{
+	const DX::MeshData& mesh = m_geometry.Get(key);
+	std::vector<VertexPositionNormalTexture> vertices(mesh.vertices.size());
+	memcpy(vertices.data(), mesh.vertices.data(), vertices.size() * sizeof(VertexPositionNormalTexture));
+	return GeometricPrimitive::CreateCustom(m_d3dContext.Get(), vertices, mesh.indices);
+}
+
+// Recreates whatever the asset database reimported since the last frame.
+// A file that fails to load leaves the old resource in place.
+void Game::ApplyAssetChanges()
+{
+	if (!m_assets.ApplyChanges(m_changedAssets))
+	{
+		return;
+	}
+
+	for (DX::AssetHandle asset : m_changedAssets)
+	{
+		try
+		{
+			if (asset == m_roomTexAsset)
+			{
+				m_textureStreamer.Reload(m_roomTexStream);
+			}
+			else if (asset == m_skullAsset)
+			{
+				CreateSkull();
+			}
+			else if (asset == m_earthTexAsset)
+			{
+				CreateAssetTexture(asset, m_earthTextureHandle, m_earth_texture);
+				m_earth_effect->SetTexture(m_earth_texture.Get());
+			}
+			else if (asset == m_teapotTexAsset)
+			{
+				m_textureStreamer.Reload(m_teapotTexStream);
+			}
+			else if (asset == m_cubemapAsset)
+			{
+				m_environment = DX::TextureData();
+				CreateEnvironment();
+			}
+			else if (asset == m_teapotMaterialAsset)
+			{
+				// The streamer rebinds the textures themselves.
+				m_teapotMaterial.MarkAllDirty();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			OutputDebugStringA(e.what());
+			OutputDebugStringA("\n");
+		}
+	}
+}
+
+// Tells the streamer where each streamed texture is seen this frame and
+// rebinds those whose resident mips changed.
+void Game::UpdateTextureStreaming(const FrameState& frame)
+{
+	DX_PROFILE_SCOPE("Streaming");
+
+	const DX::Float3 teapotCenter = { frame.teapotWorld._41, frame.teapotWorld._42, frame.teapotWorld._43 };
+	const float teapotRadius = TEAPOT_EXTENTS.Length();
+	m_textureStreamer.AddUsage(m_roomTexStream, DX::Float3{ 0, 0, 0 }, XMVectorGetX(XMVector3Length(ROOM_BOUNDS)) / 2);
+	m_textureStreamer.AddUsage(m_teapotTexStream, teapotCenter, teapotRadius);
+
+	m_textureStreamer.Update(*m_backend, DX::StreamingView{
+		DX::Float3{ frame.cameraPos.x, frame.cameraPos.y, frame.cameraPos.z }, m_proj._22, uint32_t(m_outputHeight) });
+
+	ID3D11ShaderResourceView* room = m_backend->GetNativeTexture(m_textureStreamer.GetTexture(m_roomTexStream));
+	if (room != m_roomTex.Get())
+	{
+		m_roomTex = room;
+	}
+	ID3D11ShaderResourceView* teapot = m_backend->GetNativeTexture(m_textureStreamer.GetTexture(m_teapotTexStream));
+	if (teapot != m_teapot_texture.Get())
+	{
+		m_teapot_texture = teapot;
+		m_em_effect->SetTexture(teapot);
+	}
+}
+
+void Game::UpdateSkullLight(float pitch, float yaw)
+{
+	Quaternion q = Quaternion::CreateFromYawPitchRoll(yaw, pitch, 0.f);
+	Vector3 dir = XMVector3Rotate(g_XMOne, q) / 2.f;
+	m_skullMaterial.SetLightDirection(DX::Float3{ dir.x, dir.y, dir.z });
+
+	m_lightPitch = pitch;
+	m_lightYaw = yaw;
+}
+
+void Game::ApplySkullMaterial()
+{
+	uint32_t dirty = m_skullMaterial.TakeDirty();
+	if (!dirty)
+	{
+		return;
+	}
+
+	const DX::LightingConstants& constants = m_skullMaterial.GetConstants();
+	uint32_t writes = 0;
+
+	for (const SkullEffectBinding& binding : m_skullEffects)
+	{
+		if (binding.lights && (dirty & DX::MaterialDirty::LightDirection))
+		{
+			binding.lights->SetLightDirection(0, XMVectorSet(constants.lightDirection[0],
+				constants.lightDirection[1], constants.lightDirection[2], 0.f));
+			++writes;
+		}
+
+		if (binding.fog && (dirty & DX::MaterialDirty::Fog))
+		{
+			binding.fog->SetFogEnabled(m_skullMaterial.IsFogEnabled());
+			binding.fog->SetFogStart(constants.fogStart);
+			binding.fog->SetFogEnd(constants.fogEnd);
+			binding.fog->SetFogColor(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(constants.fogColor)));
+			writes += 4;
+		}
+	}
+
+	m_skullMaterial.RecordWrites(writes);
+}
+
+void Game::ApplyTeapotMaterial()
+{
+	if (m_teapotMaterial.TakeDirty() & DX::MaterialDirty::Fresnel)
+	{
+		m_em_effect->SetFresnelFactor(m_teapotMaterial.GetConstants().fresnelFactor);
+		m_teapotMaterial.RecordWrites(1);
+	}
+}
+
+void Game::SetShaderParameters(const DirectX::SimpleMath::Matrix* world, const DirectX::SimpleMath::Matrix* view, const DirectX::SimpleMath::Matrix* projection)
+{
+	DX::TransformConstants constants;
+
+	// Transpose the matrices for the shader and copy them into the constant buffer.
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(constants.world), world->Transpose());
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(constants.view), view->Transpose());
+	XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(constants.projection), projection->Transpose());
+
+	m_backend->UpdateBuffer(m_matrixBuffer, &constants, sizeof(constants));
 
 	// Now set the constant buffer in the vertex shader with the updated values.
-	context->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
-}
\ No newline at end of file
+	m_backend->SetConstantBuffer(DX::ConstantSlot::Transforms, m_matrixBuffer);
+}
+
+// Fixed-function state travels with each pipeline or DirectXTK effect, so
+// layers only order the draws.
+void Game::SetPass(uint32_t layer, uint32_t pass)
+{
+	UNREFERENCED_PARAMETER(layer);
+	UNREFERENCED_PARAMETER(pass);
+}
+
+// DirectXTK primitives and models bind their own effect shaders when drawn,
+// so only the custom HUD shader needs binding here.
+void Game::SetShader(uint32_t shader)
+{
+	if (shader == ShaderHud)
+	{
+		m_backend->SetPipelineState(m_hudPipeline);						//apply loaded shader, input layout and HUD states
+		SetShaderParameters(&m_frame->hudWorld, &m_frame->hudView, &m_proj);			//send the world, view and projection matrices into the shader
+	}
+}
+
+void Game::SetMaterial(uint32_t material)
+{
+	// Textures are bound per draw by the DirectXTK effects.
+	UNREFERENCED_PARAMETER(material);
+}
+
+void Game::Draw(const DX::RenderCommand& command)
+{
+	switch (command.drawId)
+	{
+	case DrawRoom:
+		m_room->Draw(Matrix::Identity, m_view, m_proj, Colors::White, m_roomTex.Get());
+		break;
+
+	case DrawSkull:
+		ApplySkullMaterial();
+		m_skull->Draw(m_d3dContext.Get(), *m_states, m_frame->skullWorld, m_view, m_proj);
+		break;
+
+	case DrawEarth:
+		m_earth->Draw(m_frame->earthWorld, m_view, m_proj, Colors::White, m_earth_texture.Get());
+		break;
+
+	case DrawTeapot:
+		ApplyTeapotMaterial();
+		m_em_effect->SetView(m_view);
+		m_em_effect->SetProjection(m_proj);
+		m_em_effect->SetWorld(m_frame->teapotWorld);
+		m_teapot->Draw(m_em_effect.get(), m_inputLayout.Get(), false, false, [=] {
+			auto sampler = m_states->LinearWrap();
+			m_d3dContext->PSSetSamplers(1, 1, &sampler);
+			});
+		break;
+
+	case DrawHud:
+		m_hudBatcher.Draw(*m_backend);
+		break;
+	}
+}
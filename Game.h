@@ -5,11 +5,26 @@
 #pragma once
 
 #include "StepTimer.h"
+#include "AssetDatabase.h"
+#include "CameraController.h"
+#include "RenderQueue.h"
+#include "D3D11GraphicsBackend.h"
+#include "EnvironmentPrefilter.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "GeometryCache.h"
+#include "HudBatcher.h"
+#include "InputRecording.h"
+#include "Material.h"
+#include "MeshData.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "TextureStreamer.h"
 
 
 // A basic game implementation that creates a D3D11 device and
 // provides a game loop.
-class Game
+class Game : private DX::IRenderCommandExecutor
 {
 public:
 
@@ -22,6 +37,10 @@ public:
     // Basic game loop
     void Tick();
 
+	// Sleeps until the next frame is due. Returns false early if a window
+	// message arrives first, so the loop can handle it and wait again.
+	bool WaitForNextFrame() { return m_pacer.Wait(true); }
+
     // Messages
     void OnActivated();
     void OnDeactivated();
@@ -35,20 +54,47 @@ public:
 	// Audio
 	void OnNewAudioDevice() { m_retryAudio = true; }
 
+	// Input events from the window procedure, consumed by the simulation steps.
+	DX::InputQueue& GetInputQueue() { return m_input; }
+
+	// Call one of these before Initialize. Recording writes every tick's
+	// timer delta, keyboard state and input events to path on exit;
+	// replaying feeds a recording back in place of the clock and live
+	// input, step for step, and exits when it runs out.
+	void RecordInput(const wchar_t* path);
+	void ReplayInput(const wchar_t* path);
+
 private:
-	struct MatrixBufferType
-	{
-		DirectX::XMMATRIX world;
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-	};
+	// Render queue identifiers. Layers and shaders sort in declaration order.
+	enum RenderLayer : uint32_t { LayerWorld, LayerHud };
+	enum RenderShader : uint32_t { ShaderPrimitive, ShaderSkull, ShaderEnvironmentMap, ShaderHud };
+	enum RenderMaterial : uint32_t { MaterialRoom, MaterialSkull, MaterialEarth, MaterialTeapot, MaterialHud };
+	enum DrawId : uint32_t { DrawRoom, DrawSkull, DrawEarth, DrawTeapot, DrawHud };
 
 	float pi = 3.14159265359f;
 	float rotation;
 
+	// Everything Update hands to Render for one frame. Render reads only
+	// this and render-side members, so it can run on the render thread
+	// while Update builds the next frame.
+	struct FrameState
+	{
+		DirectX::SimpleMath::Vector3	cameraPos;
+		float							pitch;
+		float							yaw;
+		DirectX::SimpleMath::Matrix		skullWorld;
+		DirectX::SimpleMath::Matrix		earthWorld;
+		DirectX::SimpleMath::Matrix		teapotWorld;
+		DirectX::SimpleMath::Matrix		hudWorld;
+		DirectX::SimpleMath::Matrix		hudView;
+		float							fresnelFactor;
+	};
 
     void Update(DX::StepTimer const& timer);
-    void Render();
+	void CaptureFrameState(FrameState& frame) const;
+	void WriteFrameState(FrameState& frame, float blend) const;
+    void Render(const FrameState& frame);
+	static void RenderFrame(void* context, uint32_t slot);
 
     void Clear();
     void Present();
@@ -58,7 +104,27 @@ private:
 
     void OnDeviceLost();
 
-	void SetShaderParameters(DirectX::SimpleMath::Matrix* world, DirectX::SimpleMath::Matrix* view, DirectX::SimpleMath::Matrix* projection);
+	void SetShaderParameters(const DirectX::SimpleMath::Matrix* world, const DirectX::SimpleMath::Matrix* view, const DirectX::SimpleMath::Matrix* projection);
+	void UpdateSkullLight(float pitch, float yaw);
+	void ApplySkullMaterial();
+	void ApplyTeapotMaterial();
+	void ShowProfileSummary();
+	uint64_t BeginLiveTick();
+	uint64_t BeginReplayTick();
+	void SaveRecording();
+	void RegisterAssets();
+	void CreateAssetTexture(DX::AssetHandle asset, DX::TextureHandle& handle, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& texture);
+	void CreateSkull();
+	void CreateEnvironment();
+	std::unique_ptr<DirectX::GeometricPrimitive> CreatePrimitive(const DX::PrimitiveKey& key);
+	void ApplyAssetChanges();
+	void UpdateTextureStreaming(const FrameState& frame);
+
+	// IRenderCommandExecutor
+	void SetPass(uint32_t layer, uint32_t pass) override;
+	void SetShader(uint32_t shader) override;
+	void SetMaterial(uint32_t material) override;
+	void Draw(const DX::RenderCommand& command) override;
 
     // Device resources.
     HWND												m_window;
@@ -75,9 +141,58 @@ private:
 
     // Rendering loop timer.
     DX::StepTimer				                        m_timer;
-	// Input
+	// Keeps the message loop from spinning between frames.
+	DX::FramePacer										m_pacer;
+	// Update fills one frame state while the render thread draws the other.
+	FrameState											m_frames[DX::FramePipeline::SlotCount];
+	const FrameState*									m_frame;		// Being rendered.
+	// The update-side state before the latest step, blended with the current one.
+	FrameState											m_previousStep;
+	std::unique_ptr<DX::FramePipeline>					m_pipeline;
+	// Draws recorded by Render, sorted and replayed each frame.
+	DX::RenderQueue										m_renderQueue;
+	// Props hidden behind the globe are culled on the CPU before submission.
+	std::unique_ptr<DX::JobSystem>						m_jobs;
+	std::unique_ptr<DX::OcclusionCuller>				m_occlusionCuller;
+	DX::MeshData										m_earthOccluder;
+	DirectX::BoundingBox								m_skullBounds;
+	// Profiling: F1 shows the last frame's timings in the title bar, F2
+	// writes the recent frames as a Chrome trace.
+	bool												m_showProfile;
+	bool												m_captureTrace;
+	// Input. The camera runs on timestamped events; the keyboard and mouse
+	// state still serve the other controls and the cursor mode.
 	std::unique_ptr<DirectX::Keyboard>					m_keyboard;
+	DirectX::Keyboard::KeyboardStateTracker				m_keys;
 	std::unique_ptr<DirectX::Mouse>						m_mouse;
+	DX::InputQueue										m_input;
+	DX::CameraController								m_camera;
+	uint64_t											m_inputTime;	// InputQueue time the last step ended at.
+	// What the current tick's steps read: its events and the keyboard.
+	DX::InputQueue										m_tickInput;
+	DirectX::Keyboard::State							m_tickKeyboard;
+	// Record and replay.
+	DX::InputRecording									m_recording;
+	std::wstring										m_recordPath;
+	bool												m_replaying;
+	size_t												m_replayTick;
+	uint64_t											m_recordOrigin;	// Input time recorded as zero.
+	// Asset files, imported once and kept, so a device reset recreates
+	// resources from memory. Debug builds watch the files and swap edits in.
+	DX::AssetDatabase									m_assets;
+	std::vector<DX::AssetHandle>						m_changedAssets;
+	DX::AssetHandle										m_roomTexAsset;
+	DX::AssetHandle										m_skullAsset;
+	DX::AssetHandle										m_earthTexAsset;
+	DX::AssetHandle										m_teapotTexAsset;
+	DX::AssetHandle										m_cubemapAsset;
+	DX::AssetHandle										m_teapotMaterialAsset;	// Porcelain and cubemap.
+	// Tessellated primitives, kept across device recreation.
+	DX::GeometryCache									m_geometry;
+	// The room and porcelain textures, at the mips the camera needs.
+	DX::TextureStreamer									m_textureStreamer;
+	DX::StreamedTextureHandle							m_roomTexStream;
+	DX::StreamedTextureHandle							m_teapotTexStream;
 	// Room
 	std::unique_ptr<DirectX::GeometricPrimitive>		m_room;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_roomTex;
@@ -91,30 +206,47 @@ private:
 	DirectX::SimpleMath::Matrix							m_hud_world;
 	DirectX::SimpleMath::Matrix							m_hud_view;
 	// Shaders
-	Microsoft::WRL::ComPtr<ID3D11VertexShader>			m_vertexShader;
-	Microsoft::WRL::ComPtr<ID3D11PixelShader>			m_pixelShader;
-	ID3D11Buffer*										m_matrixBuffer;
-	D3D11_BUFFER_DESC									m_matrixBufferDesc;
-	ID3D11InputLayout*									m_layout;
+	std::unique_ptr<DX::D3D11GraphicsBackend>			m_backend;
+	DX::PipelineHandle									m_hudPipeline;
+	DX::BufferHandle									m_matrixBuffer;
 	// Custom Geometry
 	std::unique_ptr<DirectX::CommonStates>									m_states;
 	std::unique_ptr<DirectX::BasicEffect>									m_effect;
-	std::unique_ptr<DirectX::PrimitiveBatch<DirectX::VertexPositionColor>>	m_batch;
+	DX::HudBatcher														m_hudBatcher;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout>								m_inputLayout;
 	// Loading Meshes
 	std::unique_ptr<DirectX::Model>						m_skull;
 	DirectX::SimpleMath::Matrix							m_skull_world;
+	// Effect interfaces resolved once when the model loads; the material
+	// holds the values and says which of them changed.
+	struct SkullEffectBinding
+	{
+		DirectX::IEffectLights*	lights;
+		DirectX::IEffectFog*	fog;
+	};
+	std::vector<SkullEffectBinding>						m_skullEffects;
+	DX::Material										m_skullMaterial;
+	float												m_lightPitch;	// Camera angles the skull light was last aimed for.
+	float												m_lightYaw;
 	std::unique_ptr<DirectX::IEffectFactory>			m_fxFactory;
 
 	std::unique_ptr<DirectX::GeometricPrimitive>		m_earth;
 	DirectX::SimpleMath::Matrix							m_earth_world;
+	DX::TextureHandle									m_earthTextureHandle;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_earth_texture;
 	std::unique_ptr<DirectX::BasicEffect>				m_earth_effect;
 
 	std::unique_ptr<DirectX::GeometricPrimitive>		m_teapot;
 	DirectX::SimpleMath::Matrix							m_teapot_world;
+	float												m_fresnelFactor;
 	std::unique_ptr<DirectX::EnvironmentMapEffect>		m_em_effect;
+	DX::Material										m_teapotMaterial;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_teapot_texture;
+	// The cubemap prefiltered for GGX and its irradiance, kept across device
+	// recreation; the view starts at the teapot's roughness.
+	DX::TextureData										m_environment;
+	DX::IrradianceSH									m_irradiance;
+	DX::TextureHandle									m_environmentTexture;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>	m_cubemap;
 
 	std::unique_ptr<DirectX::AudioEngine>				m_audEngine;
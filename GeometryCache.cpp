@@ -0,0 +1,179 @@
+//
+// GeometryCache.cpp
+//
+
+#include "GeometryCache.h"
+#include "ProceduralGeometry.h"
+
+#include <chrono>
+#include <exception>
+
+using namespace DX;
+
+namespace
+{
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    uint64_t MeshBytes(const MeshData& mesh)
+    {
+        return mesh.vertices.size() * sizeof(MeshVertex) + mesh.indices.size() * sizeof(uint16_t);
+    }
+}
+
+PrimitiveKey PrimitiveKey::Box(const Float3& size, bool rhcoords, bool invertn)
+{
+    return PrimitiveKey{ PrimitiveShape::Box, size, 0, rhcoords, invertn };
+}
+
+PrimitiveKey PrimitiveKey::Sphere(float diameter, uint32_t tessellation, bool rhcoords, bool invertn)
+{
+    return PrimitiveKey{ PrimitiveShape::Sphere, Float3{ diameter, 0, 0 }, tessellation, rhcoords, invertn };
+}
+
+PrimitiveKey PrimitiveKey::Teapot(float size, uint32_t tessellation, bool rhcoords)
+{
+    return PrimitiveKey{ PrimitiveShape::Teapot, Float3{ size, 0, 0 }, tessellation, rhcoords, false };
+}
+
+bool PrimitiveKey::operator==(const PrimitiveKey& other) const
+{
+    return shape == other.shape
+        && size.x == other.size.x && size.y == other.size.y && size.z == other.size.z
+        && tessellation == other.tessellation
+        && rhcoords == other.rhcoords
+        && invertn == other.invertn;
+}
+
+void DX::GeneratePrimitive(const PrimitiveKey& key, MeshData& mesh)
+{
+    switch (key.shape)
+    {
+    case PrimitiveShape::Box:
+        CreateBoxGeometry(mesh, key.size, key.rhcoords, key.invertn);
+        break;
+
+    case PrimitiveShape::Sphere:
+        CreateSphereGeometry(mesh, key.size.x, key.tessellation, key.rhcoords, key.invertn);
+        break;
+
+    case PrimitiveShape::Teapot:
+        CreateTeapotGeometry(mesh, key.size.x, key.tessellation, key.rhcoords);
+        break;
+    }
+}
+
+GeometryCache::GeometryCache(PrimitiveGenerator generator) :
+    m_generator(generator),
+    m_stats{}
+{
+}
+
+const MeshData* GeometryCache::Find(const PrimitiveKey& key) const
+{
+    // A scene has a handful of primitives; a linear search beats hashing floats.
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.key == key)
+        {
+            return entry.mesh.get();
+        }
+    }
+    return nullptr;
+}
+
+const MeshData& GeometryCache::Insert(const PrimitiveKey& key, std::unique_ptr<MeshData> mesh)
+{
+    m_stats.residentBytes += MeshBytes(*mesh);
+    m_entries.push_back(Entry{ key, std::move(mesh) });
+    return *m_entries.back().mesh;
+}
+
+const MeshData& GeometryCache::Get(const PrimitiveKey& key)
+{
+    if (const MeshData* cached = Find(key))
+    {
+        ++m_stats.hits;
+        return *cached;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<MeshData> mesh(new MeshData());
+    m_generator(key, *mesh);
+    m_stats.generationNanoseconds += ElapsedNanoseconds(start);
+    ++m_stats.misses;
+
+    return Insert(key, std::move(mesh));
+}
+
+void GeometryCache::Prefetch(const PrimitiveKey* keys, uint32_t count, JobSystem& jobs)
+{
+    std::vector<PrimitiveKey> missing;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        bool queued = false;
+        for (const PrimitiveKey& key : missing)
+        {
+            queued = queued || key == keys[i];
+        }
+        if (!queued && !Find(keys[i]))
+        {
+            missing.push_back(keys[i]);
+        }
+    }
+    if (missing.empty())
+    {
+        return;
+    }
+
+    std::vector<std::unique_ptr<MeshData>> meshes(missing.size());
+    std::vector<uint64_t> nanoseconds(missing.size());
+    std::vector<std::exception_ptr> errors(missing.size());
+    jobs.ParallelFor(uint32_t(missing.size()), [&](uint32_t index, uint32_t)
+    {
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            meshes[index].reset(new MeshData());
+            m_generator(missing[index], *meshes[index]);
+        }
+        catch (...)
+        {
+            errors[index] = std::current_exception();
+        }
+        nanoseconds[index] = ElapsedNanoseconds(start);
+    });
+
+    // Keep whatever generated; report the first failure.
+    std::exception_ptr error;
+    for (size_t i = 0; i < missing.size(); ++i)
+    {
+        if (errors[i])
+        {
+            error = error ? error : errors[i];
+            continue;
+        }
+        m_stats.generationNanoseconds += nanoseconds[i];
+        ++m_stats.misses;
+        Insert(missing[i], std::move(meshes[i]));
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void GeometryCache::Clear()
+{
+    m_entries.clear();
+    m_stats.residentBytes = 0;
+}
+
+void GeometryCache::ResetStats()
+{
+    uint64_t residentBytes = m_stats.residentBytes;
+    m_stats = GeometryCacheStats{};
+    m_stats.residentBytes = residentBytes;
+}
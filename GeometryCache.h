@@ -0,0 +1,97 @@
+//
+// GeometryCache.h - Tessellated procedural primitives keyed by shape and
+// parameters, generated once and kept CPU-side for every later upload
+//
+
+#pragma once
+
+#include "JobSystem.h"
+#include "MeshData.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+namespace DX
+{
+    enum class PrimitiveShape : uint8_t
+    {
+        Box,
+        Sphere,
+        Teapot,
+    };
+
+    // Everything a primitive's tessellation depends on. Build keys with the
+    // factories, which zero what a shape does not use, so equal shapes
+    // compare equal.
+    struct PrimitiveKey
+    {
+        PrimitiveShape  shape;
+        Float3          size;           // Box extents; x is the sphere diameter or the teapot size.
+        uint32_t        tessellation;
+        bool            rhcoords;
+        bool            invertn;
+
+        static PrimitiveKey Box(const Float3& size, bool rhcoords = true, bool invertn = false);
+        static PrimitiveKey Sphere(float diameter = 1, uint32_t tessellation = 16, bool rhcoords = true, bool invertn = false);
+        static PrimitiveKey Teapot(float size = 1, uint32_t tessellation = 8, bool rhcoords = true);
+
+        bool operator==(const PrimitiveKey& other) const;
+        bool operator!=(const PrimitiveKey& other) const    { return !(*this == other); }
+    };
+
+    // Fills mesh with the primitive a key describes. Must be safe to call
+    // from several threads at once. GeneratePrimitive uses ProceduralGeometry.
+    typedef void (*PrimitiveGenerator)(const PrimitiveKey& key, MeshData& mesh);
+    void GeneratePrimitive(const PrimitiveKey& key, MeshData& mesh);
+
+    struct GeometryCacheStats
+    {
+        uint32_t hits;
+        uint32_t misses;                    // Each one a generation.
+        uint64_t generationNanoseconds;     // Summed over misses, on whichever thread ran them.
+        uint64_t residentBytes;             // Vertex and index data held.
+    };
+
+    // Device creation asks the cache rather than tessellating, so a device
+    // reset, or a second object of the same shape, only re-uploads.
+    class GeometryCache
+    {
+    public:
+        explicit GeometryCache(PrimitiveGenerator generator = &GeneratePrimitive);
+
+        GeometryCache(GeometryCache const&) = delete;
+        GeometryCache& operator=(GeometryCache const&) = delete;
+
+        // The mesh for key, generated on first use. The reference stays
+        // valid until Clear.
+        const MeshData& Get(const PrimitiveKey& key);
+
+        // Generates every key not cached yet, spread across jobs; the Gets
+        // that follow hit. Duplicate keys are generated once. If any
+        // generator throws, the rest are still cached and the first
+        // exception is rethrown here.
+        void Prefetch(const PrimitiveKey* keys, uint32_t count, JobSystem& jobs);
+
+        void Clear();
+
+        uint32_t GetEntryCount() const                  { return uint32_t(m_entries.size()); }
+        const GeometryCacheStats& GetStats() const      { return m_stats; }
+        void ResetStats();
+
+    private:
+        struct Entry
+        {
+            PrimitiveKey                key;
+            std::unique_ptr<MeshData>   mesh;
+        };
+
+        const MeshData* Find(const PrimitiveKey& key) const;
+        const MeshData& Insert(const PrimitiveKey& key, std::unique_ptr<MeshData> mesh);
+
+        PrimitiveGenerator  m_generator;
+        std::vector<Entry>  m_entries;
+        GeometryCacheStats  m_stats;
+    };
+}
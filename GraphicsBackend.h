@@ -0,0 +1,163 @@
+//
+// GraphicsBackend.h - Thin interface over buffers, textures, pipeline state
+// and draw submission so rendering code can run against D3D11 or without a GPU
+//
+
+#pragma once
+
+#include <stdint.h>
+
+namespace DX
+{
+    // Handles are plain integers owned by the backend that created them.
+    // Zero is never a valid handle.
+    typedef uint32_t BufferHandle;
+    typedef uint32_t TextureHandle;
+    typedef uint32_t PipelineHandle;
+
+    const uint32_t InvalidHandle = 0;
+
+    enum class BufferUsage : uint8_t
+    {
+        Vertex,
+        Index,          // 16-bit indices
+        Constant,
+    };
+
+    struct BufferDesc
+    {
+        BufferUsage usage;
+        uint32_t    sizeBytes;
+        uint32_t    strideBytes;
+        bool        dynamic;        // Updated from the CPU after creation.
+    };
+
+    enum class TextureFormat : uint8_t
+    {
+        RGBA8,
+        BGRA8,
+        BC1,
+        BC2,
+        BC3,
+    };
+
+    struct TextureDesc
+    {
+        uint32_t        width;
+        uint32_t        height;
+        uint32_t        mipLevels;
+        uint32_t        arraySize;  // Six for cubemaps.
+        TextureFormat   format;
+        bool            cubemap;
+    };
+
+    // One entry per subresource, ordered array slice major then mip.
+    struct TextureSubresourceData
+    {
+        const void* data;
+        uint32_t    rowPitch;
+        uint32_t    slicePitch;
+    };
+
+    enum class VertexLayout : uint8_t
+    {
+        PositionColor,              // float3 position, float4 color
+        PositionNormalTexture,      // float3 position, float3 normal, float2 uv
+    };
+
+    // The fixed set of shading models the scene uses. Each backend maps these
+    // onto whatever it has: compiled shaders, DirectXTK effects or CPU code.
+    enum class ShaderProgram : uint8_t
+    {
+        VertexColor,                // ui_vs/ui_ps
+        TexturedLit,                // BasicEffect with one directional light
+        LitFog,                     // Model effect with light and fog
+        EnvironmentMap,             // EnvironmentMapEffect
+    };
+
+    enum class BlendMode : uint8_t      { Opaque, AlphaBlend, Additive };
+    enum class DepthMode : uint8_t      { None, Read, ReadWrite };
+    enum class CullMode : uint8_t       { None, Clockwise, CounterClockwise };
+
+    struct PipelineDesc
+    {
+        VertexLayout    layout;
+        ShaderProgram   program;
+        BlendMode       blend;
+        DepthMode       depth;
+        CullMode        cull;
+    };
+
+    // Constant buffer layouts shared by every backend. Matrices are stored
+    // transposed, as the HLSL shaders expect.
+    namespace ConstantSlot
+    {
+        const uint32_t Transforms = 0;
+        const uint32_t Lighting = 1;
+    }
+
+    struct TransformConstants
+    {
+        float world[16];
+        float view[16];
+        float projection[16];
+    };
+
+    struct LightingConstants
+    {
+        float lightDirection[4];
+        float diffuseColor[4];
+        float fogColor[4];
+        float fogStart;
+        float fogEnd;
+        float fresnelFactor;
+        float padding;
+    };
+
+    // Counters every backend maintains for its current frame.
+    struct BackendStats
+    {
+        uint32_t drawCalls;
+        uint32_t trianglesSubmitted;
+        uint32_t pipelineBinds;
+        uint32_t bufferBinds;
+        uint32_t textureBinds;
+        uint32_t bufferUpdates;
+        uint64_t bytesUploaded;
+    };
+
+    class IGraphicsBackend
+    {
+    public:
+        virtual ~IGraphicsBackend() = default;
+
+        // Resources
+        virtual BufferHandle CreateBuffer(const BufferDesc& desc, const void* initialData) = 0;
+        virtual TextureHandle CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData) = 0;
+        virtual PipelineHandle CreatePipelineState(const PipelineDesc& desc) = 0;
+
+        virtual void DestroyBuffer(BufferHandle buffer) = 0;
+        virtual void DestroyTexture(TextureHandle texture) = 0;
+        virtual void DestroyPipelineState(PipelineHandle pipeline) = 0;
+
+        // Replaces the whole contents of a dynamic buffer.
+        virtual void UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes) = 0;
+
+        // Frame
+        virtual void BeginFrame() = 0;
+        virtual void EndFrame() = 0;
+        virtual void Clear(const float color[4], float depth) = 0;
+        virtual void SetViewport(uint32_t width, uint32_t height) = 0;
+
+        // Draw submission
+        virtual void SetPipelineState(PipelineHandle pipeline) = 0;
+        virtual void SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes) = 0;
+        virtual void SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes) = 0;
+        virtual void SetConstantBuffer(uint32_t slot, BufferHandle buffer) = 0;
+        virtual void SetTexture(uint32_t slot, TextureHandle texture) = 0;
+        virtual void Draw(uint32_t vertexCount, uint32_t startVertex) = 0;
+        virtual void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) = 0;
+
+        virtual const BackendStats& GetFrameStats() const = 0;
+    };
+}
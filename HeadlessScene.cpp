@@ -0,0 +1,590 @@
+//
+// HeadlessScene.cpp
+//
+
+#include "HeadlessScene.h"
+#include "AllocationCounter.h"
+#include "CameraController.h"
+#include "Profiler.h"
+#include "ProceduralGeometry.h"
+#include "StepTimer.h"
+#include "TextureData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const Float3 START_POSITION = { 0.f, 0.f, -6.f };
+    const Float3 ROOM_BOUNDS = { 8.f, 6.f, 12.f };
+    const float Pi = 3.14159265359f;
+
+    // Game's camera: the old per-step gains as rates for the 60 Hz step.
+    const CameraSettings CAMERA_SETTINGS = { START_POSITION, ROOM_BOUNDS, 0.07f * 60.f, 0.004f };
+    const uint8_t VK_HOME_KEY = 0x24;
+
+    const float CornflowerBlue[4] = { 0.392156899f, 0.584313750f, 0.929411829f, 1.f };
+
+    void StoreTransposed(const Matrix44& m, float out[16])
+    {
+        Matrix44 t = m.Transpose();
+        std::memcpy(out, t.m, sizeof(t.m));
+    }
+
+    BufferHandle CreateStaticBuffer(IGraphicsBackend& backend, BufferUsage usage, const void* data, size_t size, uint32_t stride)
+    {
+        BufferDesc desc = { usage, uint32_t(size), stride, false };
+        return backend.CreateBuffer(desc, data);
+    }
+
+    TextureHandle CreateTextureFromData(IGraphicsBackend& backend, const TextureData& texture)
+    {
+        std::vector<TextureSubresourceData> subresources = texture.GetSubresources();
+        return backend.CreateTexture(texture.desc, subresources.data());
+    }
+}
+
+// Replays sorted commands through the backend. Pipelines carry all fixed
+// function state, so passes need no work of their own.
+class HeadlessScene::Executor : public IRenderCommandExecutor
+{
+public:
+    Executor(HeadlessScene& scene, IGraphicsBackend& backend, const State& state) :
+        m_scene(scene),
+        m_backend(backend),
+        m_state(state)
+    {
+    }
+
+    void SetPass(uint32_t, uint32_t) override
+    {
+    }
+
+    void SetShader(uint32_t shader) override
+    {
+        m_backend.SetPipelineState(m_scene.m_pipelines[shader]);
+    }
+
+    void SetMaterial(uint32_t material) override
+    {
+        m_backend.SetTexture(0, m_scene.m_draws[material].texture);
+    }
+
+    void Draw(const RenderCommand& command) override
+    {
+        const DrawItem& item = m_scene.m_draws[command.drawId];
+
+        if (command.drawId == DrawHud)
+        {
+            m_scene.UploadTransforms(m_backend, m_state.worlds[command.drawId], m_scene.m_hudView);
+            m_scene.m_hud.Draw(m_backend);
+            return;
+        }
+
+        m_scene.UploadTransforms(m_backend, m_state.worlds[command.drawId], m_scene.m_view);
+        m_backend.SetVertexBuffer(item.vertexBuffer, item.vertexStride, 0);
+        m_backend.SetIndexBuffer(item.indexBuffer, 0);
+        m_backend.DrawIndexed(item.indexCount, 0, 0);
+    }
+
+private:
+    HeadlessScene&      m_scene;
+    IGraphicsBackend&   m_backend;
+    const State&        m_state;
+};
+
+HeadlessScene::HeadlessScene() noexcept :
+    m_state{},
+    m_previousState{},
+    m_time(0),
+    m_rotation(0),
+    m_draws{},
+    m_pipelines{},
+    m_transformBuffer(InvalidHandle),
+    m_lightingBuffer(InvalidHandle),
+    m_cubemap(InvalidHandle),
+    m_meshAssets{},
+    m_textureAssets{},
+    m_cubemapAsset(0),
+    m_occlusionCuller(nullptr),
+    m_submittedDraws(0),
+    m_textureStreamer(nullptr),
+    m_streamedTextures{},
+    m_streamedCubemap(0),
+    m_outputWidth(800),
+    m_outputHeight(600),
+    m_lightPitch(0),
+    m_lightYaw(0),
+    m_view(Matrix44::Identity()),
+    m_proj(Matrix44::Identity()),
+    m_hudView(Matrix44::CreateLookAtRH(Float3{ 0, 0, 5 }, Float3{ 0, 0, 0 }, Float3{ 0, 1, 0 }))
+{
+    for (Matrix44& world : m_state.worlds)
+    {
+        world = Matrix44::Identity();
+    }
+    m_state.cameraPosition = START_POSITION;
+    m_previousState = m_state;
+
+    SetOutputSize(m_outputWidth, m_outputHeight);
+
+    // Fog and colour never change; the light follows the camera.
+    m_material.SetDiffuseColor(Float4{ 1.f, 1.f, 1.f, 1.f });
+    m_material.SetFog(true, 0, 12, Float4{ 0.f, 0.501960814f, 0.f, 1.f });
+    UpdateLightDirection(0, 0);
+}
+
+void HeadlessScene::CreateResources(IGraphicsBackend& backend, const std::string& assetDirectory)
+{
+    AssetDatabase assets(assetDirectory);
+    CreateResources(backend, assets);
+}
+
+void HeadlessScene::CreateResources(IGraphicsBackend& backend, AssetDatabase& assets)
+{
+    // Pipelines, indexed by RenderShader.
+    m_pipelines[ShaderPrimitive] = backend.CreatePipelineState(PipelineDesc{
+        VertexLayout::PositionNormalTexture, ShaderProgram::TexturedLit, BlendMode::Opaque, DepthMode::ReadWrite, CullMode::None });
+    m_pipelines[ShaderSkull] = backend.CreatePipelineState(PipelineDesc{
+        VertexLayout::PositionNormalTexture, ShaderProgram::LitFog, BlendMode::Opaque, DepthMode::ReadWrite, CullMode::None });
+    m_pipelines[ShaderEnvironmentMap] = backend.CreatePipelineState(PipelineDesc{
+        VertexLayout::PositionNormalTexture, ShaderProgram::EnvironmentMap, BlendMode::Opaque, DepthMode::ReadWrite, CullMode::None });
+    m_pipelines[ShaderHud] = backend.CreatePipelineState(PipelineDesc{
+        VertexLayout::PositionColor, ShaderProgram::VertexColor, BlendMode::Opaque, DepthMode::None, CullMode::None });
+
+    m_transformBuffer = backend.CreateBuffer(BufferDesc{ BufferUsage::Constant, sizeof(TransformConstants), 0, true }, nullptr);
+    m_lightingBuffer = backend.CreateBuffer(BufferDesc{ BufferUsage::Constant, sizeof(LightingConstants), 0, true }, nullptr);
+    m_material.MarkAllDirty();
+
+    // Primitives come from the cache, so recreating resources only uploads.
+    SetMesh(backend, DrawRoom, ShaderPrimitive, m_geometry.Get(PrimitiveKey::Box(ROOM_BOUNDS, false, true)));
+
+    m_meshAssets[DrawSkull] = assets.Add(AssetType::Mesh, "skull.sdkmesh");
+    SetMesh(backend, DrawSkull, ShaderSkull, assets.Get(m_meshAssets[DrawSkull]).mesh);
+
+    const MeshData& sphere = m_geometry.Get(PrimitiveKey::Sphere());
+    SetMesh(backend, DrawEarth, ShaderPrimitive, sphere);
+    m_occluderMesh = sphere;
+
+    SetMesh(backend, DrawTeapot, ShaderEnvironmentMap, m_geometry.Get(PrimitiveKey::Teapot()));
+
+    // The HUD geometry never changes; its animation is a scale in the world
+    // transform, so the batcher uploads it once.
+    {
+        std::vector<ColorVertex> hudVertices;
+        std::vector<uint16_t> hudIndices;
+        CreateHudGeometry(hudVertices, hudIndices);
+
+        m_hud.Clear();
+        m_hud.AddElement(0, m_pipelines[ShaderHud], InvalidHandle, hudVertices.data(), uint32_t(hudVertices.size()),
+            hudIndices.data(), uint32_t(hudIndices.size()));
+        m_draws[DrawHud].shader = ShaderHud;
+    }
+
+    if (m_textureStreamer)
+    {
+        // Render takes the textures from the streamer once it has updated.
+        m_streamedTextures[DrawRoom] = m_textureStreamer->Add("roomtexture.dds");
+        m_streamedTextures[DrawTeapot] = m_textureStreamer->Add("porcelain.dds");
+        m_streamedCubemap = m_textureStreamer->Add("cubemap.dds");
+    }
+    else
+    {
+        m_textureAssets[DrawRoom] = assets.Add(AssetType::Texture, "roomtexture.dds");
+        m_textureAssets[DrawTeapot] = assets.Add(AssetType::Texture, "porcelain.dds");
+        m_cubemapAsset = assets.Add(AssetType::Texture, "cubemap.dds");
+        m_draws[DrawRoom].texture = CreateTextureFromData(backend, assets.Get(m_textureAssets[DrawRoom]).texture);
+        m_draws[DrawTeapot].texture = CreateTextureFromData(backend, assets.Get(m_textureAssets[DrawTeapot]).texture);
+        m_cubemap = CreateTextureFromData(backend, assets.Get(m_cubemapAsset).texture);
+    }
+
+    // earth.bmp is not in every checkout. Without it, or if it does not
+    // decode, the globe gets a flat texture of the same size class.
+    try
+    {
+        m_textureAssets[DrawEarth] = assets.Add(AssetType::Texture, "earth.bmp");
+        m_draws[DrawEarth].texture = CreateTextureFromData(backend, assets.Get(m_textureAssets[DrawEarth]).texture);
+    }
+    catch (const std::runtime_error&)
+    {
+        m_textureAssets[DrawEarth] = 0;
+        const uint32_t size = 4;
+        std::vector<uint32_t> pixels(size * size, 0xFFB0803Cu);
+        TextureDesc desc = { size, size, 1, 1, TextureFormat::RGBA8, false };
+        TextureSubresourceData sub = { pixels.data(), size * 4, size * size * 4 };
+        m_draws[DrawEarth].texture = backend.CreateTexture(desc, &sub);
+    }
+}
+
+void HeadlessScene::SetMesh(IGraphicsBackend& backend, DrawId id, uint32_t shader, const MeshData& mesh)
+{
+    DrawItem& item = m_draws[id];
+    if (item.vertexBuffer != InvalidHandle)
+    {
+        backend.DestroyBuffer(item.vertexBuffer);
+        backend.DestroyBuffer(item.indexBuffer);
+    }
+
+    item.vertexBuffer = CreateStaticBuffer(backend, BufferUsage::Vertex, mesh.vertices.data(),
+        mesh.vertices.size() * sizeof(MeshVertex), sizeof(MeshVertex));
+    item.indexBuffer = CreateStaticBuffer(backend, BufferUsage::Index, mesh.indices.data(),
+        mesh.indices.size() * sizeof(uint16_t), sizeof(uint16_t));
+    item.vertexStride = sizeof(MeshVertex);
+    item.indexCount = uint32_t(mesh.indices.size());
+    item.shader = shader;
+    item.boundsCenter = mesh.boundsCenter;
+    item.boundsExtents = mesh.boundsExtents;
+}
+
+void HeadlessScene::ReloadAssets(IGraphicsBackend& backend, AssetDatabase& assets, const std::vector<AssetHandle>& changed)
+{
+    for (AssetHandle asset : changed)
+    {
+        if (asset == m_cubemapAsset)
+        {
+            backend.DestroyTexture(m_cubemap);
+            m_cubemap = CreateTextureFromData(backend, assets.Get(asset).texture);
+        }
+
+        for (uint32_t id = 0; id < DrawCount; ++id)
+        {
+            DrawItem& item = m_draws[id];
+            if (asset == m_meshAssets[id])
+            {
+                SetMesh(backend, DrawId(id), item.shader, assets.Get(asset).mesh);
+            }
+            if (asset == m_textureAssets[id])
+            {
+                backend.DestroyTexture(item.texture);
+                item.texture = CreateTextureFromData(backend, assets.Get(asset).texture);
+            }
+        }
+    }
+}
+
+void HeadlessScene::ReleaseResources(IGraphicsBackend& backend)
+{
+    for (uint32_t id = 0; id < DrawCount; ++id)
+    {
+        DrawItem& item = m_draws[id];
+        backend.DestroyBuffer(item.vertexBuffer);
+        backend.DestroyBuffer(item.indexBuffer);
+        if (!m_streamedTextures[id])
+        {
+            backend.DestroyTexture(item.texture);
+        }
+        item.vertexBuffer = item.indexBuffer = InvalidHandle;
+        item.texture = InvalidHandle;
+    }
+
+    for (PipelineHandle& pipeline : m_pipelines)
+    {
+        backend.DestroyPipelineState(pipeline);
+        pipeline = InvalidHandle;
+    }
+
+    m_hud.ReleaseResources(backend);
+    backend.DestroyBuffer(m_transformBuffer);
+    backend.DestroyBuffer(m_lightingBuffer);
+    if (m_textureStreamer)
+    {
+        m_textureStreamer->ReleaseResources(backend);
+    }
+    else
+    {
+        backend.DestroyTexture(m_cubemap);
+    }
+    m_transformBuffer = m_lightingBuffer = InvalidHandle;
+    m_cubemap = InvalidHandle;
+}
+
+void HeadlessScene::SetOutputSize(uint32_t width, uint32_t height)
+{
+    m_outputWidth = width ? width : 1;
+    m_outputHeight = height ? height : 1;
+    m_proj = Matrix44::CreatePerspectiveFieldOfViewRH(70.f * Pi / 180.f,
+        float(m_outputWidth) / float(m_outputHeight), 0.01f, 100.f);
+}
+
+void HeadlessScene::SetCamera(const Float3& position, float pitch, float yaw)
+{
+    // A jump, not motion: nothing to blend from.
+    m_state.cameraPosition = position;
+    m_state.pitch = pitch;
+    m_state.yaw = yaw;
+    m_previousState.cameraPosition = position;
+    m_previousState.pitch = pitch;
+    m_previousState.yaw = yaw;
+}
+
+void HeadlessScene::MoveCamera(const Float3& position, float pitch, float yaw)
+{
+    m_state.cameraPosition = position;
+    m_state.pitch = pitch;
+    m_state.yaw = yaw;
+}
+
+void HeadlessScene::UpdateLightDirection(float pitch, float yaw)
+{
+    // The skull light follows the camera orientation.
+    Float3 dir = Matrix44::CreateRotationX(pitch).TransformNormal(Float3{ 1, 1, 1 });
+    dir = Matrix44::CreateRotationY(yaw).TransformNormal(dir) * 0.5f;
+    m_material.SetLightDirection(dir);
+    m_lightPitch = pitch;
+    m_lightYaw = yaw;
+}
+
+void HeadlessScene::UpdateTextureStreaming(IGraphicsBackend& backend, const State& state)
+{
+    DX_PROFILE_SCOPE("Streaming");
+
+    // Each texture spans its object's bounding sphere. The cubemap is only
+    // seen reflected in the teapot.
+    for (DrawId id : { DrawRoom, DrawTeapot })
+    {
+        const DrawItem& item = m_draws[id];
+        const Matrix44& world = state.worlds[id];
+        Float3 center = world.TransformNormal(item.boundsCenter) + world.Translation();
+        float radius = item.boundsExtents.Length();
+
+        m_textureStreamer->AddUsage(m_streamedTextures[id], center, radius);
+        if (id == DrawTeapot)
+        {
+            m_textureStreamer->AddUsage(m_streamedCubemap, center, radius);
+        }
+    }
+
+    m_textureStreamer->Update(backend, StreamingView{ state.cameraPosition, m_proj.m[1][1], m_outputHeight });
+
+    m_draws[DrawRoom].texture = m_textureStreamer->GetTexture(m_streamedTextures[DrawRoom]);
+    m_draws[DrawTeapot].texture = m_textureStreamer->GetTexture(m_streamedTextures[DrawTeapot]);
+    m_cubemap = m_textureStreamer->GetTexture(m_streamedCubemap);
+}
+
+void HeadlessScene::Update(double totalSeconds)
+{
+    DX_PROFILE_SCOPE("Update");
+
+    m_previousState = m_state;
+
+    float time = float(totalSeconds);
+    m_time = time;
+
+    m_state.fresnelFactor = std::cos(time * 2.f);
+
+    m_state.worlds[DrawSkull] = Matrix44::CreateRotationY(std::cos(time) * 3.14f) * Matrix44::CreateTranslation(0.0f, -1.0f, 4.5f);
+    m_state.worlds[DrawEarth] = Matrix44::CreateRotationY(time) * Matrix44::CreateTranslation(0.0f, -2.0f, 0.0f);
+
+    if (m_rotation >= 360)
+    {
+        m_rotation = 0;
+    }
+    else
+    {
+        m_rotation++;
+    }
+
+    m_state.worlds[DrawTeapot] = Matrix44::CreateRotationZ(std::cos(time) * 2.f)
+        * Matrix44::CreateTranslation(2.0f, -2.0f, 0.0f)
+        * Matrix44::CreateRotationY(m_rotation * Pi / 180);
+
+    // The HUD triangles breathe by dividing through cos(2t), as in Game.
+    float hudScale = 1.f / std::cos(time * 2);
+    m_state.worlds[DrawHud] = Matrix44::CreateScale(hudScale, hudScale, hudScale);
+}
+
+void HeadlessScene::GetInterpolatedState(float blend, State& state) const
+{
+    const State& from = m_previousState;
+    const State& to = m_state;
+
+    for (uint32_t i = 0; i < DrawCount; ++i)
+    {
+        state.worlds[i] = InterpolateTransform(from.worlds[i], to.worlds[i], blend);
+    }
+
+    // The HUD is a bare scale that can change sign, which a rotation
+    // would misread as a half turn.
+    state.worlds[DrawHud] = Matrix44::Lerp(from.worlds[DrawHud], to.worlds[DrawHud], blend);
+
+    state.cameraPosition = from.cameraPosition + (to.cameraPosition - from.cameraPosition) * blend;
+    state.pitch = Lerp(from.pitch, to.pitch, blend);
+    state.yaw = LerpAngle(from.yaw, to.yaw, blend);
+    state.fresnelFactor = Lerp(from.fresnelFactor, to.fresnelFactor, blend);
+}
+
+void HeadlessScene::UploadTransforms(IGraphicsBackend& backend, const Matrix44& world, const Matrix44& view)
+{
+    TransformConstants constants;
+    StoreTransposed(world, constants.world);
+    StoreTransposed(view, constants.view);
+    StoreTransposed(m_proj, constants.projection);
+
+    backend.UpdateBuffer(m_transformBuffer, &constants, sizeof(constants));
+    backend.SetConstantBuffer(ConstantSlot::Transforms, m_transformBuffer);
+}
+
+void HeadlessScene::Render(IGraphicsBackend& backend, const State& state)
+{
+    DX_PROFILE_SCOPE("Render");
+
+    m_frameArena.Reset();
+
+    backend.BeginFrame();
+    backend.SetViewport(m_outputWidth, m_outputHeight);
+    backend.Clear(CornflowerBlue, 1.0f);
+
+    const Float3& cameraPos = state.cameraPosition;
+    float y = std::sin(state.pitch);
+    float r = std::cos(state.pitch);
+    Float3 lookAt = cameraPos + Float3{ r * std::sin(state.yaw), y, r * std::cos(state.yaw) };
+    m_view = Matrix44::CreateLookAtRH(cameraPos, lookAt, Float3{ 0, 1, 0 });
+
+    // Material counters cover one frame. Only re-aim the light when the camera turned.
+    m_material.ResetStats();
+    m_material.SetFresnelFactor(state.fresnelFactor);
+    if (state.pitch != m_lightPitch || state.yaw != m_lightYaw)
+    {
+        UpdateLightDirection(state.pitch, state.yaw);
+    }
+    m_material.Flush(backend, m_lightingBuffer);
+    backend.SetConstantBuffer(ConstantSlot::Lighting, m_lightingBuffer);
+    if (m_textureStreamer)
+    {
+        UpdateTextureStreaming(backend, state);
+    }
+    backend.SetTexture(1, m_cubemap);
+
+    auto depthOf = [&](DrawId id)
+    {
+        return RenderKey::EncodeDepth((state.worlds[id].Translation() - cameraPos).Length());
+    };
+
+    // The room encloses the camera and the HUD is screen space; only the
+    // props take part in occlusion culling.
+    bool visible[DrawCount] = { true, true, true, true, true };
+    if (m_occlusionCuller)
+    {
+        DX_PROFILE_SCOPE("Occlusion");
+        m_occlusionCuller->BeginFrame(m_view * m_proj);
+        m_occlusionCuller->AddOccluder(m_occluderMesh.vertices.data(), sizeof(MeshVertex),
+            m_occluderMesh.indices.data(), uint32_t(m_occluderMesh.indices.size()), state.worlds[DrawEarth]);
+        m_occlusionCuller->RasterizeOccluders();
+
+        for (DrawId id : { DrawSkull, DrawTeapot })
+        {
+            const DrawItem& item = m_draws[id];
+            visible[id] = m_occlusionCuller->IsVisible(state.worlds[id], item.boundsCenter, item.boundsExtents);
+        }
+    }
+
+    m_queue.Reset();
+    m_queue.Submit(RenderKey::Make(LayerWorld, 0, ShaderPrimitive, DrawRoom, RenderKey::EncodeDepth(ROOM_BOUNDS.z)), DrawRoom);
+    if (visible[DrawSkull])
+    {
+        m_queue.Submit(RenderKey::Make(LayerWorld, 0, ShaderSkull, DrawSkull, depthOf(DrawSkull)), DrawSkull);
+    }
+    m_queue.Submit(RenderKey::Make(LayerWorld, 0, ShaderPrimitive, DrawEarth, depthOf(DrawEarth)), DrawEarth);
+    if (visible[DrawTeapot])
+    {
+        m_queue.Submit(RenderKey::Make(LayerWorld, 0, ShaderEnvironmentMap, DrawTeapot, depthOf(DrawTeapot)), DrawTeapot);
+    }
+    m_queue.Submit(RenderKey::Make(LayerHud, 0, ShaderHud, DrawHud, 0), DrawHud);
+    m_submittedDraws = uint32_t(m_queue.GetCommandCount());
+
+    m_queue.Sort(m_frameArena);
+
+    Executor executor(*this, backend, state);
+    m_queue.Execute(executor);
+
+    backend.EndFrame();
+}
+
+void DX::ExpectZeroAllocationFrames(HeadlessScene& scene, IGraphicsBackend& backend,
+    uint32_t warmupFrames, uint32_t checkedFrames)
+{
+    const double step = 1.0 / 60.0;
+    uint32_t frame = 0;
+
+    // Frames are profiled as the game profiles them, so the check covers the
+    // markers and the per-frame summary too.
+    for (; frame < warmupFrames; ++frame)
+    {
+        Profiler::BeginFrame();
+        scene.Update(frame * step);
+        scene.Render(backend);
+        Profiler::EndFrame();
+    }
+
+    AllocationScope scope;
+    for (uint32_t i = 0; i < checkedFrames; ++i, ++frame)
+    {
+        Profiler::BeginFrame();
+        scene.Update(frame * step);
+        scene.Render(backend);
+        Profiler::EndFrame();
+    }
+
+    scope.ExpectNoAllocations("HeadlessScene steady state");
+}
+
+uint32_t DX::ReplayRecording(HeadlessScene& scene, IGraphicsBackend& backend, const InputRecording& recording)
+{
+    StepTimer timer;
+    timer.SetFixedTimeStep(true);
+    timer.SetTargetElapsedSeconds(1.0 / 60);
+
+    uint32_t capacity = 1024;
+    for (const RecordedTick& tick : recording.ticks)
+    {
+        capacity = std::max(capacity, tick.eventCount);
+    }
+
+    InputQueue input(capacity);
+    CameraController camera(CAMERA_SETTINGS);
+    uint64_t inputTime = 0;
+    uint32_t frames = 0;
+    HeadlessScene::State state;
+
+    for (const RecordedTick& tick : recording.ticks)
+    {
+        const InputEvent* events = recording.GetEvents(tick);
+        for (uint32_t i = 0; i < tick.eventCount; ++i)
+        {
+            input.Push(events[i]);
+        }
+
+        bool home = (tick.keys[VK_HOME_KEY >> 5] & (1u << (VK_HOME_KEY & 31))) != 0;
+
+        timer.Advance(tick.timeDelta, [&]()
+        {
+            uint64_t stepStart = inputTime;
+            inputTime = std::min(inputTime + timer.GetElapsedTicks(), tick.inputTime);
+            camera.Step(input, stepStart, inputTime);
+
+            scene.Update(timer.GetTotalSeconds());
+            if (home)
+            {
+                camera.Reset();
+            }
+            scene.MoveCamera(camera.GetPosition(), camera.GetPitch(), camera.GetYaw());
+        });
+
+        // As in Game::Tick; the clock starts at zero, so don't wrap.
+        const uint64_t elapsed = timer.GetElapsedTicks();
+        inputTime = std::max(inputTime, tick.inputTime > elapsed ? tick.inputTime - elapsed : 0);
+
+        if (timer.GetFrameCount() != 0)
+        {
+            scene.GetInterpolatedState(float(timer.GetBlendFactor()), state);
+            scene.Render(backend, state);
+            ++frames;
+        }
+    }
+
+    return frames;
+}
@@ -0,0 +1,199 @@
+//
+// HeadlessScene.h - The game's scene expressed purely through IGraphicsBackend,
+// so full frames can be submitted and profiled without a window or a GPU
+//
+
+#pragma once
+
+#include "AssetDatabase.h"
+#include "CpuMath.h"
+#include "FrameArena.h"
+#include "GeometryCache.h"
+#include "GraphicsBackend.h"
+#include "HudBatcher.h"
+#include "InputRecording.h"
+#include "Material.h"
+#include "MeshData.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "TextureStreamer.h"
+
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    class HeadlessScene
+    {
+    public:
+        enum DrawId : uint32_t { DrawRoom, DrawSkull, DrawEarth, DrawTeapot, DrawHud, DrawCount };
+
+        // Everything Update and SetCamera write and Render reads. Render
+        // touches nothing else Update writes, so a copy can render on
+        // another thread while Update fills the next (see FramePipeline).
+        struct State
+        {
+            Matrix44    worlds[DrawCount];
+            Float3      cameraPosition;
+            float       pitch;
+            float       yaw;
+            float       fresnelFactor;
+        };
+
+        HeadlessScene() noexcept;
+
+        HeadlessScene(HeadlessScene const&) = delete;
+        HeadlessScene& operator=(HeadlessScene const&) = delete;
+
+        // Creates the buffers, textures and pipelines for the room, skull,
+        // globe, teapot and HUD. skull.sdkmesh and the DDS textures are read
+        // from assetDirectory; a missing or broken earth.bmp falls back to a
+        // flat texture.
+        void CreateResources(IGraphicsBackend& backend, const std::string& assetDirectory);
+
+        // The same, with the files registered in and imported by assets, so
+        // ReloadAssets can swap in new versions as they change.
+        void CreateResources(IGraphicsBackend& backend, AssetDatabase& assets);
+        void ReleaseResources(IGraphicsBackend& backend);
+
+        // Recreates the buffers and textures of the assets in changed, as
+        // filled by AssetDatabase::ApplyChanges on the database passed to
+        // CreateResources. Everything else is left alone. Render thread.
+        void ReloadAssets(IGraphicsBackend& backend, AssetDatabase& assets, const std::vector<AssetHandle>& changed);
+
+        void SetOutputSize(uint32_t width, uint32_t height);
+        void SetCamera(const Float3& position, float pitch, float yaw);
+
+        // Like SetCamera, but as movement during the step just taken: the
+        // previous state keeps the old camera, so it interpolates. Call
+        // after Update.
+        void MoveCamera(const Float3& position, float pitch, float yaw);
+
+        // Advances the animation by one fixed step, as Game::Update does.
+        // Only writes the scene state; the state before the step is kept.
+        void Update(double totalSeconds);
+        const State& GetState() const                      { return m_state; }
+        const State& GetPreviousState() const              { return m_previousState; }
+
+        // The scene blend of the way from the previous step to the current
+        // one, for rendering more often than Update runs. blend is
+        // StepTimer::GetBlendFactor: 0 gives the previous step, 1 the current.
+        void GetInterpolatedState(float blend, State& state) const;
+
+        // Records, sorts and submits one frame of the current state.
+        void Render(IGraphicsBackend& backend)              { Render(backend, m_state); }
+
+        // Records, sorts and submits one frame of a snapshot. May run on
+        // another thread than Update and SetCamera, one call at a time.
+        // Resource creation, SetOutputSize and the stats below belong to
+        // the rendering thread too.
+        void Render(IGraphicsBackend& backend, const State& state);
+
+        // Scratch memory for anything built during a frame, the render
+        // queue's sort included. Render resets it first, so allocations
+        // stay valid until the next Render.
+        FrameArena& GetFrameArena()                         { return m_frameArena; }
+
+        // When set, the globe is rasterized into the culler each frame and
+        // the skull and teapot are only submitted if their boxes pass.
+        void SetOcclusionCuller(OcclusionCuller* culler)    { m_occlusionCuller = culler; }
+        uint32_t GetSubmittedDrawCount() const              { return m_submittedDraws; }
+
+        // When set before CreateResources, the DDS textures stream through
+        // it, at the mips the camera needs, rather than loading whole, and
+        // Render updates it each frame. Its root directory must be the
+        // asset directory. The scene does not own it.
+        void SetTextureStreamer(TextureStreamer* streamer)  { m_textureStreamer = streamer; }
+
+        const RenderQueueStats& GetQueueStats() const   { return m_queue.GetStats(); }
+        const HudBatchStats& GetHudStats() const        { return m_hud.GetStats(); }
+        const MaterialStats& GetMaterialStats() const   { return m_material.GetStats(); }
+        const GeometryCacheStats& GetGeometryStats() const  { return m_geometry.GetStats(); }
+        const Matrix44& GetView() const                 { return m_view; }
+        const Matrix44& GetProjection() const           { return m_proj; }
+        const Float3& GetCameraPosition() const         { return m_state.cameraPosition; }
+
+        // World-space transform and model-space bounds of a scene object.
+        const Matrix44& GetWorld(DrawId id) const       { return m_state.worlds[id]; }
+        const Float3& GetBoundsCenter(DrawId id) const  { return m_draws[id].boundsCenter; }
+        const Float3& GetBoundsExtents(DrawId id) const { return m_draws[id].boundsExtents; }
+
+    private:
+        enum RenderLayer : uint32_t { LayerWorld, LayerHud };
+        enum RenderShader : uint32_t { ShaderPrimitive, ShaderSkull, ShaderEnvironmentMap, ShaderHud, ShaderCount };
+
+        struct DrawItem
+        {
+            BufferHandle    vertexBuffer;
+            BufferHandle    indexBuffer;
+            uint32_t        vertexStride;
+            uint32_t        indexCount;
+            TextureHandle   texture;
+            uint32_t        shader;
+            Float3          boundsCenter;
+            Float3          boundsExtents;
+        };
+
+        class Executor;
+
+        void SetMesh(IGraphicsBackend& backend, DrawId id, uint32_t shader, const MeshData& mesh);
+        void UploadTransforms(IGraphicsBackend& backend, const Matrix44& world, const Matrix44& view);
+        void UpdateLightDirection(float pitch, float yaw);
+        void UpdateTextureStreaming(IGraphicsBackend& backend, const State& state);
+
+        // Update side.
+        State           m_state;
+        State           m_previousState;
+        float           m_time;
+        float           m_rotation;
+
+        // Render side; everything below belongs to Render.
+        RenderQueue     m_queue;
+        FrameArena      m_frameArena;
+        DrawItem        m_draws[DrawCount];
+        PipelineHandle  m_pipelines[ShaderCount];
+        BufferHandle    m_transformBuffer;
+        BufferHandle    m_lightingBuffer;
+        Material        m_material;         // Skull light and fog, teapot fresnel.
+        TextureHandle   m_cubemap;
+
+        // Where the draws' meshes and textures came from; zero if generated.
+        AssetHandle     m_meshAssets[DrawCount];
+        AssetHandle     m_textureAssets[DrawCount];
+        AssetHandle     m_cubemapAsset;
+
+        OcclusionCuller*            m_occlusionCuller;
+        MeshData                    m_occluderMesh;     // CPU copy of the globe.
+        GeometryCache               m_geometry;         // Room, globe and teapot, kept across CreateResources.
+        uint32_t                    m_submittedDraws;
+
+        TextureStreamer*            m_textureStreamer;
+        StreamedTextureHandle       m_streamedTextures[DrawCount];  // Zero if not streamed.
+        StreamedTextureHandle       m_streamedCubemap;
+
+        HudBatcher                  m_hud;
+
+        uint32_t        m_outputWidth;
+        uint32_t        m_outputHeight;
+        float           m_lightPitch;       // Camera angles the light was last aimed for.
+        float           m_lightYaw;
+        Matrix44        m_view;
+        Matrix44        m_proj;
+        Matrix44        m_hudView;
+    };
+
+    // Updates and renders warmupFrames at 60Hz so every container reaches its
+    // high-water mark, then throws std::runtime_error if any of the next
+    // checkedFrames touches the heap. Only meaningful in builds that define
+    // DX_TRACK_ALLOCATIONS; elsewhere nothing is counted and it always passes.
+    void ExpectZeroAllocationFrames(HeadlessScene& scene, IGraphicsBackend& backend,
+        uint32_t warmupFrames, uint32_t checkedFrames);
+
+    // Plays a recording made with Game::RecordInput through the scene the
+    // way Game::Tick would: the recorded timer deltas drive the 60Hz steps,
+    // the recorded events drive a camera with Game's settings (Home resets
+    // it), and every tick after the first step renders the interpolated
+    // state. The same recording always produces the same frames. Returns
+    // how many were rendered.
+    uint32_t ReplayRecording(HeadlessScene& scene, IGraphicsBackend& backend, const InputRecording& recording);
+}
@@ -0,0 +1,253 @@
+//
+// HudBatcher.cpp
+//
+
+#include "HudBatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+HudBatcher::HudBatcher() noexcept :
+    m_dirty(false),
+    m_uploadPending(false),
+    m_vertexBuffer(InvalidHandle),
+    m_indexBuffer(InvalidHandle),
+    m_vertexCapacity(0),
+    m_indexCapacity(0),
+    m_stats{}
+{
+}
+
+HudElementHandle HudBatcher::AddElement(uint32_t layer, PipelineHandle pipeline, TextureHandle texture,
+    const ColorVertex* vertices, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount)
+{
+    if (layer > RenderKey::MaxLayer || pipeline > RenderKey::MaxShader || texture > RenderKey::MaxMaterial)
+    {
+        throw std::runtime_error("HudBatcher::AddElement: layer, pipeline or texture out of range");
+    }
+
+    if (vertexCount == 0 || vertexCount > MaxBatchVertices || indexCount == 0)
+    {
+        throw std::runtime_error("HudBatcher::AddElement: bad vertex or index count");
+    }
+
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        if (indices[i] >= vertexCount)
+        {
+            throw std::runtime_error("HudBatcher::AddElement: index out of range");
+        }
+    }
+
+    Element element;
+    element.layer = layer;
+    element.pipeline = pipeline;
+    element.texture = texture;
+    element.firstVertex = uint32_t(m_sourceVertices.size());
+    element.vertexCount = vertexCount;
+    element.firstIndex = uint32_t(m_sourceIndices.size());
+    element.indexCount = indexCount;
+    element.visible = true;
+
+    m_sourceVertices.insert(m_sourceVertices.end(), vertices, vertices + vertexCount);
+    m_sourceIndices.insert(m_sourceIndices.end(), indices, indices + indexCount);
+    m_elements.push_back(element);
+    m_dirty = true;
+
+    return HudElementHandle(m_elements.size());
+}
+
+void HudBatcher::UpdateElement(HudElementHandle element, const ColorVertex* vertices, uint32_t vertexCount)
+{
+    const Element& e = m_elements.at(element - 1);
+    if (vertexCount != e.vertexCount)
+    {
+        throw std::runtime_error("HudBatcher::UpdateElement: vertex count changed");
+    }
+
+    std::memcpy(&m_sourceVertices[e.firstVertex], vertices, vertexCount * sizeof(ColorVertex));
+    m_dirty = true;
+}
+
+void HudBatcher::SetElementVisible(HudElementHandle element, bool visible)
+{
+    Element& e = m_elements.at(element - 1);
+    if (e.visible != visible)
+    {
+        e.visible = visible;
+        m_dirty = true;
+    }
+}
+
+void HudBatcher::Clear() noexcept
+{
+    m_elements.clear();
+    m_sourceVertices.clear();
+    m_sourceIndices.clear();
+    m_dirty = true;
+}
+
+void HudBatcher::Build()
+{
+    if (!m_dirty)
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // The element index goes in the depth field; the radix sort is stable,
+    // so elements sharing state also keep their insertion order.
+    m_commands.clear();
+    uint32_t vertexTotal = 0;
+    uint32_t indexTotal = 0;
+    for (uint32_t i = 0; i < uint32_t(m_elements.size()); ++i)
+    {
+        const Element& e = m_elements[i];
+        if (e.visible)
+        {
+            m_commands.push_back(RenderCommand{ RenderKey::Make(e.layer, 0, e.pipeline, e.texture, i), i, 0 });
+            vertexTotal += e.vertexCount;
+            indexTotal += e.indexCount;
+        }
+    }
+
+    RadixSortCommands(m_commands, m_scratch);
+
+    // Each batch addresses its vertices from baseVertex, so the 16-bit index
+    // limit applies per batch rather than to the whole stream.
+    m_vertices.resize(vertexTotal);
+    m_indices.resize(indexTotal);
+    m_batches.clear();
+
+    uint32_t vertexCursor = 0;
+    uint32_t indexCursor = 0;
+    uint64_t batchState = 0;
+    Batch* batch = nullptr;
+
+    for (const RenderCommand& command : m_commands)
+    {
+        const Element& e = m_elements[command.drawId];
+        uint64_t state = command.key >> RenderKey::MaterialShift;
+
+        if (!batch || state != batchState || batch->vertexCount + e.vertexCount > MaxBatchVertices)
+        {
+            m_batches.push_back(Batch{ e.pipeline, e.texture, indexCursor, 0, vertexCursor, 0 });
+            batch = &m_batches.back();
+            batchState = state;
+        }
+
+        std::memcpy(&m_vertices[vertexCursor], &m_sourceVertices[e.firstVertex], e.vertexCount * sizeof(ColorVertex));
+
+        const uint16_t* source = &m_sourceIndices[e.firstIndex];
+        uint16_t* dest = &m_indices[indexCursor];
+        uint32_t base = batch->vertexCount;
+        for (uint32_t i = 0; i < e.indexCount; ++i)
+        {
+            dest[i] = uint16_t(source[i] + base);
+        }
+
+        batch->vertexCount += e.vertexCount;
+        batch->indexCount += e.indexCount;
+        vertexCursor += e.vertexCount;
+        indexCursor += e.indexCount;
+    }
+
+    m_dirty = false;
+    m_uploadPending = true;
+
+    m_stats.elements = uint32_t(m_elements.size());
+    m_stats.visibleElements = uint32_t(m_commands.size());
+    m_stats.batches = uint32_t(m_batches.size());
+    m_stats.vertices = vertexTotal;
+    m_stats.indices = indexTotal;
+    ++m_stats.rebuilds;
+    m_stats.buildNanoseconds = ElapsedNanoseconds(start);
+}
+
+void HudBatcher::Upload(IGraphicsBackend& backend)
+{
+    // Buffers grow geometrically and are never shrunk, so a HUD that settles
+    // at some size stops reallocating.
+    if (m_vertices.size() > m_vertexCapacity)
+    {
+        backend.DestroyBuffer(m_vertexBuffer);
+        m_vertexCapacity = std::max(uint32_t(m_vertices.size()), m_vertexCapacity * 2);
+        m_vertexBuffer = backend.CreateBuffer(BufferDesc{ BufferUsage::Vertex,
+            uint32_t(m_vertexCapacity * sizeof(ColorVertex)), sizeof(ColorVertex), true }, nullptr);
+    }
+
+    if (m_indices.size() > m_indexCapacity)
+    {
+        backend.DestroyBuffer(m_indexBuffer);
+        m_indexCapacity = std::max(uint32_t(m_indices.size()), m_indexCapacity * 2);
+        m_indexBuffer = backend.CreateBuffer(BufferDesc{ BufferUsage::Index,
+            uint32_t(m_indexCapacity * sizeof(uint16_t)), sizeof(uint16_t), true }, nullptr);
+    }
+
+    if (!m_vertices.empty())
+    {
+        backend.UpdateBuffer(m_vertexBuffer, m_vertices.data(), uint32_t(m_vertices.size() * sizeof(ColorVertex)));
+        backend.UpdateBuffer(m_indexBuffer, m_indices.data(), uint32_t(m_indices.size() * sizeof(uint16_t)));
+    }
+
+    m_uploadPending = false;
+}
+
+void HudBatcher::Draw(IGraphicsBackend& backend)
+{
+    Build();
+
+    if (m_uploadPending)
+    {
+        Upload(backend);
+    }
+
+    if (m_batches.empty())
+    {
+        return;
+    }
+
+    backend.SetVertexBuffer(m_vertexBuffer, sizeof(ColorVertex), 0);
+    backend.SetIndexBuffer(m_indexBuffer, 0);
+
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        const Batch& batch = m_batches[i];
+
+        if (i == 0 || batch.pipeline != m_batches[i - 1].pipeline)
+        {
+            backend.SetPipelineState(batch.pipeline);
+        }
+
+        if (i == 0 || batch.texture != m_batches[i - 1].texture)
+        {
+            backend.SetTexture(0, batch.texture);
+        }
+
+        backend.DrawIndexed(batch.indexCount, batch.startIndex, int32_t(batch.baseVertex));
+    }
+}
+
+void HudBatcher::ReleaseResources(IGraphicsBackend& backend)
+{
+    backend.DestroyBuffer(m_vertexBuffer);
+    backend.DestroyBuffer(m_indexBuffer);
+    m_vertexBuffer = m_indexBuffer = InvalidHandle;
+    m_vertexCapacity = m_indexCapacity = 0;
+
+    // The next Draw uploads into fresh buffers.
+    m_uploadPending = !m_batches.empty();
+}
@@ -0,0 +1,124 @@
+//
+// HudBatcher.h - Retained 2D/HUD geometry merged into as few draws as the
+// pipelines and textures allow
+//
+
+#pragma once
+
+#include "GraphicsBackend.h"
+#include "MeshData.h"
+#include "RenderQueue.h"
+
+#include <vector>
+
+namespace DX
+{
+    typedef uint32_t HudElementHandle;
+
+    struct HudBatchStats
+    {
+        uint32_t elements;
+        uint32_t visibleElements;
+        uint32_t batches;               // Draw calls issued per Draw.
+        uint32_t vertices;
+        uint32_t indices;
+        uint32_t rebuilds;              // Builds that actually re-merged, since creation.
+        uint64_t buildNanoseconds;      // Most recent rebuild.
+    };
+
+    // Elements are added once and keep their geometry between frames. Build
+    // sorts the visible ones by layer, pipeline and texture and concatenates
+    // them into one vertex and index stream, so every run of elements that
+    // share state becomes a single DrawIndexed. The merged stream lives in
+    // persistent buffers that are only rewritten when an element changes;
+    // per-frame animation belongs in the transform constants, not in the
+    // vertices.
+    //
+    // Within a layer, draw order is kept only between elements that share a
+    // pipeline and texture. Put anything that must overlap in a fixed order
+    // on its own layer.
+    class HudBatcher
+    {
+    public:
+        HudBatcher() noexcept;
+
+        HudBatcher(HudBatcher const&) = delete;
+        HudBatcher& operator=(HudBatcher const&) = delete;
+
+        // layer, pipeline and texture must fit the RenderKey layer, shader
+        // and material fields. Indices are relative to the element's own
+        // vertices. Throws std::runtime_error on out-of-range input.
+        HudElementHandle AddElement(uint32_t layer, PipelineHandle pipeline, TextureHandle texture,
+            const ColorVertex* vertices, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount);
+
+        // Replaces an element's vertices; the count must match AddElement.
+        void UpdateElement(HudElementHandle element, const ColorVertex* vertices, uint32_t vertexCount);
+        void SetElementVisible(HudElementHandle element, bool visible);
+
+        // Removes every element. Buffers are kept for reuse.
+        void Clear() noexcept;
+
+        // Re-merges the elements if anything changed since the last build.
+        // CPU only; Draw calls it as needed.
+        void Build();
+
+        // Uploads a fresh build and issues one DrawIndexed per batch. The
+        // caller binds the transform constants beforehand.
+        void Draw(IGraphicsBackend& backend);
+
+        void ReleaseResources(IGraphicsBackend& backend);
+
+        uint32_t GetElementCount() const                    { return uint32_t(m_elements.size()); }
+        const HudBatchStats& GetStats() const               { return m_stats; }
+        const std::vector<ColorVertex>& GetVertices() const { return m_vertices; }
+        const std::vector<uint16_t>& GetIndices() const     { return m_indices; }
+
+        // Largest vertex count one batch can address with 16-bit indices.
+        static const uint32_t MaxBatchVertices = 65536;
+
+    private:
+        struct Element
+        {
+            uint32_t        layer;
+            PipelineHandle  pipeline;
+            TextureHandle   texture;
+            uint32_t        firstVertex;    // Into m_sourceVertices.
+            uint32_t        vertexCount;
+            uint32_t        firstIndex;     // Into m_sourceIndices.
+            uint32_t        indexCount;
+            bool            visible;
+        };
+
+        struct Batch
+        {
+            PipelineHandle  pipeline;
+            TextureHandle   texture;
+            uint32_t        startIndex;
+            uint32_t        indexCount;
+            uint32_t        baseVertex;
+            uint32_t        vertexCount;
+        };
+
+        void Upload(IGraphicsBackend& backend);
+
+        std::vector<Element>        m_elements;
+        std::vector<ColorVertex>    m_sourceVertices;
+        std::vector<uint16_t>       m_sourceIndices;
+
+        // Last build.
+        std::vector<RenderCommand>  m_commands;
+        std::vector<RenderCommand>  m_scratch;
+        std::vector<ColorVertex>    m_vertices;
+        std::vector<uint16_t>       m_indices;
+        std::vector<Batch>          m_batches;
+        bool                        m_dirty;
+        bool                        m_uploadPending;
+
+        BufferHandle                m_vertexBuffer;
+        BufferHandle                m_indexBuffer;
+        uint32_t                    m_vertexCapacity;
+        uint32_t                    m_indexCapacity;
+
+        HudBatchStats               m_stats;
+    };
+}
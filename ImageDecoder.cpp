@@ -0,0 +1,782 @@
+//
+// ImageDecoder.cpp
+//
+
+#include "ImageDecoder.h"
+#include "BinaryFile.h"
+#include "Deflate.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define IMAGE_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    // Keeps width * height * 4 well inside 32 bits.
+    const uint64_t MAX_PIXELS = 1ull << 28;
+
+    const uint32_t BI_RGB = 0;
+    const uint32_t BI_BITFIELDS = 3;
+    const uint32_t BI_ALPHABITFIELDS = 6;
+
+    uint16_t ReadLE16(const uint8_t* p)     { return uint16_t(p[0] | (p[1] << 8)); }
+    uint32_t ReadLE32(const uint8_t* p)     { return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24); }
+    uint32_t ReadBE32(const uint8_t* p)     { return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3]; }
+
+    uint32_t PackRGBA(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+    {
+        return r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    void CheckDimensions(uint64_t width, uint64_t height, const char* error)
+    {
+        if (width == 0 || height == 0 || width * height > MAX_PIXELS)
+        {
+            throw std::runtime_error(error);
+        }
+    }
+
+    //
+    // BMP
+    //
+
+    // One channel of a bitfield pixel, widened to 8 bits by repeating its
+    // bits, as the 5:6:5 DDS endpoints are.
+    struct BitField
+    {
+        uint32_t mask;
+        uint32_t shift;
+        uint32_t bits;
+
+        explicit BitField(uint32_t m = 0) : mask(m), shift(0), bits(0)
+        {
+            if (mask != 0)
+            {
+                while (!((mask >> shift) & 1))
+                {
+                    ++shift;
+                }
+                while (bits < 32 - shift && ((mask >> (shift + bits)) & 1))
+                {
+                    ++bits;
+                }
+            }
+        }
+
+        uint32_t Extract(uint32_t pixel, uint32_t missing) const
+        {
+            if (bits == 0)
+            {
+                return missing;
+            }
+            const uint32_t v = (pixel & mask) >> shift;
+            if (bits >= 8)
+            {
+                return v >> (bits - 8);
+            }
+            uint32_t result = 0;
+            for (int32_t s = 8 - int32_t(bits); s > -int32_t(bits); s -= int32_t(bits))
+            {
+                result |= (s >= 0) ? (v << s) : (v >> -s);
+            }
+            return result & 0xFF;
+        }
+    };
+
+    struct BmpLayout
+    {
+        uint32_t    width;
+        uint32_t    height;
+        bool        topDown;
+        uint32_t    bitCount;
+        uint32_t    masks[4];           // R, G, B, A; A zero if there is none.
+        uint32_t    palette[256];       // As RGBA8.
+        size_t      pixelOffset;
+        uint32_t    rowBytes;
+    };
+
+    void ParseBMP(const uint8_t* data, size_t size, BmpLayout& layout)
+    {
+        if (size < 26 || data[0] != 'B' || data[1] != 'M')
+        {
+            throw std::runtime_error("DecodeImage: not a BMP file");
+        }
+
+        const uint32_t headerSize = ReadLE32(data + 14);
+        if (size < 14 + size_t(headerSize) || (headerSize != 12 && headerSize < 40))
+        {
+            throw std::runtime_error("DecodeImage: bad BMP header");
+        }
+
+        int32_t width, height;
+        uint32_t compression = BI_RGB;
+        uint32_t colorsUsed = 0;
+        if (headerSize == 12)
+        {
+            width = int16_t(ReadLE16(data + 18));
+            height = int16_t(ReadLE16(data + 20));
+            layout.bitCount = ReadLE16(data + 24);
+        }
+        else
+        {
+            width = int32_t(ReadLE32(data + 18));
+            height = int32_t(ReadLE32(data + 22));
+            layout.bitCount = ReadLE16(data + 28);
+            compression = ReadLE32(data + 30);
+            colorsUsed = ReadLE32(data + 46);
+        }
+
+        if (compression != BI_RGB && compression != BI_BITFIELDS && compression != BI_ALPHABITFIELDS)
+        {
+            throw std::runtime_error("DecodeImage: compressed BMPs are not supported");
+        }
+        switch (layout.bitCount)
+        {
+        case 1: case 2: case 4: case 8: case 16: case 24: case 32:
+            break;
+        default:
+            throw std::runtime_error("DecodeImage: unsupported BMP bit count");
+        }
+
+        layout.topDown = height < 0;
+        layout.width = uint32_t(width);
+        layout.height = uint32_t(height < 0 ? -int64_t(height) : height);
+        CheckDimensions(width < 0 ? 0 : layout.width, layout.height, "DecodeImage: bad BMP size");
+        layout.rowBytes = uint32_t((uint64_t(layout.width) * layout.bitCount + 31) / 32 * 4);
+
+        // Masks live in the header from version 2 on; a plain info header
+        // with bitfields has them straight after it.
+        size_t paletteOffset = 14 + headerSize;
+        if (compression == BI_RGB)
+        {
+            const uint32_t rgb16[4] = { 0x7C00, 0x03E0, 0x001F, 0 };
+            const uint32_t rgb32[4] = { 0x00FF0000, 0x0000FF00, 0x000000FF, 0 };
+            std::memcpy(layout.masks, layout.bitCount == 16 ? rgb16 : rgb32, sizeof(layout.masks));
+        }
+        else
+        {
+            const size_t maskOffset = 14 + 40;
+            const uint32_t maskCount = (headerSize >= 56 || compression == BI_ALPHABITFIELDS) ? 4 : 3;
+            if (size < maskOffset + maskCount * 4)
+            {
+                throw std::runtime_error("DecodeImage: bad BMP header");
+            }
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                layout.masks[i] = (i < maskCount) ? ReadLE32(data + maskOffset + i * 4) : 0;
+            }
+            if (headerSize == 40)
+            {
+                paletteOffset += maskCount * 4;
+            }
+            if (layout.bitCount != 16 && layout.bitCount != 32)
+            {
+                throw std::runtime_error("DecodeImage: bad BMP bitfields");
+            }
+        }
+
+        std::fill(layout.palette, layout.palette + 256, PackRGBA(0, 0, 0, 255));
+        if (layout.bitCount <= 8)
+        {
+            const uint32_t entryBytes = (headerSize == 12) ? 3 : 4;
+            uint32_t entries = (colorsUsed != 0) ? std::min(colorsUsed, 256u) : (1u << layout.bitCount);
+            if (paletteOffset + size_t(entries) * entryBytes > size)
+            {
+                throw std::runtime_error("DecodeImage: truncated BMP palette");
+            }
+            for (uint32_t i = 0; i < entries; ++i)
+            {
+                const uint8_t* entry = data + paletteOffset + i * entryBytes;
+                layout.palette[i] = PackRGBA(entry[2], entry[1], entry[0], 255);
+            }
+        }
+
+        layout.pixelOffset = ReadLE32(data + 10);
+        if (layout.pixelOffset > size || size - layout.pixelOffset < uint64_t(layout.rowBytes) * layout.height)
+        {
+            throw std::runtime_error("DecodeImage: truncated BMP pixels");
+        }
+    }
+
+    // BGR triples to RGBA.
+    void ConvertBGR(const uint8_t* src, uint32_t width, uint32_t* dest)
+    {
+        uint32_t x = 0;
+#if defined(IMAGE_DECODER_SSE2)
+        const __m128i low = _mm_set1_epi32(0xFF);
+        const __m128i green = _mm_set1_epi32(0xFF00);
+        const __m128i alpha = _mm_set1_epi32(int32_t(0xFF000000));
+        for (; x + 4 <= width; x += 4, src += 12)
+        {
+            uint32_t p[3];
+            std::memcpy(p, src, 12);
+            // Realign the four triples into lanes: each lane gets B, G, R in
+            // its low three bytes.
+            __m128i v = _mm_setr_epi32(int32_t(p[0]), int32_t((p[0] >> 24) | (p[1] << 8)),
+                int32_t((p[1] >> 16) | (p[2] << 16)), int32_t(p[2] >> 8));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+            __m128i b = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+            __m128i rgba = _mm_or_si128(_mm_or_si128(r, b), _mm_or_si128(_mm_and_si128(v, green), alpha));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), rgba);
+        }
+#endif
+        for (; x < width; ++x, src += 3)
+        {
+            dest[x] = PackRGBA(src[2], src[1], src[0], 255);
+        }
+    }
+
+    // BGRA or BGRX words to RGBA.
+    void ConvertBGRA(const uint8_t* src, uint32_t width, bool keepAlpha, uint32_t* dest)
+    {
+        const uint32_t alphaMask = keepAlpha ? 0xFF000000 : 0;
+        const uint32_t alphaFill = keepAlpha ? 0 : 0xFF000000;
+        uint32_t x = 0;
+#if defined(IMAGE_DECODER_SSE2)
+        const __m128i low = _mm_set1_epi32(0xFF);
+        const __m128i keep = _mm_set1_epi32(int32_t(0x0000FF00 | alphaMask));
+        const __m128i fill = _mm_set1_epi32(int32_t(alphaFill));
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+            __m128i r = _mm_and_si128(_mm_srli_epi32(v, 16), low);
+            __m128i b = _mm_slli_epi32(_mm_and_si128(v, low), 16);
+            __m128i rgba = _mm_or_si128(_mm_or_si128(r, b), _mm_or_si128(_mm_and_si128(v, keep), fill));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), rgba);
+        }
+#endif
+        for (; x < width; ++x)
+        {
+            const uint32_t p = ReadLE32(src + x * 4);
+            dest[x] = ((p >> 16) & 0xFF) | ((p & 0xFF) << 16) | (p & 0x0000FF00) | (p & alphaMask) | alphaFill;
+        }
+    }
+
+    void DecodeBMP(const uint8_t* data, size_t size, uint8_t* dest, uint32_t rowPitch)
+    {
+        BmpLayout layout;
+        ParseBMP(data, size, layout);
+
+        const BitField fields[4] = { BitField(layout.masks[0]), BitField(layout.masks[1]), BitField(layout.masks[2]), BitField(layout.masks[3]) };
+        const bool standard32 = layout.bitCount == 32
+            && layout.masks[0] == 0x00FF0000 && layout.masks[1] == 0x0000FF00 && layout.masks[2] == 0x000000FF
+            && (layout.masks[3] == 0 || layout.masks[3] == 0xFF000000);
+
+        for (uint32_t y = 0; y < layout.height; ++y)
+        {
+            const uint32_t fileRow = layout.topDown ? y : layout.height - 1 - y;
+            const uint8_t* src = data + layout.pixelOffset + size_t(fileRow) * layout.rowBytes;
+            uint32_t* out = reinterpret_cast<uint32_t*>(dest + size_t(y) * rowPitch);
+
+            switch (layout.bitCount)
+            {
+            case 24:
+                ConvertBGR(src, layout.width, out);
+                break;
+
+            case 16:
+            case 32:
+                if (standard32)
+                {
+                    ConvertBGRA(src, layout.width, layout.masks[3] != 0, out);
+                    break;
+                }
+                for (uint32_t x = 0; x < layout.width; ++x)
+                {
+                    const uint32_t p = (layout.bitCount == 16) ? ReadLE16(src + x * 2) : ReadLE32(src + x * 4);
+                    out[x] = PackRGBA(fields[0].Extract(p, 0), fields[1].Extract(p, 0), fields[2].Extract(p, 0), fields[3].Extract(p, 255));
+                }
+                break;
+
+            default:
+            {
+                // Palette indices, most significant bits first.
+                const uint32_t bits = layout.bitCount;
+                const uint32_t mask = (1u << bits) - 1;
+                for (uint32_t x = 0; x < layout.width; ++x)
+                {
+                    const uint32_t bit = x * bits;
+                    const uint32_t index = (src[bit / 8] >> (8 - bits - bit % 8)) & mask;
+                    out[x] = layout.palette[index];
+                }
+                break;
+            }
+            }
+        }
+    }
+
+    //
+    // PNG
+    //
+
+    struct PngLayout
+    {
+        uint32_t                width;
+        uint32_t                height;
+        uint32_t                depth;
+        uint32_t                colorType;
+        uint32_t                channels;
+        uint32_t                stride;         // Bytes per unfiltered row.
+        uint32_t                filterBytes;    // Bytes per pixel for the filters, at least one.
+        uint32_t                palette[256];   // As RGBA8.
+        bool                    hasKey;         // Grey or RGB colour key from tRNS.
+        uint16_t                key[3];
+        bool                    hasAlpha;
+        std::vector<uint8_t>    joinedData;     // Only if the image data spans several IDATs.
+        const uint8_t*          compressed;
+        size_t                  compressedSize;
+    };
+
+    void ParsePNG(const uint8_t* data, size_t size, PngLayout& layout, bool headerOnly)
+    {
+        if (size < 8 + 25 || std::memcmp(data, PNG_SIGNATURE, 8) != 0 || ReadBE32(data + 8) != 13 || std::memcmp(data + 12, "IHDR", 4) != 0)
+        {
+            throw std::runtime_error("DecodeImage: not a PNG file");
+        }
+
+        const uint8_t* header = data + 16;
+        layout.width = ReadBE32(header);
+        layout.height = ReadBE32(header + 4);
+        layout.depth = header[8];
+        layout.colorType = header[9];
+        CheckDimensions(layout.width, layout.height, "DecodeImage: bad PNG size");
+        if (header[10] != 0 || header[11] != 0)
+        {
+            throw std::runtime_error("DecodeImage: unknown PNG compression or filter method");
+        }
+        if (header[12] != 0)
+        {
+            throw std::runtime_error("DecodeImage: interlaced PNGs are not supported");
+        }
+
+        const uint32_t d = layout.depth;
+        switch (layout.colorType)
+        {
+        case 0: layout.channels = 1; break;
+        case 2: layout.channels = 3; break;
+        case 3: layout.channels = 1; break;
+        case 4: layout.channels = 2; break;
+        case 6: layout.channels = 4; break;
+        default: throw std::runtime_error("DecodeImage: bad PNG colour type");
+        }
+        const bool validDepth = (layout.colorType == 0) ? (d == 1 || d == 2 || d == 4 || d == 8 || d == 16)
+            : (layout.colorType == 3) ? (d == 1 || d == 2 || d == 4 || d == 8)
+            : (d == 8 || d == 16);
+        if (!validDepth)
+        {
+            throw std::runtime_error("DecodeImage: bad PNG bit depth");
+        }
+
+        const uint32_t bitsPerPixel = layout.channels * d;
+        layout.stride = uint32_t((uint64_t(layout.width) * bitsPerPixel + 7) / 8);
+        layout.filterBytes = std::max(1u, bitsPerPixel / 8);
+        layout.hasAlpha = layout.colorType == 4 || layout.colorType == 6;
+        layout.hasKey = false;
+        std::fill(layout.palette, layout.palette + 256, PackRGBA(0, 0, 0, 255));
+
+        // Walk the chunks for the palette, transparency and image data.
+        const uint8_t* firstData = nullptr;
+        size_t firstDataSize = 0;
+        uint32_t dataChunks = 0;
+        size_t offset = 8;
+        bool ended = false;
+        while (!ended)
+        {
+            if (size - offset < 12)
+            {
+                throw std::runtime_error("DecodeImage: truncated PNG");
+            }
+            const uint32_t length = ReadBE32(data + offset);
+            const uint8_t* type = data + offset + 4;
+            const uint8_t* chunk = data + offset + 8;
+            if (length > size - offset - 12)
+            {
+                throw std::runtime_error("DecodeImage: truncated PNG");
+            }
+            offset += 12 + size_t(length);
+
+            if (!std::memcmp(type, "PLTE", 4))
+            {
+                for (uint32_t i = 0; i < length / 3 && i < 256; ++i)
+                {
+                    layout.palette[i] = PackRGBA(chunk[i * 3], chunk[i * 3 + 1], chunk[i * 3 + 2], 255);
+                }
+            }
+            else if (!std::memcmp(type, "tRNS", 4))
+            {
+                layout.hasAlpha = true;
+                if (layout.colorType == 3)
+                {
+                    for (uint32_t i = 0; i < length && i < 256; ++i)
+                    {
+                        layout.palette[i] = (layout.palette[i] & 0x00FFFFFF) | (uint32_t(chunk[i]) << 24);
+                    }
+                }
+                else if (length >= layout.channels * 2)
+                {
+                    layout.hasKey = true;
+                    for (uint32_t c = 0; c < layout.channels; ++c)
+                    {
+                        layout.key[c] = uint16_t((chunk[c * 2] << 8) | chunk[c * 2 + 1]);
+                    }
+                }
+            }
+            else if (!std::memcmp(type, "IDAT", 4))
+            {
+                if (dataChunks++ == 0)
+                {
+                    firstData = chunk;
+                    firstDataSize = length;
+                }
+                else if (!headerOnly)
+                {
+                    if (dataChunks == 2)
+                    {
+                        layout.joinedData.assign(firstData, firstData + firstDataSize);
+                    }
+                    layout.joinedData.insert(layout.joinedData.end(), chunk, chunk + length);
+                }
+            }
+            else if (!std::memcmp(type, "IEND", 4))
+            {
+                ended = true;
+            }
+        }
+
+        if (dataChunks == 0)
+        {
+            throw std::runtime_error("DecodeImage: PNG has no image data");
+        }
+        layout.compressed = (dataChunks == 1) ? firstData : layout.joinedData.data();
+        layout.compressedSize = (dataChunks == 1) ? firstDataSize : layout.joinedData.size();
+    }
+
+    uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c)
+    {
+        const int32_t pa = std::abs(int32_t(b) - c);
+        const int32_t pb = std::abs(int32_t(a) - c);
+        const int32_t pc = std::abs(int32_t(a) + b - 2 * c);
+        return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+    }
+
+#if defined(IMAGE_DECODER_SSE2)
+    template <uint32_t Bytes>
+    __m128i LoadPixel(const uint8_t* p)
+    {
+        uint32_t v = 0;
+        std::memcpy(&v, p, Bytes);
+        return _mm_cvtsi32_si128(int32_t(v));
+    }
+
+    template <uint32_t Bytes>
+    void StorePixel(uint8_t* p, __m128i v)
+    {
+        uint32_t x = uint32_t(_mm_cvtsi128_si32(v));
+        std::memcpy(p, &x, Bytes);
+    }
+
+    // The three filters that chain along the row, one pixel per step with
+    // its channels in parallel.
+    template <uint32_t Bytes>
+    void UnfilterPixels(uint32_t filter, uint8_t* row, const uint8_t* prior, uint32_t stride)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        if (filter == 1)
+        {
+            __m128i a = zero;
+            for (uint32_t i = 0; i < stride; i += Bytes)
+            {
+                a = _mm_add_epi8(a, LoadPixel<Bytes>(row + i));
+                StorePixel<Bytes>(row + i, a);
+            }
+        }
+        else if (filter == 3)
+        {
+            const __m128i one = _mm_set1_epi8(1);
+            __m128i a = zero;
+            for (uint32_t i = 0; i < stride; i += Bytes)
+            {
+                __m128i b = LoadPixel<Bytes>(prior + i);
+                // avg rounds up; the filter wants the floor.
+                __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+                a = _mm_add_epi8(LoadPixel<Bytes>(row + i), average);
+                StorePixel<Bytes>(row + i, a);
+            }
+        }
+        else
+        {
+            // Sixteen-bit lanes leave room for the signed differences.
+            const __m128i low = _mm_set1_epi16(0xFF);
+            __m128i a = zero, c = zero;
+            for (uint32_t i = 0; i < stride; i += Bytes)
+            {
+                __m128i b = _mm_unpacklo_epi8(LoadPixel<Bytes>(prior + i), zero);
+                __m128i x = _mm_unpacklo_epi8(LoadPixel<Bytes>(row + i), zero);
+
+                __m128i pa = _mm_sub_epi16(b, c);
+                __m128i pb = _mm_sub_epi16(a, c);
+                __m128i pc = _mm_add_epi16(pa, pb);
+                pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+                __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                __m128i useA = _mm_cmpeq_epi16(pa, smallest);
+                __m128i useB = _mm_andnot_si128(useA, _mm_cmpeq_epi16(pb, smallest));
+                __m128i useC = _mm_andnot_si128(_mm_or_si128(useA, useB), _mm_set1_epi16(-1));
+                __m128i nearest = _mm_or_si128(_mm_or_si128(_mm_and_si128(useA, a), _mm_and_si128(useB, b)), _mm_and_si128(useC, c));
+
+                a = _mm_and_si128(_mm_add_epi16(nearest, x), low);
+                c = b;
+                StorePixel<Bytes>(row + i, _mm_packus_epi16(a, a));
+            }
+        }
+    }
+#endif
+
+    // Reverses one row's filter in place; prior is the row above, already
+    // unfiltered, or zeros for the first.
+    void Unfilter(uint32_t filter, uint8_t* row, const uint8_t* prior, uint32_t stride, uint32_t bpp)
+    {
+        switch (filter)
+        {
+        case 0:
+            return;
+
+        case 2:
+        {
+            uint32_t i = 0;
+#if defined(IMAGE_DECODER_SSE2)
+            for (; i + 16 <= stride; i += 16)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prior + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(x, b));
+            }
+#endif
+            for (; i < stride; ++i)
+            {
+                row[i] = uint8_t(row[i] + prior[i]);
+            }
+            return;
+        }
+
+        case 1:
+        case 3:
+        case 4:
+#if defined(IMAGE_DECODER_SSE2)
+            if (bpp == 4)
+            {
+                UnfilterPixels<4>(filter, row, prior, stride);
+                return;
+            }
+            if (bpp == 3)
+            {
+                UnfilterPixels<3>(filter, row, prior, stride);
+                return;
+            }
+#endif
+            for (uint32_t i = 0; i < stride; ++i)
+            {
+                const uint8_t a = (i >= bpp) ? row[i - bpp] : 0;
+                const uint8_t c = (i >= bpp) ? prior[i - bpp] : 0;
+                if (filter == 1)
+                    row[i] = uint8_t(row[i] + a);
+                else if (filter == 3)
+                    row[i] = uint8_t(row[i] + ((a + prior[i]) >> 1));
+                else
+                    row[i] = uint8_t(row[i] + Paeth(a, prior[i], c));
+            }
+            return;
+
+        default:
+            throw std::runtime_error("DecodeImage: bad PNG filter");
+        }
+    }
+
+    // One unfiltered row to RGBA8.
+    void ConvertPNGRow(const PngLayout& layout, const uint8_t* src, uint32_t* out)
+    {
+        const uint32_t width = layout.width;
+
+        if (layout.depth == 8 && !layout.hasKey)
+        {
+            switch (layout.colorType)
+            {
+            case 6:
+                std::memcpy(out, src, size_t(width) * 4);
+                return;
+            case 2:
+                for (uint32_t x = 0; x < width; ++x, src += 3)
+                {
+                    out[x] = PackRGBA(src[0], src[1], src[2], 255);
+                }
+                return;
+            case 3:
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    out[x] = layout.palette[src[x]];
+                }
+                return;
+            default:
+                break;
+            }
+        }
+
+        // Everything else a sample at a time, at the file's own depth.
+        const uint32_t depth = layout.depth;
+        const uint32_t maxSample = (1u << depth) - 1;
+        uint32_t bit = 0;
+        auto next = [&]() -> uint32_t
+        {
+            uint32_t v;
+            if (depth == 16)
+                v = (uint32_t(src[bit / 8]) << 8) | src[bit / 8 + 1];
+            else if (depth == 8)
+                v = src[bit / 8];
+            else
+                v = (src[bit / 8] >> (8 - depth - bit % 8)) & maxSample;
+            bit += depth;
+            return v;
+        };
+        // To eight bits: the high byte of sixteen, low depths scaled up.
+        auto widen = [&](uint32_t v) -> uint32_t
+        {
+            return (depth == 16) ? (v >> 8) : (depth == 8) ? v : v * 255 / maxSample;
+        };
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            switch (layout.colorType)
+            {
+            case 0:
+            {
+                const uint32_t g = next();
+                const uint32_t a = (layout.hasKey && g == layout.key[0]) ? 0 : 255;
+                out[x] = PackRGBA(widen(g), widen(g), widen(g), a);
+                break;
+            }
+            case 2:
+            {
+                const uint32_t r = next(), g = next(), b = next();
+                const uint32_t a = (layout.hasKey && r == layout.key[0] && g == layout.key[1] && b == layout.key[2]) ? 0 : 255;
+                out[x] = PackRGBA(widen(r), widen(g), widen(b), a);
+                break;
+            }
+            case 3:
+                out[x] = layout.palette[next()];
+                break;
+            case 4:
+            {
+                const uint32_t g = widen(next());
+                out[x] = PackRGBA(g, g, g, widen(next()));
+                break;
+            }
+            default:
+            {
+                const uint32_t r = next(), g = next(), b = next();
+                out[x] = PackRGBA(widen(r), widen(g), widen(b), widen(next()));
+                break;
+            }
+            }
+        }
+    }
+
+    void DecodePNG(const uint8_t* data, size_t size, uint8_t* dest, uint32_t rowPitch)
+    {
+        PngLayout layout;
+        ParsePNG(data, size, layout, false);
+
+        // Every row is its filter byte then stride bytes; they unfilter in
+        // place, each against the one above.
+        const size_t rowBytes = size_t(layout.stride) + 1;
+        std::vector<uint8_t> rows(rowBytes * layout.height);
+        ZlibDecompress(layout.compressed, layout.compressedSize, rows.data(), rows.size());
+
+        std::vector<uint8_t> zeros(layout.stride, 0);
+        const uint8_t* prior = zeros.data();
+        for (uint32_t y = 0; y < layout.height; ++y)
+        {
+            uint8_t* row = rows.data() + y * rowBytes;
+            Unfilter(row[0], row + 1, prior, layout.stride, layout.filterBytes);
+            ConvertPNGRow(layout, row + 1, reinterpret_cast<uint32_t*>(dest + size_t(y) * rowPitch));
+            prior = row + 1;
+        }
+    }
+}
+
+bool DX::IsDecodableImage(const uint8_t* data, size_t size)
+{
+    return (size >= 2 && data[0] == 'B' && data[1] == 'M')
+        || (size >= 8 && std::memcmp(data, PNG_SIGNATURE, 8) == 0);
+}
+
+ImageInfo DX::ReadImageInfo(const uint8_t* data, size_t size)
+{
+    ImageInfo info;
+    if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+    {
+        BmpLayout layout;
+        ParseBMP(data, size, layout);
+        info.width = layout.width;
+        info.height = layout.height;
+        info.format = ImageFileFormat::BMP;
+        info.hasAlpha = layout.bitCount >= 16 && layout.masks[3] != 0;
+    }
+    else
+    {
+        PngLayout layout;
+        ParsePNG(data, size, layout, true);
+        info.width = layout.width;
+        info.height = layout.height;
+        info.format = ImageFileFormat::PNG;
+        info.hasAlpha = layout.hasAlpha;
+    }
+    return info;
+}
+
+void DX::DecodeImage(const uint8_t* data, size_t size, void* dest, uint32_t rowPitch)
+{
+    if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+    {
+        DecodeBMP(data, size, static_cast<uint8_t*>(dest), rowPitch);
+    }
+    else
+    {
+        DecodePNG(data, size, static_cast<uint8_t*>(dest), rowPitch);
+    }
+}
+
+TextureData DX::LoadImageFromMemory(const uint8_t* data, size_t size)
+{
+    ImageInfo info = ReadImageInfo(data, size);
+
+    TextureData texture;
+    texture.desc = TextureDesc{ info.width, info.height, 1, 1, TextureFormat::RGBA8, false };
+    TextureSurface surface;
+    surface.width = info.width;
+    surface.height = info.height;
+    GetSurfaceInfo(TextureFormat::RGBA8, info.width, info.height, surface.rowPitch, surface.slicePitch);
+    surface.offset = 0;
+    texture.surfaces.push_back(surface);
+    texture.pixels.resize(surface.slicePitch);
+
+    DecodeImage(data, size, texture.pixels.data(), surface.rowPitch);
+    return texture;
+}
+
+TextureData DX::LoadImageFromFile(const std::string& path)
+{
+    std::vector<uint8_t> blob = ReadBinaryFile(path);
+    return LoadImageFromMemory(blob.data(), blob.size());
+}
@@ -0,0 +1,49 @@
+//
+// ImageDecoder.h - Portable BMP and PNG decoding to RGBA8, for textures
+// that do not come as DDS
+//
+
+#pragma once
+
+#include "TextureData.h"
+
+#include <stdint.h>
+
+#include <string>
+
+namespace DX
+{
+    enum class ImageFileFormat : uint8_t
+    {
+        BMP,
+        PNG,
+    };
+
+    struct ImageInfo
+    {
+        uint32_t        width;
+        uint32_t        height;
+        ImageFileFormat format;
+        bool            hasAlpha;       // Otherwise every decoded alpha is 255.
+    };
+
+    // Whether data starts like a BMP or PNG file.
+    bool IsDecodableImage(const uint8_t* data, size_t size);
+
+    // Reads the header only. Throws std::runtime_error for anything
+    // DecodeImage would refuse.
+    ImageInfo ReadImageInfo(const uint8_t* data, size_t size);
+
+    // Decodes to RGBA8 (R in the low byte, top row first) at dest, rows
+    // rowPitch bytes apart, so the pixels can land straight in an upload
+    // buffer or a texture surface. Takes uncompressed and bitfield BMPs of
+    // 1 to 32 bits per pixel, and non-interlaced PNGs of every colour type
+    // and bit depth; 16-bit channels keep their high byte. Throws
+    // std::runtime_error for anything else or for corrupt data, in which
+    // case dest may be partly written.
+    void DecodeImage(const uint8_t* data, size_t size, void* dest, uint32_t rowPitch);
+
+    // The image as a single-mip RGBA8 texture.
+    TextureData LoadImageFromMemory(const uint8_t* data, size_t size);
+    TextureData LoadImageFromFile(const std::string& path);
+}
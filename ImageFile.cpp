@@ -0,0 +1,215 @@
+//
+// ImageFile.cpp
+//
+
+#include "ImageFile.h"
+#include "BinaryFile.h"
+#include "Deflate.h"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace DX;
+
+namespace
+{
+#pragma pack(push, 2)
+    struct BITMAPFILEHEADER_
+    {
+        uint16_t type;
+        uint32_t size;
+        uint16_t reserved1;
+        uint16_t reserved2;
+        uint32_t offBits;
+    };
+#pragma pack(pop)
+
+    struct BITMAPINFOHEADER_
+    {
+        uint32_t size;
+        int32_t  width;
+        int32_t  height;
+        uint16_t planes;
+        uint16_t bitCount;
+        uint32_t compression;
+        uint32_t sizeImage;
+        int32_t  xPelsPerMeter;
+        int32_t  yPelsPerMeter;
+        uint32_t clrUsed;
+        uint32_t clrImportant;
+    };
+
+    static_assert(sizeof(BITMAPFILEHEADER_) == 14, "BMP file header size mismatch");
+    static_assert(sizeof(BITMAPINFOHEADER_) == 40, "BMP info header size mismatch");
+
+    const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    void WriteBE32(uint8_t* p, uint32_t v)
+    {
+        p[0] = uint8_t(v >> 24);
+        p[1] = uint8_t(v >> 16);
+        p[2] = uint8_t(v >> 8);
+        p[3] = uint8_t(v);
+    }
+
+    uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc)
+    {
+        static const struct Table
+        {
+            uint32_t entries[256];
+            Table()
+            {
+                for (uint32_t i = 0; i < 256; ++i)
+                {
+                    uint32_t c = i;
+                    for (uint32_t k = 0; k < 8; ++k)
+                    {
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    entries[i] = c;
+                }
+            }
+        } table;
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    void AppendChunk(std::vector<uint8_t>& file, const char* type, const uint8_t* data, size_t size)
+    {
+        uint8_t length[4];
+        WriteBE32(length, uint32_t(size));
+        file.insert(file.end(), length, length + 4);
+
+        const size_t typeOffset = file.size();
+        file.insert(file.end(), type, type + 4);
+        if (size > 0)
+        {
+            file.insert(file.end(), data, data + size);
+        }
+
+        uint8_t crc[4];
+        WriteBE32(crc, Crc32(file.data() + typeOffset, size + 4, 0xFFFFFFFFu) ^ 0xFFFFFFFFu);
+        file.insert(file.end(), crc, crc + 4);
+    }
+
+    int32_t PaethPredictor(int32_t a, int32_t b, int32_t c)
+    {
+        const int32_t pa = std::abs(b - c);
+        const int32_t pb = std::abs(a - c);
+        const int32_t pc = std::abs(a + b - 2 * c);
+        return (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+    }
+}
+
+std::vector<uint8_t> DX::EncodeBMP(uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+    // Rows are BGR and padded to four bytes.
+    const uint32_t rowBytes = (width * 3 + 3) & ~3u;
+    const uint32_t imageBytes = rowBytes * height;
+    const uint32_t headerBytes = sizeof(BITMAPFILEHEADER_) + sizeof(BITMAPINFOHEADER_);
+
+    std::vector<uint8_t> file(headerBytes + imageBytes, 0);
+
+    BITMAPFILEHEADER_ fileHeader = { 0x4D42, headerBytes + imageBytes, 0, 0, headerBytes };
+    BITMAPINFOHEADER_ infoHeader = { sizeof(BITMAPINFOHEADER_), int32_t(width), -int32_t(height), 1, 24, 0, imageBytes, 2835, 2835, 0, 0 };
+    std::memcpy(file.data(), &fileHeader, sizeof(fileHeader));
+    std::memcpy(file.data() + sizeof(fileHeader), &infoHeader, sizeof(infoHeader));
+
+    // A negative height stores rows top-down, matching the source.
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint32_t* src = pixels + size_t(y) * width;
+        uint8_t* dst = file.data() + headerBytes + size_t(y) * rowBytes;
+
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint32_t p = src[x];
+            dst[x * 3 + 0] = uint8_t(p >> 16);
+            dst[x * 3 + 1] = uint8_t(p >> 8);
+            dst[x * 3 + 2] = uint8_t(p);
+        }
+    }
+
+    return file;
+}
+
+void DX::SaveBMPToFile(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+    std::vector<uint8_t> file = EncodeBMP(width, height, pixels);
+    WriteBinaryFile(path, file.data(), file.size());
+}
+
+std::vector<uint8_t> DX::EncodePNG(uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+    // Filter every row five ways and keep the one with the smallest sum of
+    // signed bytes, the usual guess at what deflates best.
+    const size_t stride = size_t(width) * 4;
+    std::vector<uint8_t> filtered((stride + 1) * height);
+    std::vector<uint8_t> candidates(stride * 5);
+    std::vector<uint8_t> zeros(stride, 0);
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t* row = reinterpret_cast<const uint8_t*>(pixels + size_t(y) * width);
+        const uint8_t* prior = (y > 0) ? row - stride : zeros.data();
+
+        uint32_t best = 0;
+        uint64_t bestCost = ~0ull;
+        for (uint32_t filter = 0; filter < 5; ++filter)
+        {
+            uint8_t* out = candidates.data() + filter * stride;
+            uint64_t cost = 0;
+            for (size_t i = 0; i < stride; ++i)
+            {
+                const int32_t a = (i >= 4) ? row[i - 4] : 0;
+                const int32_t b = prior[i];
+                const int32_t c = (i >= 4) ? prior[i - 4] : 0;
+                int32_t predicted = 0;
+                switch (filter)
+                {
+                case 1: predicted = a; break;
+                case 2: predicted = b; break;
+                case 3: predicted = (a + b) >> 1; break;
+                case 4: predicted = PaethPredictor(a, b, c); break;
+                }
+                out[i] = uint8_t(row[i] - predicted);
+                cost += uint32_t(std::abs(int32_t(int8_t(out[i]))));
+            }
+            if (cost < bestCost)
+            {
+                best = filter;
+                bestCost = cost;
+            }
+        }
+
+        uint8_t* dest = filtered.data() + y * (stride + 1);
+        dest[0] = uint8_t(best);
+        std::memcpy(dest + 1, candidates.data() + best * stride, stride);
+    }
+
+    std::vector<uint8_t> compressed = ZlibCompress(filtered.data(), filtered.size());
+
+    std::vector<uint8_t> file(PNG_SIGNATURE, PNG_SIGNATURE + 8);
+    uint8_t header[13];
+    WriteBE32(header, width);
+    WriteBE32(header + 4, height);
+    header[8] = 8;      // Bit depth
+    header[9] = 6;      // RGBA
+    header[10] = 0;
+    header[11] = 0;
+    header[12] = 0;
+    AppendChunk(file, "IHDR", header, sizeof(header));
+    AppendChunk(file, "IDAT", compressed.data(), compressed.size());
+    AppendChunk(file, "IEND", nullptr, 0);
+    return file;
+}
+
+void DX::SavePNGToFile(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels)
+{
+    std::vector<uint8_t> file = EncodePNG(width, height, pixels);
+    WriteBinaryFile(path, file.data(), file.size());
+}
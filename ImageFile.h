@@ -0,0 +1,23 @@
+//
+// ImageFile.h - Writes CPU-side images to disk in formats any viewer opens
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    // Saves tightly packed RGBA8 pixels (R in the low byte, top row first)
+    // as an uncompressed 24-bit BMP. Alpha is dropped.
+    void SaveBMPToFile(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels);
+    std::vector<uint8_t> EncodeBMP(uint32_t width, uint32_t height, const uint32_t* pixels);
+
+    // The same pixels as an 8-bit RGBA PNG, alpha kept. Each row takes
+    // whichever filter leaves it smallest, and the data is deflated with
+    // the fixed codes (see ZlibCompress).
+    void SavePNGToFile(const std::string& path, uint32_t width, uint32_t height, const uint32_t* pixels);
+    std::vector<uint8_t> EncodePNG(uint32_t width, uint32_t height, const uint32_t* pixels);
+}
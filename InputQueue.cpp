@@ -0,0 +1,51 @@
+//
+// InputQueue.cpp
+//
+
+#include "InputQueue.h"
+
+#include <chrono>
+
+using namespace DX;
+
+uint64_t InputQueue::Now()
+{
+    typedef std::chrono::duration<uint64_t, std::ratio<1, TicksPerSecond>> Ticks;
+    return std::chrono::duration_cast<Ticks>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+InputQueue::InputQueue(uint32_t capacity) :
+    m_events(capacity),
+    m_dropped(0)
+{
+}
+
+bool InputQueue::Push(const InputEvent& event)
+{
+    if (!m_events.TryPush(event))
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool InputQueue::PushKey(uint8_t key, bool down, uint64_t time)
+{
+    return Push(InputEvent{ time, 0, 0, down ? InputEventType::KeyDown : InputEventType::KeyUp, key });
+}
+
+bool InputQueue::PushButton(uint8_t button, bool down, uint64_t time)
+{
+    return Push(InputEvent{ time, 0, 0, down ? InputEventType::ButtonDown : InputEventType::ButtonUp, button });
+}
+
+bool InputQueue::PushMouseDelta(int32_t dx, int32_t dy, uint64_t time)
+{
+    return Push(InputEvent{ time, dx, dy, InputEventType::MouseDelta, 0 });
+}
+
+bool InputQueue::PushFocusLost(uint64_t time)
+{
+    return Push(InputEvent{ time, 0, 0, InputEventType::FocusLost, 0 });
+}
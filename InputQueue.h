@@ -0,0 +1,80 @@
+//
+// InputQueue.h - Timestamped input events passed from the message pump to the
+// simulation through a lock-free ring
+//
+
+#pragma once
+
+#include "SpscQueue.h"
+
+namespace DX
+{
+    enum class InputEventType : uint8_t
+    {
+        KeyDown,        // code is a Win32 virtual-key code.
+        KeyUp,
+        MouseDelta,     // dx, dy in raw mouse counts.
+        ButtonDown,     // code is an InputButton.
+        ButtonUp,
+        FocusLost,      // Everything held is released.
+    };
+
+    namespace InputButton
+    {
+        const uint8_t Left = 0;
+        const uint8_t Right = 1;
+        const uint8_t Middle = 2;
+    }
+
+    struct InputEvent
+    {
+        uint64_t        time;           // InputQueue::Now() when the event arrived.
+        int32_t         dx;
+        int32_t         dy;
+        InputEventType  type;
+        uint8_t         code;
+    };
+
+    // The window procedure (or a test) pushes events as they arrive, stamped
+    // with the time they arrived; the simulation takes them in order up to
+    // the end of each step, so an event lands in the step whose slice of
+    // wall-clock time contains it rather than whichever step runs next.
+    class InputQueue
+    {
+    public:
+        // Same units as StepTimer, so step lengths can be used directly.
+        static const uint64_t TicksPerSecond = 10000000;
+
+        static uint64_t Now();
+
+        explicit InputQueue(uint32_t capacity = 1024);
+
+        // Producer. A full queue drops the event and counts it.
+        bool Push(const InputEvent& event);
+        bool PushKey(uint8_t key, bool down, uint64_t time = Now());
+        bool PushButton(uint8_t button, bool down, uint64_t time = Now());
+        bool PushMouseDelta(int32_t dx, int32_t dy, uint64_t time = Now());
+        bool PushFocusLost(uint64_t time = Now());
+
+        // Consumer. Calls handler(const InputEvent&) for every queued event
+        // stamped at or before time, oldest first. Returns how many it took.
+        template <typename Handler>
+        uint32_t ConsumeUntil(uint64_t time, Handler&& handler)
+        {
+            uint32_t count = 0;
+            for (const InputEvent* event = m_events.Peek(); event && event->time <= time; event = m_events.Peek())
+            {
+                handler(*event);
+                m_events.Pop();
+                ++count;
+            }
+            return count;
+        }
+
+        uint32_t GetDroppedCount() const    { return m_dropped.load(std::memory_order_relaxed); }
+
+    private:
+        SpscQueue<InputEvent>   m_events;
+        std::atomic<uint32_t>   m_dropped;
+    };
+}
@@ -0,0 +1,261 @@
+//
+// InputRecording.cpp
+//
+
+#include "InputRecording.h"
+#include "BinaryFile.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const uint32_t RECORDING_MAGIC = 0x52495844;    // "DXIR"
+    const uint32_t RECORDING_VERSION = 1;
+    const uint8_t TICK_KEYS_CHANGED = 0x01;
+
+    struct RecordingHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t tickCount;
+        uint32_t eventCount;
+    };
+
+    uint64_t ZigZag(int64_t value)
+    {
+        return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+    }
+
+    int64_t UnZigZag(uint64_t value)
+    {
+        return int64_t(value >> 1) ^ -int64_t(value & 1);
+    }
+
+    void WriteVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const uint8_t* data, size_t size) :
+            m_data(data),
+            m_size(size),
+            m_offset(0)
+        {
+        }
+
+        void Read(void* value, size_t size)
+        {
+            if (m_size - m_offset < size)
+            {
+                throw std::runtime_error("LoadInputRecording: truncated file");
+            }
+            std::memcpy(value, m_data + m_offset, size);
+            m_offset += size;
+        }
+
+        uint8_t ReadByte()
+        {
+            uint8_t value;
+            Read(&value, 1);
+            return value;
+        }
+
+        uint64_t ReadVarint()
+        {
+            uint64_t value = 0;
+            for (uint32_t shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t byte = ReadByte();
+                value |= uint64_t(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                {
+                    return value;
+                }
+            }
+            throw std::runtime_error("LoadInputRecording: invalid varint");
+        }
+
+        bool AtEnd() const      { return m_offset == m_size; }
+
+    private:
+        const uint8_t*  m_data;
+        size_t          m_size;
+        size_t          m_offset;
+    };
+}
+
+void InputRecording::AddTick(uint64_t timeDelta, uint64_t inputTime, const uint32_t keys[8])
+{
+    RecordedTick tick;
+    tick.timeDelta = timeDelta;
+    tick.inputTime = inputTime;
+    std::memcpy(tick.keys, keys, sizeof(tick.keys));
+    tick.firstEvent = uint32_t(events.size());
+    tick.eventCount = 0;
+    ticks.push_back(tick);
+}
+
+void InputRecording::AddEvent(const InputEvent& event)
+{
+    if (ticks.empty())
+    {
+        throw std::logic_error("InputRecording::AddEvent: no tick");
+    }
+
+    events.push_back(event);
+    ++ticks.back().eventCount;
+}
+
+void InputRecording::Clear()
+{
+    ticks.clear();
+    events.clear();
+}
+
+std::vector<uint8_t> DX::SaveInputRecordingToMemory(const InputRecording& recording)
+{
+    RecordingHeader header = { RECORDING_MAGIC, RECORDING_VERSION, uint32_t(recording.ticks.size()), uint32_t(recording.events.size()) };
+
+    std::vector<uint8_t> out(sizeof(header));
+    std::memcpy(out.data(), &header, sizeof(header));
+
+    uint64_t previousTime = 0;
+    uint32_t previousKeys[8] = {};
+
+    for (const RecordedTick& tick : recording.ticks)
+    {
+        bool keysChanged = std::memcmp(tick.keys, previousKeys, sizeof(previousKeys)) != 0;
+
+        WriteVarint(out, tick.timeDelta);
+        WriteVarint(out, ZigZag(int64_t(tick.inputTime - previousTime)));
+        WriteVarint(out, tick.eventCount);
+        out.push_back(keysChanged ? TICK_KEYS_CHANGED : 0);
+
+        if (keysChanged)
+        {
+            const uint8_t* keys = reinterpret_cast<const uint8_t*>(tick.keys);
+            out.insert(out.end(), keys, keys + sizeof(tick.keys));
+            std::memcpy(previousKeys, tick.keys, sizeof(previousKeys));
+        }
+
+        // Event times relative to the tick, which they usually just precede.
+        const InputEvent* events = recording.GetEvents(tick);
+        for (uint32_t i = 0; i < tick.eventCount; ++i)
+        {
+            const InputEvent& event = events[i];
+            WriteVarint(out, ZigZag(int64_t(event.time - tick.inputTime)));
+            out.push_back(uint8_t(event.type));
+            out.push_back(event.code);
+            if (event.type == InputEventType::MouseDelta)
+            {
+                WriteVarint(out, ZigZag(event.dx));
+                WriteVarint(out, ZigZag(event.dy));
+            }
+        }
+
+        previousTime = tick.inputTime;
+    }
+
+    return out;
+}
+
+void DX::SaveInputRecordingToFile(const InputRecording& recording, const std::string& path)
+{
+    std::vector<uint8_t> blob = SaveInputRecordingToMemory(recording);
+    WriteBinaryFile(path, blob.data(), blob.size());
+}
+
+InputRecording DX::LoadInputRecordingFromMemory(const uint8_t* data, size_t size)
+{
+    Reader reader(data, size);
+
+    RecordingHeader header;
+    reader.Read(&header, sizeof(header));
+    if (header.magic != RECORDING_MAGIC)
+    {
+        throw std::runtime_error("LoadInputRecording: not an input recording");
+    }
+    if (header.version != RECORDING_VERSION)
+    {
+        throw std::runtime_error("LoadInputRecording: unsupported version");
+    }
+
+    // Every tick takes at least four bytes, every event three.
+    if (header.tickCount > size / 4 || header.eventCount > size / 3)
+    {
+        throw std::runtime_error("LoadInputRecording: invalid counts");
+    }
+
+    InputRecording recording;
+    recording.ticks.reserve(header.tickCount);
+    recording.events.reserve(header.eventCount);
+
+    uint64_t time = 0;
+    uint32_t keys[8] = {};
+
+    for (uint32_t t = 0; t < header.tickCount; ++t)
+    {
+        uint64_t timeDelta = reader.ReadVarint();
+        time += uint64_t(UnZigZag(reader.ReadVarint()));
+        uint64_t eventCount = reader.ReadVarint();
+        uint8_t flags = reader.ReadByte();
+
+        if (flags & ~TICK_KEYS_CHANGED)
+        {
+            throw std::runtime_error("LoadInputRecording: invalid tick");
+        }
+        if (flags & TICK_KEYS_CHANGED)
+        {
+            reader.Read(keys, sizeof(keys));
+        }
+        if (eventCount > header.eventCount - recording.events.size())
+        {
+            throw std::runtime_error("LoadInputRecording: too many events");
+        }
+
+        recording.AddTick(timeDelta, time, keys);
+
+        for (uint64_t i = 0; i < eventCount; ++i)
+        {
+            InputEvent event = {};
+            event.time = time + uint64_t(UnZigZag(reader.ReadVarint()));
+            uint8_t type = reader.ReadByte();
+            if (type > uint8_t(InputEventType::FocusLost))
+            {
+                throw std::runtime_error("LoadInputRecording: invalid event");
+            }
+            event.type = InputEventType(type);
+            event.code = reader.ReadByte();
+            if (event.type == InputEventType::MouseDelta)
+            {
+                event.dx = int32_t(UnZigZag(reader.ReadVarint()));
+                event.dy = int32_t(UnZigZag(reader.ReadVarint()));
+            }
+            recording.AddEvent(event);
+        }
+    }
+
+    if (recording.events.size() != header.eventCount || !reader.AtEnd())
+    {
+        throw std::runtime_error("LoadInputRecording: invalid file");
+    }
+
+    return recording;
+}
+
+InputRecording DX::LoadInputRecordingFromFile(const std::string& path)
+{
+    std::vector<uint8_t> blob = ReadBinaryFile(path);
+    return LoadInputRecordingFromMemory(blob.data(), blob.size());
+}
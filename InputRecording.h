@@ -0,0 +1,51 @@
+//
+// InputRecording.h - Per-tick timer deltas and input captured from a session,
+// with a compact binary file format, so the session can be replayed exactly
+//
+
+#pragma once
+
+#include "InputQueue.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    struct RecordedTick
+    {
+        uint64_t    timeDelta;      // StepTimer::GetLastTickDelta for the tick.
+        uint64_t    inputTime;      // Input clock when the tick began, from the start of the recording.
+        uint32_t    keys[8];        // Keyboard state during the tick, one bit per virtual-key code.
+        uint32_t    firstEvent;
+        uint32_t    eventCount;
+    };
+
+    // Everything a tick reads that does not come from the simulation itself:
+    // how far the timer moved, the keyboard state Update polls and the input
+    // events the camera consumes. Event times are on the same clock as
+    // inputTime, so replaying them against a clock that starts at zero
+    // reproduces every step boundary and every mid-step event.
+    struct InputRecording
+    {
+        std::vector<RecordedTick>   ticks;
+        std::vector<InputEvent>     events;
+
+        // Starts a tick; events added afterwards belong to it.
+        void AddTick(uint64_t timeDelta, uint64_t inputTime, const uint32_t keys[8]);
+        void AddEvent(const InputEvent& event);
+
+        const InputEvent* GetEvents(const RecordedTick& tick) const    { return events.data() + tick.firstEvent; }
+
+        void Clear();
+    };
+
+    // Ticks are stored as variable-length deltas from the previous tick,
+    // with the keyboard only when it changed, so an idle minute is a few
+    // kilobytes. Throws std::runtime_error on malformed input.
+    std::vector<uint8_t> SaveInputRecordingToMemory(const InputRecording& recording);
+    void SaveInputRecordingToFile(const InputRecording& recording, const std::string& path);
+    InputRecording LoadInputRecordingFromMemory(const uint8_t* data, size_t size);
+    InputRecording LoadInputRecordingFromFile(const std::string& path);
+}
@@ -0,0 +1,127 @@
+//
+// JobSystem.cpp
+//
+
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <string>
+
+using namespace DX;
+
+JobSystem::JobSystem(uint32_t workerCount) :
+    m_function(nullptr),
+    m_context(nullptr),
+    m_count(0),
+    m_next(0),
+    m_busyWorkers(0),
+    m_generation(0),
+    m_quit(false)
+{
+    if (workerCount == 0)
+    {
+        uint32_t hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 0;
+    }
+
+    m_workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerMain, this, i + 1);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void JobSystem::RunIndices(uint32_t threadIndex)
+{
+    for (;;)
+    {
+        uint32_t index = m_next.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_count)
+        {
+            return;
+        }
+
+        m_function(m_context, index, threadIndex);
+    }
+}
+
+void JobSystem::WorkerMain(uint32_t threadIndex)
+{
+    Profiler::SetThreadName(("Worker " + std::to_string(threadIndex)).c_str());
+
+    uint64_t seen = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_quit || m_generation != seen; });
+            if (m_quit)
+            {
+                return;
+            }
+            seen = m_generation;
+        }
+
+        RunIndices(threadIndex);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busyWorkers == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+}
+
+void JobSystem::ParallelFor(uint32_t count, JobFunction function, const void* context)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Not worth waking anyone for a single item.
+    if (count == 1 || m_workers.empty())
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            function(context, i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = function;
+        m_context = context;
+        m_count = count;
+        m_next.store(0, std::memory_order_relaxed);
+        m_busyWorkers = uint32_t(m_workers.size());
+        ++m_generation;
+    }
+    m_wake.notify_all();
+
+    RunIndices(0);
+
+    // Workers still hold a pointer to the context until they check in.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_busyWorkers == 0; });
+    m_function = nullptr;
+    m_context = nullptr;
+}
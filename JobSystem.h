@@ -0,0 +1,69 @@
+//
+// JobSystem.h - Fixed pool of worker threads for data-parallel loops
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace DX
+{
+    class JobSystem
+    {
+    public:
+        // Zero picks one worker per hardware thread, less the calling thread.
+        explicit JobSystem(uint32_t workerCount = 0);
+        ~JobSystem();
+
+        JobSystem(JobSystem const&) = delete;
+        JobSystem& operator=(JobSystem const&) = delete;
+
+        // Threads that take part in ParallelFor, including the caller.
+        uint32_t GetThreadCount() const     { return uint32_t(m_workers.size()) + 1; }
+
+        // Calls body(index, threadIndex) once for every index in [0, count)
+        // and returns when all of them have finished. The calling thread is
+        // thread 0 and works alongside the pool. Indices are handed out one
+        // at a time, so uneven work balances itself. Not reentrant.
+        //
+        // body is called through a plain function pointer rather than a
+        // std::function, so passing a lambda never allocates.
+        template <typename Body>
+        void ParallelFor(uint32_t count, const Body& body)
+        {
+            ParallelFor(count, &InvokeBody<Body>, &body);
+        }
+
+        typedef void (*JobFunction)(const void* context, uint32_t index, uint32_t threadIndex);
+        void ParallelFor(uint32_t count, JobFunction function, const void* context);
+
+    private:
+        template <typename Body>
+        static void InvokeBody(const void* context, uint32_t index, uint32_t threadIndex)
+        {
+            (*static_cast<const Body*>(context))(index, threadIndex);
+        }
+
+        void WorkerMain(uint32_t threadIndex);
+        void RunIndices(uint32_t threadIndex);
+
+        std::vector<std::thread>                            m_workers;
+        std::mutex                                          m_mutex;
+        std::condition_variable                             m_wake;
+        std::condition_variable                             m_done;
+
+        JobFunction                                         m_function;
+        const void*                                         m_context;
+        uint32_t                                            m_count;
+        std::atomic<uint32_t>                               m_next;
+        uint32_t                                            m_busyWorkers;
+        uint64_t                                            m_generation;
+        bool                                                m_quit;
+    };
+}
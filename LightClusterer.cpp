@@ -0,0 +1,375 @@
+//
+// LightClusterer.cpp
+//
+
+#include "LightClusterer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define LIGHT_CLUSTERER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    const uint32_t MaxLights = 0xFFFF;
+
+    // Lights bounded per job in the first pass.
+    const uint32_t LightsPerJob = 256;
+
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Distance from v to [low, high] along one axis.
+    float AxisDistance(float v, float low, float high)
+    {
+        return std::max(low - v, 0.f) + std::max(v - high, 0.f);
+    }
+
+    uint16_t ToTile(float ndc, uint32_t tiles)
+    {
+        const float t = std::floor((ndc + 1.f) * 0.5f * tiles);
+        return uint16_t(std::min(std::max(t, 0.f), float(tiles - 1)));
+    }
+}
+
+LightClusterer::LightClusterer(JobSystem& jobs, const ClusterGridSettings& settings) :
+    m_jobs(jobs),
+    m_settings(settings),
+    m_scaleX(0),
+    m_scaleY(0),
+    m_nearZ(0),
+    m_farZ(0),
+    m_sliceScale(0),
+    m_stats{}
+{
+    if (settings.tilesX == 0 || settings.tilesY == 0 || settings.slices < 2 || settings.maxLightsPerCluster == 0
+        || settings.tilesX > 0xFFFF || settings.tilesY > 0xFFFF || settings.slices > 0xFFFF)
+    {
+        throw std::runtime_error("LightClusterer: bad grid settings");
+    }
+
+    m_rowStride = (settings.tilesX + 3) & ~3u;
+    m_sliceDepths.resize(settings.slices + 1);
+    m_minX.resize(size_t(settings.slices) * m_rowStride);
+    m_maxX.resize(m_minX.size());
+    m_minY.resize(size_t(settings.slices) * settings.tilesY);
+    m_maxY.resize(m_minY.size());
+    m_sliceOffsets.resize(settings.slices + 1);
+    m_sliceTests.resize(settings.slices);
+    m_sliceDropped.resize(settings.slices);
+    m_scratch.resize(size_t(GetClusterCount()) * settings.maxLightsPerCluster);
+    m_clusters.resize(GetClusterCount());
+}
+
+void LightClusterer::SetProjection(const Matrix44& projection)
+{
+    // For a right-handed perspective, m[2][2] = f / (n - f) and
+    // m[3][2] = n f / (n - f).
+    m_scaleX = projection.m[0][0];
+    m_scaleY = projection.m[1][1];
+    m_nearZ = projection.m[3][2] / projection.m[2][2];
+    const float projectionFar = projection.m[3][2] / (projection.m[2][2] + 1.f);
+    m_farZ = (m_settings.maxDepth > 0.f) ? std::min(m_settings.maxDepth, projectionFar) : projectionFar;
+
+    const uint32_t slices = m_settings.slices;
+    const float first = std::min(std::max(m_settings.firstSliceDepth, m_nearZ * 1.001f), m_farZ * 0.999f);
+    m_sliceScale = (slices - 1) / std::log(m_farZ / first);
+    m_sliceDepths[0] = m_nearZ;
+    for (uint32_t slice = 1; slice < slices; ++slice)
+    {
+        m_sliceDepths[slice] = first * std::pow(m_farZ / first, float(slice - 1) / (slices - 1));
+    }
+    m_sliceDepths[slices] = m_farZ;
+
+    // A tile's side planes pass through the eye, so its widest extent in a
+    // slice is at one of the slice's two depths.
+    const float padding = std::numeric_limits<float>::max();
+    for (uint32_t slice = 0; slice < slices; ++slice)
+    {
+        const float nearDepth = m_sliceDepths[slice], farDepth = m_sliceDepths[slice + 1];
+        for (uint32_t x = 0; x < m_rowStride; ++x)
+        {
+            const size_t i = size_t(slice) * m_rowStride + x;
+            if (x >= m_settings.tilesX)
+            {
+                m_minX[i] = padding;
+                m_maxX[i] = -padding;
+                continue;
+            }
+            const float left = -1.f + 2.f * x / m_settings.tilesX, right = -1.f + 2.f * (x + 1) / m_settings.tilesX;
+            m_minX[i] = std::min(left * nearDepth, left * farDepth) / m_scaleX;
+            m_maxX[i] = std::max(right * nearDepth, right * farDepth) / m_scaleX;
+        }
+        for (uint32_t y = 0; y < m_settings.tilesY; ++y)
+        {
+            const size_t i = size_t(slice) * m_settings.tilesY + y;
+            const float top = 1.f - 2.f * y / m_settings.tilesY, bottom = 1.f - 2.f * (y + 1) / m_settings.tilesY;
+            m_minY[i] = std::min(bottom * nearDepth, bottom * farDepth) / m_scaleY;
+            m_maxY[i] = std::max(top * nearDepth, top * farDepth) / m_scaleY;
+        }
+    }
+}
+
+uint32_t LightClusterer::GetSlice(float depth) const
+{
+    if (depth < m_sliceDepths[1])
+    {
+        return 0;
+    }
+    const float slice = 1.f + std::floor(std::log(depth / m_sliceDepths[1]) * m_sliceScale);
+    return uint32_t(std::min(slice, float(m_settings.slices - 1)));
+}
+
+uint32_t LightClusterer::GetClusterIndex(const Float3& viewPosition) const
+{
+    const float depth = -viewPosition.z;
+    if (m_scaleX == 0.f || depth < m_nearZ || depth > m_farZ)
+    {
+        return ~0u;
+    }
+    const float ndcX = viewPosition.x * m_scaleX / depth, ndcY = viewPosition.y * m_scaleY / depth;
+    if (std::abs(ndcX) > 1.f || std::abs(ndcY) > 1.f)
+    {
+        return ~0u;
+    }
+    const uint32_t x = ToTile(ndcX, m_settings.tilesX);
+    const uint32_t y = m_settings.tilesY - 1 - ToTile(ndcY, m_settings.tilesY);
+    return (GetSlice(depth) * m_settings.tilesY + y) * m_settings.tilesX + x;
+}
+
+void LightClusterer::BoundLight(const Matrix44& view, const DynamicLight& light, LightBounds& bounds) const
+{
+    // The smallest sphere around a cone: for wide cones the cap's circle,
+    // for narrow ones the sphere through the apex and the cap's rim.
+    Float3 center = light.position;
+    float radius = light.range;
+    if (light.type == LightType::Spot)
+    {
+        const float cosAngle = std::min(std::max(light.cosOuterAngle, 0.f), 1.f);
+        if (cosAngle < 0.70710678f)
+        {
+            center = light.position + light.direction * (light.range * cosAngle);
+            radius = light.range * std::sqrt(1.f - cosAngle * cosAngle);
+        }
+        else
+        {
+            radius = light.range / (2.f * cosAngle);
+            center = light.position + light.direction * radius;
+        }
+    }
+
+    const Float4 v = view.Transform(center);
+    bounds.x = v.x;
+    bounds.y = v.y;
+    bounds.z = v.z;
+    bounds.radius = radius;
+    bounds.firstSlice = 1;
+    bounds.lastSlice = 0;
+
+    const float nearDepth = std::max(-v.z - radius, m_nearZ);
+    const float farDepth = std::min(-v.z + radius, m_farZ);
+    if (nearDepth > farDepth || !(radius > 0.f))
+    {
+        return;
+    }
+
+    // x / depth over the sphere's box is widest at one of the two depths.
+    const float left = std::min((v.x - radius) / nearDepth, (v.x - radius) / farDepth) * m_scaleX;
+    const float right = std::max((v.x + radius) / nearDepth, (v.x + radius) / farDepth) * m_scaleX;
+    const float bottom = std::min((v.y - radius) / nearDepth, (v.y - radius) / farDepth) * m_scaleY;
+    const float top = std::max((v.y + radius) / nearDepth, (v.y + radius) / farDepth) * m_scaleY;
+    if (right < -1.f || left > 1.f || top < -1.f || bottom > 1.f)
+    {
+        return;
+    }
+
+    bounds.firstSlice = uint16_t(GetSlice(nearDepth));
+    bounds.lastSlice = uint16_t(GetSlice(farDepth));
+    bounds.firstTileX = ToTile(left, m_settings.tilesX);
+    bounds.lastTileX = ToTile(right, m_settings.tilesX);
+    bounds.firstTileY = uint16_t(m_settings.tilesY - 1 - ToTile(top, m_settings.tilesY));
+    bounds.lastTileY = uint16_t(m_settings.tilesY - 1 - ToTile(bottom, m_settings.tilesY));
+}
+
+void LightClusterer::Assign(const Matrix44& view, const DynamicLight* lights, uint32_t count)
+{
+    DX_PROFILE_SCOPE("LightClusterer::Assign");
+    auto start = std::chrono::steady_clock::now();
+
+    if (count > MaxLights)
+    {
+        throw std::runtime_error("LightClusterer: too many lights");
+    }
+    if (m_scaleX == 0.f)
+    {
+        throw std::runtime_error("LightClusterer: no projection");
+    }
+
+    m_stats = ClusterStats{};
+    m_stats.lights = count;
+
+    // Bound every light, in parallel.
+    m_bounds.resize(count);
+    m_jobs.ParallelFor((count + LightsPerJob - 1) / LightsPerJob, [&](uint32_t job, uint32_t)
+    {
+        const uint32_t end = std::min(count, (job + 1) * LightsPerJob);
+        for (uint32_t i = job * LightsPerJob; i < end; ++i)
+        {
+            BoundLight(view, lights[i], m_bounds[i]);
+        }
+    });
+
+    // Bin them by slice, in light order.
+    const uint32_t slices = m_settings.slices;
+    std::fill(m_sliceOffsets.begin(), m_sliceOffsets.end(), 0);
+    for (const LightBounds& bounds : m_bounds)
+    {
+        for (uint32_t slice = bounds.firstSlice; slice <= bounds.lastSlice; ++slice)
+        {
+            ++m_sliceOffsets[slice + 1];
+        }
+        m_stats.lightsVisible += (bounds.firstSlice <= bounds.lastSlice) ? 1 : 0;
+    }
+    for (uint32_t slice = 0; slice < slices; ++slice)
+    {
+        m_sliceOffsets[slice + 1] += m_sliceOffsets[slice];
+    }
+    m_sliceLights.resize(m_sliceOffsets[slices]);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const LightBounds& bounds = m_bounds[i];
+        for (uint32_t slice = bounds.firstSlice; slice <= bounds.lastSlice; ++slice)
+        {
+            m_sliceLights[m_sliceOffsets[slice]++] = uint16_t(i);
+        }
+    }
+    for (uint32_t slice = slices; slice > 0; --slice)
+    {
+        m_sliceOffsets[slice] = m_sliceOffsets[slice - 1];
+    }
+    m_sliceOffsets[0] = 0;
+
+    // Test each slice's lights against its clusters.
+    m_jobs.ParallelFor(slices, [&](uint32_t slice, uint32_t) { AssignSlice(slice); });
+
+    // Pack the lists.
+    const uint32_t clustersPerSlice = m_settings.tilesX * m_settings.tilesY;
+    uint32_t offset = 0;
+    for (ClusterRange& cluster : m_clusters)
+    {
+        cluster.offset = offset;
+        offset += cluster.count;
+        m_stats.maxLightsInCluster = std::max(m_stats.maxLightsInCluster, cluster.count);
+    }
+    m_indices.resize(offset);
+    m_jobs.ParallelFor(slices, [&](uint32_t slice, uint32_t)
+    {
+        for (uint32_t i = slice * clustersPerSlice, end = i + clustersPerSlice; i < end; ++i)
+        {
+            const uint16_t* list = &m_scratch[size_t(i) * m_settings.maxLightsPerCluster];
+            std::copy(list, list + m_clusters[i].count, m_indices.begin() + m_clusters[i].offset);
+        }
+    });
+
+    for (uint32_t slice = 0; slice < slices; ++slice)
+    {
+        m_stats.clusterTests += m_sliceTests[slice];
+        m_stats.droppedAssignments += m_sliceDropped[slice];
+    }
+    m_stats.assignments = offset;
+    m_stats.assignNanoseconds = ElapsedNanoseconds(start);
+}
+
+void LightClusterer::AssignSlice(uint32_t slice)
+{
+    const uint32_t tilesX = m_settings.tilesX, tilesY = m_settings.tilesY;
+    const uint32_t capacity = m_settings.maxLightsPerCluster;
+    const size_t firstCluster = size_t(slice) * tilesX * tilesY;
+    const float* minX = &m_minX[size_t(slice) * m_rowStride];
+    const float* maxX = &m_maxX[size_t(slice) * m_rowStride];
+    const float* minY = &m_minY[size_t(slice) * tilesY];
+    const float* maxY = &m_maxY[size_t(slice) * tilesY];
+    const float minZ = -m_sliceDepths[slice + 1], maxZ = -m_sliceDepths[slice];
+
+    for (size_t i = firstCluster, end = firstCluster + size_t(tilesX) * tilesY; i < end; ++i)
+    {
+        m_clusters[i].count = 0;
+    }
+
+    uint32_t tests = 0, dropped = 0;
+    for (uint32_t l = m_sliceOffsets[slice]; l < m_sliceOffsets[slice + 1]; ++l)
+    {
+        const uint16_t light = m_sliceLights[l];
+        const LightBounds& bounds = m_bounds[light];
+        const float radius2 = bounds.radius * bounds.radius;
+        const float dz = AxisDistance(bounds.z, minZ, maxZ);
+        const uint32_t x0 = bounds.firstTileX & ~3u;
+
+        for (uint32_t y = bounds.firstTileY; y <= bounds.lastTileY; ++y)
+        {
+            const float dy = AxisDistance(bounds.y, minY[y], maxY[y]);
+            const float dyz = dy * dy + dz * dz;
+            if (dyz > radius2)
+            {
+                continue;
+            }
+
+            ClusterRange* row = &m_clusters[firstCluster + size_t(y) * tilesX];
+            uint16_t* rowLists = &m_scratch[(firstCluster + size_t(y) * tilesX) * capacity];
+            for (uint32_t x = x0; x <= bounds.lastTileX; x += 4)
+            {
+                // Four clusters of the row against the sphere; lanes outside
+                // the light's tile range are masked off below.
+                uint32_t hits;
+#if defined(LIGHT_CLUSTERER_SSE2)
+                const __m128 cx = _mm_set1_ps(bounds.x);
+                const __m128 zero = _mm_setzero_ps();
+                const __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(minX + x), cx), zero),
+                    _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(maxX + x)), zero));
+                const __m128 distance2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_set1_ps(dyz));
+                hits = uint32_t(_mm_movemask_ps(_mm_cmple_ps(distance2, _mm_set1_ps(radius2))));
+#else
+                hits = 0;
+                for (uint32_t lane = 0; lane < 4; ++lane)
+                {
+                    const float dx = AxisDistance(bounds.x, minX[x + lane], maxX[x + lane]);
+                    hits |= (dx * dx + dyz <= radius2) ? 1u << lane : 0u;
+                }
+#endif
+                tests += 4;
+
+                for (uint32_t lane = 0; lane < 4; ++lane)
+                {
+                    const uint32_t tile = x + lane;
+                    if (!(hits & (1u << lane)) || tile < bounds.firstTileX || tile > bounds.lastTileX)
+                    {
+                        continue;
+                    }
+                    ClusterRange& cluster = row[tile];
+                    if (cluster.count < capacity)
+                    {
+                        rowLists[size_t(tile) * capacity + cluster.count++] = light;
+                    }
+                    else
+                    {
+                        ++dropped;
+                    }
+                }
+            }
+        }
+    }
+
+    m_sliceTests[slice] = tests;
+    m_sliceDropped[slice] = dropped;
+}
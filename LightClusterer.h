@@ -0,0 +1,146 @@
+//
+// LightClusterer.h - Clustered forward lighting on the CPU: point and spot
+// lights binned into a froxel grid so shading only visits nearby lights
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "JobSystem.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace DX
+{
+    enum class LightType : uint8_t
+    {
+        Point,
+        Spot,
+    };
+
+    struct DynamicLight
+    {
+        Float3      position;           // World space.
+        float       range;              // Nothing is lit past this distance.
+        Float3      color;
+        LightType   type;
+        Float3      direction;          // Spot lights: unit vector along the cone.
+        float       cosOuterAngle;      // Spot lights: cosine of the cone's half angle.
+    };
+
+    struct ClusterGridSettings
+    {
+        uint32_t    tilesX;
+        uint32_t    tilesY;
+        uint32_t    slices;             // Depth slices; the first ends at firstSliceDepth, the rest are spaced exponentially.
+        float       firstSliceDepth;    // Keeps the slices from bunching up against a close near plane.
+        float       maxDepth;           // Lights wholly past this are dropped. Zero for the projection's far plane.
+        uint32_t    maxLightsPerCluster;
+    };
+
+    // Where a cluster's light indices sit in GetLightIndices.
+    struct ClusterRange
+    {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    struct ClusterStats
+    {
+        uint32_t lights;                // Passed to Assign.
+        uint32_t lightsVisible;         // Reaching at least one cluster's depth and tile range.
+        uint32_t clusterTests;          // Sphere-against-cluster tests.
+        uint32_t assignments;           // Indices in the packed list.
+        uint32_t maxLightsInCluster;
+        uint32_t droppedAssignments;    // Past maxLightsPerCluster.
+        uint64_t assignNanoseconds;
+    };
+
+    // Usage: SetProjection whenever the projection changes, then Assign
+    // once per frame with the view and the frame's lights. Clusters are
+    // numbered x fastest, then y from the top of the screen, then slice.
+    //
+    // Every light is bounded by a view-space sphere (spot cones by the
+    // smallest sphere around the cone) and first narrowed to the slices and
+    // tiles its sphere can reach. The slices are then shared across the job
+    // system, each testing its lights against four clusters of a row at a
+    // time with SSE2. The index lists are packed per cluster in light
+    // order, so the result does not depend on the thread count.
+    //
+    // The projection must be a symmetric right-handed perspective, as
+    // CreatePerspectiveFieldOfViewRH builds. At most 65535 lights.
+    class LightClusterer
+    {
+    public:
+        LightClusterer(JobSystem& jobs, const ClusterGridSettings& settings);
+
+        LightClusterer(LightClusterer const&) = delete;
+        LightClusterer& operator=(LightClusterer const&) = delete;
+
+        void SetProjection(const Matrix44& projection);
+
+        // Throws std::runtime_error past the light limit or before SetProjection.
+        void Assign(const Matrix44& view, const DynamicLight* lights, uint32_t count);
+
+        // The cluster a view-space point falls in, or ~0u if it is off
+        // screen or outside the grid's depth range.
+        uint32_t GetClusterIndex(const Float3& viewPosition) const;
+
+        uint32_t GetClusterCount() const                        { return m_settings.tilesX * m_settings.tilesY * m_settings.slices; }
+        const std::vector<ClusterRange>& GetClusters() const    { return m_clusters; }
+        const std::vector<uint16_t>& GetLightIndices() const    { return m_indices; }
+        const ClusterStats& GetStats() const                    { return m_stats; }
+
+        // View-space depth where a slice starts; slice == slices gives the end of the grid.
+        float GetSliceDepth(uint32_t slice) const               { return m_sliceDepths[slice]; }
+
+    private:
+        // A light's view-space sphere and the part of the grid it can reach;
+        // firstSlice > lastSlice when it reaches none.
+        struct LightBounds
+        {
+            float       x, y, z, radius;
+            uint16_t    firstSlice, lastSlice;
+            uint16_t    firstTileX, lastTileX;
+            uint16_t    firstTileY, lastTileY;
+        };
+
+        uint32_t GetSlice(float depth) const;
+        void BoundLight(const Matrix44& view, const DynamicLight& light, LightBounds& bounds) const;
+        void AssignSlice(uint32_t slice);
+
+        JobSystem&                  m_jobs;
+        ClusterGridSettings         m_settings;
+        uint32_t                    m_rowStride;        // tilesX rounded up to whole groups of four.
+
+        // Projection terms and the grid's depth range.
+        float                       m_scaleX;
+        float                       m_scaleY;
+        float                       m_nearZ;
+        float                       m_farZ;
+        float                       m_sliceScale;
+        std::vector<float>          m_sliceDepths;
+
+        // View-space cluster bounds, split by axis: x per slice and column
+        // (padded to m_rowStride), y per slice and row.
+        std::vector<float>          m_minX;
+        std::vector<float>          m_maxX;
+        std::vector<float>          m_minY;
+        std::vector<float>          m_maxY;
+
+        std::vector<LightBounds>    m_bounds;
+        std::vector<uint32_t>       m_sliceOffsets;
+        std::vector<uint16_t>       m_sliceLights;
+        std::vector<uint32_t>       m_sliceTests;
+        std::vector<uint32_t>       m_sliceDropped;
+
+        // Each cluster's lights before packing, maxLightsPerCluster apiece.
+        std::vector<uint16_t>       m_scratch;
+        std::vector<ClusterRange>   m_clusters;
+        std::vector<uint16_t>       m_indices;
+
+        ClusterStats                m_stats;
+    };
+}
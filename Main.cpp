@@ -5,12 +5,24 @@
 #include "pch.h"
 #include "Game.h"
 #include <Dbt.h>
+#include <shellapi.h>
 
 using namespace DirectX;
 
 namespace
 {
     std::unique_ptr<Game> g_game;
+
+    // Key transitions go to the game's input queue; auto-repeat does not.
+    void PushKeyMessage(DX::InputQueue& input, UINT message, WPARAM wParam, LPARAM lParam)
+    {
+        bool down = (message == WM_KEYDOWN || message == WM_SYSKEYDOWN);
+        bool repeat = (lParam & 0x40000000) != 0;
+        if (wParam < 256 && !(down && repeat))
+        {
+            input.PushKey(static_cast<uint8_t>(wParam), down);
+        }
+    }
 };
 
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
@@ -36,6 +48,33 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         return 1;
 
     g_game = std::make_unique<Game>();
+
+    // -record <file> saves the session's input on exit; -replay <file> plays one back.
+    {
+        int argc = 0;
+        LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+        if (argv)
+        {
+            try
+            {
+                for (int i = 1; i + 1 < argc; ++i)
+                {
+                    if (_wcsicmp(argv[i], L"-record") == 0)
+                        g_game->RecordInput(argv[++i]);
+                    else if (_wcsicmp(argv[i], L"-replay") == 0)
+                        g_game->ReplayInput(argv[++i]);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                OutputDebugStringA(e.what());
+                OutputDebugStringA("\n");
+                LocalFree(argv);
+                return 1;
+            }
+            LocalFree(argv);
+        }
+    }
 	HDEVNOTIFY hNewAudio = nullptr;
     // Register class and create window
     {
@@ -99,7 +138,7 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
-        else
+        else if (g_game->WaitForNextFrame())
         {
             g_game->Tick();
         }
@@ -198,6 +237,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             else
             {
                 game->OnDeactivated();
+				game->GetInputQueue().PushFocusLost();
             }
         }
 		Keyboard::ProcessMessage(message, wParam, lParam);
@@ -248,9 +288,30 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         break;
 
 	case WM_INPUT:
-	case WM_MOUSEMOVE:
+		// Raw relative motion, timestamped as it arrives, drives mouse look.
+		if (game)
+		{
+			RAWINPUT raw;
+			UINT size = sizeof(raw);
+			if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, &raw, &size, sizeof(RAWINPUTHEADER)) != UINT(-1)
+				&& raw.header.dwType == RIM_TYPEMOUSE
+				&& !(raw.data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE)
+				&& (raw.data.mouse.lLastX || raw.data.mouse.lLastY))
+			{
+				game->GetInputQueue().PushMouseDelta(raw.data.mouse.lLastX, raw.data.mouse.lLastY);
+			}
+		}
+		Mouse::ProcessMessage(message, wParam, lParam);
+		break;
 	case WM_LBUTTONDOWN:
 	case WM_LBUTTONUP:
+		if (game)
+		{
+			game->GetInputQueue().PushButton(DX::InputButton::Left, message == WM_LBUTTONDOWN);
+		}
+		Mouse::ProcessMessage(message, wParam, lParam);
+		break;
+	case WM_MOUSEMOVE:
 	case WM_RBUTTONDOWN:
 	case WM_RBUTTONUP:
 	case WM_MBUTTONDOWN:
@@ -264,10 +325,18 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	case WM_KEYDOWN:
 	case WM_KEYUP:
 	case WM_SYSKEYUP:
+		if (game)
+		{
+			PushKeyMessage(game->GetInputQueue(), message, wParam, lParam);
+		}
 		Keyboard::ProcessMessage(message, wParam, lParam);
 		break;
 
     case WM_SYSKEYDOWN:
+		if (game)
+		{
+			PushKeyMessage(game->GetInputQueue(), message, wParam, lParam);
+		}
         if (wParam == VK_RETURN && (lParam & 0x60000000) == 0x20000000)
         {
             // Implements the classic ALT+ENTER fullscreen toggle
@@ -0,0 +1,89 @@
+//
+// Material.cpp
+//
+
+#include "Material.h"
+
+using namespace DX;
+
+Material::Material() noexcept :
+    m_constants{},
+    m_fogEnabled(false),
+    m_dirty(MaterialDirty::All),
+    m_stats{}
+{
+}
+
+namespace
+{
+    // Copies source over dest and reports whether anything differed.
+    bool Assign(float* dest, const float* source, uint32_t count)
+    {
+        bool changed = false;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (dest[i] != source[i])
+            {
+                dest[i] = source[i];
+                changed = true;
+            }
+        }
+        return changed;
+    }
+}
+
+void Material::Record(bool changed, uint32_t group)
+{
+    ++m_stats.parameterSets;
+    if (changed)
+    {
+        ++m_stats.parameterChanges;
+        m_dirty |= group;
+    }
+}
+
+void Material::SetLightDirection(const Float3& direction)
+{
+    const float value[3] = { direction.x, direction.y, direction.z };
+    Record(Assign(m_constants.lightDirection, value, 3), MaterialDirty::LightDirection);
+}
+
+void Material::SetDiffuseColor(const Float4& color)
+{
+    const float value[4] = { color.x, color.y, color.z, color.w };
+    Record(Assign(m_constants.diffuseColor, value, 4), MaterialDirty::DiffuseColor);
+}
+
+void Material::SetFog(bool enabled, float start, float end, const Float4& color)
+{
+    const float value[4] = { color.x, color.y, color.z, color.w };
+    bool changed = Assign(m_constants.fogColor, value, 4);
+    changed |= Assign(&m_constants.fogStart, &start, 1);
+    changed |= Assign(&m_constants.fogEnd, &end, 1);
+    changed |= (enabled != m_fogEnabled);
+    m_fogEnabled = enabled;
+
+    Record(changed, MaterialDirty::Fog);
+}
+
+void Material::SetFresnelFactor(float factor)
+{
+    Record(Assign(&m_constants.fresnelFactor, &factor, 1), MaterialDirty::Fresnel);
+}
+
+bool Material::Flush(IGraphicsBackend& backend, BufferHandle constantBuffer)
+{
+    uint32_t dirty = TakeDirty();
+    if (!dirty)
+    {
+        return false;
+    }
+
+    backend.UpdateBuffer(constantBuffer, &m_constants, sizeof(m_constants));
+    ++m_stats.bufferUploads;
+    RecordWrites((dirty & MaterialDirty::LightDirection ? 1 : 0)
+        + (dirty & MaterialDirty::DiffuseColor ? 1 : 0)
+        + (dirty & MaterialDirty::Fog ? 1 : 0)
+        + (dirty & MaterialDirty::Fresnel ? 1 : 0));
+    return true;
+}
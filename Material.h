@@ -0,0 +1,78 @@
+//
+// Material.h - Compact shading parameter block with per-group dirty bits, so
+// unchanged values never reach an effect or constant buffer
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "GraphicsBackend.h"
+
+namespace DX
+{
+    // One bit per parameter group. A group is written as a unit.
+    namespace MaterialDirty
+    {
+        const uint32_t LightDirection = 1u << 0;
+        const uint32_t DiffuseColor = 1u << 1;
+        const uint32_t Fog = 1u << 2;
+        const uint32_t Fresnel = 1u << 3;
+        const uint32_t All = LightDirection | DiffuseColor | Fog | Fresnel;
+    }
+
+    // Counters since the last ResetStats, normally once per frame.
+    struct MaterialStats
+    {
+        uint32_t parameterSets;         // Setter calls.
+        uint32_t parameterChanges;      // Setter calls that changed a value.
+        uint32_t parameterWrites;       // Values pushed to an effect or buffer.
+        uint32_t bufferUploads;
+    };
+
+    // Parameters are stored in the LightingConstants layout every backend
+    // already understands. Setters compare against the stored value and only
+    // mark a group dirty when something differs; whoever applies the
+    // material takes the dirty mask, writes those groups and reports how
+    // many values it wrote.
+    class Material
+    {
+    public:
+        Material() noexcept;
+
+        void SetLightDirection(const Float3& direction);
+        void SetDiffuseColor(const Float4& color);
+        void SetFog(bool enabled, float start, float end, const Float4& color);
+        void SetFresnelFactor(float factor);
+
+        const LightingConstants& GetConstants() const   { return m_constants; }
+        bool IsFogEnabled() const                       { return m_fogEnabled; }
+
+        uint32_t GetDirtyMask() const                   { return m_dirty; }
+
+        // Returns the dirty groups and clears them.
+        uint32_t TakeDirty()
+        {
+            uint32_t dirty = m_dirty;
+            m_dirty = 0;
+            return dirty;
+        }
+
+        // Forces a full rewrite, e.g. after the effects were recreated.
+        void MarkAllDirty()                             { m_dirty = MaterialDirty::All; }
+
+        // Uploads the whole block if any group is dirty. Returns true if it did.
+        bool Flush(IGraphicsBackend& backend, BufferHandle constantBuffer);
+
+        void RecordWrites(uint32_t count)               { m_stats.parameterWrites += count; }
+        const MaterialStats& GetStats() const           { return m_stats; }
+        void ResetStats()                               { m_stats = MaterialStats{}; }
+
+    private:
+        void Record(bool changed, uint32_t group);
+
+        LightingConstants   m_constants;
+        bool                m_fogEnabled;
+        uint32_t            m_dirty;
+        MaterialStats       m_stats;
+    };
+}
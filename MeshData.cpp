@@ -0,0 +1,240 @@
+//
+// MeshData.cpp
+//
+
+#include "MeshData.h"
+#include "BinaryFile.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    // On-disk SDKMESH structures (version 101). Offsets are from the start of
+    // the file; the layout matches the 8-byte packing the format was saved with.
+#pragma pack(push, 8)
+    struct SDKMESH_HEADER
+    {
+        uint32_t Version;
+        uint8_t  IsBigEndian;
+        uint64_t HeaderSize;
+        uint64_t NonBufferDataSize;
+        uint64_t BufferDataSize;
+        uint32_t NumVertexBuffers;
+        uint32_t NumIndexBuffers;
+        uint32_t NumMeshes;
+        uint32_t NumTotalSubsets;
+        uint32_t NumFrames;
+        uint32_t NumMaterials;
+        uint64_t VertexStreamHeadersOffset;
+        uint64_t IndexStreamHeadersOffset;
+        uint64_t MeshDataOffset;
+        uint64_t SubsetDataOffset;
+        uint64_t FrameDataOffset;
+        uint64_t MaterialDataOffset;
+    };
+
+    struct D3DVERTEXELEMENT9
+    {
+        uint16_t Stream;
+        uint16_t Offset;
+        uint8_t  Type;
+        uint8_t  Method;
+        uint8_t  Usage;
+        uint8_t  UsageIndex;
+    };
+
+    struct SDKMESH_VERTEX_BUFFER_HEADER
+    {
+        uint64_t NumVertices;
+        uint64_t SizeBytes;
+        uint64_t StrideBytes;
+        D3DVERTEXELEMENT9 Decl[32];
+        uint64_t DataOffset;
+    };
+
+    struct SDKMESH_INDEX_BUFFER_HEADER
+    {
+        uint64_t NumIndices;
+        uint64_t SizeBytes;
+        uint32_t IndexType;
+        uint64_t DataOffset;
+    };
+
+    struct SDKMESH_MESH
+    {
+        char     Name[100];
+        uint8_t  NumVertexBuffers;
+        uint32_t VertexBuffers[16];
+        uint32_t IndexBuffer;
+        uint32_t NumSubsets;
+        uint32_t NumFrameInfluences;
+        float    BoundingBoxCenter[3];
+        float    BoundingBoxExtents[3];
+        uint64_t SubsetOffset;
+        uint64_t FrameInfluenceOffset;
+    };
+
+    struct SDKMESH_SUBSET
+    {
+        char     Name[100];
+        uint32_t MaterialID;
+        uint32_t PrimitiveType;
+        uint64_t IndexStart;
+        uint64_t IndexCount;
+        uint64_t VertexStart;
+        uint64_t VertexCount;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(SDKMESH_HEADER) == 104, "SDKMESH header size mismatch");
+    static_assert(sizeof(SDKMESH_VERTEX_BUFFER_HEADER) == 288, "SDKMESH vertex buffer header size mismatch");
+    static_assert(sizeof(SDKMESH_INDEX_BUFFER_HEADER) == 32, "SDKMESH index buffer header size mismatch");
+    static_assert(sizeof(SDKMESH_MESH) == 224, "SDKMESH mesh size mismatch");
+    static_assert(sizeof(SDKMESH_SUBSET) == 144, "SDKMESH subset size mismatch");
+
+    const uint32_t SDKMESH_FILE_VERSION = 101;
+    const uint8_t D3DDECLTYPE_FLOAT2 = 1;
+    const uint8_t D3DDECLTYPE_FLOAT3 = 2;
+    const uint8_t D3DDECLUSAGE_POSITION = 0;
+    const uint8_t D3DDECLUSAGE_NORMAL = 3;
+    const uint8_t D3DDECLUSAGE_TEXCOORD = 5;
+    const uint32_t IT_16BIT = 0;
+
+    template<typename T>
+    T ReadAt(const uint8_t* data, size_t size, uint64_t offset)
+    {
+        if (offset > size || size - offset < sizeof(T))
+        {
+            throw std::runtime_error("LoadSDKMESH: truncated file");
+        }
+
+        T value;
+        std::memcpy(&value, data + offset, sizeof(T));
+        return value;
+    }
+}
+
+void MeshData::ComputeBounds()
+{
+    Float3 lo = { FLT_MAX, FLT_MAX, FLT_MAX };
+    Float3 hi = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+    for (const MeshVertex& v : vertices)
+    {
+        lo = Float3{ std::min(lo.x, v.position.x), std::min(lo.y, v.position.y), std::min(lo.z, v.position.z) };
+        hi = Float3{ std::max(hi.x, v.position.x), std::max(hi.y, v.position.y), std::max(hi.z, v.position.z) };
+    }
+
+    if (vertices.empty())
+    {
+        lo = hi = Float3{ 0, 0, 0 };
+    }
+
+    boundsCenter = (lo + hi) * 0.5f;
+    boundsExtents = (hi - lo) * 0.5f;
+}
+
+MeshData DX::LoadSDKMESHFromMemory(const uint8_t* data, size_t size)
+{
+    auto header = ReadAt<SDKMESH_HEADER>(data, size, 0);
+    if (header.Version != SDKMESH_FILE_VERSION || header.IsBigEndian)
+    {
+        throw std::runtime_error("LoadSDKMESH: unsupported version");
+    }
+
+    if (!header.NumMeshes)
+    {
+        throw std::runtime_error("LoadSDKMESH: no meshes");
+    }
+
+    auto mesh = ReadAt<SDKMESH_MESH>(data, size, header.MeshDataOffset);
+    if (mesh.NumVertexBuffers < 1 || mesh.VertexBuffers[0] >= header.NumVertexBuffers || mesh.IndexBuffer >= header.NumIndexBuffers)
+    {
+        throw std::runtime_error("LoadSDKMESH: invalid mesh");
+    }
+
+    auto vb = ReadAt<SDKMESH_VERTEX_BUFFER_HEADER>(data, size,
+        header.VertexStreamHeadersOffset + mesh.VertexBuffers[0] * sizeof(SDKMESH_VERTEX_BUFFER_HEADER));
+    auto ib = ReadAt<SDKMESH_INDEX_BUFFER_HEADER>(data, size,
+        header.IndexStreamHeadersOffset + mesh.IndexBuffer * sizeof(SDKMESH_INDEX_BUFFER_HEADER));
+
+    if (ib.IndexType != IT_16BIT)
+    {
+        throw std::runtime_error("LoadSDKMESH: 32-bit indices are not supported");
+    }
+
+    uint64_t vbOffset = vb.DataOffset;
+    uint64_t ibOffset = ib.DataOffset;
+    if (vbOffset + vb.SizeBytes > size || ibOffset + ib.SizeBytes > size || vb.StrideBytes == 0)
+    {
+        throw std::runtime_error("LoadSDKMESH: truncated buffers");
+    }
+
+    int positionOffset = -1;
+    int normalOffset = -1;
+    int texcoordOffset = -1;
+    for (const D3DVERTEXELEMENT9& element : vb.Decl)
+    {
+        if (element.Stream == 0xFF)
+            break;
+
+        if (element.Usage == D3DDECLUSAGE_POSITION && element.Type == D3DDECLTYPE_FLOAT3)
+            positionOffset = element.Offset;
+        else if (element.Usage == D3DDECLUSAGE_NORMAL && element.Type == D3DDECLTYPE_FLOAT3)
+            normalOffset = element.Offset;
+        else if (element.Usage == D3DDECLUSAGE_TEXCOORD && element.UsageIndex == 0 && element.Type == D3DDECLTYPE_FLOAT2 && texcoordOffset < 0)
+            texcoordOffset = element.Offset;
+    }
+
+    if (positionOffset < 0)
+    {
+        throw std::runtime_error("LoadSDKMESH: no float3 position");
+    }
+
+    MeshData result;
+    result.vertices.resize(size_t(vb.NumVertices));
+
+    const uint8_t* src = data + vbOffset;
+    for (size_t i = 0; i < result.vertices.size(); ++i, src += vb.StrideBytes)
+    {
+        MeshVertex& v = result.vertices[i];
+        std::memcpy(&v.position, src + positionOffset, sizeof(Float3));
+        v.normal = Float3{ 0, 0, 0 };
+        v.textureCoordinate = Float2{ 0, 0 };
+        if (normalOffset >= 0)
+            std::memcpy(&v.normal, src + normalOffset, sizeof(Float3));
+        if (texcoordOffset >= 0)
+            std::memcpy(&v.textureCoordinate, src + texcoordOffset, sizeof(Float2));
+    }
+
+    result.indices.resize(size_t(ib.NumIndices));
+    std::memcpy(result.indices.data(), data + ibOffset, result.indices.size() * sizeof(uint16_t));
+
+    for (uint32_t i = 0; i < mesh.NumSubsets; ++i)
+    {
+        auto subsetIndex = ReadAt<uint32_t>(data, size, mesh.SubsetOffset + i * sizeof(uint32_t));
+        auto subset = ReadAt<SDKMESH_SUBSET>(data, size, header.SubsetDataOffset + subsetIndex * sizeof(SDKMESH_SUBSET));
+        if (subset.IndexStart + subset.IndexCount > ib.NumIndices)
+        {
+            throw std::runtime_error("LoadSDKMESH: invalid subset");
+        }
+
+        result.subsets.push_back(MeshSubset{ subset.MaterialID, uint32_t(subset.IndexStart), uint32_t(subset.IndexCount) });
+    }
+
+    result.boundsCenter = Float3{ mesh.BoundingBoxCenter[0], mesh.BoundingBoxCenter[1], mesh.BoundingBoxCenter[2] };
+    result.boundsExtents = Float3{ mesh.BoundingBoxExtents[0], mesh.BoundingBoxExtents[1], mesh.BoundingBoxExtents[2] };
+
+    return result;
+}
+
+MeshData DX::LoadSDKMESHFromFile(const std::string& path)
+{
+    std::vector<uint8_t> blob = ReadBinaryFile(path);
+    return LoadSDKMESHFromMemory(blob.data(), blob.size());
+}
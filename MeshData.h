@@ -0,0 +1,55 @@
+//
+// MeshData.h - CPU-side mesh data and a portable SDKMESH reader
+//
+
+#pragma once
+
+#include "CpuMath.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    // Same layout as DirectX::VertexPositionNormalTexture.
+    struct MeshVertex
+    {
+        Float3 position;
+        Float3 normal;
+        Float2 textureCoordinate;
+    };
+
+    // Same layout as DirectX::VertexPositionColor.
+    struct ColorVertex
+    {
+        Float3 position;
+        Float4 color;
+    };
+
+    struct MeshSubset
+    {
+        uint32_t materialId;
+        uint32_t indexStart;
+        uint32_t indexCount;
+    };
+
+    struct MeshData
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<uint16_t>   indices;
+        std::vector<MeshSubset> subsets;
+        Float3                  boundsCenter;
+        Float3                  boundsExtents;
+
+        // Recomputes boundsCenter/boundsExtents from the vertices.
+        void ComputeBounds();
+    };
+
+    // Reads the first mesh of an SDKMESH file (the format Model::CreateFromSDKMESH
+    // consumes). Positions, normals and the first texture coordinate are
+    // extracted; meshes with 32-bit indices are rejected.
+    // Throws std::runtime_error on malformed input.
+    MeshData LoadSDKMESHFromMemory(const uint8_t* data, size_t size);
+    MeshData LoadSDKMESHFromFile(const std::string& path);
+}
@@ -0,0 +1,518 @@
+//
+// MipGenerator.cpp
+//
+
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    // Rows each job filters; small mips end up as a single job.
+    const uint32_t RowsPerJob = 16;
+
+    // Linear values are quantized this finely before the sRGB lookup; fine
+    // enough that no step skips an 8-bit code.
+    const uint32_t EncodeTableSize = 16384;
+
+    float SrgbToLinear(float c)
+    {
+        return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSrgb(float c)
+    {
+        return (c <= 0.0031308f) ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    }
+
+    struct SrgbTables
+    {
+        float   decode[256];
+        uint8_t encode[EncodeTableSize];
+
+        SrgbTables()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                decode[i] = SrgbToLinear(i / 255.f);
+            }
+            for (uint32_t i = 0; i < EncodeTableSize; ++i)
+            {
+                encode[i] = uint8_t(LinearToSrgb(float(i) / (EncodeTableSize - 1)) * 255.f + 0.5f);
+            }
+        }
+    };
+
+    const SrgbTables& GetSrgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // Four floats per texel, RGBA, rows packed.
+    struct Image
+    {
+        uint32_t            width;
+        uint32_t            height;
+        std::vector<float>  texels;
+
+        void Resize(uint32_t w, uint32_t h)
+        {
+            width = w;
+            height = h;
+            texels.resize(size_t(w) * h * 4);
+        }
+
+        float* Row(uint32_t y)                  { return texels.data() + size_t(y) * width * 4; }
+        const float* Row(uint32_t y) const      { return texels.data() + size_t(y) * width * 4; }
+    };
+
+    // One axis of a separable filter: every output texel reads taps source
+    // texels, indices already clamped to the edge.
+    struct FilterKernel
+    {
+        uint32_t                taps;
+        std::vector<uint32_t>   indices;
+        std::vector<float>      weights;
+    };
+
+    double Sinc(double x)
+    {
+        const double pi = 3.14159265358979323846;
+        return (x == 0.0) ? 1.0 : std::sin(pi * x) / (pi * x);
+    }
+
+    // Modified Bessel function of the first kind, order zero.
+    double BesselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (uint32_t k = 1; k < 32 && term > sum * 1e-12; ++k)
+        {
+            term *= (x * x / 4.0) / (double(k) * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Half-width in output texels.
+    double FilterSupport(MipFilter filter)
+    {
+        return (filter == MipFilter::Box) ? 0.5 : 3.0;
+    }
+
+    // t is in output texels from the output texel's centre.
+    double FilterWeight(MipFilter filter, double t)
+    {
+        const double a = std::abs(t);
+        switch (filter)
+        {
+        case MipFilter::Box:
+            // A source texel on the boundary is shared by both neighbours.
+            return (a < 0.5) ? 1.0 : (a == 0.5) ? 0.5 : 0.0;
+
+        case MipFilter::Kaiser:
+        {
+            const double alpha = 4.0, width = 3.0;
+            if (a >= width)
+            {
+                return 0.0;
+            }
+            const double r = a / width;
+            return Sinc(a) * BesselI0(alpha * std::sqrt(1.0 - r * r)) / BesselI0(alpha);
+        }
+
+        default:
+            return (a < 3.0) ? Sinc(a) * Sinc(a / 3.0) : 0.0;
+        }
+    }
+
+    void BuildKernel(MipFilter filter, uint32_t srcSize, uint32_t dstSize, FilterKernel& kernel)
+    {
+        const double scale = double(srcSize) / dstSize;
+        const double support = FilterSupport(filter) * scale;      // In source texels.
+
+        kernel.taps = uint32_t(std::ceil(support * 2)) + 1;
+        kernel.indices.resize(size_t(dstSize) * kernel.taps);
+        kernel.weights.resize(size_t(dstSize) * kernel.taps);
+
+        for (uint32_t x = 0; x < dstSize; ++x)
+        {
+            const double center = (x + 0.5) * scale;
+            const int32_t first = int32_t(std::ceil(center - support - 0.5));
+
+            uint32_t* indices = &kernel.indices[size_t(x) * kernel.taps];
+            float* weights = &kernel.weights[size_t(x) * kernel.taps];
+
+            double sum = 0.0;
+            for (uint32_t k = 0; k < kernel.taps; ++k)
+            {
+                const int32_t i = first + int32_t(k);
+                const double w = FilterWeight(filter, (i + 0.5 - center) / scale);
+                indices[k] = uint32_t(std::min(std::max(i, 0), int32_t(srcSize) - 1));
+                weights[k] = float(w);
+                sum += w;
+            }
+            for (uint32_t k = 0; k < kernel.taps; ++k)
+            {
+                weights[k] = float(weights[k] / sum);
+            }
+        }
+    }
+
+    template <typename Body>
+    void ForEach(JobSystem* jobs, uint32_t count, const Body& body)
+    {
+        if (jobs)
+        {
+            jobs->ParallelFor(count, [&](uint32_t index, uint32_t) { body(index); });
+        }
+        else
+        {
+            for (uint32_t index = 0; index < count; ++index)
+            {
+                body(index);
+            }
+        }
+    }
+
+    void DecodeToImage(const uint32_t* texels, uint32_t width, uint32_t height, bool srgb, Image& image)
+    {
+        const float* decode = GetSrgbTables().decode;
+
+        image.Resize(width, height);
+        float* out = image.texels.data();
+        for (size_t i = 0, count = size_t(width) * height; i < count; ++i, out += 4)
+        {
+            const uint32_t p = texels[i];
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const uint32_t v = (p >> (c * 8)) & 0xFF;
+                out[c] = srgb ? decode[v] : v / 255.f;
+            }
+            out[3] = (p >> 24) / 255.f;
+        }
+    }
+
+    // Output rows [y0, y1) of an exact halving in both directions.
+    void DownsampleBox(const Image& src, Image& dst, uint32_t y0, uint32_t y1)
+    {
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            const float* top = src.Row(y * 2);
+            const float* bottom = src.Row(y * 2 + 1);
+            float* out = dst.Row(y);
+
+#if defined(MIP_GENERATOR_SSE2)
+            const __m128 quarter = _mm_set1_ps(0.25f);
+            for (uint32_t x = 0; x < dst.width; ++x, top += 8, bottom += 8, out += 4)
+            {
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(top), _mm_loadu_ps(top + 4)),
+                    _mm_add_ps(_mm_loadu_ps(bottom), _mm_loadu_ps(bottom + 4)));
+                _mm_storeu_ps(out, _mm_mul_ps(sum, quarter));
+            }
+#else
+            for (uint32_t x = 0; x < dst.width; ++x, top += 8, bottom += 8, out += 4)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    out[c] = ((top[c] + top[c + 4]) + (bottom[c] + bottom[c + 4])) * 0.25f;
+                }
+            }
+#endif
+        }
+    }
+
+    // Rows [y0, y1) of src filtered across to dst, which is as tall as src.
+    void FilterHorizontal(const Image& src, const FilterKernel& kernel, Image& dst, uint32_t y0, uint32_t y1)
+    {
+        const uint32_t taps = kernel.taps;
+
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            const float* row = src.Row(y);
+            float* out = dst.Row(y);
+
+            for (uint32_t x = 0; x < dst.width; ++x, out += 4)
+            {
+                const uint32_t* indices = &kernel.indices[size_t(x) * taps];
+                const float* weights = &kernel.weights[size_t(x) * taps];
+
+#if defined(MIP_GENERATOR_SSE2)
+                __m128 sum = _mm_mul_ps(_mm_set1_ps(weights[0]), _mm_loadu_ps(row + indices[0] * 4));
+                for (uint32_t k = 1; k < taps; ++k)
+                {
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(row + indices[k] * 4)));
+                }
+                _mm_storeu_ps(out, sum);
+#else
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    float sum = weights[0] * row[indices[0] * 4 + c];
+                    for (uint32_t k = 1; k < taps; ++k)
+                    {
+                        sum += weights[k] * row[indices[k] * 4 + c];
+                    }
+                    out[c] = sum;
+                }
+#endif
+            }
+        }
+    }
+
+    // Rows [y0, y1) of dst filtered down from src, which is as wide as dst.
+    void FilterVertical(const Image& src, const FilterKernel& kernel, Image& dst, uint32_t y0, uint32_t y1)
+    {
+        const uint32_t taps = kernel.taps;
+        const uint32_t floats = dst.width * 4;
+
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            const uint32_t* indices = &kernel.indices[size_t(y) * taps];
+            const float* weights = &kernel.weights[size_t(y) * taps];
+            float* out = dst.Row(y);
+
+            // Whole rows at a time, so each source row streams through once.
+            const float* row = src.Row(indices[0]);
+#if defined(MIP_GENERATOR_SSE2)
+            __m128 w = _mm_set1_ps(weights[0]);
+            for (uint32_t i = 0; i < floats; i += 4)
+            {
+                _mm_storeu_ps(out + i, _mm_mul_ps(w, _mm_loadu_ps(row + i)));
+            }
+            for (uint32_t k = 1; k < taps; ++k)
+            {
+                row = src.Row(indices[k]);
+                w = _mm_set1_ps(weights[k]);
+                for (uint32_t i = 0; i < floats; i += 4)
+                {
+                    _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(w, _mm_loadu_ps(row + i))));
+                }
+            }
+#else
+            for (uint32_t i = 0; i < floats; ++i)
+            {
+                out[i] = weights[0] * row[i];
+            }
+            for (uint32_t k = 1; k < taps; ++k)
+            {
+                row = src.Row(indices[k]);
+                for (uint32_t i = 0; i < floats; ++i)
+                {
+                    out[i] += weights[k] * row[i];
+                }
+            }
+#endif
+        }
+    }
+
+    // Fraction of texels whose alpha, scaled, passes a test at reference.
+    float AlphaCoverage(const Image& image, float reference, float scale)
+    {
+        size_t passed = 0;
+        const float* texel = image.texels.data();
+        for (size_t i = 0, count = size_t(image.width) * image.height; i < count; ++i, texel += 4)
+        {
+            passed += (std::min(texel[3] * scale, 1.f) > reference) ? 1 : 0;
+        }
+        return float(passed) / (size_t(image.width) * image.height);
+    }
+
+    // Bisects for the alpha scale that brings the coverage closest to target.
+    float FindAlphaScale(const Image& image, float reference, float target)
+    {
+        float best = 1.f;
+        float bestError = std::abs(AlphaCoverage(image, reference, 1.f) - target);
+
+        float low = 0.f, high = 4.f;
+        for (uint32_t i = 0; i < 10 && bestError > 0.f; ++i)
+        {
+            const float scale = (low + high) * 0.5f;
+            const float coverage = AlphaCoverage(image, reference, scale);
+            if (std::abs(coverage - target) < bestError)
+            {
+                best = scale;
+                bestError = std::abs(coverage - target);
+            }
+            if (coverage < target)
+            {
+                low = scale;
+            }
+            else
+            {
+                high = scale;
+            }
+        }
+        return best;
+    }
+
+    // Rows [y0, y1) back to RGBA8, clamped; dest is the whole surface.
+    void EncodeRows(const Image& image, bool srgb, float alphaScale, uint8_t* dest, uint32_t y0, uint32_t y1)
+    {
+        const uint8_t* encode = GetSrgbTables().encode;
+        const float colorRange = srgb ? float(EncodeTableSize - 1) : 255.f;
+
+#if defined(MIP_GENERATOR_SSE2)
+        const __m128 scale = _mm_setr_ps(1.f, 1.f, 1.f, alphaScale);
+        const __m128 range = _mm_setr_ps(colorRange, colorRange, colorRange, 255.f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.f);
+        const __m128 half = _mm_set1_ps(0.5f);
+#endif
+
+        for (uint32_t y = y0; y < y1; ++y)
+        {
+            const float* texel = image.Row(y);
+            uint8_t* out = dest + size_t(y) * image.width * 4;
+
+            for (uint32_t x = 0; x < image.width; ++x, texel += 4, out += 4)
+            {
+                int32_t q[4];
+#if defined(MIP_GENERATOR_SSE2)
+                __m128 v = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(texel), scale), zero), one);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(q), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, range), half)));
+#else
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    const float v = std::min(std::max(texel[c] * (c == 3 ? alphaScale : 1.f), 0.f), 1.f);
+                    q[c] = int32_t(v * (c == 3 ? 255.f : colorRange) + 0.5f);
+                }
+#endif
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    out[c] = srgb ? encode[q[c]] : uint8_t(q[c]);
+                }
+                out[3] = uint8_t(q[3]);
+            }
+        }
+    }
+}
+
+TextureData DX::GenerateMips(const TextureData& source, const MipOptions& options, JobSystem* jobs)
+{
+    const TextureDesc& sourceDesc = source.desc;
+    if (sourceDesc.width == 0 || sourceDesc.height == 0 || source.surfaces.empty())
+    {
+        throw std::runtime_error("GenerateMips: empty texture");
+    }
+
+    uint32_t fullChain = 1;
+    while ((std::max(sourceDesc.width, sourceDesc.height) >> fullChain) != 0)
+    {
+        ++fullChain;
+    }
+
+    TextureData result;
+    result.desc = sourceDesc;
+    result.desc.format = TextureFormat::RGBA8;
+    result.desc.mipLevels = (options.mipLevels == 0) ? fullChain : std::min(options.mipLevels, fullChain);
+
+    size_t payload = 0;
+    for (uint32_t slice = 0; slice < result.desc.arraySize; ++slice)
+    {
+        for (uint32_t mip = 0; mip < result.desc.mipLevels; ++mip)
+        {
+            TextureSurface surface;
+            surface.width = std::max(1u, result.desc.width >> mip);
+            surface.height = std::max(1u, result.desc.height >> mip);
+            GetSurfaceInfo(TextureFormat::RGBA8, surface.width, surface.height, surface.rowPitch, surface.slicePitch);
+            surface.offset = payload;
+            payload += surface.slicePitch;
+            result.surfaces.push_back(surface);
+        }
+    }
+    result.pixels.resize(payload);
+
+    const uint32_t slices = result.desc.arraySize;
+    std::vector<Image> current(slices), next(slices), across(slices);
+    std::vector<float> coverage(slices, 0.f);
+    std::vector<float> alphaScales(slices, 1.f);
+
+    // Mip zero is the source, decoded; its linear copy seeds the chain.
+    ForEach(jobs, slices, [&](uint32_t slice)
+    {
+        const TextureSurface& surface = source.GetSurface(slice, 0);
+        uint32_t* top = reinterpret_cast<uint32_t*>(result.pixels.data() + result.GetSurface(slice, 0).offset);
+        DecodeSurfaceToRGBA8(sourceDesc.format, surface.width, surface.height, source.GetSurfacePixels(slice, 0), surface.rowPitch, top);
+        DecodeToImage(top, surface.width, surface.height, options.srgb, current[slice]);
+        if (options.alphaReference > 0.f)
+        {
+            coverage[slice] = AlphaCoverage(current[slice], options.alphaReference, 1.f);
+        }
+    });
+
+    FilterKernel kernelX, kernelY;
+    for (uint32_t mip = 1; mip < result.desc.mipLevels; ++mip)
+    {
+        const uint32_t srcWidth = current[0].width, srcHeight = current[0].height;
+        const uint32_t width = std::max(1u, srcWidth / 2), height = std::max(1u, srcHeight / 2);
+        const uint32_t bands = (height + RowsPerJob - 1) / RowsPerJob;
+
+        for (uint32_t slice = 0; slice < slices; ++slice)
+        {
+            next[slice].Resize(width, height);
+        }
+
+        if (options.filter == MipFilter::Box && srcWidth == width * 2 && srcHeight == height * 2)
+        {
+            ForEach(jobs, slices * bands, [&](uint32_t index)
+            {
+                const uint32_t slice = index / bands, y0 = (index % bands) * RowsPerJob;
+                DownsampleBox(current[slice], next[slice], y0, std::min(height, y0 + RowsPerJob));
+            });
+        }
+        else
+        {
+            // Across every source row first, then down into the new level.
+            BuildKernel(options.filter, srcWidth, width, kernelX);
+            BuildKernel(options.filter, srcHeight, height, kernelY);
+
+            const uint32_t srcBands = (srcHeight + RowsPerJob - 1) / RowsPerJob;
+            for (uint32_t slice = 0; slice < slices; ++slice)
+            {
+                across[slice].Resize(width, srcHeight);
+            }
+            ForEach(jobs, slices * srcBands, [&](uint32_t index)
+            {
+                const uint32_t slice = index / srcBands, y0 = (index % srcBands) * RowsPerJob;
+                FilterHorizontal(current[slice], kernelX, across[slice], y0, std::min(srcHeight, y0 + RowsPerJob));
+            });
+            ForEach(jobs, slices * bands, [&](uint32_t index)
+            {
+                const uint32_t slice = index / bands, y0 = (index % bands) * RowsPerJob;
+                FilterVertical(across[slice], kernelY, next[slice], y0, std::min(height, y0 + RowsPerJob));
+            });
+        }
+
+        // The scale only applies to what is stored; the next level is still
+        // filtered from the unscaled alpha.
+        if (options.alphaReference > 0.f)
+        {
+            ForEach(jobs, slices, [&](uint32_t slice)
+            {
+                alphaScales[slice] = FindAlphaScale(next[slice], options.alphaReference, coverage[slice]);
+            });
+        }
+
+        ForEach(jobs, slices * bands, [&](uint32_t index)
+        {
+            const uint32_t slice = index / bands, y0 = (index % bands) * RowsPerJob;
+            uint8_t* dest = result.pixels.data() + result.GetSurface(slice, mip).offset;
+            EncodeRows(next[slice], options.srgb, alphaScales[slice], dest, y0, std::min(height, y0 + RowsPerJob));
+        });
+
+        std::swap(current, next);
+    }
+
+    return result;
+}
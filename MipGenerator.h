@@ -0,0 +1,40 @@
+//
+// MipGenerator.h - Mip chains built on the CPU from a texture's top level,
+// filtered in linear light
+//
+
+#pragma once
+
+#include "JobSystem.h"
+#include "TextureData.h"
+
+#include <stdint.h>
+
+namespace DX
+{
+    enum class MipFilter : uint8_t
+    {
+        Box,        // Averages 2x2 texels on even sizes. Cheapest, slightly soft.
+        Kaiser,     // Kaiser-windowed sinc, three texels wide. Sharper, barely rings.
+        Lanczos,    // Lanczos-3. Sharpest, rings most on hard edges.
+    };
+
+    struct MipOptions
+    {
+        MipFilter   filter;
+        bool        srgb;               // Colour is sRGB-encoded: filtered in linear light, then re-encoded.
+        float       alphaReference;     // Non-zero scales each mip's alpha so as many texels pass an alpha test at this value as in mip zero.
+        uint32_t    mipLevels;          // Zero for the full chain down to 1x1.
+    };
+
+    // Builds every array slice's chain from its mip zero; whatever mips the
+    // source had below that are ignored. Any format LoadDDS reads goes in and
+    // RGBA8 comes out, mip zero decoded unchanged. Each level is filtered
+    // from the one above, clamped at the edges (cubemap faces are filtered
+    // separately). With jobs, the rows of each level are split across the
+    // workers.
+    //
+    // Holds two four-float copies of a slice's top levels while it works,
+    // so it suits textures up to a few thousand texels across.
+    TextureData GenerateMips(const TextureData& source, const MipOptions& options, JobSystem* jobs = nullptr);
+}
@@ -0,0 +1,149 @@
+//
+// NullGraphicsBackend.cpp
+//
+
+#include "NullGraphicsBackend.h"
+
+using namespace DX;
+
+NullGraphicsBackend::NullGraphicsBackend() noexcept :
+    m_frame{},
+    m_total{},
+    m_nextHandle(1),
+    m_liveResources(0),
+    m_frameCount(0)
+{
+}
+
+void NullGraphicsBackend::Upload(uint64_t bytes)
+{
+    m_frame.bytesUploaded += bytes;
+    m_total.bytesUploaded += bytes;
+}
+
+BufferHandle NullGraphicsBackend::CreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+    if (initialData)
+    {
+        Upload(desc.sizeBytes);
+    }
+
+    ++m_liveResources;
+    return m_nextHandle++;
+}
+
+TextureHandle NullGraphicsBackend::CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData)
+{
+    if (initialData)
+    {
+        uint32_t subresources = desc.mipLevels * desc.arraySize;
+        for (uint32_t i = 0; i < subresources; ++i)
+        {
+            Upload(initialData[i].slicePitch);
+        }
+    }
+
+    ++m_liveResources;
+    return m_nextHandle++;
+}
+
+PipelineHandle NullGraphicsBackend::CreatePipelineState(const PipelineDesc&)
+{
+    ++m_liveResources;
+    return m_nextHandle++;
+}
+
+void NullGraphicsBackend::DestroyBuffer(BufferHandle buffer)
+{
+    if (buffer != InvalidHandle)
+    {
+        --m_liveResources;
+    }
+}
+
+void NullGraphicsBackend::DestroyTexture(TextureHandle texture)
+{
+    if (texture != InvalidHandle)
+    {
+        --m_liveResources;
+    }
+}
+
+void NullGraphicsBackend::DestroyPipelineState(PipelineHandle pipeline)
+{
+    if (pipeline != InvalidHandle)
+    {
+        --m_liveResources;
+    }
+}
+
+void NullGraphicsBackend::UpdateBuffer(BufferHandle, const void*, uint32_t sizeBytes)
+{
+    ++m_frame.bufferUpdates;
+    ++m_total.bufferUpdates;
+    Upload(sizeBytes);
+}
+
+void NullGraphicsBackend::BeginFrame()
+{
+    m_frame = BackendStats{};
+}
+
+void NullGraphicsBackend::EndFrame()
+{
+    ++m_frameCount;
+}
+
+void NullGraphicsBackend::Clear(const float*, float)
+{
+}
+
+void NullGraphicsBackend::SetViewport(uint32_t, uint32_t)
+{
+}
+
+void NullGraphicsBackend::SetPipelineState(PipelineHandle)
+{
+    ++m_frame.pipelineBinds;
+    ++m_total.pipelineBinds;
+}
+
+void NullGraphicsBackend::SetVertexBuffer(BufferHandle, uint32_t, uint32_t)
+{
+    ++m_frame.bufferBinds;
+    ++m_total.bufferBinds;
+}
+
+void NullGraphicsBackend::SetIndexBuffer(BufferHandle, uint32_t)
+{
+    ++m_frame.bufferBinds;
+    ++m_total.bufferBinds;
+}
+
+void NullGraphicsBackend::SetConstantBuffer(uint32_t, BufferHandle)
+{
+    ++m_frame.bufferBinds;
+    ++m_total.bufferBinds;
+}
+
+void NullGraphicsBackend::SetTexture(uint32_t, TextureHandle)
+{
+    ++m_frame.textureBinds;
+    ++m_total.textureBinds;
+}
+
+void NullGraphicsBackend::Draw(uint32_t vertexCount, uint32_t)
+{
+    ++m_frame.drawCalls;
+    ++m_total.drawCalls;
+    m_frame.trianglesSubmitted += vertexCount / 3;
+    m_total.trianglesSubmitted += vertexCount / 3;
+}
+
+void NullGraphicsBackend::DrawIndexed(uint32_t indexCount, uint32_t, int32_t)
+{
+    ++m_frame.drawCalls;
+    ++m_total.drawCalls;
+    m_frame.trianglesSubmitted += indexCount / 3;
+    m_total.trianglesSubmitted += indexCount / 3;
+}
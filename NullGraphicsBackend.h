@@ -0,0 +1,56 @@
+//
+// NullGraphicsBackend.h - Backend that validates nothing and draws nothing,
+// it only counts calls and bytes so CPU submission cost can be profiled
+//
+
+#pragma once
+
+#include "GraphicsBackend.h"
+
+namespace DX
+{
+    class NullGraphicsBackend : public IGraphicsBackend
+    {
+    public:
+        NullGraphicsBackend() noexcept;
+
+        BufferHandle CreateBuffer(const BufferDesc& desc, const void* initialData) override;
+        TextureHandle CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData) override;
+        PipelineHandle CreatePipelineState(const PipelineDesc& desc) override;
+
+        void DestroyBuffer(BufferHandle buffer) override;
+        void DestroyTexture(TextureHandle texture) override;
+        void DestroyPipelineState(PipelineHandle pipeline) override;
+
+        void UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes) override;
+
+        void BeginFrame() override;
+        void EndFrame() override;
+        void Clear(const float color[4], float depth) override;
+        void SetViewport(uint32_t width, uint32_t height) override;
+
+        void SetPipelineState(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes) override;
+        void SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes) override;
+        void SetConstantBuffer(uint32_t slot, BufferHandle buffer) override;
+        void SetTexture(uint32_t slot, TextureHandle texture) override;
+        void Draw(uint32_t vertexCount, uint32_t startVertex) override;
+        void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+
+        const BackendStats& GetFrameStats() const override     { return m_frame; }
+
+        // Totals since construction, including resource creation.
+        const BackendStats& GetTotalStats() const               { return m_total; }
+        uint32_t GetFrameCount() const                          { return m_frameCount; }
+        uint32_t GetLiveResourceCount() const                   { return m_liveResources; }
+
+    private:
+        void Upload(uint64_t bytes);
+
+        BackendStats    m_frame;
+        BackendStats    m_total;
+        uint32_t        m_nextHandle;
+        uint32_t        m_liveResources;
+        uint32_t        m_frameCount;
+    };
+}
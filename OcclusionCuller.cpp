@@ -0,0 +1,343 @@
+//
+// OcclusionCuller.cpp
+//
+
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define OCCLUSION_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+OcclusionCuller::OcclusionCuller(JobSystem& jobs, uint32_t width, uint32_t height) :
+    m_jobs(jobs),
+    m_viewProjection(Matrix44::Identity()),
+    m_stats{}
+{
+    // Whole blocks and whole four-pixel groups keep the inner loops simple.
+    m_width = std::max(TileWidth, (width + TileWidth - 1) / TileWidth * TileWidth);
+    m_height = std::max(TileHeight, (height + TileHeight - 1) / TileHeight * TileHeight);
+    m_blocksX = m_width / BlockSize;
+    m_blocksY = m_height / BlockSize;
+    m_tilesX = m_width / TileWidth;
+    m_tilesY = m_height / TileHeight;
+
+    m_depth.assign(size_t(m_width) * m_height, 1.f);
+    m_blockMaxDepth.assign(size_t(m_blocksX) * m_blocksY, 1.f);
+    m_bins.resize(m_tilesX * m_tilesY);
+}
+
+void OcclusionCuller::BeginFrame(const Matrix44& viewProjection)
+{
+    m_viewProjection = viewProjection;
+    m_triangles.clear();
+    for (std::vector<uint32_t>& bin : m_bins)
+    {
+        bin.clear();
+    }
+    m_stats = OcclusionStats{};
+}
+
+void OcclusionCuller::AddOccluder(const void* vertices, uint32_t strideBytes, const uint16_t* indices, uint32_t indexCount, const Matrix44& world)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t vertexCount = 0;
+    for (uint32_t i = 0; i < indexCount; ++i)
+    {
+        vertexCount = std::max(vertexCount, uint32_t(indices[i]) + 1);
+    }
+
+    const Matrix44 worldViewProjection = world * m_viewProjection;
+    const uint8_t* base = static_cast<const uint8_t*>(vertices);
+
+    m_clip.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const float* p = reinterpret_cast<const float*>(base + size_t(i) * strideBytes);
+        m_clip[i] = worldViewProjection.Transform(Float3{ p[0], p[1], p[2] });
+    }
+
+    const float halfWidth = float(m_width) * 0.5f;
+    const float halfHeight = float(m_height) * 0.5f;
+
+    for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        ++m_stats.occluderTriangles;
+
+        const Float4* v[3] = { &m_clip[indices[i]], &m_clip[indices[i + 1]], &m_clip[indices[i + 2]] };
+        if (v[0]->z < 0.f || v[1]->z < 0.f || v[2]->z < 0.f)
+        {
+            continue;
+        }
+
+        Triangle tri;
+        float z[3];
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            float invW = 1.f / v[k]->w;
+            tri.x[k] = (v[k]->x * invW + 1.f) * halfWidth;
+            tri.y[k] = (1.f - v[k]->y * invW) * halfHeight;
+            z[k] = v[k]->z * invW;
+        }
+
+        // Keep front faces only; clockwise on screen, as the scene draws them.
+        float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+        if (!(area > 0.f))
+        {
+            continue;
+        }
+
+        tri.minX = std::max(0, int32_t(std::floor(std::min({ tri.x[0], tri.x[1], tri.x[2] }))));
+        tri.minY = std::max(0, int32_t(std::floor(std::min({ tri.y[0], tri.y[1], tri.y[2] }))));
+        tri.maxX = std::min(int32_t(m_width), int32_t(std::ceil(std::max({ tri.x[0], tri.x[1], tri.x[2] }))));
+        tri.maxY = std::min(int32_t(m_height), int32_t(std::ceil(std::max({ tri.y[0], tri.y[1], tri.y[2] }))));
+        if (tri.minX >= tri.maxX || tri.minY >= tri.maxY)
+        {
+            continue;
+        }
+
+        float dx1 = tri.x[1] - tri.x[0], dy1 = tri.y[1] - tri.y[0];
+        float dx2 = tri.x[2] - tri.x[0], dy2 = tri.y[2] - tri.y[0];
+        float dz1 = z[1] - z[0], dz2 = z[2] - z[0];
+        tri.depth.x = (dz1 * dy2 - dz2 * dy1) / area;
+        tri.depth.y = (dz2 * dx1 - dz1 * dx2) / area;
+        tri.depth.z = z[0] - tri.depth.x * tri.x[0] - tri.depth.y * tri.y[0];
+        tri.minZ = std::min({ z[0], z[1], z[2] });
+
+        uint32_t index = uint32_t(m_triangles.size());
+        m_triangles.push_back(tri);
+        ++m_stats.occluderTrianglesBinned;
+
+        for (uint32_t ty = uint32_t(tri.minY) / TileHeight; ty <= uint32_t(tri.maxY - 1) / TileHeight; ++ty)
+        {
+            for (uint32_t tx = uint32_t(tri.minX) / TileWidth; tx <= uint32_t(tri.maxX - 1) / TileWidth; ++tx)
+            {
+                m_bins[ty * m_tilesX + tx].push_back(index);
+            }
+        }
+    }
+
+    m_stats.rasterNanoseconds += ElapsedNanoseconds(start);
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+    DX_PROFILE_SCOPE("OcclusionCuller::RasterizeOccluders");
+    auto start = std::chrono::steady_clock::now();
+
+    m_jobs.ParallelFor(m_tilesX * m_tilesY, [this](uint32_t tile, uint32_t)
+    {
+        RasterizeTile(tile);
+    });
+
+    m_stats.rasterNanoseconds += ElapsedNanoseconds(start);
+}
+
+void OcclusionCuller::RasterizeTile(uint32_t tile)
+{
+    const int32_t x0 = int32_t((tile % m_tilesX) * TileWidth);
+    const int32_t y0 = int32_t((tile / m_tilesX) * TileHeight);
+    const int32_t x1 = x0 + int32_t(TileWidth);
+    const int32_t y1 = y0 + int32_t(TileHeight);
+
+    for (int32_t y = y0; y < y1; ++y)
+    {
+        std::fill(&m_depth[size_t(y) * m_width + x0], &m_depth[size_t(y) * m_width + x1], 1.f);
+    }
+
+    for (uint32_t index : m_bins[tile])
+    {
+        const Triangle& tri = m_triangles[index];
+        RasterizeTriangle(tri, std::max(x0, tri.minX), std::max(y0, tri.minY), std::min(x1, tri.maxX), std::min(y1, tri.maxY));
+    }
+
+    // Farthest depth of each block: anything behind it is hidden everywhere
+    // in the block.
+    for (int32_t by = y0; by < y1; by += BlockSize)
+    {
+        for (int32_t bx = x0; bx < x1; bx += BlockSize)
+        {
+            float farthest = 0.f;
+            for (int32_t y = by; y < by + int32_t(BlockSize); ++y)
+            {
+                const float* row = &m_depth[size_t(y) * m_width + bx];
+                for (uint32_t x = 0; x < BlockSize; ++x)
+                {
+                    farthest = std::max(farthest, row[x]);
+                }
+            }
+            m_blockMaxDepth[(by / BlockSize) * m_blocksX + bx / BlockSize] = farthest;
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeTriangle(const Triangle& tri, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    // Edge i runs from vertex i to vertex i + 1; inside is positive for the
+    // clockwise triangles AddOccluder keeps.
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        uint32_t j = (i + 1) % 3;
+        edgeA[i] = tri.y[i] - tri.y[j];
+        edgeB[i] = tri.x[j] - tri.x[i];
+        edgeC[i] = tri.x[i] * tri.y[j] - tri.x[j] * tri.y[i];
+    }
+
+    const int32_t quadX0 = x0 & ~3;
+
+#if defined(OCCLUSION_CULLER_SSE2)
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 laneIndices = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minX = _mm_set1_ps(float(x0));
+    const __m128 maxX = _mm_set1_ps(float(x1));
+
+    for (int32_t y = y0; y < y1; ++y)
+    {
+        const float py = float(y) + 0.5f;
+        float* row = &m_depth[size_t(y) * m_width];
+
+        for (int32_t x = quadX0; x < x1; x += 4)
+        {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), laneOffsets);
+            const __m128 lanes = _mm_add_ps(_mm_set1_ps(float(x)), laneIndices);
+
+            __m128 mask = _mm_and_ps(_mm_cmpge_ps(lanes, minX), _mm_cmplt_ps(lanes, maxX));
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                __m128 e = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[i]), px), _mm_set1_ps(edgeB[i] * py + edgeC[i]));
+                mask = _mm_and_ps(mask, _mm_cmpge_ps(e, zero));
+            }
+
+            if (!_mm_movemask_ps(mask))
+            {
+                continue;
+            }
+
+            __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.depth.x), px), _mm_set1_ps(tri.depth.y * py + tri.depth.z));
+            __m128 stored = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(depth, stored);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(mask, nearer), _mm_andnot_ps(mask, stored)));
+        }
+    }
+#else
+    for (int32_t y = y0; y < y1; ++y)
+    {
+        const float py = float(y) + 0.5f;
+        float* row = &m_depth[size_t(y) * m_width];
+
+        for (int32_t x = x0; x < x1; ++x)
+        {
+            const float px = float(x) + 0.5f;
+            if (edgeA[0] * px + edgeB[0] * py + edgeC[0] >= 0.f
+                && edgeA[1] * px + edgeB[1] * py + edgeC[1] >= 0.f
+                && edgeA[2] * px + edgeB[2] * py + edgeC[2] >= 0.f)
+            {
+                row[x] = std::min(row[x], tri.depth.x * px + tri.depth.y * py + tri.depth.z);
+            }
+        }
+    }
+    (void)quadX0;
+#endif
+}
+
+bool OcclusionCuller::IsVisible(const Matrix44& world, const Float3& center, const Float3& extents)
+{
+    auto start = std::chrono::steady_clock::now();
+    ++m_stats.occludeesTested;
+
+    const Matrix44 worldViewProjection = world * m_viewProjection;
+
+    float minX = float(m_width), minY = float(m_height), maxX = 0.f, maxY = 0.f;
+    float nearest = 1.f;
+    bool visible = false;
+
+    for (uint32_t corner = 0; corner < 8 && !visible; ++corner)
+    {
+        Float3 p = {
+            center.x + ((corner & 1) ? extents.x : -extents.x),
+            center.y + ((corner & 2) ? extents.y : -extents.y),
+            center.z + ((corner & 4) ? extents.z : -extents.z) };
+
+        Float4 clip = worldViewProjection.Transform(p);
+        if (clip.z < 0.f)
+        {
+            visible = true;
+            break;
+        }
+
+        float invW = 1.f / clip.w;
+        float x = (clip.x * invW + 1.f) * 0.5f * float(m_width);
+        float y = (1.f - clip.y * invW) * 0.5f * float(m_height);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, clip.z * invW);
+    }
+
+    int32_t x0 = std::max(0, int32_t(std::floor(minX)));
+    int32_t y0 = std::max(0, int32_t(std::floor(minY)));
+    int32_t x1 = std::min(int32_t(m_width), int32_t(std::ceil(maxX)));
+    int32_t y1 = std::min(int32_t(m_height), int32_t(std::ceil(maxY)));
+
+    if (visible || x0 >= x1 || y0 >= y1)
+    {
+        m_stats.testNanoseconds += ElapsedNanoseconds(start);
+        return true;
+    }
+
+    // Blocks that are wholly nearer than the box hide their part of it;
+    // the rest are checked pixel by pixel.
+    for (int32_t by = y0 / int32_t(BlockSize); by * int32_t(BlockSize) < y1 && !visible; ++by)
+    {
+        for (int32_t bx = x0 / int32_t(BlockSize); bx * int32_t(BlockSize) < x1 && !visible; ++bx)
+        {
+            if (m_blockMaxDepth[by * m_blocksX + bx] < nearest)
+            {
+                continue;
+            }
+
+            int32_t px0 = std::max(x0, bx * int32_t(BlockSize)), px1 = std::min(x1, (bx + 1) * int32_t(BlockSize));
+            int32_t py0 = std::max(y0, by * int32_t(BlockSize)), py1 = std::min(y1, (by + 1) * int32_t(BlockSize));
+
+            for (int32_t y = py0; y < py1 && !visible; ++y)
+            {
+                const float* row = &m_depth[size_t(y) * m_width];
+                for (int32_t x = px0; x < px1; ++x)
+                {
+                    if (row[x] >= nearest)
+                    {
+                        visible = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!visible)
+    {
+        ++m_stats.occludeesCulled;
+    }
+
+    m_stats.testNanoseconds += ElapsedNanoseconds(start);
+    return visible;
+}
@@ -0,0 +1,93 @@
+//
+// OcclusionCuller.h - Low-resolution CPU depth buffer rasterized from a few
+// large occluders, used to skip draws that are hidden behind them
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "JobSystem.h"
+
+#include <vector>
+
+namespace DX
+{
+    struct OcclusionStats
+    {
+        uint32_t occluderTriangles;         // Submitted through AddOccluder.
+        uint32_t occluderTrianglesBinned;   // Front-facing, on screen and in front of the near plane.
+        uint32_t occludeesTested;
+        uint32_t occludeesCulled;
+        uint64_t rasterNanoseconds;         // Binning, rasterization and the hierarchy build.
+        uint64_t testNanoseconds;
+    };
+
+    // Usage per frame: BeginFrame, AddOccluder for each occluder, then
+    // RasterizeOccluders once, then IsVisible for every other object.
+    //
+    // Occluders write their nearest depth into a small buffer in screen
+    // tiles spread over the job system, four pixels at a time with SSE2.
+    // Each 8x8 block then keeps its farthest depth, so most queries are
+    // answered from the block level without touching pixels.
+    //
+    // Occluder triangles that cross the near plane are dropped rather than
+    // clipped. That only ever makes the buffer emptier, so culling stays
+    // conservative.
+    class OcclusionCuller
+    {
+    public:
+        OcclusionCuller(JobSystem& jobs, uint32_t width = 256, uint32_t height = 128);
+
+        OcclusionCuller(OcclusionCuller const&) = delete;
+        OcclusionCuller& operator=(OcclusionCuller const&) = delete;
+
+        void BeginFrame(const Matrix44& viewProjection);
+
+        // Positions are read from the first three floats of each vertex.
+        void AddOccluder(const void* vertices, uint32_t strideBytes, const uint16_t* indices, uint32_t indexCount, const Matrix44& world);
+
+        void RasterizeOccluders();
+
+        // Tests a box given in the object's model space. Boxes that reach the
+        // near plane or leave the screen are reported visible.
+        bool IsVisible(const Matrix44& world, const Float3& center, const Float3& extents);
+
+        const OcclusionStats& GetStats() const      { return m_stats; }
+        uint32_t GetWidth() const                   { return m_width; }
+        uint32_t GetHeight() const                  { return m_height; }
+        const float* GetDepthBuffer() const         { return m_depth.data(); }
+
+        static const uint32_t BlockSize = 8;
+        static const uint32_t TileWidth = 64;
+        static const uint32_t TileHeight = 32;
+
+    private:
+        struct Triangle
+        {
+            float       x[3], y[3];
+            Float3      depth;          // Plane: z = x * depth.x + y * depth.y + depth.z
+            int32_t     minX, minY, maxX, maxY;
+            float       minZ;
+        };
+
+        void RasterizeTile(uint32_t tile);
+        void RasterizeTriangle(const Triangle& tri, int32_t x0, int32_t y0, int32_t x1, int32_t y1);
+
+        JobSystem&                          m_jobs;
+        uint32_t                            m_width;
+        uint32_t                            m_height;
+        uint32_t                            m_blocksX;
+        uint32_t                            m_blocksY;
+        uint32_t                            m_tilesX;
+        uint32_t                            m_tilesY;
+
+        Matrix44                            m_viewProjection;
+        std::vector<float>                  m_depth;
+        std::vector<float>                  m_blockMaxDepth;
+        std::vector<Triangle>               m_triangles;
+        std::vector<std::vector<uint32_t>>  m_bins;
+        std::vector<Float4>                 m_clip;
+
+        OcclusionStats                      m_stats;
+    };
+}
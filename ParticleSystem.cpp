@@ -0,0 +1,368 @@
+//
+// ParticleSystem.cpp
+//
+
+#include "ParticleSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define PARTICLE_SYSTEM_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    // Particles per job for the update, compaction and vertex passes; a
+    // multiple of four, so only the last block has a scalar tail.
+    const uint32_t BlockSize = 16384;
+
+    // Emitted particles per job.
+    const uint32_t EmitBlockSize = 4096;
+
+    // Radix digits for the depth sort: three passes cover a 32-bit key.
+    const uint32_t RadixBits = 11;
+    const uint32_t RadixBuckets = 1u << RadixBits;
+
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    uint32_t Hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7FEB352Du;
+        x ^= x >> 15;
+        x *= 0x846CA68Bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Successive values in [0, 1) from one particle's seed.
+    struct Random
+    {
+        uint32_t state;
+
+        float Next()
+        {
+            state = Hash(state + 0x9E3779B9u);
+            return float(state >> 8) * (1.f / 16777216.f);
+        }
+
+        // In [-1, 1).
+        float NextSigned()      { return Next() * 2.f - 1.f; }
+    };
+
+    uint32_t PackColor(const Float4& color)
+    {
+        auto channel = [](float v) { return uint32_t(std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f); };
+        return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | (channel(color.w) << 24);
+    }
+
+    // Float bits reordered so unsigned comparison matches float order.
+    uint32_t SortableFloat(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+    }
+
+    const uint8_t BitCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+}
+
+void ParticleSystem::Attributes::Resize(uint32_t capacity)
+{
+    for (std::vector<float>* attribute : { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &age, &lifetime, &size })
+    {
+        attribute->resize(capacity);
+    }
+    color.resize(capacity);
+}
+
+ParticleSystem::ParticleSystem(JobSystem& jobs, uint32_t capacity) :
+    m_jobs(jobs),
+    m_capacity(capacity),
+    m_count(0),
+    m_emitCounter(0),
+    m_gravity{ 0.f, 0.f, 0.f },
+    m_drag(0.f),
+    m_live(&m_attributes[0]),
+    m_spare(&m_attributes[1]),
+    m_stats{}
+{
+    if (capacity == 0)
+    {
+        throw std::runtime_error("ParticleSystem: zero capacity");
+    }
+    m_attributes[0].Resize(capacity);
+    m_attributes[1].Resize(capacity);
+    m_blockAlive.resize((capacity + BlockSize - 1) / BlockSize + 1);
+    m_keys.resize(capacity);
+    m_order.resize(capacity);
+    m_sortKeys.resize(capacity);
+    m_sortOrder.resize(capacity);
+}
+
+void ParticleSystem::SetForces(const Float3& gravity, float drag)
+{
+    m_gravity = gravity;
+    m_drag = drag;
+}
+
+void ParticleSystem::Clear()
+{
+    m_count = 0;
+    m_stats = ParticleStats{};
+}
+
+uint32_t ParticleSystem::Emit(const ParticleEmitter& emitter, uint32_t count)
+{
+    const uint32_t spawn = std::min(count, m_capacity - m_count);
+    m_stats.dropped += count - spawn;
+    if (spawn == 0)
+    {
+        return 0;
+    }
+
+    DX_PROFILE_SCOPE("ParticleSystem::Emit");
+    auto start = std::chrono::steady_clock::now();
+
+    const uint32_t first = m_count, seedBase = m_emitCounter;
+    const uint32_t color = PackColor(emitter.color);
+    Attributes& live = *m_live;
+
+    m_jobs.ParallelFor((spawn + EmitBlockSize - 1) / EmitBlockSize, [&](uint32_t block, uint32_t)
+    {
+        const uint32_t end = std::min(spawn, (block + 1) * EmitBlockSize);
+        for (uint32_t i = block * EmitBlockSize; i < end; ++i)
+        {
+            Random random = { Hash(seedBase + i) };
+            const uint32_t p = first + i;
+            live.positionX[p] = emitter.position.x + emitter.extents.x * random.NextSigned();
+            live.positionY[p] = emitter.position.y + emitter.extents.y * random.NextSigned();
+            live.positionZ[p] = emitter.position.z + emitter.extents.z * random.NextSigned();
+            live.velocityX[p] = emitter.velocity.x + emitter.velocitySpread.x * random.NextSigned();
+            live.velocityY[p] = emitter.velocity.y + emitter.velocitySpread.y * random.NextSigned();
+            live.velocityZ[p] = emitter.velocity.z + emitter.velocitySpread.z * random.NextSigned();
+            live.age[p] = 0.f;
+            live.lifetime[p] = std::max(emitter.lifetime + emitter.lifetimeSpread * random.NextSigned(), 1e-3f);
+            live.size[p] = emitter.size;
+            live.color[p] = color;
+        }
+    });
+
+    m_count += spawn;
+    m_emitCounter += spawn;
+    m_stats.emitted += spawn;
+    m_stats.alive = m_count;
+    m_stats.emitNanoseconds += ElapsedNanoseconds(start);
+    return spawn;
+}
+
+// Particles [begin, end) of the live arrays; stores how many survive in
+// the block's slot.
+void ParticleSystem::Integrate(uint32_t begin, uint32_t end, float elapsedSeconds)
+{
+    Attributes& a = *m_live;
+    const float damping = std::max(0.f, 1.f - m_drag * elapsedSeconds);
+    const Float3 impulse = m_gravity * elapsedSeconds;
+    uint32_t alive = 0;
+    uint32_t i = begin;
+
+#if defined(PARTICLE_SYSTEM_SSE2)
+    const __m128 dt = _mm_set1_ps(elapsedSeconds);
+    const __m128 damp = _mm_set1_ps(damping);
+    const __m128 gx = _mm_set1_ps(impulse.x), gy = _mm_set1_ps(impulse.y), gz = _mm_set1_ps(impulse.z);
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&a.velocityX[i]), gx), damp);
+        const __m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&a.velocityY[i]), gy), damp);
+        const __m128 vz = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&a.velocityZ[i]), gz), damp);
+        _mm_storeu_ps(&a.velocityX[i], vx);
+        _mm_storeu_ps(&a.velocityY[i], vy);
+        _mm_storeu_ps(&a.velocityZ[i], vz);
+        _mm_storeu_ps(&a.positionX[i], _mm_add_ps(_mm_loadu_ps(&a.positionX[i]), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(&a.positionY[i], _mm_add_ps(_mm_loadu_ps(&a.positionY[i]), _mm_mul_ps(vy, dt)));
+        _mm_storeu_ps(&a.positionZ[i], _mm_add_ps(_mm_loadu_ps(&a.positionZ[i]), _mm_mul_ps(vz, dt)));
+
+        const __m128 age = _mm_add_ps(_mm_loadu_ps(&a.age[i]), dt);
+        _mm_storeu_ps(&a.age[i], age);
+        alive += BitCount[_mm_movemask_ps(_mm_cmplt_ps(age, _mm_loadu_ps(&a.lifetime[i])))];
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        const float vx = (a.velocityX[i] + impulse.x) * damping;
+        const float vy = (a.velocityY[i] + impulse.y) * damping;
+        const float vz = (a.velocityZ[i] + impulse.z) * damping;
+        a.velocityX[i] = vx;
+        a.velocityY[i] = vy;
+        a.velocityZ[i] = vz;
+        a.positionX[i] += vx * elapsedSeconds;
+        a.positionY[i] += vy * elapsedSeconds;
+        a.positionZ[i] += vz * elapsedSeconds;
+        a.age[i] += elapsedSeconds;
+        alive += (a.age[i] < a.lifetime[i]) ? 1 : 0;
+    }
+
+    m_blockAlive[begin / BlockSize + 1] = alive;
+}
+
+void ParticleSystem::Update(float elapsedSeconds)
+{
+    DX_PROFILE_SCOPE("ParticleSystem::Update");
+    auto start = std::chrono::steady_clock::now();
+
+    const uint32_t count = m_count;
+    const uint32_t blocks = (count + BlockSize - 1) / BlockSize;
+    m_jobs.ParallelFor(blocks, [&](uint32_t block, uint32_t)
+    {
+        Integrate(block * BlockSize, std::min(count, (block + 1) * BlockSize), elapsedSeconds);
+    });
+
+    // Where each block's survivors start.
+    m_blockAlive[0] = 0;
+    for (uint32_t block = 0; block < blocks; ++block)
+    {
+        m_blockAlive[block + 1] += m_blockAlive[block];
+    }
+
+    const Attributes& from = *m_live;
+    Attributes& to = *m_spare;
+    m_jobs.ParallelFor(blocks, [&](uint32_t block, uint32_t)
+    {
+        uint32_t out = m_blockAlive[block];
+        for (uint32_t i = block * BlockSize, end = std::min(count, (block + 1) * BlockSize); i < end; ++i)
+        {
+            if (!(from.age[i] < from.lifetime[i]))
+            {
+                continue;
+            }
+            to.positionX[out] = from.positionX[i];
+            to.positionY[out] = from.positionY[i];
+            to.positionZ[out] = from.positionZ[i];
+            to.velocityX[out] = from.velocityX[i];
+            to.velocityY[out] = from.velocityY[i];
+            to.velocityZ[out] = from.velocityZ[i];
+            to.age[out] = from.age[i];
+            to.lifetime[out] = from.lifetime[i];
+            to.size[out] = from.size[i];
+            to.color[out] = from.color[i];
+            ++out;
+        }
+    });
+
+    std::swap(m_live, m_spare);
+    m_count = m_blockAlive[blocks];
+
+    m_stats.died = count - m_count;
+    m_stats.alive = m_count;
+    m_stats.updateNanoseconds = ElapsedNanoseconds(start);
+    m_stats.emitted = 0;
+    m_stats.dropped = 0;
+    m_stats.emitNanoseconds = 0;
+}
+
+void ParticleSystem::SortBackToFront(const Matrix44& view)
+{
+    const Attributes& a = *m_live;
+    const uint32_t count = m_count;
+
+    // Farthest first: keys of the negated view depth ascending.
+    m_jobs.ParallelFor((count + BlockSize - 1) / BlockSize, [&](uint32_t block, uint32_t)
+    {
+        for (uint32_t i = block * BlockSize, end = std::min(count, (block + 1) * BlockSize); i < end; ++i)
+        {
+            const float viewZ = a.positionX[i] * view.m[0][2] + a.positionY[i] * view.m[1][2] + a.positionZ[i] * view.m[2][2] + view.m[3][2];
+            m_keys[i] = SortableFloat(viewZ);
+            m_order[i] = i;
+        }
+    });
+
+    // Least significant digit first; each pass is stable, so equal depths
+    // keep storage order.
+    uint32_t histogram[RadixBuckets];
+    for (uint32_t shift = 0; shift < 32; shift += RadixBits)
+    {
+        memset(histogram, 0, sizeof(histogram));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            ++histogram[(m_keys[i] >> shift) & (RadixBuckets - 1)];
+        }
+        uint32_t sum = 0;
+        for (uint32_t& bucket : histogram)
+        {
+            const uint32_t n = bucket;
+            bucket = sum;
+            sum += n;
+        }
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const uint32_t slot = histogram[(m_keys[i] >> shift) & (RadixBuckets - 1)]++;
+            m_sortKeys[slot] = m_keys[i];
+            m_sortOrder[slot] = m_order[i];
+        }
+        std::swap(m_keys, m_sortKeys);
+        std::swap(m_order, m_sortOrder);
+    }
+}
+
+void ParticleSystem::WriteQuads(const Matrix44& view, const uint32_t* order, uint32_t begin, uint32_t end, ColorVertex* dest) const
+{
+    const Attributes& a = *m_live;
+
+    // The camera's right and up axes in world space.
+    const Float3 right = { view.m[0][0], view.m[1][0], view.m[2][0] };
+    const Float3 up = { view.m[0][1], view.m[1][1], view.m[2][1] };
+
+    ColorVertex* out = dest + size_t(begin) * VerticesPerParticle;
+    for (uint32_t i = begin; i < end; ++i, out += VerticesPerParticle)
+    {
+        const uint32_t p = order ? order[i] : i;
+        const Float3 center = { a.positionX[p], a.positionY[p], a.positionZ[p] };
+        const Float3 r = right * a.size[p], u = up * a.size[p];
+
+        const uint32_t c = a.color[p];
+        const float fade = 1.f - a.age[p] / a.lifetime[p];
+        const Float4 color = { (c & 0xFF) / 255.f, ((c >> 8) & 0xFF) / 255.f, ((c >> 16) & 0xFF) / 255.f, (c >> 24) / 255.f * fade };
+
+        const Float3 bottomLeft = center - r - u, topLeft = center - r + u;
+        const Float3 topRight = center + r + u, bottomRight = center + r - u;
+        out[0] = ColorVertex{ bottomLeft, color };
+        out[1] = ColorVertex{ topLeft, color };
+        out[2] = ColorVertex{ topRight, color };
+        out[3] = ColorVertex{ bottomLeft, color };
+        out[4] = ColorVertex{ topRight, color };
+        out[5] = ColorVertex{ bottomRight, color };
+    }
+}
+
+uint32_t ParticleSystem::WriteVertices(const Matrix44& view, ParticleOrder order, ColorVertex* dest)
+{
+    DX_PROFILE_SCOPE("ParticleSystem::WriteVertices");
+    auto start = std::chrono::steady_clock::now();
+
+    const uint32_t* sorted = nullptr;
+    if (order == ParticleOrder::BackToFront)
+    {
+        SortBackToFront(view);
+        sorted = m_order.data();
+    }
+
+    const uint32_t count = m_count;
+    m_jobs.ParallelFor((count + BlockSize - 1) / BlockSize, [&](uint32_t block, uint32_t)
+    {
+        WriteQuads(view, sorted, block * BlockSize, std::min(count, (block + 1) * BlockSize), dest);
+    });
+
+    m_stats.vertexNanoseconds = ElapsedNanoseconds(start);
+    return count * VerticesPerParticle;
+}
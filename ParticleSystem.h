@@ -0,0 +1,132 @@
+//
+// ParticleSystem.h - Data-oriented particles: structure-of-arrays storage,
+// SIMD integration and jobified emit, update, compaction and vertex output
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "JobSystem.h"
+#include "MeshData.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace DX
+{
+    struct ParticleEmitter
+    {
+        Float3  position;           // Centre of the spawn box.
+        Float3  extents;            // Half-size of the spawn box.
+        Float3  velocity;           // Mean launch velocity.
+        Float3  velocitySpread;     // Each component varies by up to this much either way.
+        float   lifetime;           // Seconds.
+        float   lifetimeSpread;     // Varies by up to this much either way.
+        float   size;               // Half-width of each quad.
+        Float4  color;              // Alpha fades to zero over the lifetime.
+    };
+
+    enum class ParticleOrder : uint8_t
+    {
+        Unsorted,                   // Storage order; right for additive blending.
+        BackToFront,                // By view depth, for alpha blending.
+    };
+
+    struct ParticleStats
+    {
+        uint32_t alive;
+        uint32_t emitted;           // Since the last Update.
+        uint32_t died;              // In the last Update.
+        uint32_t dropped;           // Emits refused since the last Update because the system was full.
+        uint64_t emitNanoseconds;
+        uint64_t updateNanoseconds; // Integration and compaction.
+        uint64_t vertexNanoseconds; // The last WriteVertices, sort included.
+    };
+
+    // Particles live in one array per attribute, capacity long, so the
+    // update streams through memory four particles at a time with SSE2.
+    // Update integrates and counts the survivors of each block of
+    // particles in parallel, then copies them, in order, into a second set
+    // of arrays that becomes the live one; nothing moves twice and nothing
+    // allocates after construction.
+    //
+    // Random values come from a hash of a running emit counter, so the
+    // particles do not depend on the thread count.
+    class ParticleSystem
+    {
+    public:
+        ParticleSystem(JobSystem& jobs, uint32_t capacity);
+
+        ParticleSystem(ParticleSystem const&) = delete;
+        ParticleSystem& operator=(ParticleSystem const&) = delete;
+
+        // Applied every Update: velocity += gravity * dt, then scaled by
+        // (1 - drag * dt).
+        void SetForces(const Float3& gravity, float drag);
+
+        // Spawns count particles, fewer if the system fills up. Returns how
+        // many it spawned.
+        uint32_t Emit(const ParticleEmitter& emitter, uint32_t count);
+
+        // Ages and moves every particle, then drops those past their
+        // lifetime, keeping the rest in order.
+        void Update(float elapsedSeconds);
+
+        // Writes a camera-facing quad per particle, as two triangles of
+        // VerticesPerParticle ColorVertex, for one non-indexed draw. dest
+        // must hold GetCount() * VerticesPerParticle vertices. Returns the
+        // number of vertices written.
+        uint32_t WriteVertices(const Matrix44& view, ParticleOrder order, ColorVertex* dest);
+
+        void Clear();
+
+        uint32_t GetCount() const                   { return m_count; }
+        uint32_t GetCapacity() const                { return m_capacity; }
+        const ParticleStats& GetStats() const       { return m_stats; }
+
+        const float* GetPositionsX() const          { return m_live->positionX.data(); }
+        const float* GetPositionsY() const          { return m_live->positionY.data(); }
+        const float* GetPositionsZ() const          { return m_live->positionZ.data(); }
+
+        static const uint32_t VerticesPerParticle = 6;
+
+    private:
+        struct Attributes
+        {
+            std::vector<float>      positionX, positionY, positionZ;
+            std::vector<float>      velocityX, velocityY, velocityZ;
+            std::vector<float>      age;
+            std::vector<float>      lifetime;
+            std::vector<float>      size;
+            std::vector<uint32_t>   color;      // RGBA8, R in the low byte.
+
+            void Resize(uint32_t capacity);
+        };
+
+        void Integrate(uint32_t begin, uint32_t end, float elapsedSeconds);
+        void WriteQuads(const Matrix44& view, const uint32_t* order, uint32_t begin, uint32_t end, ColorVertex* dest) const;
+        void SortBackToFront(const Matrix44& view);
+
+        JobSystem&              m_jobs;
+        uint32_t                m_capacity;
+        uint32_t                m_count;
+        uint32_t                m_emitCounter;
+        Float3                  m_gravity;
+        float                   m_drag;
+
+        Attributes              m_attributes[2];
+        Attributes*             m_live;
+        Attributes*             m_spare;
+        std::vector<uint32_t>   m_blockAlive;
+
+        // Depth keys and particle indices for the back-to-front sort, and
+        // their radix-sort partners.
+        std::vector<uint32_t>   m_keys;
+        std::vector<uint32_t>   m_order;
+        std::vector<uint32_t>   m_sortKeys;
+        std::vector<uint32_t>   m_sortOrder;
+
+        ParticleStats           m_stats;
+    };
+}
@@ -0,0 +1,278 @@
+//
+// ProceduralGeometry.cpp
+//
+
+#include "ProceduralGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+using namespace DX;
+
+namespace
+{
+    const float Pi = 3.14159265359f;
+
+    // Converts between right and left handed winding, as DirectXTK does.
+    void ReverseWinding(MeshData& mesh)
+    {
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            std::swap(mesh.indices[i], mesh.indices[i + 2]);
+        }
+
+        for (MeshVertex& v : mesh.vertices)
+        {
+            v.textureCoordinate.x = 1.f - v.textureCoordinate.x;
+        }
+    }
+
+    void InvertNormals(MeshData& mesh)
+    {
+        for (MeshVertex& v : mesh.vertices)
+        {
+            v.normal = -v.normal;
+        }
+    }
+
+    void CheckIndexRange(const MeshData& mesh)
+    {
+        if (mesh.vertices.size() > 0xFFFF)
+        {
+            throw std::out_of_range("Too many vertices for 16-bit index buffer");
+        }
+    }
+
+    Float3 Multiply(const Float3& a, const Float3& b)
+    {
+        return Float3{ a.x * b.x, a.y * b.y, a.z * b.z };
+    }
+
+    float Bezier(float p0, float p1, float p2, float p3, float t)
+    {
+        float s = 1.f - t;
+        return s * s * s * p0 + 3.f * s * s * t * p1 + 3.f * s * t * t * p2 + t * t * t * p3;
+    }
+}
+
+void DX::CreateBoxGeometry(MeshData& mesh, const Float3& size, bool rhcoords, bool invertn)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.subsets.clear();
+
+    static const Float3 faceNormals[6] =
+    {
+        { 0, 0, 1 }, { 0, 0, -1 }, { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 },
+    };
+
+    static const Float2 textureCoordinates[4] =
+    {
+        { 1, 0 }, { 1, 1 }, { 0, 1 }, { 0, 0 },
+    };
+
+    Float3 tsize = size * 0.5f;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        Float3 normal = faceNormals[i];
+        Float3 basis = (i >= 4) ? Float3{ 0, 0, 1 } : Float3{ 0, 1, 0 };
+        Float3 side1 = normal.Cross(basis);
+        Float3 side2 = normal.Cross(side1);
+
+        uint16_t vbase = uint16_t(mesh.vertices.size());
+        const uint16_t faceIndices[6] = { 0, 1, 2, 0, 2, 3 };
+        for (uint16_t index : faceIndices)
+        {
+            mesh.indices.push_back(uint16_t(vbase + index));
+        }
+
+        mesh.vertices.push_back(MeshVertex{ Multiply(normal - side1 - side2, tsize), normal, textureCoordinates[0] });
+        mesh.vertices.push_back(MeshVertex{ Multiply(normal - side1 + side2, tsize), normal, textureCoordinates[1] });
+        mesh.vertices.push_back(MeshVertex{ Multiply(normal + side1 + side2, tsize), normal, textureCoordinates[2] });
+        mesh.vertices.push_back(MeshVertex{ Multiply(normal + side1 - side2, tsize), normal, textureCoordinates[3] });
+    }
+
+    if (!rhcoords)
+        ReverseWinding(mesh);
+
+    if (invertn)
+        InvertNormals(mesh);
+
+    mesh.subsets.push_back(MeshSubset{ 0, 0, uint32_t(mesh.indices.size()) });
+    mesh.ComputeBounds();
+}
+
+void DX::CreateSphereGeometry(MeshData& mesh, float diameter, uint32_t tessellation, bool rhcoords, bool invertn)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.subsets.clear();
+
+    if (tessellation < 3)
+        throw std::out_of_range("tesselation parameter out of range");
+
+    uint32_t verticalSegments = tessellation;
+    uint32_t horizontalSegments = tessellation * 2;
+    float radius = diameter / 2;
+
+    for (uint32_t i = 0; i <= verticalSegments; ++i)
+    {
+        float v = 1 - float(i) / verticalSegments;
+        float latitude = (i * Pi / verticalSegments) - Pi / 2;
+        float dy = std::sin(latitude);
+        float dxz = std::cos(latitude);
+
+        for (uint32_t j = 0; j <= horizontalSegments; ++j)
+        {
+            float u = float(j) / horizontalSegments;
+            float longitude = j * 2 * Pi / horizontalSegments;
+            float dx = std::sin(longitude) * dxz;
+            float dz = std::cos(longitude) * dxz;
+
+            Float3 normal = { dx, dy, dz };
+            mesh.vertices.push_back(MeshVertex{ normal * radius, normal, Float2{ u, v } });
+        }
+    }
+
+    uint32_t stride = horizontalSegments + 1;
+
+    for (uint32_t i = 0; i < verticalSegments; ++i)
+    {
+        for (uint32_t j = 0; j <= horizontalSegments; ++j)
+        {
+            uint32_t nextI = i + 1;
+            uint32_t nextJ = (j + 1) % stride;
+
+            mesh.indices.push_back(uint16_t(i * stride + j));
+            mesh.indices.push_back(uint16_t(i * stride + nextJ));
+            mesh.indices.push_back(uint16_t(nextI * stride + j));
+
+            mesh.indices.push_back(uint16_t(i * stride + nextJ));
+            mesh.indices.push_back(uint16_t(nextI * stride + nextJ));
+            mesh.indices.push_back(uint16_t(nextI * stride + j));
+        }
+    }
+
+    CheckIndexRange(mesh);
+
+    if (!rhcoords)
+        ReverseWinding(mesh);
+
+    if (invertn)
+        InvertNormals(mesh);
+
+    mesh.subsets.push_back(MeshSubset{ 0, 0, uint32_t(mesh.indices.size()) });
+    mesh.ComputeBounds();
+}
+
+void DX::CreateTeapotGeometry(MeshData& mesh, float size, uint32_t tessellation, bool rhcoords)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    mesh.subsets.clear();
+
+    if (tessellation < 1)
+        throw std::out_of_range("tesselation parameter out of range");
+
+    // (radius, height) control points of the rotational teapot patches, from
+    // the lid knob down to the base.
+    static const float profile[][4][2] =
+    {
+        { { 0.f, 3.15f }, { 0.8f, 3.15f }, { 0.f, 2.85f }, { 0.2f, 2.7f } },
+        { { 0.2f, 2.7f }, { 0.4f, 2.55f }, { 1.3f, 2.55f }, { 1.3f, 2.4f } },
+        { { 1.4f, 2.4f }, { 1.3375f, 2.53125f }, { 1.4375f, 2.53125f }, { 1.5f, 2.4f } },
+        { { 1.5f, 2.4f }, { 1.75f, 1.875f }, { 2.f, 1.35f }, { 2.f, 0.9f } },
+        { { 2.f, 0.9f }, { 2.f, 0.45f }, { 1.5f, 0.225f }, { 1.5f, 0.15f } },
+        { { 1.5f, 0.15f }, { 0.f, 0.15f }, { 0.f, 0.f }, { 0.f, 0.f } },
+    };
+
+    const uint32_t curveCount = sizeof(profile) / sizeof(profile[0]);
+    const uint32_t ringSegments = tessellation * 4;
+    const float scale = size / 3.15f;
+    const float centerY = 3.15f / 2;
+
+    for (uint32_t c = 0; c < curveCount; ++c)
+    {
+        const float (*p)[2] = profile[c];
+        uint32_t rowBase = uint32_t(mesh.vertices.size());
+
+        for (uint32_t i = 0; i <= tessellation; ++i)
+        {
+            float t = float(i) / tessellation;
+            float r = Bezier(p[0][0], p[1][0], p[2][0], p[3][0], t);
+            float y = Bezier(p[0][1], p[1][1], p[2][1], p[3][1], t);
+
+            // Profile tangent by central difference; the curves run top to
+            // bottom, so (-dy, dr) points away from the axis.
+            float e = 1.f / (tessellation * 8);
+            float t0 = std::max(0.f, t - e), t1 = std::min(1.f, t + e);
+            float dr = Bezier(p[0][0], p[1][0], p[2][0], p[3][0], t1) - Bezier(p[0][0], p[1][0], p[2][0], p[3][0], t0);
+            float dy = Bezier(p[0][1], p[1][1], p[2][1], p[3][1], t1) - Bezier(p[0][1], p[1][1], p[2][1], p[3][1], t0);
+
+            for (uint32_t j = 0; j <= ringSegments; ++j)
+            {
+                float u = float(j) / ringSegments;
+                float angle = u * 2 * Pi;
+                float sa = std::sin(angle), ca = std::cos(angle);
+
+                Float3 position = { r * ca * scale, (y - centerY) * scale, r * sa * scale };
+                Float3 normal = Float3{ -dy * ca, dr, -dy * sa }.Normalized();
+                mesh.vertices.push_back(MeshVertex{ position, normal, Float2{ u, t } });
+            }
+        }
+
+        uint32_t stride = ringSegments + 1;
+        for (uint32_t i = 0; i < tessellation; ++i)
+        {
+            for (uint32_t j = 0; j < ringSegments; ++j)
+            {
+                uint32_t a = rowBase + i * stride + j;
+                uint32_t b = a + 1;
+                uint32_t d = a + stride;
+                uint32_t e = d + 1;
+
+                mesh.indices.push_back(uint16_t(a));
+                mesh.indices.push_back(uint16_t(b));
+                mesh.indices.push_back(uint16_t(d));
+
+                mesh.indices.push_back(uint16_t(b));
+                mesh.indices.push_back(uint16_t(e));
+                mesh.indices.push_back(uint16_t(d));
+            }
+        }
+    }
+
+    CheckIndexRange(mesh);
+
+    if (!rhcoords)
+        ReverseWinding(mesh);
+
+    mesh.subsets.push_back(MeshSubset{ 0, 0, uint32_t(mesh.indices.size()) });
+    mesh.ComputeBounds();
+}
+
+void DX::CreateHudGeometry(std::vector<ColorVertex>& vertices, std::vector<uint16_t>& indices)
+{
+    const Float4 greenYellow = { 0.678431392f, 1.f, 0.184313729f, 1.f };
+    const Float4 green = { 0.f, 0.501960814f, 0.f, 1.f };
+
+    vertices.clear();
+    indices.clear();
+
+    // One triangle per screen quadrant; sx/sy mirror the upper-left one.
+    const float signs[4][2] = { { -1, 1 }, { 1, 1 }, { -1, -1 }, { 1, -1 } };
+    for (const auto& s : signs)
+    {
+        vertices.push_back(ColorVertex{ Float3{ 0.5f * s[0], 0.5f * s[1], 0.5f }, greenYellow });
+        vertices.push_back(ColorVertex{ Float3{ 1.0f * s[0], 0.75f * s[1], 0.5f }, green });
+        vertices.push_back(ColorVertex{ Float3{ 0.75f * s[0], 1.f * s[1], 0.5f }, green });
+    }
+
+    for (uint16_t i = 0; i < uint16_t(vertices.size()); ++i)
+    {
+        indices.push_back(i);
+    }
+}
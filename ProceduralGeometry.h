@@ -0,0 +1,24 @@
+//
+// ProceduralGeometry.h - Portable versions of the GeometricPrimitive shapes
+// the scene uses, producing CPU-side vertex and index data
+//
+
+#pragma once
+
+#include "MeshData.h"
+
+namespace DX
+{
+    // The box and sphere follow DirectXTK's GeometricPrimitive tessellation so
+    // the headless scene pushes the same vertex and index counts as the game.
+    void CreateBoxGeometry(MeshData& mesh, const Float3& size, bool rhcoords = true, bool invertn = false);
+    void CreateSphereGeometry(MeshData& mesh, float diameter = 1, uint32_t tessellation = 16, bool rhcoords = true, bool invertn = false);
+
+    // Lathe of the Utah teapot's body and lid profile curves. The spout and
+    // handle patches are omitted, so it is a stand-in of the right size and
+    // comparable triangle count rather than an exact copy.
+    void CreateTeapotGeometry(MeshData& mesh, float size = 1, uint32_t tessellation = 8, bool rhcoords = true);
+
+    // The four animated HUD triangles drawn by Game, in model space.
+    void CreateHudGeometry(std::vector<ColorVertex>& vertices, std::vector<uint16_t>& indices);
+}
@@ -0,0 +1,307 @@
+//
+// Profiler.cpp
+//
+
+#include "Profiler.h"
+#include "BinaryFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace DX;
+
+namespace
+{
+    struct ThreadBuffer
+    {
+        std::vector<ProfileEvent>   events;     // EventsPerThread entries, used as a ring.
+        std::atomic<uint64_t>       written;
+        uint32_t                    depth;
+        uint32_t                    id;
+        std::string                 name;
+    };
+
+    struct FrameMark
+    {
+        uint64_t start;
+        uint64_t end;
+    };
+
+    struct ClockOrigin
+    {
+        uint64_t                                ticks;
+        std::chrono::steady_clock::time_point   time;
+    };
+
+    const uint32_t EventMask = Profiler::EventsPerThread - 1;
+    static_assert((Profiler::EventsPerThread & EventMask) == 0, "EventsPerThread must be a power of two");
+
+    std::atomic<bool>                           g_enabled(true);
+    std::mutex                                  g_threadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>>  g_threads;
+    thread_local ThreadBuffer*                  t_buffer = nullptr;
+
+    const ClockOrigin                           g_origin = { Profiler::Now(), std::chrono::steady_clock::now() };
+
+    // Frame state, owned by the thread that calls BeginFrame/EndFrame.
+    FrameMark                                   g_frames[Profiler::MaxFrames];
+    uint64_t                                    g_frameCount = 0;
+    uint64_t                                    g_frameStart = 0;
+    double                                      g_lastFrameMilliseconds = 0;
+    std::vector<ProfileEvent>                   g_frameEvents;
+    std::vector<ProfileSummaryEntry>            g_summary;
+
+    ThreadBuffer* GetThreadBuffer()
+    {
+        if (!t_buffer)
+        {
+            std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+            buffer->events.resize(Profiler::EventsPerThread);
+            buffer->written.store(0, std::memory_order_relaxed);
+            buffer->depth = 0;
+
+            std::lock_guard<std::mutex> lock(g_threadsMutex);
+            buffer->id = uint32_t(g_threads.size());
+            buffer->name = "Thread " + std::to_string(buffer->id);
+            t_buffer = buffer.get();
+            g_threads.push_back(std::move(buffer));
+        }
+        return t_buffer;
+    }
+
+    void AppendEscaped(std::string& out, const char* text)
+    {
+        for (; *text; ++text)
+        {
+            char c = *text;
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if (uint8_t(c) >= 0x20)
+            {
+                out += c;
+            }
+        }
+    }
+
+    void AppendCompleteEvent(std::string& out, const char* name, uint32_t tid, double ts, double dur)
+    {
+        char numbers[128];
+        out += "{\"name\":\"";
+        AppendEscaped(out, name);
+        std::snprintf(numbers, sizeof(numbers), "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+            tid, ts, dur);
+        out += numbers;
+    }
+}
+
+double Profiler::GetTicksPerSecond()
+{
+#if defined(DX_PROFILER_RDTSC)
+    // Too short a baseline gives a noisy rate, so the first call may wait.
+    const auto minimum = std::chrono::milliseconds(10);
+    while (std::chrono::steady_clock::now() - g_origin.time < minimum)
+    {
+        std::this_thread::yield();
+    }
+
+    uint64_t ticks = Now();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - g_origin.time).count();
+    return double(ticks - g_origin.ticks) / seconds;
+#else
+    return 1e9;
+#endif
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Profiler::IsEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ThreadBuffer* buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(g_threadsMutex);
+    buffer->name = name;
+}
+
+void Profiler::BeginFrame()
+{
+    GetThreadBuffer();
+    g_frameStart = Now();
+}
+
+void Profiler::EndFrame()
+{
+    const uint64_t frameEnd = Now();
+    g_frames[g_frameCount % MaxFrames] = FrameMark{ g_frameStart, frameEnd };
+    ++g_frameCount;
+
+    // Scopes are written as they close, so walking back from the newest one
+    // reaches everything that closed this frame and stops at the first that
+    // closed before it began.
+    ThreadBuffer* buffer = GetThreadBuffer();
+    uint64_t written = buffer->written.load(std::memory_order_relaxed);
+    uint64_t oldest = written > EventsPerThread ? written - EventsPerThread : 0;
+
+    g_frameEvents.clear();
+    for (uint64_t i = written; i > oldest; --i)
+    {
+        const ProfileEvent& event = buffer->events[(i - 1) & EventMask];
+        if (event.end < g_frameStart)
+        {
+            break;
+        }
+        if (event.start >= g_frameStart)
+        {
+            g_frameEvents.push_back(event);
+        }
+    }
+
+    std::sort(g_frameEvents.begin(), g_frameEvents.end(), [](const ProfileEvent& a, const ProfileEvent& b)
+    {
+        return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+    });
+
+    const double millisecondsPerTick = 1000.0 / GetTicksPerSecond();
+
+    g_summary.clear();
+    for (const ProfileEvent& event : g_frameEvents)
+    {
+        auto entry = std::find_if(g_summary.begin(), g_summary.end(), [&](const ProfileSummaryEntry& e)
+        {
+            return e.name == event.name && e.depth == event.depth;
+        });
+
+        if (entry == g_summary.end())
+        {
+            g_summary.push_back(ProfileSummaryEntry{ event.name, event.depth, 0, 0 });
+            entry = g_summary.end() - 1;
+        }
+
+        ++entry->calls;
+        entry->milliseconds += double(event.end - event.start) * millisecondsPerTick;
+    }
+
+    g_lastFrameMilliseconds = double(frameEnd - g_frameStart) * millisecondsPerTick;
+}
+
+uint64_t Profiler::GetFrameCount()
+{
+    return g_frameCount;
+}
+
+double Profiler::GetLastFrameMilliseconds()
+{
+    return g_lastFrameMilliseconds;
+}
+
+const std::vector<ProfileSummaryEntry>& Profiler::GetLastFrameSummary()
+{
+    return g_summary;
+}
+
+void Profiler::WriteChromeTrace(const std::string& path, uint32_t frameCount)
+{
+    uint64_t frames = std::min<uint64_t>(std::min<uint64_t>(frameCount, g_frameCount), MaxFrames);
+
+    std::string json;
+    json.reserve(1 << 20);
+    json += "{\"traceEvents\":[\n";
+
+    if (frames > 0)
+    {
+        const uint64_t firstFrame = g_frameCount - frames;
+        const uint64_t first = g_frames[firstFrame % MaxFrames].start;
+        const uint64_t last = g_frames[(g_frameCount - 1) % MaxFrames].end;
+        const double microsecondsPerTick = 1e6 / GetTicksPerSecond();
+
+        auto toMicroseconds = [&](uint64_t ticks) { return double(ticks - first) * microsecondsPerTick; };
+
+        std::lock_guard<std::mutex> lock(g_threadsMutex);
+
+        // Frames get a track of their own above the threads.
+        const uint32_t frameTrack = uint32_t(g_threads.size());
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(frameTrack)
+            + ",\"args\":{\"name\":\"Frames\"}},\n";
+        json += "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(frameTrack)
+            + ",\"args\":{\"sort_index\":-1}},\n";
+
+        for (uint64_t f = firstFrame; f < g_frameCount; ++f)
+        {
+            const FrameMark& mark = g_frames[f % MaxFrames];
+            std::string name = "Frame " + std::to_string(f);
+            AppendCompleteEvent(json, name.c_str(), frameTrack,
+                toMicroseconds(mark.start), double(mark.end - mark.start) * microsecondsPerTick);
+        }
+
+        for (const auto& thread : g_threads)
+        {
+            json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread->id) + ",\"args\":{\"name\":\"";
+            AppendEscaped(json, thread->name.c_str());
+            json += "\"}},\n";
+
+            uint64_t written = thread->written.load(std::memory_order_acquire);
+            uint64_t oldest = written > EventsPerThread ? written - EventsPerThread : 0;
+
+            for (uint64_t i = oldest; i < written; ++i)
+            {
+                const ProfileEvent& event = thread->events[i & EventMask];
+                if (event.start >= first && event.end <= last)
+                {
+                    AppendCompleteEvent(json, event.name, thread->id,
+                        toMicroseconds(event.start), double(event.end - event.start) * microsecondsPerTick);
+                }
+            }
+        }
+    }
+
+    // Drop the trailing comma; the format does not allow one.
+    if (json.size() >= 2 && json[json.size() - 2] == ',')
+    {
+        json.erase(json.size() - 2, 1);
+    }
+    json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+    WriteBinaryFile(path, json.data(), json.size());
+}
+
+ProfileScope::ProfileScope(const char* name) :
+    m_name(nullptr),
+    m_start(0),
+    m_depth(0)
+{
+    if (g_enabled.load(std::memory_order_relaxed))
+    {
+        ThreadBuffer* buffer = GetThreadBuffer();
+        m_name = name;
+        m_depth = buffer->depth++;
+        m_start = Profiler::Now();
+    }
+}
+
+ProfileScope::~ProfileScope()
+{
+    if (m_name)
+    {
+        uint64_t end = Profiler::Now();
+        ThreadBuffer* buffer = t_buffer;
+        --buffer->depth;
+
+        uint64_t written = buffer->written.load(std::memory_order_relaxed);
+        buffer->events[written & EventMask] = ProfileEvent{ m_name, m_start, end, m_depth };
+        buffer->written.store(written + 1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,113 @@
+//
+// Profiler.h - Scoped CPU timing markers recorded per thread, summarised per
+// frame and exportable as a Chrome trace
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// The time stamp counter is the cheapest clock on x86; everything else falls
+// back to steady_clock.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DX_PROFILER_RDTSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+namespace DX
+{
+    // One closed scope. Names must be string literals or otherwise outlive
+    // the profiler; only the pointer is stored.
+    struct ProfileEvent
+    {
+        const char* name;
+        uint64_t    start;
+        uint64_t    end;
+        uint32_t    depth;      // Enclosing scopes open on the same thread.
+    };
+
+    // Scopes of the last frame on the thread that calls BeginFrame/EndFrame,
+    // merged by name and depth, in the order they first opened.
+    struct ProfileSummaryEntry
+    {
+        const char* name;
+        uint32_t    depth;
+        uint32_t    calls;
+        double      milliseconds;
+    };
+
+    // Every thread records into its own ring of the most recent
+    // EventsPerThread scopes, so recording takes no locks. A scope costs two
+    // clock reads and one ring write. The rings are read back by EndFrame
+    // (for the calling thread only) and WriteChromeTrace (all threads); the
+    // latter must run between frames, while no other thread is recording.
+    namespace Profiler
+    {
+        const uint32_t EventsPerThread = 1u << 15;
+        const uint32_t MaxFrames = 256;
+
+        inline uint64_t Now()
+        {
+#if defined(DX_PROFILER_RDTSC)
+            return __rdtsc();
+#else
+            return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        // Ticks of Now() per second. With the TSC this is measured against
+        // steady_clock since the first call, so it sharpens as the run goes on.
+        double GetTicksPerSecond();
+
+        // Disabled scopes cost one branch. Enabled by default.
+        void SetEnabled(bool enabled);
+        bool IsEnabled();
+
+        // Names the calling thread in exported traces. Copied.
+        void SetThreadName(const char* name);
+
+        void BeginFrame();
+        void EndFrame();
+
+        uint64_t GetFrameCount();
+        double GetLastFrameMilliseconds();
+        const std::vector<ProfileSummaryEntry>& GetLastFrameSummary();
+
+        // Writes the last frameCount completed frames, from every thread, as
+        // Chrome about:tracing / Perfetto JSON. Frames older than MaxFrames,
+        // or scopes already overwritten in a thread's ring, are dropped.
+        // Throws std::runtime_error if the file cannot be written.
+        void WriteChromeTrace(const std::string& path, uint32_t frameCount);
+    }
+
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char* name);
+        ~ProfileScope();
+
+        ProfileScope(ProfileScope const&) = delete;
+        ProfileScope& operator=(ProfileScope const&) = delete;
+
+    private:
+        const char* m_name;     // Null when the profiler was disabled at open.
+        uint64_t    m_start;
+        uint32_t    m_depth;
+    };
+}
+
+#define DX_PROFILE_JOIN2(a, b) a##b
+#define DX_PROFILE_JOIN(a, b) DX_PROFILE_JOIN2(a, b)
+
+// Times the rest of the enclosing block.
+#define DX_PROFILE_SCOPE(name) DX::ProfileScope DX_PROFILE_JOIN(profileScope_, __LINE__)(name)
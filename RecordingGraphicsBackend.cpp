@@ -0,0 +1,483 @@
+//
+// RecordingGraphicsBackend.cpp
+//
+
+#include "RecordingGraphicsBackend.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace DX;
+
+namespace
+{
+    // Records are buffered and written in large chunks so recording a frame
+    // does not turn every call into a file write.
+    const size_t FlushThreshold = 1 << 20;
+
+    uint32_t SubresourceCount(const TextureDesc& desc)
+    {
+        return desc.mipLevels * desc.arraySize;
+    }
+}
+
+RecordingGraphicsBackend::RecordingGraphicsBackend(IGraphicsBackend& inner, const char* path) :
+    m_inner(inner),
+    m_file(path, std::ios::out | std::ios::binary | std::ios::trunc),
+    m_bytesWritten(0)
+{
+    if (!m_file)
+    {
+        throw std::runtime_error("RecordingGraphicsBackend");
+    }
+
+    m_pending.reserve(FlushThreshold);
+
+    CommandStreamHeader header = { CommandStreamMagic, CommandStreamVersion };
+    Write(header.magic);
+    Write(header.version);
+}
+
+RecordingGraphicsBackend::~RecordingGraphicsBackend()
+{
+    Flush();
+}
+
+template<typename T>
+void RecordingGraphicsBackend::Write(const T& value)
+{
+    WriteBytes(&value, sizeof(T));
+}
+
+void RecordingGraphicsBackend::WriteBytes(const void* data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    m_pending.insert(m_pending.end(), bytes, bytes + size);
+}
+
+void RecordingGraphicsBackend::Flush()
+{
+    if (m_pending.empty())
+    {
+        return;
+    }
+
+    m_file.write(reinterpret_cast<const char*>(m_pending.data()), std::streamsize(m_pending.size()));
+    m_bytesWritten += m_pending.size();
+    m_pending.clear();
+}
+
+BufferHandle RecordingGraphicsBackend::CreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+    BufferHandle handle = m_inner.CreateBuffer(desc, initialData);
+
+    Write(CommandOp::CreateBuffer);
+    Write(handle);
+    Write(desc.usage);
+    Write(desc.sizeBytes);
+    Write(desc.strideBytes);
+    Write(uint8_t(desc.dynamic));
+    Write(uint8_t(initialData != nullptr));
+    if (initialData)
+    {
+        WriteBytes(initialData, desc.sizeBytes);
+    }
+
+    return handle;
+}
+
+TextureHandle RecordingGraphicsBackend::CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData)
+{
+    TextureHandle handle = m_inner.CreateTexture(desc, initialData);
+
+    Write(CommandOp::CreateTexture);
+    Write(handle);
+    Write(desc.width);
+    Write(desc.height);
+    Write(desc.mipLevels);
+    Write(desc.arraySize);
+    Write(desc.format);
+    Write(uint8_t(desc.cubemap));
+    Write(uint8_t(initialData != nullptr));
+    if (initialData)
+    {
+        for (uint32_t i = 0; i < SubresourceCount(desc); ++i)
+        {
+            Write(initialData[i].rowPitch);
+            Write(initialData[i].slicePitch);
+            WriteBytes(initialData[i].data, initialData[i].slicePitch);
+        }
+    }
+
+    return handle;
+}
+
+PipelineHandle RecordingGraphicsBackend::CreatePipelineState(const PipelineDesc& desc)
+{
+    PipelineHandle handle = m_inner.CreatePipelineState(desc);
+
+    Write(CommandOp::CreatePipelineState);
+    Write(handle);
+    Write(desc.layout);
+    Write(desc.program);
+    Write(desc.blend);
+    Write(desc.depth);
+    Write(desc.cull);
+
+    return handle;
+}
+
+void RecordingGraphicsBackend::DestroyBuffer(BufferHandle buffer)
+{
+    Write(CommandOp::DestroyBuffer);
+    Write(buffer);
+    m_inner.DestroyBuffer(buffer);
+}
+
+void RecordingGraphicsBackend::DestroyTexture(TextureHandle texture)
+{
+    Write(CommandOp::DestroyTexture);
+    Write(texture);
+    m_inner.DestroyTexture(texture);
+}
+
+void RecordingGraphicsBackend::DestroyPipelineState(PipelineHandle pipeline)
+{
+    Write(CommandOp::DestroyPipelineState);
+    Write(pipeline);
+    m_inner.DestroyPipelineState(pipeline);
+}
+
+void RecordingGraphicsBackend::UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes)
+{
+    Write(CommandOp::UpdateBuffer);
+    Write(buffer);
+    Write(sizeBytes);
+    WriteBytes(data, sizeBytes);
+    m_inner.UpdateBuffer(buffer, data, sizeBytes);
+}
+
+void RecordingGraphicsBackend::BeginFrame()
+{
+    Write(CommandOp::BeginFrame);
+    m_inner.BeginFrame();
+}
+
+void RecordingGraphicsBackend::EndFrame()
+{
+    Write(CommandOp::EndFrame);
+    m_inner.EndFrame();
+
+    if (m_pending.size() >= FlushThreshold)
+    {
+        Flush();
+    }
+}
+
+void RecordingGraphicsBackend::Clear(const float color[4], float depth)
+{
+    Write(CommandOp::Clear);
+    WriteBytes(color, sizeof(float) * 4);
+    Write(depth);
+    m_inner.Clear(color, depth);
+}
+
+void RecordingGraphicsBackend::SetViewport(uint32_t width, uint32_t height)
+{
+    Write(CommandOp::SetViewport);
+    Write(width);
+    Write(height);
+    m_inner.SetViewport(width, height);
+}
+
+void RecordingGraphicsBackend::SetPipelineState(PipelineHandle pipeline)
+{
+    Write(CommandOp::SetPipelineState);
+    Write(pipeline);
+    m_inner.SetPipelineState(pipeline);
+}
+
+void RecordingGraphicsBackend::SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes)
+{
+    Write(CommandOp::SetVertexBuffer);
+    Write(buffer);
+    Write(strideBytes);
+    Write(offsetBytes);
+    m_inner.SetVertexBuffer(buffer, strideBytes, offsetBytes);
+}
+
+void RecordingGraphicsBackend::SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes)
+{
+    Write(CommandOp::SetIndexBuffer);
+    Write(buffer);
+    Write(offsetBytes);
+    m_inner.SetIndexBuffer(buffer, offsetBytes);
+}
+
+void RecordingGraphicsBackend::SetConstantBuffer(uint32_t slot, BufferHandle buffer)
+{
+    Write(CommandOp::SetConstantBuffer);
+    Write(slot);
+    Write(buffer);
+    m_inner.SetConstantBuffer(slot, buffer);
+}
+
+void RecordingGraphicsBackend::SetTexture(uint32_t slot, TextureHandle texture)
+{
+    Write(CommandOp::SetTexture);
+    Write(slot);
+    Write(texture);
+    m_inner.SetTexture(slot, texture);
+}
+
+void RecordingGraphicsBackend::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+    Write(CommandOp::Draw);
+    Write(vertexCount);
+    Write(startVertex);
+    m_inner.Draw(vertexCount, startVertex);
+}
+
+void RecordingGraphicsBackend::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+    Write(CommandOp::DrawIndexed);
+    Write(indexCount);
+    Write(startIndex);
+    Write(baseVertex);
+    m_inner.DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+//--------------------------------------------------------------------------------------
+// Replay
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+    class StreamReader
+    {
+    public:
+        StreamReader(const std::vector<uint8_t>& data) : m_data(data), m_offset(0) {}
+
+        bool AtEnd() const { return m_offset >= m_data.size(); }
+
+        template<typename T> T Read()
+        {
+            T value;
+            std::memcpy(&value, Bytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        const uint8_t* Bytes(size_t size)
+        {
+            if (size > m_data.size() - m_offset)
+            {
+                throw std::runtime_error("ReplayCommandStream: truncated stream");
+            }
+
+            const uint8_t* result = m_data.data() + m_offset;
+            m_offset += size;
+            return result;
+        }
+
+    private:
+        const std::vector<uint8_t>& m_data;
+        size_t m_offset;
+    };
+
+    uint32_t Remap(const std::unordered_map<uint32_t, uint32_t>& handles, uint32_t handle)
+    {
+        auto it = handles.find(handle);
+        return it == handles.end() ? InvalidHandle : it->second;
+    }
+}
+
+uint32_t DX::ReplayCommandStream(const char* path, IGraphicsBackend& target)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        throw std::runtime_error("ReplayCommandStream");
+    }
+
+    std::vector<uint8_t> data(size_t(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(data.data()), std::streamsize(data.size()));
+    if (!file)
+    {
+        throw std::runtime_error("ReplayCommandStream");
+    }
+
+    StreamReader reader(data);
+    if (reader.Read<uint32_t>() != CommandStreamMagic || reader.Read<uint32_t>() != CommandStreamVersion)
+    {
+        throw std::runtime_error("ReplayCommandStream: not a command stream");
+    }
+
+    // Recorded handle -> handle created by the target backend.
+    std::unordered_map<uint32_t, uint32_t> handles;
+    std::vector<TextureSubresourceData> subresources;
+    uint32_t frames = 0;
+
+    while (!reader.AtEnd())
+    {
+        switch (reader.Read<CommandOp>())
+        {
+        case CommandOp::CreateBuffer:
+        {
+            uint32_t recorded = reader.Read<uint32_t>();
+            BufferDesc desc;
+            desc.usage = reader.Read<BufferUsage>();
+            desc.sizeBytes = reader.Read<uint32_t>();
+            desc.strideBytes = reader.Read<uint32_t>();
+            desc.dynamic = reader.Read<uint8_t>() != 0;
+            const void* initialData = reader.Read<uint8_t>() ? reader.Bytes(desc.sizeBytes) : nullptr;
+            handles[recorded] = target.CreateBuffer(desc, initialData);
+            break;
+        }
+
+        case CommandOp::CreateTexture:
+        {
+            uint32_t recorded = reader.Read<uint32_t>();
+            TextureDesc desc;
+            desc.width = reader.Read<uint32_t>();
+            desc.height = reader.Read<uint32_t>();
+            desc.mipLevels = reader.Read<uint32_t>();
+            desc.arraySize = reader.Read<uint32_t>();
+            desc.format = reader.Read<TextureFormat>();
+            desc.cubemap = reader.Read<uint8_t>() != 0;
+            bool hasData = reader.Read<uint8_t>() != 0;
+            subresources.clear();
+            if (hasData)
+            {
+                for (uint32_t i = 0; i < SubresourceCount(desc); ++i)
+                {
+                    TextureSubresourceData sub;
+                    sub.rowPitch = reader.Read<uint32_t>();
+                    sub.slicePitch = reader.Read<uint32_t>();
+                    sub.data = reader.Bytes(sub.slicePitch);
+                    subresources.push_back(sub);
+                }
+            }
+            handles[recorded] = target.CreateTexture(desc, hasData ? subresources.data() : nullptr);
+            break;
+        }
+
+        case CommandOp::CreatePipelineState:
+        {
+            uint32_t recorded = reader.Read<uint32_t>();
+            PipelineDesc desc;
+            desc.layout = reader.Read<VertexLayout>();
+            desc.program = reader.Read<ShaderProgram>();
+            desc.blend = reader.Read<BlendMode>();
+            desc.depth = reader.Read<DepthMode>();
+            desc.cull = reader.Read<CullMode>();
+            handles[recorded] = target.CreatePipelineState(desc);
+            break;
+        }
+
+        case CommandOp::DestroyBuffer:
+            target.DestroyBuffer(Remap(handles, reader.Read<uint32_t>()));
+            break;
+
+        case CommandOp::DestroyTexture:
+            target.DestroyTexture(Remap(handles, reader.Read<uint32_t>()));
+            break;
+
+        case CommandOp::DestroyPipelineState:
+            target.DestroyPipelineState(Remap(handles, reader.Read<uint32_t>()));
+            break;
+
+        case CommandOp::UpdateBuffer:
+        {
+            uint32_t buffer = Remap(handles, reader.Read<uint32_t>());
+            uint32_t size = reader.Read<uint32_t>();
+            target.UpdateBuffer(buffer, reader.Bytes(size), size);
+            break;
+        }
+
+        case CommandOp::BeginFrame:
+            target.BeginFrame();
+            break;
+
+        case CommandOp::EndFrame:
+            target.EndFrame();
+            ++frames;
+            break;
+
+        case CommandOp::Clear:
+        {
+            float color[4];
+            std::memcpy(color, reader.Bytes(sizeof(color)), sizeof(color));
+            float depth = reader.Read<float>();
+            target.Clear(color, depth);
+            break;
+        }
+
+        case CommandOp::SetViewport:
+        {
+            uint32_t width = reader.Read<uint32_t>();
+            uint32_t height = reader.Read<uint32_t>();
+            target.SetViewport(width, height);
+            break;
+        }
+
+        case CommandOp::SetPipelineState:
+            target.SetPipelineState(Remap(handles, reader.Read<uint32_t>()));
+            break;
+
+        case CommandOp::SetVertexBuffer:
+        {
+            uint32_t buffer = Remap(handles, reader.Read<uint32_t>());
+            uint32_t stride = reader.Read<uint32_t>();
+            uint32_t offset = reader.Read<uint32_t>();
+            target.SetVertexBuffer(buffer, stride, offset);
+            break;
+        }
+
+        case CommandOp::SetIndexBuffer:
+        {
+            uint32_t buffer = Remap(handles, reader.Read<uint32_t>());
+            uint32_t offset = reader.Read<uint32_t>();
+            target.SetIndexBuffer(buffer, offset);
+            break;
+        }
+
+        case CommandOp::SetConstantBuffer:
+        {
+            uint32_t slot = reader.Read<uint32_t>();
+            target.SetConstantBuffer(slot, Remap(handles, reader.Read<uint32_t>()));
+            break;
+        }
+
+        case CommandOp::SetTexture:
+        {
+            uint32_t slot = reader.Read<uint32_t>();
+            target.SetTexture(slot, Remap(handles, reader.Read<uint32_t>()));
+            break;
+        }
+
+        case CommandOp::Draw:
+        {
+            uint32_t vertexCount = reader.Read<uint32_t>();
+            uint32_t startVertex = reader.Read<uint32_t>();
+            target.Draw(vertexCount, startVertex);
+            break;
+        }
+
+        case CommandOp::DrawIndexed:
+        {
+            uint32_t indexCount = reader.Read<uint32_t>();
+            uint32_t startIndex = reader.Read<uint32_t>();
+            int32_t baseVertex = reader.Read<int32_t>();
+            target.DrawIndexed(indexCount, startIndex, baseVertex);
+            break;
+        }
+
+        default:
+            throw std::runtime_error("ReplayCommandStream: unknown command");
+        }
+    }
+
+    return frames;
+}
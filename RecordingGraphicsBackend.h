@@ -0,0 +1,104 @@
+//
+// RecordingGraphicsBackend.h - Backend decorator that writes every call made
+// through it to a binary command stream file before forwarding it
+//
+
+#pragma once
+
+#include "GraphicsBackend.h"
+
+#include <fstream>
+#include <vector>
+
+namespace DX
+{
+    // Stream layout: a CommandStreamHeader followed by records. Each record is
+    // a one-byte CommandOp and the call's arguments in declaration order,
+    // little-endian. Upload payloads are written inline, prefixed by their size.
+    struct CommandStreamHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+    };
+
+    const uint32_t CommandStreamMagic = 0x53435844; // 'DXCS'
+    const uint32_t CommandStreamVersion = 1;
+
+    enum class CommandOp : uint8_t
+    {
+        CreateBuffer = 1,
+        CreateTexture,
+        CreatePipelineState,
+        DestroyBuffer,
+        DestroyTexture,
+        DestroyPipelineState,
+        UpdateBuffer,
+        BeginFrame,
+        EndFrame,
+        Clear,
+        SetViewport,
+        SetPipelineState,
+        SetVertexBuffer,
+        SetIndexBuffer,
+        SetConstantBuffer,
+        SetTexture,
+        Draw,
+        DrawIndexed,
+    };
+
+    class RecordingGraphicsBackend : public IGraphicsBackend
+    {
+    public:
+        // Throws std::runtime_error if the file cannot be created.
+        RecordingGraphicsBackend(IGraphicsBackend& inner, const char* path);
+        ~RecordingGraphicsBackend();
+
+        RecordingGraphicsBackend(RecordingGraphicsBackend const&) = delete;
+        RecordingGraphicsBackend& operator=(RecordingGraphicsBackend const&) = delete;
+
+        BufferHandle CreateBuffer(const BufferDesc& desc, const void* initialData) override;
+        TextureHandle CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData) override;
+        PipelineHandle CreatePipelineState(const PipelineDesc& desc) override;
+
+        void DestroyBuffer(BufferHandle buffer) override;
+        void DestroyTexture(TextureHandle texture) override;
+        void DestroyPipelineState(PipelineHandle pipeline) override;
+
+        void UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes) override;
+
+        void BeginFrame() override;
+        void EndFrame() override;
+        void Clear(const float color[4], float depth) override;
+        void SetViewport(uint32_t width, uint32_t height) override;
+
+        void SetPipelineState(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes) override;
+        void SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes) override;
+        void SetConstantBuffer(uint32_t slot, BufferHandle buffer) override;
+        void SetTexture(uint32_t slot, TextureHandle texture) override;
+        void Draw(uint32_t vertexCount, uint32_t startVertex) override;
+        void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+
+        const BackendStats& GetFrameStats() const override     { return m_inner.GetFrameStats(); }
+
+        // Bytes written to the stream so far.
+        uint64_t GetBytesWritten() const                        { return m_bytesWritten + m_pending.size(); }
+
+        // Writes any buffered records; also happens at EndFrame and on destruction.
+        void Flush();
+
+    private:
+        template<typename T> void Write(const T& value);
+        void WriteBytes(const void* data, size_t size);
+
+        IGraphicsBackend&       m_inner;
+        std::ofstream           m_file;
+        std::vector<uint8_t>    m_pending;
+        uint64_t                m_bytesWritten;
+    };
+
+    // Replays a recorded stream into another backend, remapping resource
+    // handles. Returns the number of frames replayed.
+    // Throws std::runtime_error if the file is missing or malformed.
+    uint32_t ReplayCommandStream(const char* path, IGraphicsBackend& target);
+}
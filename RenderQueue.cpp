@@ -0,0 +1,229 @@
+//
+// RenderQueue.cpp
+//
+
+#include "RenderQueue.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+using namespace DX;
+
+uint32_t RenderKey::EncodeDepth(float viewDepth, bool backToFront) noexcept
+{
+    // Non-negative IEEE floats compare the same as their bit patterns, so the
+    // raw bits give a monotonic integer without any quantization.
+    if (!(viewDepth > 0.f))
+    {
+        viewDepth = 0.f;
+    }
+
+    uint32_t bits;
+    std::memcpy(&bits, &viewDepth, sizeof(bits));
+
+    return backToFront ? ~bits : bits;
+}
+
+uint64_t RenderKey::Make(uint32_t layer, uint32_t pass, uint32_t shader, uint32_t material, uint32_t depth) noexcept
+{
+    return (uint64_t(layer & MaxLayer) << LayerShift)
+        | (uint64_t(pass & MaxPass) << PassShift)
+        | (uint64_t(shader & MaxShader) << ShaderShift)
+        | (uint64_t(material & MaxMaterial) << MaterialShift)
+        | uint64_t(depth);
+}
+
+namespace
+{
+    // Sorts count commands from src, using dst as the other buffer of each
+    // scatter pass. Returns whichever of the two holds the sorted commands.
+    RenderCommand* RadixSort(RenderCommand* src, RenderCommand* dst, size_t count, uint32_t& passes)
+    {
+        passes = 0;
+        if (count < 2)
+        {
+            return src;
+        }
+
+        // Build all eight digit histograms in a single read of the keys.
+        uint32_t histograms[8][256] = {};
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t key = src[i].key;
+            for (uint32_t digit = 0; digit < 8; ++digit)
+            {
+                ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+            }
+        }
+
+        for (uint32_t digit = 0; digit < 8; ++digit)
+        {
+            uint32_t* histogram = histograms[digit];
+
+            // Every key shares this digit; scattering would be a plain copy.
+            if (histogram[(src[0].key >> (digit * 8)) & 0xFF] == count)
+            {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (uint32_t bucket = 0; bucket < 256; ++bucket)
+            {
+                uint32_t n = histogram[bucket];
+                histogram[bucket] = offset;
+                offset += n;
+            }
+
+            const uint32_t shift = digit * 8;
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+            }
+
+            std::swap(src, dst);
+            ++passes;
+        }
+
+        return src;
+    }
+}
+
+uint32_t DX::RadixSortCommands(std::vector<RenderCommand>& commands, std::vector<RenderCommand>& scratch)
+{
+    const size_t count = commands.size();
+    if (count < 2)
+    {
+        return 0;
+    }
+
+    scratch.resize(count);
+
+    uint32_t passes;
+    if (RadixSort(commands.data(), scratch.data(), count, passes) != commands.data())
+    {
+        commands.swap(scratch);
+    }
+
+    return passes;
+}
+
+RenderQueue::RenderQueue() noexcept :
+    m_stats{}
+{
+}
+
+void RenderQueue::Reset() noexcept
+{
+    m_commands.clear();
+    m_stats = RenderQueueStats{};
+}
+
+void RenderQueue::Reserve(size_t count)
+{
+    m_commands.reserve(count);
+    m_scratch.reserve(count);
+}
+
+void RenderQueue::Submit(uint64_t key, uint32_t drawId, uint32_t userData)
+{
+    m_commands.push_back(RenderCommand{ key, drawId, userData });
+}
+
+void RenderQueue::Sort()
+{
+    DX_PROFILE_SCOPE("RenderQueue::Sort");
+    auto start = std::chrono::steady_clock::now();
+
+    m_stats.radixPasses = RadixSortCommands(m_commands, m_scratch);
+
+    auto end = std::chrono::steady_clock::now();
+    m_stats.sortNanoseconds = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+void RenderQueue::Sort(FrameArena& arena)
+{
+    DX_PROFILE_SCOPE("RenderQueue::Sort");
+    auto start = std::chrono::steady_clock::now();
+
+    // The arena's memory cannot be swapped into m_commands, so an odd
+    // number of passes ends with a copy back.
+    const size_t count = m_commands.size();
+    RenderCommand* scratch = arena.AllocateArray<RenderCommand>(count);
+    const RenderCommand* sorted = RadixSort(m_commands.data(), scratch, count, m_stats.radixPasses);
+    if (sorted != m_commands.data())
+    {
+        std::copy(sorted, sorted + count, m_commands.begin());
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    m_stats.sortNanoseconds = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+void RenderQueue::Execute(IRenderCommandExecutor& executor)
+{
+    DX_PROFILE_SCOPE("RenderQueue::Execute");
+    m_stats.commands = uint32_t(m_commands.size());
+    m_stats.passChanges = 0;
+    m_stats.shaderChanges = 0;
+    m_stats.materialChanges = 0;
+
+    if (m_commands.empty())
+    {
+        m_stats.redundantChangesSkipped = 0;
+        return;
+    }
+
+    // The first command always binds everything.
+    uint64_t first = m_commands[0].key;
+    uint32_t layer = RenderKey::Layer(first);
+    uint32_t pass = RenderKey::Pass(first);
+    uint32_t shader = RenderKey::Shader(first);
+    uint32_t material = RenderKey::Material(first);
+
+    executor.SetPass(layer, pass);
+    executor.SetShader(shader);
+    executor.SetMaterial(material);
+    m_stats.passChanges = 1;
+    m_stats.shaderChanges = 1;
+    m_stats.materialChanges = 1;
+
+    for (const RenderCommand& command : m_commands)
+    {
+        uint64_t key = command.key;
+
+        uint32_t nextLayer = RenderKey::Layer(key);
+        uint32_t nextPass = RenderKey::Pass(key);
+        if (nextLayer != layer || nextPass != pass)
+        {
+            layer = nextLayer;
+            pass = nextPass;
+            executor.SetPass(layer, pass);
+            ++m_stats.passChanges;
+        }
+
+        uint32_t nextShader = RenderKey::Shader(key);
+        if (nextShader != shader)
+        {
+            shader = nextShader;
+            executor.SetShader(shader);
+            ++m_stats.shaderChanges;
+        }
+
+        uint32_t nextMaterial = RenderKey::Material(key);
+        if (nextMaterial != material)
+        {
+            material = nextMaterial;
+            executor.SetMaterial(material);
+            ++m_stats.materialChanges;
+        }
+
+        executor.Draw(command);
+    }
+
+    // A naive submitter binds pass, shader and material for every draw.
+    m_stats.redundantChangesSkipped = m_stats.commands * 3
+        - (m_stats.passChanges + m_stats.shaderChanges + m_stats.materialChanges);
+}
@@ -0,0 +1,147 @@
+//
+// RenderQueue.h - Records draws as sortable commands and replays them with
+// redundant state changes filtered out
+//
+
+#pragma once
+
+#include "FrameArena.h"
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+namespace DX
+{
+    // 64-bit sort key. Fields are packed most significant first so that a
+    // plain integer sort orders commands by layer, then pass, then shader,
+    // then material and finally depth:
+    //
+    //   63..60  layer      (4 bits)
+    //   59..56  pass       (4 bits)
+    //   55..44  shader     (12 bits)
+    //   43..32  material   (12 bits)
+    //   31..0   depth      (32 bits)
+    namespace RenderKey
+    {
+        const uint32_t LayerBits = 4;
+        const uint32_t PassBits = 4;
+        const uint32_t ShaderBits = 12;
+        const uint32_t MaterialBits = 12;
+        const uint32_t DepthBits = 32;
+
+        const uint32_t MaterialShift = DepthBits;
+        const uint32_t ShaderShift = MaterialShift + MaterialBits;
+        const uint32_t PassShift = ShaderShift + ShaderBits;
+        const uint32_t LayerShift = PassShift + PassBits;
+
+        const uint32_t MaxLayer = (1u << LayerBits) - 1;
+        const uint32_t MaxPass = (1u << PassBits) - 1;
+        const uint32_t MaxShader = (1u << ShaderBits) - 1;
+        const uint32_t MaxMaterial = (1u << MaterialBits) - 1;
+
+        // Maps a view depth to an integer that sorts front-to-back. Pass
+        // backToFront for blended geometry.
+        uint32_t EncodeDepth(float viewDepth, bool backToFront = false) noexcept;
+
+        uint64_t Make(uint32_t layer, uint32_t pass, uint32_t shader, uint32_t material, uint32_t depth) noexcept;
+
+        inline uint32_t Layer(uint64_t key) noexcept       { return uint32_t(key >> LayerShift) & MaxLayer; }
+        inline uint32_t Pass(uint64_t key) noexcept        { return uint32_t(key >> PassShift) & MaxPass; }
+        inline uint32_t Shader(uint64_t key) noexcept      { return uint32_t(key >> ShaderShift) & MaxShader; }
+        inline uint32_t Material(uint64_t key) noexcept    { return uint32_t(key >> MaterialShift) & MaxMaterial; }
+        inline uint32_t Depth(uint64_t key) noexcept       { return uint32_t(key); }
+    }
+
+    // A single recorded draw. The payload is opaque to the queue: drawId
+    // identifies what to draw and userData is free for the recorder.
+    struct RenderCommand
+    {
+        uint64_t key;
+        uint32_t drawId;
+        uint32_t userData;
+    };
+
+    // Receives the sorted command stream. Only state that differs from the
+    // previous command is forwarded, so implementations can bind directly.
+    class IRenderCommandExecutor
+    {
+    public:
+        virtual ~IRenderCommandExecutor() = default;
+
+        virtual void SetPass(uint32_t layer, uint32_t pass) = 0;
+        virtual void SetShader(uint32_t shader) = 0;
+        virtual void SetMaterial(uint32_t material) = 0;
+        virtual void Draw(const RenderCommand& command) = 0;
+    };
+
+    // Per-frame counters filled by Sort and Execute.
+    struct RenderQueueStats
+    {
+        uint32_t commands;
+        uint32_t passChanges;
+        uint32_t shaderChanges;
+        uint32_t materialChanges;
+        uint32_t redundantChangesSkipped;
+        uint32_t radixPasses;
+        uint64_t sortNanoseconds;
+    };
+
+    // Sorts commands in place by key using an LSD radix sort on 8-bit digits.
+    // Digits that are identical for every command are skipped. scratch is
+    // resized as needed and can be reused between calls.
+    // Returns the number of scatter passes performed.
+    uint32_t RadixSortCommands(std::vector<RenderCommand>& commands, std::vector<RenderCommand>& scratch);
+
+    class RenderQueue
+    {
+    public:
+        RenderQueue() noexcept;
+
+        // Drops all recorded commands but keeps their storage.
+        void Reset() noexcept;
+        void Reserve(size_t count);
+
+        void Submit(uint64_t key, uint32_t drawId, uint32_t userData = 0);
+
+        void Sort();
+
+        // The same, with the sort's scratch taken from a FrameArena the
+        // caller resets every frame rather than kept by the queue.
+        void Sort(FrameArena& arena);
+        void Execute(IRenderCommandExecutor& executor);
+
+        size_t GetCommandCount() const                      { return m_commands.size(); }
+        const RenderCommand* GetCommands() const            { return m_commands.data(); }
+        const RenderQueueStats& GetStats() const            { return m_stats; }
+
+    private:
+        std::vector<RenderCommand>  m_commands;
+        std::vector<RenderCommand>  m_scratch;
+        RenderQueueStats            m_stats;
+    };
+
+    // Executor that only counts what it is asked to do. Used to measure sort
+    // cost and state-change counts without a device.
+    class NullRenderCommandExecutor : public IRenderCommandExecutor
+    {
+    public:
+        NullRenderCommandExecutor() noexcept :
+            passCalls(0),
+            shaderCalls(0),
+            materialCalls(0),
+            drawCalls(0)
+        {
+        }
+
+        void SetPass(uint32_t, uint32_t) override       { ++passCalls; }
+        void SetShader(uint32_t) override               { ++shaderCalls; }
+        void SetMaterial(uint32_t) override             { ++materialCalls; }
+        void Draw(const RenderCommand&) override        { ++drawCalls; }
+
+        uint64_t passCalls;
+        uint64_t shaderCalls;
+        uint64_t materialCalls;
+        uint64_t drawCalls;
+    };
+}
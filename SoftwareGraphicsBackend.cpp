@@ -0,0 +1,1035 @@
+//
+// SoftwareGraphicsBackend.cpp
+//
+
+#include "SoftwareGraphicsBackend.h"
+#include "ImageFile.h"
+#include "Profiler.h"
+#include "TextureData.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SOFTWARE_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace DX;
+
+namespace
+{
+    struct Color
+    {
+        float r, g, b, a;
+    };
+
+    // DirectXTK's EnableDefaultLighting rig, which every lit effect in the
+    // scene starts from.
+    const Float3 DefaultLightDirections[3] =
+    {
+        { -0.5265408f, -0.5735765f, -0.6275069f },
+        { 0.7198464f, 0.3420201f, 0.6040227f },
+        { 0.4545195f, -0.7660444f, 0.4545195f },
+    };
+
+    const Float3 DefaultLightColors[3] =
+    {
+        { 1.0000000f, 0.9607844f, 0.8078432f },
+        { 0.9647059f, 0.7607844f, 0.4078432f },
+        { 0.3231373f, 0.3607844f, 0.3937255f },
+    };
+
+    const Float3 DefaultAmbientColor = { 0.05333332f, 0.09882354f, 0.1819608f };
+
+    inline float Saturate(float v)
+    {
+        return v < 0.f ? 0.f : (v > 1.f ? 1.f : v);
+    }
+
+    inline Color Unpack(uint32_t texel)
+    {
+        const float scale = 1.f / 255.f;
+        return Color{ float(texel & 0xFF) * scale, float((texel >> 8) & 0xFF) * scale,
+            float((texel >> 16) & 0xFF) * scale, float(texel >> 24) * scale };
+    }
+
+    inline uint32_t Pack(const Color& c)
+    {
+        return uint32_t(Saturate(c.r) * 255.f + 0.5f)
+            | (uint32_t(Saturate(c.g) * 255.f + 0.5f) << 8)
+            | (uint32_t(Saturate(c.b) * 255.f + 0.5f) << 16)
+            | (uint32_t(Saturate(c.a) * 255.f + 0.5f) << 24);
+    }
+
+    inline int32_t Wrap(int32_t i, int32_t size)
+    {
+        // Most coordinates are already in range; skip the divide for them.
+        if (uint32_t(i) < uint32_t(size))
+        {
+            return i;
+        }
+
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+
+    // Bilinear filter with wrap addressing, as LinearWrap samples.
+    Color SampleBilinear(const uint32_t* texels, uint32_t width, uint32_t height, float u, float v)
+    {
+        float x = u * float(width) - 0.5f;
+        float y = v * float(height) - 0.5f;
+        float fx = std::floor(x), fy = std::floor(y);
+        float tx = x - fx, ty = y - fy;
+
+        int32_t w = int32_t(width), h = int32_t(height);
+        int32_t x0 = Wrap(int32_t(fx), w), y0 = Wrap(int32_t(fy), h);
+        int32_t x1 = (x0 + 1 == w) ? 0 : x0 + 1;
+        int32_t y1 = (y0 + 1 == h) ? 0 : y0 + 1;
+
+        Color c00 = Unpack(texels[y0 * w + x0]), c10 = Unpack(texels[y0 * w + x1]);
+        Color c01 = Unpack(texels[y1 * w + x0]), c11 = Unpack(texels[y1 * w + x1]);
+
+        auto lerp = [](float a, float b, float t) { return a + (b - a) * t; };
+        return Color{
+            lerp(lerp(c00.r, c10.r, tx), lerp(c01.r, c11.r, tx), ty),
+            lerp(lerp(c00.g, c10.g, tx), lerp(c01.g, c11.g, tx), ty),
+            lerp(lerp(c00.b, c10.b, tx), lerp(c01.b, c11.b, tx), ty),
+            lerp(lerp(c00.a, c10.a, tx), lerp(c01.a, c11.a, tx), ty) };
+    }
+
+    // Picks the D3D cube face (+X, -X, +Y, -Y, +Z, -Z) and its coordinates.
+    uint32_t CubeFace(const Float3& d, float& u, float& v)
+    {
+        float ax = std::fabs(d.x), ay = std::fabs(d.y), az = std::fabs(d.z);
+        float sc, tc, ma;
+        uint32_t face;
+
+        if (ax >= ay && ax >= az)
+        {
+            face = d.x >= 0 ? 0 : 1;
+            sc = d.x >= 0 ? -d.z : d.z;
+            tc = -d.y;
+            ma = ax;
+        }
+        else if (ay >= az)
+        {
+            face = d.y >= 0 ? 2 : 3;
+            sc = d.x;
+            tc = d.y >= 0 ? d.z : -d.z;
+            ma = ay;
+        }
+        else
+        {
+            face = d.z >= 0 ? 4 : 5;
+            sc = d.z >= 0 ? d.x : -d.x;
+            tc = -d.y;
+            ma = az;
+        }
+
+        float inv = ma > 0.f ? 0.5f / ma : 0.f;
+        u = sc * inv + 0.5f;
+        v = tc * inv + 0.5f;
+        return face;
+    }
+
+    void ReadTransposed(const uint8_t* data, size_t offset, Matrix44& m)
+    {
+        Matrix44 t;
+        std::memcpy(t.m, data + offset, sizeof(t.m));
+        m = t.Transpose();
+    }
+
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+SoftwareGraphicsBackend::SoftwareGraphicsBackend(JobSystem& jobs) :
+    m_jobs(jobs),
+    m_pipeline(InvalidHandle),
+    m_vertexBuffer(InvalidHandle),
+    m_vertexStride(0),
+    m_vertexOffset(0),
+    m_indexBuffer(InvalidHandle),
+    m_indexOffset(0),
+    m_constantBuffers{},
+    m_boundTextures{},
+    m_width(0),
+    m_height(0),
+    m_pitch(0),
+    m_tilesX(0),
+    m_tilesY(0),
+    m_threadCounters(jobs.GetThreadCount()),
+    m_stats{},
+    m_rasterStats{}
+{
+    ResizeTargets(800, 600);
+}
+
+// Resources ---------------------------------------------------------------
+
+BufferHandle SoftwareGraphicsBackend::CreateBuffer(const BufferDesc& desc, const void* initialData)
+{
+    Buffer buffer;
+    buffer.desc = desc;
+    buffer.data.resize(desc.sizeBytes);
+    buffer.live = true;
+
+    if (initialData)
+    {
+        std::memcpy(buffer.data.data(), initialData, desc.sizeBytes);
+        m_stats.bytesUploaded += desc.sizeBytes;
+    }
+
+    m_buffers.push_back(std::move(buffer));
+    return BufferHandle(m_buffers.size());
+}
+
+TextureHandle SoftwareGraphicsBackend::CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData)
+{
+    if (!initialData)
+    {
+        throw std::runtime_error("SoftwareGraphicsBackend: textures need initial data");
+    }
+
+    Texture texture;
+    texture.desc = desc;
+    texture.live = true;
+    texture.surfaces.resize(desc.arraySize * desc.mipLevels);
+
+    for (uint32_t slice = 0; slice < desc.arraySize; ++slice)
+    {
+        for (uint32_t mip = 0; mip < desc.mipLevels; ++mip)
+        {
+            uint32_t index = slice * desc.mipLevels + mip;
+            Surface& surface = texture.surfaces[index];
+            surface.width = std::max(1u, desc.width >> mip);
+            surface.height = std::max(1u, desc.height >> mip);
+            surface.texels.resize(size_t(surface.width) * surface.height);
+
+            DecodeSurfaceToRGBA8(desc.format, surface.width, surface.height,
+                initialData[index].data, initialData[index].rowPitch, surface.texels.data());
+            m_stats.bytesUploaded += initialData[index].slicePitch;
+        }
+    }
+
+    m_textures.push_back(std::move(texture));
+    return TextureHandle(m_textures.size());
+}
+
+PipelineHandle SoftwareGraphicsBackend::CreatePipelineState(const PipelineDesc& desc)
+{
+    m_pipelines.push_back(Pipeline{ desc, true });
+    return PipelineHandle(m_pipelines.size());
+}
+
+void SoftwareGraphicsBackend::DestroyBuffer(BufferHandle buffer)
+{
+    if (buffer != InvalidHandle)
+    {
+        Buffer& b = m_buffers[buffer - 1];
+        b.data.clear();
+        b.data.shrink_to_fit();
+        b.live = false;
+    }
+}
+
+void SoftwareGraphicsBackend::DestroyTexture(TextureHandle texture)
+{
+    if (texture != InvalidHandle)
+    {
+        // Binned triangles may still sample it.
+        Flush();
+
+        Texture& t = m_textures[texture - 1];
+        t.surfaces.clear();
+        t.surfaces.shrink_to_fit();
+        t.live = false;
+    }
+}
+
+void SoftwareGraphicsBackend::DestroyPipelineState(PipelineHandle pipeline)
+{
+    if (pipeline != InvalidHandle)
+    {
+        m_pipelines[pipeline - 1].live = false;
+    }
+}
+
+void SoftwareGraphicsBackend::UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes)
+{
+    // Vertices are transformed at draw time, so earlier draws have already
+    // consumed the old contents.
+    Buffer& b = m_buffers[buffer - 1];
+    std::memcpy(b.data.data(), data, std::min<size_t>(sizeBytes, b.data.size()));
+
+    ++m_stats.bufferUpdates;
+    m_stats.bytesUploaded += sizeBytes;
+}
+
+// Frame -------------------------------------------------------------------
+
+void SoftwareGraphicsBackend::ResizeTargets(uint32_t width, uint32_t height)
+{
+    Flush();
+
+    m_width = width ? width : 1;
+    m_height = height ? height : 1;
+
+    // Rows are padded so four-wide loads never leave the row.
+    m_pitch = (m_width + 3) & ~3u;
+    m_tilesX = (m_width + TileSize - 1) / TileSize;
+    m_tilesY = (m_height + TileSize - 1) / TileSize;
+
+    m_color.assign(size_t(m_pitch) * m_height, 0);
+    m_depth.assign(size_t(m_pitch) * m_height, 1.f);
+    m_bins.assign(m_tilesX * m_tilesY, std::vector<uint32_t>());
+}
+
+void SoftwareGraphicsBackend::BeginFrame()
+{
+    m_stats = BackendStats{};
+    m_rasterStats = SoftwareRasterStats{};
+}
+
+void SoftwareGraphicsBackend::EndFrame()
+{
+    Flush();
+}
+
+void SoftwareGraphicsBackend::Clear(const float color[4], float depth)
+{
+    Flush();
+
+    DX_PROFILE_SCOPE("SoftwareGraphicsBackend::Clear");
+    const uint32_t packed = Pack(Color{ color[0], color[1], color[2], color[3] });
+
+    m_jobs.ParallelFor(m_tilesY, [&](uint32_t tileRow, uint32_t)
+    {
+        uint32_t y0 = tileRow * TileSize;
+        uint32_t y1 = std::min(y0 + TileSize, m_height);
+        std::fill(m_color.begin() + size_t(y0) * m_pitch, m_color.begin() + size_t(y1) * m_pitch, packed);
+        std::fill(m_depth.begin() + size_t(y0) * m_pitch, m_depth.begin() + size_t(y1) * m_pitch, depth);
+    });
+}
+
+void SoftwareGraphicsBackend::SetViewport(uint32_t width, uint32_t height)
+{
+    if (width != m_width || height != m_height)
+    {
+        ResizeTargets(width, height);
+    }
+}
+
+void SoftwareGraphicsBackend::SaveFrame(const std::string& path)
+{
+    Flush();
+
+    std::vector<uint32_t> pixels(size_t(m_width) * m_height);
+    for (uint32_t y = 0; y < m_height; ++y)
+    {
+        std::memcpy(&pixels[size_t(y) * m_width], &m_color[size_t(y) * m_pitch], m_width * sizeof(uint32_t));
+    }
+
+    SaveBMPToFile(path, m_width, m_height, pixels.data());
+}
+
+// State -------------------------------------------------------------------
+
+void SoftwareGraphicsBackend::SetPipelineState(PipelineHandle pipeline)
+{
+    m_pipeline = pipeline;
+    ++m_stats.pipelineBinds;
+}
+
+void SoftwareGraphicsBackend::SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes)
+{
+    m_vertexBuffer = buffer;
+    m_vertexStride = strideBytes;
+    m_vertexOffset = offsetBytes;
+    ++m_stats.bufferBinds;
+}
+
+void SoftwareGraphicsBackend::SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes)
+{
+    m_indexBuffer = buffer;
+    m_indexOffset = offsetBytes;
+    ++m_stats.bufferBinds;
+}
+
+void SoftwareGraphicsBackend::SetConstantBuffer(uint32_t slot, BufferHandle buffer)
+{
+    if (slot < 2)
+    {
+        m_constantBuffers[slot] = buffer;
+    }
+    ++m_stats.bufferBinds;
+}
+
+void SoftwareGraphicsBackend::SetTexture(uint32_t slot, TextureHandle texture)
+{
+    if (slot < MaxTextureSlots)
+    {
+        m_boundTextures[slot] = texture;
+    }
+    ++m_stats.textureBinds;
+}
+
+// Geometry ----------------------------------------------------------------
+
+void SoftwareGraphicsBackend::Draw(uint32_t vertexCount, uint32_t startVertex)
+{
+    ++m_stats.drawCalls;
+    m_stats.trianglesSubmitted += vertexCount / 3;
+
+    SubmitTriangles(nullptr, vertexCount, int32_t(startVertex));
+}
+
+void SoftwareGraphicsBackend::DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex)
+{
+    ++m_stats.drawCalls;
+    m_stats.trianglesSubmitted += indexCount / 3;
+
+    const Buffer& ib = m_buffers[m_indexBuffer - 1];
+    const uint16_t* indices = reinterpret_cast<const uint16_t*>(ib.data.data() + m_indexOffset) + startIndex;
+
+    SubmitTriangles(indices, indexCount, baseVertex);
+}
+
+void SoftwareGraphicsBackend::SubmitTriangles(const uint16_t* indices, uint32_t count, int32_t baseVertex)
+{
+    if (m_pipeline == InvalidHandle || m_vertexBuffer == InvalidHandle || m_constantBuffers[0] == InvalidHandle || count < 3)
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Snapshot the state the pixel stage will need after the constants move on.
+    DrawState state;
+    state.pipeline = m_pipelines[m_pipeline - 1].desc;
+    std::copy(m_boundTextures, m_boundTextures + MaxTextureSlots, state.textures);
+    state.lighting = LightingConstants{};
+    if (m_constantBuffers[1] != InvalidHandle)
+    {
+        const Buffer& lighting = m_buffers[m_constantBuffers[1] - 1];
+        std::memcpy(&state.lighting, lighting.data.data(), std::min(sizeof(LightingConstants), lighting.data.size()));
+    }
+
+    const uint8_t* constants = m_buffers[m_constantBuffers[0] - 1].data.data();
+    Matrix44 world, view, projection;
+    ReadTransposed(constants, offsetof(TransformConstants, world), world);
+    ReadTransposed(constants, offsetof(TransformConstants, view), view);
+    ReadTransposed(constants, offsetof(TransformConstants, projection), projection);
+
+    // The camera sits at -t * R^T for a rigid view matrix.
+    Float3 t = view.Translation();
+    state.eye = Float3{
+        -(t.x * view.m[0][0] + t.y * view.m[0][1] + t.z * view.m[0][2]),
+        -(t.x * view.m[1][0] + t.y * view.m[1][1] + t.z * view.m[1][2]),
+        -(t.x * view.m[2][0] + t.y * view.m[2][1] + t.z * view.m[2][2]) };
+
+    const uint32_t stateIndex = uint32_t(m_drawStates.size());
+    m_drawStates.push_back(state);
+
+    // Transform each referenced vertex once.
+    uint32_t minIndex = 0, maxIndex = count - 1;
+    if (indices)
+    {
+        minIndex = *std::min_element(indices, indices + count);
+        maxIndex = *std::max_element(indices, indices + count);
+    }
+
+    const uint32_t vertexCount = maxIndex - minIndex + 1;
+    const uint32_t attributeCount = TransformVertices(uint32_t(baseVertex + int32_t(minIndex)), vertexCount,
+        state.pipeline, world, world * view * projection);
+
+    const uint32_t triangleCount = count / 3;
+    for (uint32_t i = 0; i < triangleCount; ++i)
+    {
+        uint32_t i0 = indices ? indices[i * 3 + 0] : i * 3 + 0;
+        uint32_t i1 = indices ? indices[i * 3 + 1] : i * 3 + 1;
+        uint32_t i2 = indices ? indices[i * 3 + 2] : i * 3 + 2;
+
+        const ClipVertex* v[3] = { &m_clipVertices[i0 - minIndex], &m_clipVertices[i1 - minIndex], &m_clipVertices[i2 - minIndex] };
+        ClipTriangle(v, attributeCount, stateIndex);
+    }
+
+    m_rasterStats.setupNanoseconds += ElapsedNanoseconds(start);
+}
+
+uint32_t SoftwareGraphicsBackend::TransformVertices(uint32_t first, uint32_t count, const PipelineDesc& pipeline,
+    const Matrix44& world, const Matrix44& worldViewProjection)
+{
+    m_clipVertices.resize(count);
+
+    const Buffer& vb = m_buffers[m_vertexBuffer - 1];
+    const uint8_t* base = vb.data.data() + m_vertexOffset + size_t(first) * m_vertexStride;
+    const uint32_t stride = m_vertexStride;
+    const bool colored = pipeline.layout == VertexLayout::PositionColor;
+    const bool hudShader = pipeline.program == ShaderProgram::VertexColor;
+
+    auto transform = [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const float* src = reinterpret_cast<const float*>(base + size_t(i) * stride);
+            ClipVertex& out = m_clipVertices[i];
+
+            Float3 position = { src[0], src[1], src[2] };
+            if (hudShader)
+            {
+                // ui_vs.hlsl doubles x and y before transforming.
+                position.x *= 2.f;
+                position.y *= 2.f;
+            }
+
+            Float4 clip = worldViewProjection.Transform(position);
+            out.x = clip.x;
+            out.y = clip.y;
+            out.z = clip.z;
+            out.w = clip.w;
+
+            if (colored)
+            {
+                std::memcpy(out.attributes, src + 3, 4 * sizeof(float));
+            }
+            else
+            {
+                Float3 normal = world.TransformNormal(Float3{ src[3], src[4], src[5] });
+                Float4 worldPosition = world.Transform(position);
+                out.attributes[0] = normal.x;
+                out.attributes[1] = normal.y;
+                out.attributes[2] = normal.z;
+                out.attributes[3] = src[6];
+                out.attributes[4] = src[7];
+                out.attributes[5] = worldPosition.x;
+                out.attributes[6] = worldPosition.y;
+                out.attributes[7] = worldPosition.z;
+            }
+        }
+    };
+
+    // Only big meshes are worth spreading over the workers.
+    const uint32_t chunk = 2048;
+    if (count > chunk)
+    {
+        m_jobs.ParallelFor((count + chunk - 1) / chunk, [&](uint32_t index, uint32_t)
+        {
+            transform(index * chunk, std::min(count, (index + 1) * chunk));
+        });
+    }
+    else
+    {
+        transform(0, count);
+    }
+
+    return colored ? 4 : 8;
+}
+
+void SoftwareGraphicsBackend::ClipTriangle(const ClipVertex* v[3], uint32_t attributeCount, uint32_t stateIndex)
+{
+    // Trivially reject triangles wholly outside one frustum plane.
+    auto outside = [&](float (*distance)(const ClipVertex&))
+    {
+        return distance(*v[0]) < 0.f && distance(*v[1]) < 0.f && distance(*v[2]) < 0.f;
+    };
+
+    if (outside([](const ClipVertex& c) { return c.w - c.x; }) || outside([](const ClipVertex& c) { return c.w + c.x; })
+        || outside([](const ClipVertex& c) { return c.w - c.y; }) || outside([](const ClipVertex& c) { return c.w + c.y; })
+        || outside([](const ClipVertex& c) { return c.w - c.z; }) || outside([](const ClipVertex& c) { return c.z; }))
+    {
+        ++m_rasterStats.trianglesCulled;
+        return;
+    }
+
+    // Only the near plane (z >= 0) needs real clipping; it also keeps w
+    // positive. The other planes are handled by the screen bounds.
+    if (v[0]->z >= 0.f && v[1]->z >= 0.f && v[2]->z >= 0.f)
+    {
+        SetupTriangle(v, attributeCount, stateIndex);
+        return;
+    }
+
+    ++m_rasterStats.trianglesClipped;
+
+    ClipVertex polygon[4];
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        const ClipVertex& a = *v[i];
+        const ClipVertex& b = *v[(i + 1) % 3];
+
+        if (a.z >= 0.f)
+        {
+            polygon[n++] = a;
+        }
+
+        if ((a.z >= 0.f) != (b.z >= 0.f))
+        {
+            float t = a.z / (a.z - b.z);
+            ClipVertex& c = polygon[n++];
+            c.x = a.x + (b.x - a.x) * t;
+            c.y = a.y + (b.y - a.y) * t;
+            c.z = 0.f;
+            c.w = a.w + (b.w - a.w) * t;
+            for (uint32_t k = 0; k < attributeCount; ++k)
+            {
+                c.attributes[k] = a.attributes[k] + (b.attributes[k] - a.attributes[k]) * t;
+            }
+        }
+    }
+
+    for (uint32_t i = 2; i < n; ++i)
+    {
+        const ClipVertex* fan[3] = { &polygon[0], &polygon[i - 1], &polygon[i] };
+        SetupTriangle(fan, attributeCount, stateIndex);
+    }
+}
+
+void SoftwareGraphicsBackend::SetupTriangle(const ClipVertex* v[3], uint32_t attributeCount, uint32_t stateIndex)
+{
+    const DrawState& state = m_drawStates[stateIndex];
+
+    float sx[3], sy[3], sz[3], iw[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        iw[i] = 1.f / v[i]->w;
+        sx[i] = (v[i]->x * iw[i] * 0.5f + 0.5f) * float(m_width);
+        sy[i] = (0.5f - v[i]->y * iw[i] * 0.5f) * float(m_height);
+        sz[i] = v[i]->z * iw[i];
+    }
+
+    // Positive area is clockwise on screen with y pointing down.
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+
+    if (area == 0.f
+        || (state.pipeline.cull == CullMode::Clockwise && area > 0.f)
+        || (state.pipeline.cull == CullMode::CounterClockwise && area < 0.f))
+    {
+        ++m_rasterStats.trianglesCulled;
+        return;
+    }
+
+    // Wind every triangle the same way so inside is always positive.
+    uint32_t order[3] = { 0, 1, 2 };
+    if (area < 0.f)
+    {
+        std::swap(order[1], order[2]);
+        area = -area;
+    }
+
+    Triangle tri;
+    tri.minX = std::max(0, int32_t(std::floor(std::min({ sx[0], sx[1], sx[2] }))));
+    tri.minY = std::max(0, int32_t(std::floor(std::min({ sy[0], sy[1], sy[2] }))));
+    tri.maxX = std::min(int32_t(m_width), int32_t(std::ceil(std::max({ sx[0], sx[1], sx[2] }))));
+    tri.maxY = std::min(int32_t(m_height), int32_t(std::ceil(std::max({ sy[0], sy[1], sy[2] }))));
+
+    if (tri.minX >= tri.maxX || tri.minY >= tri.maxY)
+    {
+        ++m_rasterStats.trianglesCulled;
+        return;
+    }
+
+    const uint32_t a0 = order[0], a1 = order[1], a2 = order[2];
+    const float x[3] = { sx[a0], sx[a1], sx[a2] };
+    const float y[3] = { sy[a0], sy[a1], sy[a2] };
+
+    // Edge i runs between the two vertices opposite vertex i.
+    tri.topLeft = 0;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        uint32_t j = (i + 1) % 3, k = (i + 2) % 3;
+        tri.edgeA[i] = y[j] - y[k];
+        tri.edgeB[i] = x[k] - x[j];
+        tri.edgeX[i] = x[j];
+        tri.edgeY[i] = y[j];
+
+        if (tri.edgeA[i] > 0.f || (tri.edgeA[i] == 0.f && tri.edgeB[i] > 0.f))
+        {
+            tri.topLeft |= 1u << i;
+        }
+    }
+
+    tri.ox = x[0];
+    tri.oy = y[0];
+
+    const float dx1 = x[1] - x[0], dy1 = y[1] - y[0];
+    const float dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+    const float invArea = 1.f / area;
+
+    auto makePlane = [&](float v0, float v1, float v2)
+    {
+        float d1 = v1 - v0, d2 = v2 - v0;
+        return Plane{ (d1 * dy2 - d2 * dy1) * invArea, (d2 * dx1 - d1 * dx2) * invArea, v0 };
+    };
+
+    tri.depth = makePlane(sz[a0], sz[a1], sz[a2]);
+    tri.invW = makePlane(iw[a0], iw[a1], iw[a2]);
+    for (uint32_t k = 0; k < attributeCount; ++k)
+    {
+        tri.attributes[k] = makePlane(v[a0]->attributes[k] * iw[a0], v[a1]->attributes[k] * iw[a1], v[a2]->attributes[k] * iw[a2]);
+    }
+
+    tri.attributeCount = attributeCount;
+    tri.state = stateIndex;
+    tri.mip = 0;
+
+    // One mip per triangle from the ratio of texel area to pixel area.
+    TextureHandle texture = state.textures[0];
+    if (attributeCount == 8 && texture != InvalidHandle && m_textures[texture - 1].live)
+    {
+        const Texture& t = m_textures[texture - 1];
+        float du1 = v[1]->attributes[3] - v[0]->attributes[3], dv1 = v[1]->attributes[4] - v[0]->attributes[4];
+        float du2 = v[2]->attributes[3] - v[0]->attributes[3], dv2 = v[2]->attributes[4] - v[0]->attributes[4];
+        float texelArea = std::fabs(du1 * dv2 - du2 * dv1) * float(t.desc.width) * float(t.desc.height);
+
+        if (texelArea > area)
+        {
+            float lod = 0.5f * std::log2(texelArea / area);
+            tri.mip = std::min(uint32_t(lod + 0.5f), t.desc.mipLevels - 1);
+        }
+    }
+
+    m_triangles.push_back(tri);
+    BinTriangle(uint32_t(m_triangles.size() - 1));
+}
+
+void SoftwareGraphicsBackend::BinTriangle(uint32_t index)
+{
+    const Triangle& tri = m_triangles[index];
+    ++m_rasterStats.trianglesBinned;
+
+    uint32_t tx0 = uint32_t(tri.minX) / TileSize, tx1 = uint32_t(tri.maxX - 1) / TileSize;
+    uint32_t ty0 = uint32_t(tri.minY) / TileSize, ty1 = uint32_t(tri.maxY - 1) / TileSize;
+    bool single = tx0 == tx1 && ty0 == ty1;
+
+    for (uint32_t ty = ty0; ty <= ty1; ++ty)
+    {
+        for (uint32_t tx = tx0; tx <= tx1; ++tx)
+        {
+            // Skip tiles the bounding box overlaps but no edge reaches: test
+            // the tile corner furthest inside each edge.
+            if (!single)
+            {
+                float left = float(tx * TileSize) + 0.5f, right = float((tx + 1) * TileSize) - 0.5f;
+                float top = float(ty * TileSize) + 0.5f, bottom = float((ty + 1) * TileSize) - 0.5f;
+                bool rejected = false;
+
+                for (uint32_t i = 0; i < 3 && !rejected; ++i)
+                {
+                    float px = tri.edgeA[i] > 0.f ? right : left;
+                    float py = tri.edgeB[i] > 0.f ? bottom : top;
+                    rejected = tri.edgeA[i] * (px - tri.edgeX[i]) + tri.edgeB[i] * (py - tri.edgeY[i]) < 0.f;
+                }
+
+                if (rejected)
+                {
+                    continue;
+                }
+            }
+
+            m_bins[ty * m_tilesX + tx].push_back(index);
+            ++m_rasterStats.binEntries;
+        }
+    }
+}
+
+// Rasterization -----------------------------------------------------------
+
+void SoftwareGraphicsBackend::Flush()
+{
+    if (m_triangles.empty())
+    {
+        m_drawStates.clear();
+        return;
+    }
+
+    DX_PROFILE_SCOPE("SoftwareGraphicsBackend::Flush");
+    auto start = std::chrono::steady_clock::now();
+
+    for (ThreadCounters& counters : m_threadCounters)
+    {
+        counters.pixelsShaded = 0;
+    }
+
+    m_jobs.ParallelFor(m_tilesX * m_tilesY, [this](uint32_t tile, uint32_t threadIndex)
+    {
+        RasterizeTile(tile, threadIndex);
+    });
+
+    for (const ThreadCounters& counters : m_threadCounters)
+    {
+        m_rasterStats.pixelsShaded += counters.pixelsShaded;
+    }
+
+    for (std::vector<uint32_t>& bin : m_bins)
+    {
+        bin.clear();
+    }
+    m_triangles.clear();
+    m_drawStates.clear();
+
+    m_rasterStats.rasterNanoseconds += ElapsedNanoseconds(start);
+}
+
+void SoftwareGraphicsBackend::RasterizeTile(uint32_t tile, uint32_t threadIndex)
+{
+    DX_PROFILE_SCOPE("RasterizeTile");
+
+    const int32_t tileX0 = int32_t((tile % m_tilesX) * TileSize);
+    const int32_t tileY0 = int32_t((tile / m_tilesX) * TileSize);
+    const int32_t tileX1 = std::min(tileX0 + int32_t(TileSize), int32_t(m_width));
+    const int32_t tileY1 = std::min(tileY0 + int32_t(TileSize), int32_t(m_height));
+
+    uint64_t pixelsShaded = 0;
+
+    // Triangles are binned in submission order, which keeps blending and
+    // equal-depth results identical to a GPU.
+    for (uint32_t index : m_bins[tile])
+    {
+        const Triangle& tri = m_triangles[index];
+        RasterizeTriangle(tri,
+            std::max(tileX0, tri.minX), std::max(tileY0, tri.minY),
+            std::min(tileX1, tri.maxX), std::min(tileY1, tri.maxY),
+            pixelsShaded);
+    }
+
+    m_threadCounters[threadIndex].pixelsShaded += pixelsShaded;
+}
+
+void SoftwareGraphicsBackend::RasterizeTriangle(const Triangle& tri, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint64_t& pixelsShaded)
+{
+    const DrawState& state = m_drawStates[tri.state];
+    const bool depthTest = state.pipeline.depth != DepthMode::None;
+    const bool depthWrite = state.pipeline.depth == DepthMode::ReadWrite;
+
+    // Quads of four pixels start on a multiple of four so depth rows load
+    // in whole groups; lanes outside [x0, x1) are masked off.
+    const int32_t quadX0 = x0 & ~3;
+
+#if defined(SOFTWARE_RASTER_SSE2)
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 laneIndices = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 minX = _mm_set1_ps(float(x0));
+    const __m128 maxX = _mm_set1_ps(float(x1));
+
+    __m128 edgeStep[3], topLeft[3];
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        edgeStep[i] = _mm_set1_ps(tri.edgeA[i] * 4.f);
+        topLeft[i] = (tri.topLeft & (1u << i)) ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : zero;
+    }
+    const __m128 depthStep = _mm_set1_ps(tri.depth.dx * 4.f);
+
+    for (int32_t y = y0; y < y1; ++y)
+    {
+        const float py = float(y) + 0.5f;
+        const float qx = float(quadX0);
+
+        __m128 edge[3];
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            float row = tri.edgeA[i] * (qx - tri.edgeX[i]) + tri.edgeB[i] * (py - tri.edgeY[i]);
+            edge[i] = _mm_add_ps(_mm_set1_ps(row), _mm_mul_ps(_mm_set1_ps(tri.edgeA[i]), laneOffsets));
+        }
+
+        float depthRow = tri.depth.origin + tri.depth.dx * (qx - tri.ox) + tri.depth.dy * (py - tri.oy);
+        __m128 depth = _mm_add_ps(_mm_set1_ps(depthRow), _mm_mul_ps(_mm_set1_ps(tri.depth.dx), laneOffsets));
+
+        float* depthBuffer = &m_depth[size_t(y) * m_pitch];
+        uint32_t* colorBuffer = &m_color[size_t(y) * m_pitch];
+
+        for (int32_t x = quadX0; x < x1; x += 4)
+        {
+            __m128 lanes = _mm_add_ps(_mm_set1_ps(float(x)), laneIndices);
+            __m128 mask = _mm_and_ps(_mm_cmpge_ps(lanes, minX), _mm_cmplt_ps(lanes, maxX));
+
+            for (uint32_t i = 0; i < 3; ++i)
+            {
+                __m128 inside = _mm_or_ps(_mm_cmpgt_ps(edge[i], zero), _mm_and_ps(_mm_cmpeq_ps(edge[i], zero), topLeft[i]));
+                mask = _mm_and_ps(mask, inside);
+                edge[i] = _mm_add_ps(edge[i], edgeStep[i]);
+            }
+
+            // Beyond the far plane.
+            mask = _mm_and_ps(mask, _mm_cmple_ps(depth, one));
+
+            if (_mm_movemask_ps(mask) && depthTest)
+            {
+                __m128 stored = _mm_loadu_ps(depthBuffer + x);
+                mask = _mm_and_ps(mask, _mm_cmplt_ps(depth, stored));
+
+                if (depthWrite)
+                {
+                    _mm_storeu_ps(depthBuffer + x, _mm_or_ps(_mm_and_ps(mask, depth), _mm_andnot_ps(mask, stored)));
+                }
+            }
+
+            int bits = _mm_movemask_ps(mask);
+            depth = _mm_add_ps(depth, depthStep);
+
+            while (bits)
+            {
+                int lane = 0;
+                while (!(bits & (1 << lane)))
+                {
+                    ++lane;
+                }
+                bits &= ~(1 << lane);
+
+                int32_t px = x + lane;
+                colorBuffer[px] = ShadePixel(tri, state, float(px) + 0.5f, py, colorBuffer[px]);
+                ++pixelsShaded;
+            }
+        }
+    }
+#else
+    for (int32_t y = y0; y < y1; ++y)
+    {
+        const float py = float(y) + 0.5f;
+        float* depthBuffer = &m_depth[size_t(y) * m_pitch];
+        uint32_t* colorBuffer = &m_color[size_t(y) * m_pitch];
+
+        for (int32_t x = x0; x < x1; ++x)
+        {
+            const float px = float(x) + 0.5f;
+            bool inside = true;
+
+            for (uint32_t i = 0; i < 3 && inside; ++i)
+            {
+                float e = tri.edgeA[i] * (px - tri.edgeX[i]) + tri.edgeB[i] * (py - tri.edgeY[i]);
+                inside = e > 0.f || (e == 0.f && (tri.topLeft & (1u << i)));
+            }
+
+            float depth = tri.depth.origin + tri.depth.dx * (px - tri.ox) + tri.depth.dy * (py - tri.oy);
+            if (!inside || depth > 1.f || (depthTest && !(depth < depthBuffer[x])))
+            {
+                continue;
+            }
+
+            if (depthWrite)
+            {
+                depthBuffer[x] = depth;
+            }
+
+            colorBuffer[x] = ShadePixel(tri, state, px, py, colorBuffer[x]);
+            ++pixelsShaded;
+        }
+    }
+    (void)quadX0;
+#endif
+}
+
+uint32_t SoftwareGraphicsBackend::ShadePixel(const Triangle& tri, const DrawState& state, float x, float y, uint32_t dest) const
+{
+    const float rx = x - tri.ox, ry = y - tri.oy;
+    auto evaluate = [&](const Plane& p) { return p.origin + p.dx * rx + p.dy * ry; };
+
+    // Attributes were interpolated divided by w; undo that per pixel.
+    const float w = 1.f / evaluate(tri.invW);
+    float a[MaxAttributes];
+    for (uint32_t k = 0; k < tri.attributeCount; ++k)
+    {
+        a[k] = evaluate(tri.attributes[k]) * w;
+    }
+
+    Color color;
+    if (state.pipeline.program == ShaderProgram::VertexColor)
+    {
+        color = Color{ a[0], a[1], a[2], a[3] };
+    }
+    else
+    {
+        const Float3 normal = Float3{ a[0], a[1], a[2] }.Normalized();
+        const Float3 position = { a[5], a[6], a[7] };
+        const LightingConstants& lighting = state.lighting;
+
+        color = Color{ 1.f, 1.f, 1.f, 1.f };
+        TextureHandle texture = state.textures[0];
+        if (texture != InvalidHandle && m_textures[texture - 1].live)
+        {
+            const Surface& surface = m_textures[texture - 1].surfaces[tri.mip];
+            color = SampleBilinear(surface.texels.data(), surface.width, surface.height, a[3], a[4]);
+        }
+
+        // The skull's effect replaces the key light with the camera-relative one.
+        Float3 lightDirections[3] = { DefaultLightDirections[0], DefaultLightDirections[1], DefaultLightDirections[2] };
+        Float3 lightColors[3] = { DefaultLightColors[0], DefaultLightColors[1], DefaultLightColors[2] };
+        if (state.pipeline.program == ShaderProgram::LitFog)
+        {
+            lightDirections[0] = Float3{ lighting.lightDirection[0], lighting.lightDirection[1], lighting.lightDirection[2] }.Normalized();
+            lightColors[0] = Float3{ lighting.diffuseColor[0], lighting.diffuseColor[1], lighting.diffuseColor[2] };
+        }
+
+        Float3 diffuse = DefaultAmbientColor;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            diffuse += lightColors[i] * std::max(0.f, -normal.Dot(lightDirections[i]));
+        }
+
+        color.r *= diffuse.x;
+        color.g *= diffuse.y;
+        color.b *= diffuse.z;
+
+        if (state.pipeline.program == ShaderProgram::EnvironmentMap && state.textures[1] != InvalidHandle)
+        {
+            const Texture& cube = m_textures[state.textures[1] - 1];
+            const Float3 eye = (state.eye - position).Normalized();
+            const float facing = normal.Dot(eye);
+            const Float3 reflected = normal * (2.f * facing) - eye;
+
+            if (cube.live && cube.desc.arraySize == 6)
+            {
+                float u, v;
+                uint32_t face = CubeFace(reflected, u, v);
+                const Surface& surface = cube.surfaces[face * cube.desc.mipLevels];
+                Color env = SampleBilinear(surface.texels.data(), surface.width, surface.height, u, v);
+
+                float fresnel = std::pow(1.f - Saturate(facing), std::max(0.f, lighting.fresnelFactor));
+                color.r += (env.r - color.r) * fresnel;
+                color.g += (env.g - color.g) * fresnel;
+                color.b += (env.b - color.b) * fresnel;
+            }
+        }
+
+        if (state.pipeline.program == ShaderProgram::LitFog && lighting.fogEnd > lighting.fogStart)
+        {
+            float fog = Saturate(((state.eye - position).Length() - lighting.fogStart) / (lighting.fogEnd - lighting.fogStart));
+            color.r += (lighting.fogColor[0] - color.r) * fog;
+            color.g += (lighting.fogColor[1] - color.g) * fog;
+            color.b += (lighting.fogColor[2] - color.b) * fog;
+        }
+    }
+
+    switch (state.pipeline.blend)
+    {
+    case BlendMode::AlphaBlend:
+    {
+        Color d = Unpack(dest);
+        float s = Saturate(color.a);
+        color = Color{ color.r * s + d.r * (1.f - s), color.g * s + d.g * (1.f - s), color.b * s + d.b * (1.f - s), color.a + d.a * (1.f - s) };
+        break;
+    }
+    case BlendMode::Additive:
+    {
+        Color d = Unpack(dest);
+        float s = Saturate(color.a);
+        color = Color{ color.r * s + d.r, color.g * s + d.g, color.b * s + d.b, color.a + d.a };
+        break;
+    }
+    default:
+        break;
+    }
+
+    return Pack(color);
+}
@@ -0,0 +1,205 @@
+//
+// SoftwareGraphicsBackend.h - Tile-binned CPU rasterizer behind IGraphicsBackend,
+// for rendering and regression-testing frames on machines without a GPU
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "GraphicsBackend.h"
+#include "JobSystem.h"
+
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    // Counters for the most recent frame, on top of BackendStats.
+    struct SoftwareRasterStats
+    {
+        uint32_t trianglesBinned;       // Survived clipping and culling.
+        uint32_t trianglesCulled;       // Back-facing, degenerate or off screen.
+        uint32_t trianglesClipped;      // Split against the near plane.
+        uint32_t binEntries;            // Triangle references across all tiles.
+        uint64_t pixelsShaded;
+        uint64_t setupNanoseconds;      // Vertex processing, clipping and binning.
+        uint64_t rasterNanoseconds;     // Tile rasterization, summed over flushes.
+    };
+
+    // Draw calls transform vertices and bin triangles into 64x64 screen tiles
+    // straight away; the tiles are rasterized in parallel when the frame ends
+    // (or something needs the render target earlier). Coverage and depth are
+    // tested four pixels at a time with SSE2 where available. Shading mirrors
+    // the scene's effects: vertex colour, textured default lighting, the
+    // skull's light and fog, and the teapot's environment map. Textures are
+    // decoded to RGBA8 on creation and sampled bilinearly from one mip chosen
+    // per triangle.
+    class SoftwareGraphicsBackend : public IGraphicsBackend
+    {
+    public:
+        explicit SoftwareGraphicsBackend(JobSystem& jobs);
+
+        SoftwareGraphicsBackend(SoftwareGraphicsBackend const&) = delete;
+        SoftwareGraphicsBackend& operator=(SoftwareGraphicsBackend const&) = delete;
+
+        BufferHandle CreateBuffer(const BufferDesc& desc, const void* initialData) override;
+        TextureHandle CreateTexture(const TextureDesc& desc, const TextureSubresourceData* initialData) override;
+        PipelineHandle CreatePipelineState(const PipelineDesc& desc) override;
+
+        void DestroyBuffer(BufferHandle buffer) override;
+        void DestroyTexture(TextureHandle texture) override;
+        void DestroyPipelineState(PipelineHandle pipeline) override;
+
+        void UpdateBuffer(BufferHandle buffer, const void* data, uint32_t sizeBytes) override;
+
+        void BeginFrame() override;
+        void EndFrame() override;
+        void Clear(const float color[4], float depth) override;
+        void SetViewport(uint32_t width, uint32_t height) override;
+
+        void SetPipelineState(PipelineHandle pipeline) override;
+        void SetVertexBuffer(BufferHandle buffer, uint32_t strideBytes, uint32_t offsetBytes) override;
+        void SetIndexBuffer(BufferHandle buffer, uint32_t offsetBytes) override;
+        void SetConstantBuffer(uint32_t slot, BufferHandle buffer) override;
+        void SetTexture(uint32_t slot, TextureHandle texture) override;
+        void Draw(uint32_t vertexCount, uint32_t startVertex) override;
+        void DrawIndexed(uint32_t indexCount, uint32_t startIndex, int32_t baseVertex) override;
+
+        const BackendStats& GetFrameStats() const override     { return m_stats; }
+        const SoftwareRasterStats& GetRasterStats() const       { return m_rasterStats; }
+
+        // Rasterizes everything submitted so far.
+        void Flush();
+
+        // The render target as RGBA8 (R in the low byte), GetPitch texels per row.
+        uint32_t GetWidth() const                   { return m_width; }
+        uint32_t GetHeight() const                  { return m_height; }
+        uint32_t GetPitch() const                   { return m_pitch; }
+        const uint32_t* GetColorBuffer() const      { return m_color.data(); }
+        const float* GetDepthBuffer() const         { return m_depth.data(); }
+
+        // Writes the current render target to a BMP file.
+        void SaveFrame(const std::string& path);
+
+        static const uint32_t TileSize = 64;
+        static const uint32_t MaxTextureSlots = 2;
+        static const uint32_t MaxAttributes = 8;
+
+    private:
+        struct Buffer
+        {
+            BufferDesc              desc;
+            std::vector<uint8_t>    data;
+            bool                    live;
+        };
+
+        struct Surface
+        {
+            uint32_t                width;
+            uint32_t                height;
+            std::vector<uint32_t>   texels;
+        };
+
+        struct Texture
+        {
+            TextureDesc             desc;
+            std::vector<Surface>    surfaces;   // Array slice major, then mip.
+            bool                    live;
+        };
+
+        struct Pipeline
+        {
+            PipelineDesc            desc;
+            bool                    live;
+        };
+
+        // Everything the pixel stage needs from the state at draw time.
+        struct DrawState
+        {
+            PipelineDesc        pipeline;
+            TextureHandle       textures[MaxTextureSlots];
+            LightingConstants   lighting;
+            Float3              eye;
+        };
+
+        struct ClipVertex
+        {
+            float x, y, z, w;
+            float attributes[MaxAttributes];
+        };
+
+        // value(x, y) = origin + dx * (x - Triangle::ox) + dy * (y - Triangle::oy)
+        struct Plane
+        {
+            float dx, dy, origin;
+        };
+
+        struct Triangle
+        {
+            float       ox, oy;
+            float       edgeA[3], edgeB[3];     // Edge i: A * (x - edgeX) + B * (y - edgeY) >= 0 inside.
+            float       edgeX[3], edgeY[3];
+            uint32_t    topLeft;                // Bit i set if edge i owns pixels lying exactly on it.
+            int32_t     minX, minY, maxX, maxY; // Half-open pixel bounds.
+            Plane       depth;
+            Plane       invW;
+            Plane       attributes[MaxAttributes];
+            uint32_t    attributeCount;
+            uint32_t    state;
+            uint32_t    mip;
+        };
+
+        // Padded to a cache line so worker threads do not share one.
+        struct ThreadCounters
+        {
+            uint64_t pixelsShaded;
+            uint8_t  padding[56];
+        };
+
+        void ResizeTargets(uint32_t width, uint32_t height);
+        void SubmitTriangles(const uint16_t* indices, uint32_t count, int32_t baseVertex);
+        uint32_t TransformVertices(uint32_t first, uint32_t count, const PipelineDesc& pipeline,
+            const Matrix44& world, const Matrix44& worldViewProjection);
+        void ClipTriangle(const ClipVertex* v[3], uint32_t attributeCount, uint32_t stateIndex);
+        void SetupTriangle(const ClipVertex* v[3], uint32_t attributeCount, uint32_t stateIndex);
+        void BinTriangle(uint32_t index);
+        void RasterizeTile(uint32_t tile, uint32_t threadIndex);
+        void RasterizeTriangle(const Triangle& tri, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint64_t& pixelsShaded);
+        uint32_t ShadePixel(const Triangle& tri, const DrawState& state, float x, float y, uint32_t dest) const;
+
+        JobSystem&                          m_jobs;
+
+        std::vector<Buffer>                 m_buffers;
+        std::vector<Texture>                m_textures;
+        std::vector<Pipeline>               m_pipelines;
+
+        // Bound state.
+        PipelineHandle                      m_pipeline;
+        BufferHandle                        m_vertexBuffer;
+        uint32_t                            m_vertexStride;
+        uint32_t                            m_vertexOffset;
+        BufferHandle                        m_indexBuffer;
+        uint32_t                            m_indexOffset;
+        BufferHandle                        m_constantBuffers[2];
+        TextureHandle                       m_boundTextures[MaxTextureSlots];
+
+        // Render target.
+        uint32_t                            m_width;
+        uint32_t                            m_height;
+        uint32_t                            m_pitch;
+        uint32_t                            m_tilesX;
+        uint32_t                            m_tilesY;
+        std::vector<uint32_t>               m_color;
+        std::vector<float>                  m_depth;
+
+        // Work binned for the next flush.
+        std::vector<ClipVertex>             m_clipVertices;
+        std::vector<DrawState>              m_drawStates;
+        std::vector<Triangle>               m_triangles;
+        std::vector<std::vector<uint32_t>>  m_bins;
+        std::vector<ThreadCounters>         m_threadCounters;
+
+        BackendStats                        m_stats;
+        SoftwareRasterStats                 m_rasterStats;
+    };
+}
@@ -0,0 +1,99 @@
+//
+// SpscQueue.h - Bounded lock-free queue for exactly one producer thread and
+// one consumer thread
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace DX
+{
+    // A power-of-two ring indexed by two free-running counters. The producer
+    // only writes m_tail and the consumer only writes m_head, so neither side
+    // ever waits; a full queue rejects the push instead. The counters sit on
+    // separate cache lines so the two threads do not bounce one line.
+    template <typename T>
+    class SpscQueue
+    {
+    public:
+        // capacity is rounded up to a power of two.
+        explicit SpscQueue(uint32_t capacity) :
+            m_head(0),
+            m_tail(0)
+        {
+            uint32_t size = 1;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            m_items.resize(size);
+            m_mask = size - 1;
+        }
+
+        SpscQueue(SpscQueue const&) = delete;
+        SpscQueue& operator=(SpscQueue const&) = delete;
+
+        // Producer. Returns false if the queue is full.
+        bool TryPush(const T& item)
+        {
+            uint32_t tail = m_tail.load(std::memory_order_relaxed);
+            if (tail - m_head.load(std::memory_order_acquire) > m_mask)
+            {
+                return false;
+            }
+
+            m_items[tail & m_mask] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer. The oldest item, or null if empty. Stays valid until Pop.
+        const T* Peek() const
+        {
+            uint32_t head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail.load(std::memory_order_acquire))
+            {
+                return nullptr;
+            }
+            return &m_items[head & m_mask];
+        }
+
+        // Consumer. Discards the item Peek returned.
+        void Pop()
+        {
+            m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Consumer. Returns false if empty.
+        bool TryPop(T& item)
+        {
+            const T* front = Peek();
+            if (!front)
+            {
+                return false;
+            }
+            item = *front;
+            Pop();
+            return true;
+        }
+
+        uint32_t GetCapacity() const    { return m_mask + 1; }
+
+        // Exact only when called from one of the two sides while the other is idle.
+        uint32_t GetSize() const        { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+
+    private:
+        static const size_t CacheLineBytes = 64;
+
+        std::vector<T>          m_items;
+        uint32_t                m_mask;
+        std::atomic<uint32_t>   m_head;     // Next item to read; written by the consumer.
+        uint8_t                 m_padding[CacheLineBytes - sizeof(std::atomic<uint32_t>)];
+        std::atomic<uint32_t>   m_tail;     // Next slot to write; written by the producer.
+    };
+}
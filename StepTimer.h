@@ -8,9 +8,14 @@
 #include <exception>
 #include <stdint.h>
 
+#if !defined(_WIN32)
+#include <chrono>
+#endif
+
 namespace DX
 {
-    // Helper class for animation and simulation timing.
+    // Helper class for animation and simulation timing. Off Windows the
+    // performance counter is std::chrono::steady_clock, in nanoseconds.
     class StepTimer
     {
     public:
@@ -22,21 +27,15 @@ namespace DX
             m_framesPerSecond(0),
             m_framesThisSecond(0),
             m_qpcSecondCounter(0),
+            m_lastTickDelta(0),
             m_isFixedTimeStep(false),
             m_targetElapsedTicks(TicksPerSecond / 60)
         {
-            if (!QueryPerformanceFrequency(&m_qpcFrequency))
-            {
-                throw std::exception( "QueryPerformanceFrequency" );
-            }
-
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception( "QueryPerformanceCounter" );
-            }
+            m_qpcFrequency = QueryFrequency();
+            m_qpcLastTime = QueryCounter();
 
             // Initialize max delta to 1/10 of a second.
-            m_qpcMaxDelta = static_cast<uint64_t>(m_qpcFrequency.QuadPart / 10);
+            m_qpcMaxDelta = m_qpcFrequency / 10;
         }
 
         // Get elapsed time since the previous Update call.
@@ -47,12 +46,43 @@ namespace DX
         uint64_t GetTotalTicks() const						{ return m_totalTicks; }
         double GetTotalSeconds() const						{ return TicksToSeconds(m_totalTicks); }
 
+        // Get the time the last Tick or Advance added, before fixed timestep rounding.
+        // Passing it back to Advance repeats that tick exactly.
+        uint64_t GetLastTickDelta() const					{ return m_lastTickDelta; }
+
         // Get total number of updates since start of the program.
         uint32_t GetFrameCount() const						{ return m_frameCount; }
 
         // Get the current framerate.
         uint32_t GetFramesPerSecond() const					{ return m_framesPerSecond; }
 
+        // Get how long until the next Update is due, measured from now. Zero in variable
+        // timestep mode, where every Tick updates.
+        uint64_t GetTicksUntilNextUpdate() const
+        {
+            if (!m_isFixedTimeStep)
+            {
+                return 0;
+            }
+
+            uint64_t timeDelta = QueryCounter() - m_qpcLastTime;
+            if (timeDelta > m_qpcMaxDelta)
+            {
+                timeDelta = m_qpcMaxDelta;
+            }
+
+            uint64_t pending = m_leftOverTicks + timeDelta * TicksPerSecond / m_qpcFrequency;
+            return pending < m_targetElapsedTicks ? m_targetElapsedTicks - pending : 0;
+        }
+
+        // Get how far the time not yet consumed by fixed updates reaches into the next
+        // update, from 0 up to 1. Rendering blends the last two updates by it. Always 1
+        // in variable timestep mode, which leaves nothing over.
+        double GetBlendFactor() const
+        {
+            return m_isFixedTimeStep ? static_cast<double>(m_leftOverTicks) / m_targetElapsedTicks : 1.0;
+        }
+
         // Set whether to use fixed or variable timestep mode.
         void SetFixedTimeStep(bool isFixedTimestep)			{ m_isFixedTimeStep = isFixedTimestep; }
 
@@ -72,10 +102,7 @@ namespace DX
 
         void ResetElapsedTime()
         {
-            if (!QueryPerformanceCounter(&m_qpcLastTime))
-            {
-                throw std::exception("QueryPerformanceCounter");
-            }
+            m_qpcLastTime = QueryCounter();
 
             m_leftOverTicks = 0;
             m_framesPerSecond = 0;
@@ -88,14 +115,9 @@ namespace DX
         void Tick(const TUpdate& update)
         {
             // Query the current time.
-            LARGE_INTEGER currentTime;
+            uint64_t currentTime = QueryCounter();
 
-            if (!QueryPerformanceCounter(&currentTime))
-            {
-                throw std::exception( "QueryPerformanceCounter" );
-            }
-
-            uint64_t timeDelta = static_cast<uint64_t>(currentTime.QuadPart - m_qpcLastTime.QuadPart);
+            uint64_t timeDelta = currentTime - m_qpcLastTime;
 
             m_qpcLastTime = currentTime;
             m_qpcSecondCounter += timeDelta;
@@ -108,10 +130,34 @@ namespace DX
 
             // Convert QPC units into a canonical tick format. This cannot overflow due to the previous clamp.
             timeDelta *= TicksPerSecond;
-            timeDelta /= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+            timeDelta /= m_qpcFrequency;
 
             uint32_t lastFrameCount = m_frameCount;
 
+            Advance(timeDelta, update);
+
+            // Track the current framerate.
+            if (m_frameCount != lastFrameCount)
+            {
+                m_framesThisSecond++;
+            }
+
+            if (m_qpcSecondCounter >= m_qpcFrequency)
+            {
+                m_framesPerSecond = m_framesThisSecond;
+                m_framesThisSecond = 0;
+                m_qpcSecondCounter %= m_qpcFrequency;
+            }
+        }
+
+        // Run the Update logic for timeDelta ticks without reading the clock, so a
+        // recorded session (see InputRecording) replays with exactly the steps it had.
+        // Leaves the framerate alone.
+        template<typename TUpdate>
+        void Advance(uint64_t timeDelta, const TUpdate& update)
+        {
+            m_lastTickDelta = timeDelta;
+
             if (m_isFixedTimeStep)
             {
                 // Fixed timestep update logic
@@ -150,25 +196,46 @@ namespace DX
 
                 update();
             }
+        }
 
-            // Track the current framerate.
-            if (m_frameCount != lastFrameCount)
+    private:
+#if defined(_WIN32)
+        static uint64_t QueryFrequency()
+        {
+            LARGE_INTEGER frequency;
+
+            if (!QueryPerformanceFrequency(&frequency))
             {
-                m_framesThisSecond++;
+                throw std::exception( "QueryPerformanceFrequency" );
             }
 
-            if (m_qpcSecondCounter >= static_cast<uint64_t>(m_qpcFrequency.QuadPart))
+            return static_cast<uint64_t>(frequency.QuadPart);
+        }
+
+        static uint64_t QueryCounter()
+        {
+            LARGE_INTEGER counter;
+
+            if (!QueryPerformanceCounter(&counter))
             {
-                m_framesPerSecond = m_framesThisSecond;
-                m_framesThisSecond = 0;
-                m_qpcSecondCounter %= static_cast<uint64_t>(m_qpcFrequency.QuadPart);
+                throw std::exception( "QueryPerformanceCounter" );
             }
+
+            return static_cast<uint64_t>(counter.QuadPart);
         }
+#else
+        static uint64_t QueryFrequency()					{ return 1000000000; }
+
+        static uint64_t QueryCounter()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+#endif
 
-    private:
         // Source timing data uses QPC units.
-        LARGE_INTEGER m_qpcFrequency;
-        LARGE_INTEGER m_qpcLastTime;
+        uint64_t m_qpcFrequency;
+        uint64_t m_qpcLastTime;
         uint64_t m_qpcMaxDelta;
 
         // Derived timing data uses a canonical tick format.
@@ -181,6 +248,7 @@ namespace DX
         uint32_t m_framesPerSecond;
         uint32_t m_framesThisSecond;
         uint64_t m_qpcSecondCounter;
+        uint64_t m_lastTickDelta;
 
         // Members for configuring fixed timestep mode.
         bool m_isFixedTimeStep;
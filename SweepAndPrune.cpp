@@ -0,0 +1,459 @@
+//
+// SweepAndPrune.cpp
+//
+
+#include "SweepAndPrune.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const uint64_t EmptyKey = ~0ull;
+    const size_t InitialPairSlots = 256;
+
+    uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point start)
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    float Component(const Float3& v, uint32_t axis)
+    {
+        return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+    }
+
+    uint64_t PairKey(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    size_t PairHome(uint64_t key, size_t mask)
+    {
+        return size_t((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    }
+}
+
+BroadphaseBox DX::ComputeWorldBox(const Matrix44& world, const Float3& center, const Float3& extents)
+{
+    const Float3 worldCenter = world.TransformNormal(center) + world.Translation();
+    const Float3 worldExtents =
+    {
+        std::fabs(world.m[0][0]) * extents.x + std::fabs(world.m[1][0]) * extents.y + std::fabs(world.m[2][0]) * extents.z,
+        std::fabs(world.m[0][1]) * extents.x + std::fabs(world.m[1][1]) * extents.y + std::fabs(world.m[2][1]) * extents.z,
+        std::fabs(world.m[0][2]) * extents.x + std::fabs(world.m[1][2]) * extents.y + std::fabs(world.m[2][2]) * extents.z,
+    };
+    return BroadphaseBox{ worldCenter - worldExtents, worldCenter + worldExtents };
+}
+
+SweepAndPrune::SweepAndPrune() :
+    m_liveBodies(0),
+    m_pairs(InitialPairSlots, PairSlot{ EmptyKey, 0 }),
+    m_pairSlotsUsed(0),
+    m_pairCount(0),
+    m_stats{}
+{
+}
+
+uint32_t SweepAndPrune::AddBody(const BroadphaseBox& box)
+{
+    uint32_t body;
+    if (!m_freeBodies.empty())
+    {
+        body = m_freeBodies.back();
+        m_freeBodies.pop_back();
+        m_boxes[body] = box;
+        m_states[body] = BodyAdded;
+    }
+    else
+    {
+        body = uint32_t(m_boxes.size());
+        m_boxes.push_back(box);
+        m_states.push_back(BodyAdded);
+    }
+    m_addedBodies.push_back(body);
+    ++m_liveBodies;
+    return body;
+}
+
+void SweepAndPrune::RemoveBody(uint32_t body)
+{
+    if (body >= m_states.size() || (m_states[body] != BodyLive && m_states[body] != BodyAdded))
+    {
+        throw std::runtime_error("SweepAndPrune: removing a body that does not exist");
+    }
+    m_states[body] = BodyRemoved;
+    m_removedBodies.push_back(body);
+    --m_liveBodies;
+}
+
+bool SweepAndPrune::Overlaps(uint32_t a, uint32_t b) const
+{
+    const BroadphaseBox& boxA = m_boxes[a];
+    const BroadphaseBox& boxB = m_boxes[b];
+    return boxA.min.x <= boxB.max.x && boxB.min.x <= boxA.max.x
+        && boxA.min.y <= boxB.max.y && boxB.min.y <= boxA.max.y
+        && boxA.min.z <= boxB.max.z && boxB.min.z <= boxA.max.z;
+}
+
+SweepAndPrune::PairSlot* SweepAndPrune::FindPair(uint64_t key)
+{
+    return const_cast<PairSlot*>(static_cast<const SweepAndPrune*>(this)->FindPair(key));
+}
+
+const SweepAndPrune::PairSlot* SweepAndPrune::FindPair(uint64_t key) const
+{
+    const size_t mask = m_pairs.size() - 1;
+    for (size_t i = PairHome(key, mask);; i = (i + 1) & mask)
+    {
+        if (m_pairs[i].key == key)
+        {
+            return &m_pairs[i];
+        }
+        if (m_pairs[i].key == EmptyKey)
+        {
+            return nullptr;
+        }
+    }
+}
+
+SweepAndPrune::PairSlot& SweepAndPrune::InsertPair(uint64_t key)
+{
+    // At most half full, so probes stay short.
+    if ((m_pairSlotsUsed + 1) * 2 > m_pairs.size())
+    {
+        GrowPairs();
+    }
+
+    const size_t mask = m_pairs.size() - 1;
+    size_t i = PairHome(key, mask);
+    while (m_pairs[i].key != EmptyKey)
+    {
+        i = (i + 1) & mask;
+    }
+    m_pairs[i] = PairSlot{ key, 0 };
+    ++m_pairSlotsUsed;
+    return m_pairs[i];
+}
+
+// Shifts later entries of the probe run back over the hole, so lookups
+// never need tombstones.
+void SweepAndPrune::ErasePair(PairSlot& slot)
+{
+    const size_t mask = m_pairs.size() - 1;
+    size_t hole = size_t(&slot - m_pairs.data());
+    for (size_t i = (hole + 1) & mask; m_pairs[i].key != EmptyKey; i = (i + 1) & mask)
+    {
+        // Entries whose home lies cyclically in (hole, i] stay put.
+        const size_t home = PairHome(m_pairs[i].key, mask);
+        const bool stays = (hole <= i) ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!stays)
+        {
+            m_pairs[hole] = m_pairs[i];
+            hole = i;
+        }
+    }
+    m_pairs[hole] = PairSlot{ EmptyKey, 0 };
+    --m_pairSlotsUsed;
+}
+
+void SweepAndPrune::GrowPairs()
+{
+    std::vector<PairSlot> old(m_pairs.size() * 2, PairSlot{ EmptyKey, 0 });
+    old.swap(m_pairs);
+
+    const size_t mask = m_pairs.size() - 1;
+    for (const PairSlot& slot : old)
+    {
+        if (slot.key == EmptyKey)
+        {
+            continue;
+        }
+        size_t i = PairHome(slot.key, mask);
+        while (m_pairs[i].key != EmptyKey)
+        {
+            i = (i + 1) & mask;
+        }
+        m_pairs[i] = slot;
+    }
+}
+
+// Records a change of overlap. The first change in an Update remembers
+// whether the pair overlapped before it, so the events can be netted out
+// at the end.
+void SweepAndPrune::SetPair(uint32_t a, uint32_t b, bool present)
+{
+    const uint64_t key = PairKey(a, b);
+    PairSlot* slot = FindPair(key);
+    if (present)
+    {
+        if (slot && (slot->flags & PairPresent))
+        {
+            return;
+        }
+        if (!slot)
+        {
+            slot = &InsertPair(key);
+        }
+        else if (!(slot->flags & PairTouched))
+        {
+            slot->flags |= PairWasPresent;
+        }
+        slot->flags |= PairPresent;
+        ++m_pairCount;
+    }
+    else
+    {
+        if (!slot || !(slot->flags & PairPresent))
+        {
+            return;
+        }
+        if (!(slot->flags & PairTouched))
+        {
+            slot->flags |= PairWasPresent;
+        }
+        slot->flags &= ~PairPresent;
+        --m_pairCount;
+    }
+
+    if (!(slot->flags & PairTouched))
+    {
+        slot->flags |= PairTouched;
+        m_touched.push_back(key);
+    }
+}
+
+bool SweepAndPrune::HasPair(uint32_t a, uint32_t b) const
+{
+    const PairSlot* slot = FindPair(PairKey(a, b));
+    return slot && (slot->flags & PairPresent);
+}
+
+void SweepAndPrune::GetPairs(std::vector<BroadphasePair>& pairs) const
+{
+    pairs.clear();
+    for (const PairSlot& slot : m_pairs)
+    {
+        if (slot.key != EmptyKey && (slot.flags & PairPresent))
+        {
+            pairs.push_back(BroadphasePair{ uint32_t(slot.key >> 32), uint32_t(slot.key) });
+        }
+    }
+}
+
+void SweepAndPrune::RemoveBodies()
+{
+    if (m_removedBodies.empty())
+    {
+        return;
+    }
+
+    for (std::vector<Endpoint>& endpoints : m_axes)
+    {
+        endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(), [this](const Endpoint& endpoint)
+        {
+            return m_states[endpoint.data >> 1] == BodyRemoved;
+        }), endpoints.end());
+    }
+
+    // SetPair only clears flags here, so the table does not move under the loop.
+    for (const PairSlot& slot : m_pairs)
+    {
+        if (slot.key == EmptyKey || !(slot.flags & PairPresent))
+        {
+            continue;
+        }
+        const uint32_t a = uint32_t(slot.key >> 32), b = uint32_t(slot.key);
+        if (m_states[a] == BodyRemoved || m_states[b] == BodyRemoved)
+        {
+            SetPair(a, b, false);
+        }
+    }
+
+    for (uint32_t body : m_removedBodies)
+    {
+        m_states[body] = BodyFree;
+        m_freeBodies.push_back(body);
+    }
+    m_removedBodies.clear();
+}
+
+void SweepAndPrune::SortAxis(uint32_t axis)
+{
+    std::vector<Endpoint>& endpoints = m_axes[axis];
+    for (Endpoint& endpoint : endpoints)
+    {
+        const BroadphaseBox& box = m_boxes[endpoint.data >> 1];
+        endpoint.value = Component((endpoint.data & 1) ? box.max : box.min, axis);
+    }
+
+    // Ties put mins first, so boxes touching at a face overlap here too.
+    uint32_t swaps = 0;
+    for (size_t i = 1, count = endpoints.size(); i < count; ++i)
+    {
+        const Endpoint endpoint = endpoints[i];
+        const bool isMax = (endpoint.data & 1) != 0;
+        size_t j = i;
+        for (; j > 0; --j)
+        {
+            const Endpoint& before = endpoints[j - 1];
+            const bool beforeIsMax = (before.data & 1) != 0;
+            if (!(endpoint.value < before.value || (endpoint.value == before.value && !isMax && beforeIsMax)))
+            {
+                break;
+            }
+
+            if (!isMax && beforeIsMax)
+            {
+                if (Overlaps(endpoint.data >> 1, before.data >> 1))
+                {
+                    SetPair(endpoint.data >> 1, before.data >> 1, true);
+                }
+            }
+            else if (isMax && !beforeIsMax)
+            {
+                SetPair(endpoint.data >> 1, before.data >> 1, false);
+            }
+            endpoints[j] = before;
+            ++swaps;
+        }
+        endpoints[j] = endpoint;
+    }
+    m_stats.swaps += swaps;
+}
+
+void SweepAndPrune::InsertBodies()
+{
+    if (m_addedBodies.empty())
+    {
+        return;
+    }
+
+    auto before = [](const Endpoint& a, const Endpoint& b)
+    {
+        return a.value < b.value || (a.value == b.value && !(a.data & 1) && (b.data & 1));
+    };
+
+    uint32_t inserted = 0;
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        m_merge.clear();
+        for (uint32_t body : m_addedBodies)
+        {
+            if (m_states[body] == BodyAdded)
+            {
+                m_merge.push_back(Endpoint{ Component(m_boxes[body].min, axis), body << 1 });
+                m_merge.push_back(Endpoint{ Component(m_boxes[body].max, axis), (body << 1) | 1 });
+            }
+        }
+        std::sort(m_merge.begin(), m_merge.end(), before);
+        inserted = uint32_t(m_merge.size() / 2);
+
+        // Merge from the back, in place.
+        std::vector<Endpoint>& endpoints = m_axes[axis];
+        size_t i = endpoints.size(), j = m_merge.size();
+        endpoints.resize(i + j);
+        for (size_t k = endpoints.size(); j > 0;)
+        {
+            if (i > 0 && before(m_merge[j - 1], endpoints[i - 1]))
+            {
+                endpoints[--k] = endpoints[--i];
+            }
+            else
+            {
+                endpoints[--k] = m_merge[--j];
+            }
+        }
+    }
+
+    // One sweep along x finds every pair with a new body: each box meets
+    // the boxes still open when its min goes past.
+    m_active.clear();
+    for (const Endpoint& endpoint : m_axes[0])
+    {
+        const uint32_t body = endpoint.data >> 1;
+        if (endpoint.data & 1)
+        {
+            auto found = std::find(m_active.begin(), m_active.end(), body);
+            *found = m_active.back();
+            m_active.pop_back();
+            continue;
+        }
+
+        const bool isNew = m_states[body] == BodyAdded;
+        for (uint32_t other : m_active)
+        {
+            if ((isNew || m_states[other] == BodyAdded) && Overlaps(body, other))
+            {
+                SetPair(body, other, true);
+            }
+        }
+        m_active.push_back(body);
+    }
+
+    for (uint32_t body : m_addedBodies)
+    {
+        if (m_states[body] == BodyAdded)
+        {
+            m_states[body] = BodyLive;
+        }
+    }
+    m_addedBodies.clear();
+    m_stats.insertedBodies = inserted;
+}
+
+void SweepAndPrune::Update()
+{
+    DX_PROFILE_SCOPE("SweepAndPrune::Update");
+    auto start = std::chrono::steady_clock::now();
+
+    m_added.clear();
+    m_removed.clear();
+    m_touched.clear();
+    m_stats.swaps = 0;
+    m_stats.insertedBodies = 0;
+
+    RemoveBodies();
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        SortAxis(axis);
+    }
+    InsertBodies();
+
+    // Net out what changed: a pair that started and stopped (or the other
+    // way round) within this Update reports nothing.
+    for (uint64_t key : m_touched)
+    {
+        PairSlot* slot = FindPair(key);
+        const bool present = (slot->flags & PairPresent) != 0;
+        const bool wasPresent = (slot->flags & PairWasPresent) != 0;
+        const BroadphasePair pair = { uint32_t(key >> 32), uint32_t(key) };
+        if (present && !wasPresent)
+        {
+            m_added.push_back(pair);
+        }
+        else if (!present && wasPresent)
+        {
+            m_removed.push_back(pair);
+        }
+
+        if (present)
+        {
+            slot->flags = PairPresent;
+        }
+        else
+        {
+            ErasePair(*slot);
+        }
+    }
+
+    m_stats.bodies = m_liveBodies;
+    m_stats.pairs = m_pairCount;
+    m_stats.added = uint32_t(m_added.size());
+    m_stats.removed = uint32_t(m_removed.size());
+    m_stats.updateNanoseconds = ElapsedNanoseconds(start);
+}
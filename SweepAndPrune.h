@@ -0,0 +1,138 @@
+//
+// SweepAndPrune.h - Incremental sweep-and-prune broadphase: sorted AABB
+// endpoints per axis, kept sorted across steps, reporting overlap pairs as
+// they start and stop
+//
+
+#pragma once
+
+#include "CpuMath.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace DX
+{
+    struct BroadphaseBox
+    {
+        Float3 min;
+        Float3 max;
+    };
+
+    // Always a < b.
+    struct BroadphasePair
+    {
+        uint32_t a;
+        uint32_t b;
+    };
+
+    struct BroadphaseStats
+    {
+        uint32_t bodies;
+        uint32_t pairs;             // Overlapping after the last Update.
+        uint32_t added;             // Pairs that started overlapping in the last Update.
+        uint32_t removed;           // Pairs that stopped.
+        uint32_t swaps;             // Endpoint swaps while re-sorting.
+        uint32_t insertedBodies;
+        uint64_t updateNanoseconds;
+    };
+
+    // The world box of a model-space box under a transform.
+    BroadphaseBox ComputeWorldBox(const Matrix44& world, const Float3& center, const Float3& extents);
+
+    // Usage: AddBody, SetBounds whenever a body moves, then Update once per
+    // step and read the pair events. Bodies are numbered by AddBody; ids
+    // of removed bodies are handed out again after the next Update.
+    //
+    // Each axis keeps the bodies' min and max endpoints sorted. Update
+    // re-sorts them by insertion sort, which is close to linear when bodies
+    // move a little between steps; a min passing a max is the only way two
+    // boxes can start overlapping, and a max passing a min the only way
+    // they can stop, so only those swaps touch the pair set. Bodies added
+    // since the last Update are merged in afterwards and swept once along x.
+    //
+    // Boxes touching at a face count as overlapping. Pairs that start and
+    // stop within one Update produce no events.
+    class SweepAndPrune
+    {
+    public:
+        SweepAndPrune();
+
+        SweepAndPrune(SweepAndPrune const&) = delete;
+        SweepAndPrune& operator=(SweepAndPrune const&) = delete;
+
+        uint32_t AddBody(const BroadphaseBox& box);
+
+        // The body's pairs are reported removed by the next Update.
+        void RemoveBody(uint32_t body);
+
+        void SetBounds(uint32_t body, const BroadphaseBox& box)    { m_boxes[body] = box; }
+        const BroadphaseBox& GetBounds(uint32_t body) const         { return m_boxes[body]; }
+
+        void Update();
+
+        const std::vector<BroadphasePair>& GetAddedPairs() const    { return m_added; }
+        const std::vector<BroadphasePair>& GetRemovedPairs() const  { return m_removed; }
+        bool HasPair(uint32_t a, uint32_t b) const;
+
+        // Every overlapping pair, in no particular order.
+        void GetPairs(std::vector<BroadphasePair>& pairs) const;
+
+        const BroadphaseStats& GetStats() const                     { return m_stats; }
+
+    private:
+        enum BodyState : uint8_t { BodyFree, BodyLive, BodyAdded, BodyRemoved };
+
+        // value, then the body id shifted left once with the low bit set
+        // for a max.
+        struct Endpoint
+        {
+            float       value;
+            uint32_t    data;
+        };
+
+        // Entry flags: overlapping now, overlapping before this Update, and
+        // already on the touched list.
+        enum PairFlags : uint8_t { PairPresent = 1, PairWasPresent = 2, PairTouched = 4 };
+
+        struct PairSlot
+        {
+            uint64_t    key;        // EmptyKey when unused.
+            uint8_t     flags;
+        };
+
+        bool Overlaps(uint32_t a, uint32_t b) const;
+        void SortAxis(uint32_t axis);
+        void InsertBodies();
+        void RemoveBodies();
+
+        // The pair set: open addressing with linear probing.
+        PairSlot* FindPair(uint64_t key);
+        const PairSlot* FindPair(uint64_t key) const;
+        PairSlot& InsertPair(uint64_t key);
+        void ErasePair(PairSlot& slot);
+        void GrowPairs();
+        void SetPair(uint32_t a, uint32_t b, bool present);
+
+        std::vector<BroadphaseBox>  m_boxes;
+        std::vector<uint8_t>        m_states;
+        std::vector<uint32_t>       m_freeBodies;
+        std::vector<uint32_t>       m_addedBodies;
+        std::vector<uint32_t>       m_removedBodies;
+        uint32_t                    m_liveBodies;
+
+        std::vector<Endpoint>       m_axes[3];
+        std::vector<Endpoint>       m_merge;
+        std::vector<uint32_t>       m_active;
+
+        std::vector<PairSlot>       m_pairs;
+        uint32_t                    m_pairSlotsUsed;
+        uint32_t                    m_pairCount;
+        std::vector<uint64_t>       m_touched;
+
+        std::vector<BroadphasePair> m_added;
+        std::vector<BroadphasePair> m_removed;
+        BroadphaseStats             m_stats;
+    };
+}
@@ -0,0 +1,608 @@
+//
+// TextureData.cpp
+//
+
+#include "TextureData.h"
+#include "BinaryFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+    const uint32_t DDS_ALPHAPIXELS = 0x00000001;
+    const uint32_t DDS_FOURCC = 0x00000004;
+    const uint32_t DDS_RGB = 0x00000040;
+    const uint32_t DDS_CUBEMAP = 0x00000200;
+    const uint32_t DDS_CUBEMAP_ALLFACES = 0x0000FC00;
+
+    const uint32_t DDSD_CAPS = 0x00000001;
+    const uint32_t DDSD_HEIGHT = 0x00000002;
+    const uint32_t DDSD_WIDTH = 0x00000004;
+    const uint32_t DDSD_PITCH = 0x00000008;
+    const uint32_t DDSD_PIXELFORMAT = 0x00001000;
+    const uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+    const uint32_t DDSD_LINEARSIZE = 0x00080000;
+
+    const uint32_t DDSCAPS_COMPLEX = 0x00000008;
+    const uint32_t DDSCAPS_TEXTURE = 0x00001000;
+    const uint32_t DDSCAPS_MIPMAP = 0x00400000;
+
+    const uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+    const uint32_t DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+    const uint32_t DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29;
+    const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+    const uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+    const uint32_t DXGI_FORMAT_BC2_UNORM = 74;
+    const uint32_t DXGI_FORMAT_BC2_UNORM_SRGB = 75;
+    const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+    const uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+    const uint32_t DXGI_FORMAT_B8G8R8A8_UNORM = 87;
+    const uint32_t DXGI_FORMAT_B8G8R8A8_UNORM_SRGB = 91;
+
+    const uint32_t D3D11_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+    struct DDS_PIXELFORMAT
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t RGBBitCount;
+        uint32_t RBitMask;
+        uint32_t GBitMask;
+        uint32_t BBitMask;
+        uint32_t ABitMask;
+    };
+
+    struct DDS_HEADER
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        DDS_PIXELFORMAT ddspf;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+
+    struct DDS_HEADER_DXT10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+
+    static_assert(sizeof(DDS_HEADER) == 124, "DDS header size mismatch");
+    static_assert(sizeof(DDS_HEADER_DXT10) == 20, "DDS DX10 header size mismatch");
+
+    constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+    {
+        return uint32_t(uint8_t(a)) | (uint32_t(uint8_t(b)) << 8) | (uint32_t(uint8_t(c)) << 16) | (uint32_t(uint8_t(d)) << 24);
+    }
+
+    TextureFormat FormatFromDXGI(uint32_t format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:   return TextureFormat::RGBA8;
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:   return TextureFormat::BGRA8;
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:        return TextureFormat::BC1;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:        return TextureFormat::BC2;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:        return TextureFormat::BC3;
+        default:
+            throw std::runtime_error("LoadDDS: unsupported DXGI format");
+        }
+    }
+
+    TextureFormat FormatFromPixelFormat(const DDS_PIXELFORMAT& pf)
+    {
+        if (pf.flags & DDS_FOURCC)
+        {
+            switch (pf.fourCC)
+            {
+            case MakeFourCC('D', 'X', 'T', '1'): return TextureFormat::BC1;
+            case MakeFourCC('D', 'X', 'T', '2'):
+            case MakeFourCC('D', 'X', 'T', '3'): return TextureFormat::BC2;
+            case MakeFourCC('D', 'X', 'T', '4'):
+            case MakeFourCC('D', 'X', 'T', '5'): return TextureFormat::BC3;
+            default: break;
+            }
+        }
+        else if ((pf.flags & DDS_RGB) && pf.RGBBitCount == 32)
+        {
+            if (pf.RBitMask == 0x000000ff && pf.GBitMask == 0x0000ff00 && pf.BBitMask == 0x00ff0000)
+                return TextureFormat::RGBA8;
+            if (pf.RBitMask == 0x00ff0000 && pf.GBitMask == 0x0000ff00 && pf.BBitMask == 0x000000ff)
+                return TextureFormat::BGRA8;
+        }
+
+        throw std::runtime_error("LoadDDS: unsupported pixel format");
+    }
+
+    uint32_t PackRGBA(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+    {
+        return r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    // Expands a 5:6:5 endpoint to 8 bits per channel.
+    void Unpack565(uint16_t c, uint32_t rgb[3])
+    {
+        uint32_t r = (c >> 11) & 0x1F, g = (c >> 5) & 0x3F, b = c & 0x1F;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Decodes the colour half of a BC1-BC3 block into 16 texels. BC2 and BC3
+    // always use the four-colour mode; alpha is filled in separately.
+    void DecodeColorBlock(const uint8_t* block, bool allowPunchThrough, uint32_t texels[16])
+    {
+        uint16_t c0 = uint16_t(block[0] | (block[1] << 8));
+        uint16_t c1 = uint16_t(block[2] | (block[3] << 8));
+        uint32_t indices = uint32_t(block[4]) | (uint32_t(block[5]) << 8) | (uint32_t(block[6]) << 16) | (uint32_t(block[7]) << 24);
+
+        uint32_t e0[3], e1[3];
+        Unpack565(c0, e0);
+        Unpack565(c1, e1);
+
+        uint32_t palette[4];
+        palette[0] = PackRGBA(e0[0], e0[1], e0[2], 255);
+        palette[1] = PackRGBA(e1[0], e1[1], e1[2], 255);
+
+        if (c0 > c1 || !allowPunchThrough)
+        {
+            palette[2] = PackRGBA((2 * e0[0] + e1[0]) / 3, (2 * e0[1] + e1[1]) / 3, (2 * e0[2] + e1[2]) / 3, 255);
+            palette[3] = PackRGBA((e0[0] + 2 * e1[0]) / 3, (e0[1] + 2 * e1[1]) / 3, (e0[2] + 2 * e1[2]) / 3, 255);
+        }
+        else
+        {
+            palette[2] = PackRGBA((e0[0] + e1[0]) / 2, (e0[1] + e1[1]) / 2, (e0[2] + e1[2]) / 2, 255);
+            palette[3] = 0;
+        }
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            texels[i] = palette[(indices >> (i * 2)) & 3];
+        }
+    }
+
+    void DecodeExplicitAlpha(const uint8_t* block, uint32_t texels[16])
+    {
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t a = (block[i / 2] >> ((i & 1) * 4)) & 0xF;
+            texels[i] = (texels[i] & 0x00FFFFFF) | ((a * 17) << 24);
+        }
+    }
+
+    void DecodeInterpolatedAlpha(const uint8_t* block, uint32_t texels[16])
+    {
+        uint32_t a0 = block[0], a1 = block[1];
+        uint32_t palette[8] = { a0, a1 };
+
+        if (a0 > a1)
+        {
+            for (uint32_t i = 1; i < 7; ++i)
+            {
+                palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+            }
+        }
+        else
+        {
+            for (uint32_t i = 1; i < 5; ++i)
+            {
+                palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t indices = 0;
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            indices |= uint64_t(block[2 + i]) << (i * 8);
+        }
+
+        for (uint32_t i = 0; i < 16; ++i)
+        {
+            uint32_t a = palette[(indices >> (i * 3)) & 7];
+            texels[i] = (texels[i] & 0x00FFFFFF) | (a << 24);
+        }
+    }
+
+    // Magic, header and the optional DX10 extension.
+    const size_t DDS_HEADER_BYTES = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+    // Fills desc from the start of a DDS file; returns where the pixel data begins.
+    size_t ParseDDSHeader(const uint8_t* data, size_t size, TextureDesc& desc)
+    {
+        if (size < sizeof(uint32_t) + sizeof(DDS_HEADER))
+        {
+            throw std::runtime_error("LoadDDS: file too small");
+        }
+
+        uint32_t magic;
+        std::memcpy(&magic, data, sizeof(magic));
+        if (magic != DDS_MAGIC)
+        {
+            throw std::runtime_error("LoadDDS: not a DDS file");
+        }
+
+        DDS_HEADER header;
+        std::memcpy(&header, data + sizeof(uint32_t), sizeof(header));
+        size_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+
+        desc.width = header.width;
+        desc.height = header.height;
+        desc.mipLevels = std::max(1u, header.mipMapCount);
+        desc.arraySize = 1;
+        desc.cubemap = false;
+
+        if ((header.ddspf.flags & DDS_FOURCC) && header.ddspf.fourCC == MakeFourCC('D', 'X', '1', '0'))
+        {
+            if (size < offset + sizeof(DDS_HEADER_DXT10))
+            {
+                throw std::runtime_error("LoadDDS: file too small");
+            }
+
+            DDS_HEADER_DXT10 dx10;
+            std::memcpy(&dx10, data + offset, sizeof(dx10));
+            offset += sizeof(dx10);
+
+            desc.format = FormatFromDXGI(dx10.dxgiFormat);
+            desc.arraySize = std::max(1u, dx10.arraySize);
+            if (dx10.miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE)
+            {
+                desc.cubemap = true;
+                desc.arraySize *= 6;
+            }
+        }
+        else
+        {
+            desc.format = FormatFromPixelFormat(header.ddspf);
+            if (header.caps2 & DDS_CUBEMAP)
+            {
+                desc.cubemap = true;
+                desc.arraySize = 6;
+            }
+        }
+
+        return offset;
+    }
+
+    // Fills texture.surfaces from its desc, packed the way DDS files store
+    // them; returns the total payload.
+    size_t LayoutSurfaces(TextureData& texture)
+    {
+        texture.surfaces.clear();
+
+        size_t payload = 0;
+        for (uint32_t slice = 0; slice < texture.desc.arraySize; ++slice)
+        {
+            uint32_t w = texture.desc.width;
+            uint32_t h = texture.desc.height;
+            for (uint32_t mip = 0; mip < texture.desc.mipLevels; ++mip)
+            {
+                TextureSurface surface;
+                surface.width = w;
+                surface.height = h;
+                GetSurfaceInfo(texture.desc.format, w, h, surface.rowPitch, surface.slicePitch);
+                surface.offset = payload;
+                payload += surface.slicePitch;
+                texture.surfaces.push_back(surface);
+
+                w = std::max(1u, w / 2);
+                h = std::max(1u, h / 2);
+            }
+        }
+        return payload;
+    }
+}
+
+bool DX::IsBlockCompressed(TextureFormat format)
+{
+    return format == TextureFormat::BC1 || format == TextureFormat::BC2 || format == TextureFormat::BC3;
+}
+
+void DX::GetSurfaceInfo(TextureFormat format, uint32_t width, uint32_t height, uint32_t& rowPitch, uint32_t& slicePitch)
+{
+    if (IsBlockCompressed(format))
+    {
+        uint32_t blockBytes = (format == TextureFormat::BC1) ? 8 : 16;
+        uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+        uint32_t blocksHigh = std::max(1u, (height + 3) / 4);
+        rowPitch = blocksWide * blockBytes;
+        slicePitch = rowPitch * blocksHigh;
+    }
+    else
+    {
+        rowPitch = width * 4;
+        slicePitch = rowPitch * height;
+    }
+}
+
+void DX::DecodeSurfaceToRGBA8(TextureFormat format, uint32_t width, uint32_t height,
+    const void* data, uint32_t rowPitch, uint32_t* dest)
+{
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+
+    if (!IsBlockCompressed(format))
+    {
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            const uint8_t* row = src + size_t(y) * rowPitch;
+            uint32_t* out = dest + size_t(y) * width;
+
+            if (format == TextureFormat::RGBA8)
+            {
+                std::memcpy(out, row, size_t(width) * 4);
+            }
+            else
+            {
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    out[x] = PackRGBA(row[x * 4 + 2], row[x * 4 + 1], row[x * 4 + 0], row[x * 4 + 3]);
+                }
+            }
+        }
+        return;
+    }
+
+    const uint32_t blockBytes = (format == TextureFormat::BC1) ? 8 : 16;
+    const uint32_t blocksWide = std::max(1u, (width + 3) / 4);
+    const uint32_t blocksHigh = std::max(1u, (height + 3) / 4);
+
+    for (uint32_t by = 0; by < blocksHigh; ++by)
+    {
+        const uint8_t* block = src + size_t(by) * rowPitch;
+
+        for (uint32_t bx = 0; bx < blocksWide; ++bx, block += blockBytes)
+        {
+            uint32_t texels[16];
+            switch (format)
+            {
+            case TextureFormat::BC1:
+                DecodeColorBlock(block, true, texels);
+                break;
+            case TextureFormat::BC2:
+                DecodeColorBlock(block + 8, false, texels);
+                DecodeExplicitAlpha(block, texels);
+                break;
+            default:
+                DecodeColorBlock(block + 8, false, texels);
+                DecodeInterpolatedAlpha(block, texels);
+                break;
+            }
+
+            // Edge blocks of small mips cover texels outside the surface.
+            for (uint32_t ty = 0; ty < 4 && by * 4 + ty < height; ++ty)
+            {
+                for (uint32_t tx = 0; tx < 4 && bx * 4 + tx < width; ++tx)
+                {
+                    dest[size_t(by * 4 + ty) * width + bx * 4 + tx] = texels[ty * 4 + tx];
+                }
+            }
+        }
+    }
+}
+
+std::vector<TextureSubresourceData> TextureData::GetSubresources() const
+{
+    std::vector<TextureSubresourceData> result;
+    result.reserve(surfaces.size());
+
+    for (const TextureSurface& surface : surfaces)
+    {
+        result.push_back(TextureSubresourceData{ pixels.data() + surface.offset, surface.rowPitch, surface.slicePitch });
+    }
+
+    return result;
+}
+
+TextureData DX::LoadDDSFromMemory(const uint8_t* data, size_t size)
+{
+    TextureData texture;
+    size_t offset = ParseDDSHeader(data, size, texture.desc);
+
+    // Lay out every surface, then copy the payload in one go.
+    size_t payload = LayoutSurfaces(texture);
+    if (size < offset + payload)
+    {
+        throw std::runtime_error("LoadDDS: truncated pixel data");
+    }
+
+    texture.pixels.assign(data + offset, data + offset + payload);
+    return texture;
+}
+
+TextureData DX::LoadDDSFromFile(const std::string& path)
+{
+    std::vector<uint8_t> blob = ReadBinaryFile(path);
+    return LoadDDSFromMemory(blob.data(), blob.size());
+}
+
+TextureDesc DX::LoadDDSDescFromFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("LoadDDS: " + path);
+    }
+
+    uint8_t header[DDS_HEADER_BYTES];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    TextureDesc desc;
+    ParseDDSHeader(header, size_t(file.gcount()), desc);
+    return desc;
+}
+
+TextureData DX::LoadDDSMipsFromFile(const std::string& path, uint32_t firstMip)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("LoadDDS: " + path);
+    }
+
+    uint8_t header[DDS_HEADER_BYTES];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    TextureData whole;
+    size_t offset = ParseDDSHeader(header, size_t(file.gcount()), whole.desc);
+    if (firstMip >= whole.desc.mipLevels)
+    {
+        throw std::runtime_error("LoadDDS: no such mip");
+    }
+    size_t chainBytes = LayoutSurfaces(whole) / whole.desc.arraySize;
+    size_t skippedBytes = whole.surfaces[firstMip].offset;
+
+    TextureData texture;
+    texture.desc = whole.desc;
+    texture.desc.width = whole.surfaces[firstMip].width;
+    texture.desc.height = whole.surfaces[firstMip].height;
+    texture.desc.mipLevels -= firstMip;
+    size_t keptBytes = LayoutSurfaces(texture) / texture.desc.arraySize;
+
+    // Each slice's chain is contiguous, its small mips last: one read per slice.
+    texture.pixels.resize(keptBytes * texture.desc.arraySize);
+    for (uint32_t slice = 0; slice < texture.desc.arraySize; ++slice)
+    {
+        file.clear();
+        file.seekg(std::streamoff(offset + slice * chainBytes + skippedBytes), std::ios::beg);
+        file.read(reinterpret_cast<char*>(texture.pixels.data() + slice * keptBytes), std::streamsize(keptBytes));
+        if (!file)
+        {
+            throw std::runtime_error("LoadDDS: truncated pixel data");
+        }
+    }
+
+    return texture;
+}
+
+TextureData DX::CopyMips(const TextureData& texture, uint32_t firstMip)
+{
+    if (firstMip >= texture.desc.mipLevels)
+    {
+        throw std::runtime_error("CopyMips: no such mip");
+    }
+
+    TextureData result;
+    result.desc = texture.desc;
+    result.desc.width = texture.surfaces[firstMip].width;
+    result.desc.height = texture.surfaces[firstMip].height;
+    result.desc.mipLevels -= firstMip;
+    size_t keptBytes = LayoutSurfaces(result) / result.desc.arraySize;
+
+    result.pixels.resize(keptBytes * result.desc.arraySize);
+    for (uint32_t slice = 0; slice < result.desc.arraySize; ++slice)
+    {
+        std::memcpy(result.pixels.data() + slice * keptBytes, texture.GetSurfacePixels(slice, firstMip), keptBytes);
+    }
+    return result;
+}
+
+void DX::SaveDDSToFile(const std::string& path, const TextureData& texture)
+{
+    const TextureDesc& desc = texture.desc;
+    const bool compressed = IsBlockCompressed(desc.format);
+    const bool extended = desc.arraySize != (desc.cubemap ? 6u : 1u);
+
+    DDS_HEADER header = {};
+    header.size = sizeof(DDS_HEADER);
+    header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT
+        | (compressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+    header.height = desc.height;
+    header.width = desc.width;
+    header.pitchOrLinearSize = compressed ? texture.GetSurface(0, 0).slicePitch : texture.GetSurface(0, 0).rowPitch;
+    header.mipMapCount = desc.mipLevels;
+    header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+    header.caps = DDSCAPS_TEXTURE
+        | (desc.mipLevels > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0)
+        | (desc.cubemap ? DDSCAPS_COMPLEX : 0);
+    header.caps2 = desc.cubemap ? DDS_CUBEMAP | DDS_CUBEMAP_ALLFACES : 0;
+
+    DDS_HEADER_DXT10 dx10 = {};
+    if (extended)
+    {
+        static const uint32_t dxgiFormats[] =
+        {
+            DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM,
+            DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC2_UNORM, DXGI_FORMAT_BC3_UNORM,
+        };
+        header.ddspf.flags = DDS_FOURCC;
+        header.ddspf.fourCC = MakeFourCC('D', 'X', '1', '0');
+        dx10.dxgiFormat = dxgiFormats[uint32_t(desc.format)];
+        dx10.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+        dx10.miscFlag = desc.cubemap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+        dx10.arraySize = desc.cubemap ? desc.arraySize / 6 : desc.arraySize;
+    }
+    else if (compressed)
+    {
+        static const char digits[] = { '1', '3', '5' };
+        header.ddspf.flags = DDS_FOURCC;
+        header.ddspf.fourCC = MakeFourCC('D', 'X', 'T', digits[uint32_t(desc.format) - uint32_t(TextureFormat::BC1)]);
+    }
+    else
+    {
+        const bool rgba = desc.format == TextureFormat::RGBA8;
+        header.ddspf.flags = DDS_RGB | DDS_ALPHAPIXELS;
+        header.ddspf.RGBBitCount = 32;
+        header.ddspf.RBitMask = rgba ? 0x000000ff : 0x00ff0000;
+        header.ddspf.GBitMask = 0x0000ff00;
+        header.ddspf.BBitMask = rgba ? 0x00ff0000 : 0x000000ff;
+        header.ddspf.ABitMask = 0xff000000;
+    }
+
+    size_t payload = 0;
+    for (const TextureSurface& surface : texture.surfaces)
+    {
+        payload += surface.slicePitch;
+    }
+
+    std::vector<uint8_t> file(sizeof(uint32_t) + sizeof(header) + (extended ? sizeof(dx10) : 0) + payload);
+    uint8_t* out = file.data();
+    std::memcpy(out, &DDS_MAGIC, sizeof(uint32_t));
+    out += sizeof(uint32_t);
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    if (extended)
+    {
+        std::memcpy(out, &dx10, sizeof(dx10));
+        out += sizeof(dx10);
+    }
+
+    // Slice major, then mip, whatever order the pixels are held in.
+    for (uint32_t slice = 0; slice < desc.arraySize; ++slice)
+    {
+        for (uint32_t mip = 0; mip < desc.mipLevels; ++mip)
+        {
+            const TextureSurface& surface = texture.GetSurface(slice, mip);
+            std::memcpy(out, texture.GetSurfacePixels(slice, mip), surface.slicePitch);
+            out += surface.slicePitch;
+        }
+    }
+
+    WriteBinaryFile(path, file.data(), file.size());
+}
@@ -0,0 +1,73 @@
+//
+// TextureData.h - CPU-side texture surfaces parsed from DDS files
+//
+
+#pragma once
+
+#include "GraphicsBackend.h"
+
+#include <string>
+#include <vector>
+
+namespace DX
+{
+    struct TextureSurface
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t rowPitch;
+        uint32_t slicePitch;
+        size_t   offset;        // Into TextureData::pixels.
+    };
+
+    struct TextureData
+    {
+        TextureDesc                 desc;
+        std::vector<TextureSurface> surfaces;   // Array slice major, then mip.
+        std::vector<uint8_t>        pixels;
+
+        const uint8_t* GetSurfacePixels(uint32_t arraySlice, uint32_t mip) const
+        {
+            return pixels.data() + surfaces[arraySlice * desc.mipLevels + mip].offset;
+        }
+
+        const TextureSurface& GetSurface(uint32_t arraySlice, uint32_t mip) const
+        {
+            return surfaces[arraySlice * desc.mipLevels + mip];
+        }
+
+        // Subresource table suitable for IGraphicsBackend::CreateTexture.
+        std::vector<TextureSubresourceData> GetSubresources() const;
+    };
+
+    // Bytes per row and per surface for a mip of the given format.
+    void GetSurfaceInfo(TextureFormat format, uint32_t width, uint32_t height, uint32_t& rowPitch, uint32_t& slicePitch);
+
+    bool IsBlockCompressed(TextureFormat format);
+
+    // Expands one surface of any supported format to tightly packed RGBA8
+    // texels (R in the low byte), so CPU code can sample it directly.
+    void DecodeSurfaceToRGBA8(TextureFormat format, uint32_t width, uint32_t height,
+        const void* data, uint32_t rowPitch, uint32_t* dest);
+
+    // Parses DDS files holding RGBA8/BGRA8 or BC1-BC3 data, including mip
+    // chains and cubemaps. Throws std::runtime_error for anything else.
+    TextureData LoadDDSFromMemory(const uint8_t* data, size_t size);
+    TextureData LoadDDSFromFile(const std::string& path);
+
+    // Reads only the header: what LoadDDSFromFile's desc would be.
+    TextureDesc LoadDDSDescFromFile(const std::string& path);
+
+    // Reads mips firstMip onwards of every array slice and seeks past the
+    // rest, so a coarse mip costs only its share of the file. The desc
+    // describes what was read: firstMip becomes mip zero.
+    TextureData LoadDDSMipsFromFile(const std::string& path, uint32_t firstMip);
+
+    // The same cut of a texture already in memory.
+    TextureData CopyMips(const TextureData& texture, uint32_t firstMip);
+
+    // Writes a DDS file LoadDDSFromFile reads back unchanged: a legacy
+    // header for single textures and cubemaps, the DX10 extension for other
+    // arrays. Throws std::runtime_error if the file cannot be written.
+    void SaveDDSToFile(const std::string& path, const TextureData& texture);
+}
@@ -0,0 +1,446 @@
+//
+// TextureStreamer.cpp
+//
+
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+
+using namespace DX;
+
+namespace
+{
+    // Mips this size and smaller stay resident from Add on, so every
+    // texture always has something to draw with.
+    const uint32_t TAIL_SIZE = 64;
+
+    // Nearer than this, or inside the bounds, counts as this near.
+    const float MIN_DISTANCE = 0.01f;
+
+    uint32_t MipSize(const TextureDesc& desc, uint32_t mip)
+    {
+        return std::max(1u, std::max(desc.width, desc.height) >> mip);
+    }
+}
+
+TextureStreamer::TextureStreamer(const std::string& rootDirectory, uint64_t budgetBytes) :
+    m_root(rootDirectory.empty() ? std::string(".") : rootDirectory),
+    m_budget(budgetBytes),
+    m_stats{},
+    m_reading(false),
+    m_stop(false)
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    if (m_reader.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_requestReady.notify_one();
+        m_reader.join();
+    }
+}
+
+StreamedTextureHandle TextureStreamer::Add(const std::string& name)
+{
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        if (m_textures[i].name == name)
+        {
+            return StreamedTextureHandle(i + 1);
+        }
+    }
+
+    Texture texture;
+    texture.name = name;
+    texture.loadingMip = NoLoad;
+    texture.generation = 0;
+    texture.screenSize = 0;
+    texture.gpu = InvalidHandle;
+    texture.uploaded = false;
+    ReadTail(texture);
+
+    m_textures.push_back(std::move(texture));
+    return StreamedTextureHandle(m_textures.size());
+}
+
+void TextureStreamer::Reload(StreamedTextureHandle texture)
+{
+    if (texture == 0 || texture > m_textures.size())
+    {
+        throw std::runtime_error("TextureStreamer::Reload: invalid handle");
+    }
+
+    Texture& entry = m_textures[texture - 1];
+    ReadTail(entry);
+    ++entry.generation;
+    entry.loadingMip = NoLoad;
+}
+
+void TextureStreamer::ReadTail(Texture& texture)
+{
+    const std::string path = m_root + "/" + texture.name;
+    TextureDesc desc = LoadDDSDescFromFile(path);
+
+    std::vector<uint64_t> bytesFromMip(desc.mipLevels + 1, 0);
+    for (uint32_t mip = desc.mipLevels; mip-- > 0;)
+    {
+        uint32_t rowPitch, slicePitch;
+        GetSurfaceInfo(desc.format, std::max(1u, desc.width >> mip), std::max(1u, desc.height >> mip), rowPitch, slicePitch);
+        bytesFromMip[mip] = bytesFromMip[mip + 1] + uint64_t(slicePitch) * desc.arraySize;
+    }
+
+    // Block compressed textures can only start at a mip whose sides are
+    // whole blocks.
+    uint32_t tail = 0;
+    while (tail + 1 < desc.mipLevels && MipSize(desc, tail) > TAIL_SIZE)
+    {
+        uint32_t width = std::max(1u, desc.width >> (tail + 1));
+        uint32_t height = std::max(1u, desc.height >> (tail + 1));
+        if (IsBlockCompressed(desc.format) && (width % 4 != 0 || height % 4 != 0))
+        {
+            break;
+        }
+        ++tail;
+    }
+
+    TextureData data = LoadDDSMipsFromFile(path, tail);
+    m_stats.bytesRead += data.pixels.size();
+
+    texture.desc = desc;
+    texture.bytesFromMip = std::move(bytesFromMip);
+    texture.tailMip = tail;
+    texture.desiredMip = tail;
+    texture.targetMip = tail;
+    SetResident(texture, std::move(data), tail);
+}
+
+void TextureStreamer::SetResident(Texture& texture, TextureData data, uint32_t mip)
+{
+    m_stats.residentBytes = m_stats.residentBytes - texture.resident.pixels.size() + data.pixels.size();
+    texture.resident = std::move(data);
+    texture.residentMip = mip;
+    texture.uploaded = false;
+}
+
+void TextureStreamer::AddUsage(StreamedTextureHandle texture, const Float3& center, float radius)
+{
+    if (texture == 0 || texture > m_textures.size())
+    {
+        throw std::runtime_error("TextureStreamer::AddUsage: invalid handle");
+    }
+    m_usages.push_back(Usage{ texture, center, radius });
+}
+
+void TextureStreamer::ChooseTargets(const StreamingView& view)
+{
+    for (Texture& texture : m_textures)
+    {
+        texture.screenSize = 0;
+    }
+
+    // A sphere of radius r at distance d spans r * cot(fov / 2) / d of
+    // the half-height of the viewport.
+    for (const Usage& usage : m_usages)
+    {
+        float distance = std::max((usage.center - view.cameraPosition).Length() - usage.radius, MIN_DISTANCE);
+        float size = usage.radius * view.projectionScale * float(view.viewportHeight) / distance;
+
+        Texture& texture = m_textures[usage.texture - 1];
+        texture.screenSize = std::max(texture.screenSize, size);
+    }
+    m_usages.clear();
+
+    // One texel per pixel: the mip whose size is the first at most twice
+    // the size on screen.
+    auto texelsPerPixel = [](const Texture& texture, uint32_t mip)
+    {
+        return float(MipSize(texture.desc, mip)) / texture.screenSize;
+    };
+
+    uint64_t total = 0;
+    m_candidates.clear();
+    for (uint32_t i = 0; i < m_textures.size(); ++i)
+    {
+        Texture& texture = m_textures[i];
+
+        uint32_t desired = texture.tailMip;
+        if (texture.screenSize > 0)
+        {
+            float ratio = texelsPerPixel(texture, 0);
+            desired = ratio > 1 ? std::min(uint32_t(std::log2(ratio)), texture.tailMip) : 0;
+        }
+        texture.desiredMip = desired;
+        texture.targetMip = desired;
+        total += texture.bytesFromMip[desired];
+
+        if (desired < texture.tailMip)
+        {
+            m_candidates.emplace_back(texelsPerPixel(texture, desired), i);
+        }
+    }
+    m_stats.wantedBytes = total;
+
+    // Over budget, halve whichever texture has the most texels per pixel,
+    // which costs the least detail on screen, until the rest fits.
+    std::make_heap(m_candidates.begin(), m_candidates.end());
+    while (m_budget != 0 && total > m_budget && !m_candidates.empty())
+    {
+        std::pop_heap(m_candidates.begin(), m_candidates.end());
+        uint32_t index = m_candidates.back().second;
+        m_candidates.pop_back();
+
+        Texture& texture = m_textures[index];
+        total -= texture.bytesFromMip[texture.targetMip] - texture.bytesFromMip[texture.targetMip + 1];
+        ++texture.targetMip;
+
+        if (texture.targetMip < texture.tailMip)
+        {
+            m_candidates.emplace_back(texelsPerPixel(texture, texture.targetMip), index);
+            std::push_heap(m_candidates.begin(), m_candidates.end());
+        }
+    }
+}
+
+void TextureStreamer::InstallLoads()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished.swap(m_results);
+    }
+
+    for (LoadResult& result : m_finished)
+    {
+        Texture& texture = m_textures[result.texture - 1];
+        m_stats.bytesRead += result.data.pixels.size();
+
+        if (result.generation != texture.generation)
+        {
+            ++m_stats.loadsDiscarded;
+            continue;
+        }
+        texture.loadingMip = NoLoad;
+
+        if (result.failed)
+        {
+            ++m_stats.loadsFailed;
+            continue;
+        }
+
+        // Never finer than wanted now, nor past the budget: targets may
+        // have moved since the load was queued.
+        uint32_t mip = std::max(result.mip, texture.targetMip);
+        while (mip < texture.residentMip && m_budget != 0
+            && m_stats.residentBytes - texture.resident.pixels.size() + texture.bytesFromMip[mip] > m_budget)
+        {
+            ++mip;
+        }
+        if (mip >= texture.residentMip)
+        {
+            ++m_stats.loadsDiscarded;
+            continue;
+        }
+
+        SetResident(texture, mip == result.mip ? std::move(result.data) : CopyMips(result.data, mip - result.mip), mip);
+        ++m_stats.loadsCompleted;
+    }
+    m_finished.clear();
+}
+
+void TextureStreamer::QueueLoads()
+{
+    auto priorityOf = [](const Texture& texture)
+    {
+        return texture.screenSize / float(MipSize(texture.desc, texture.residentMip));
+    };
+
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Requests the reader has not started follow the new targets, or
+        // go if their texture no longer wants anything.
+        size_t kept = 0;
+        for (size_t i = 0; i < m_queue.size(); ++i)
+        {
+            LoadRequest& request = m_queue[i];
+            Texture& texture = m_textures[request.texture - 1];
+            if (request.generation != texture.generation)
+            {
+                continue;
+            }
+            if (texture.targetMip >= texture.residentMip)
+            {
+                texture.loadingMip = NoLoad;
+                continue;
+            }
+
+            request.mip = texture.targetMip;
+            request.priority = priorityOf(texture);
+            texture.loadingMip = texture.targetMip;
+            if (kept != i)
+            {
+                m_queue[kept] = std::move(request);
+            }
+            ++kept;
+        }
+        m_queue.erase(m_queue.begin() + kept, m_queue.end());
+
+        for (uint32_t i = 0; i < m_textures.size(); ++i)
+        {
+            Texture& texture = m_textures[i];
+            if (texture.targetMip < texture.residentMip && texture.loadingMip == NoLoad)
+            {
+                texture.loadingMip = texture.targetMip;
+                m_queue.push_back(LoadRequest{ i + 1, texture.generation, texture.targetMip, priorityOf(texture),
+                    m_root + "/" + texture.name });
+                queued = true;
+            }
+        }
+
+        std::stable_sort(m_queue.begin(), m_queue.end(),
+            [](const LoadRequest& a, const LoadRequest& b) { return a.priority > b.priority; });
+
+        if (queued && !m_reader.joinable())
+        {
+            m_reader = std::thread(&TextureStreamer::LoadMain, this);
+        }
+    }
+
+    if (queued)
+    {
+        m_requestReady.notify_one();
+    }
+}
+
+void TextureStreamer::Update(IGraphicsBackend& backend, const StreamingView& view)
+{
+    ChooseTargets(view);
+
+    // Cut back before installing loads, so they have the room.
+    for (Texture& texture : m_textures)
+    {
+        if (texture.residentMip < texture.targetMip)
+        {
+            SetResident(texture, CopyMips(texture.resident, texture.targetMip - texture.residentMip), texture.targetMip);
+            ++m_stats.mipDrops;
+        }
+    }
+
+    InstallLoads();
+    QueueLoads();
+
+    uint32_t below = 0;
+    uint32_t pending = 0;
+    for (Texture& texture : m_textures)
+    {
+        if (!texture.uploaded)
+        {
+            backend.DestroyTexture(texture.gpu);
+            std::vector<TextureSubresourceData> subresources = texture.resident.GetSubresources();
+            texture.gpu = backend.CreateTexture(texture.resident.desc, subresources.data());
+            texture.uploaded = true;
+            m_stats.bytesUploaded += texture.resident.pixels.size();
+        }
+
+        below += texture.residentMip > texture.desiredMip ? 1 : 0;
+        pending += texture.loadingMip != NoLoad ? 1 : 0;
+    }
+    m_stats.texturesBelowDesired = below;
+    m_stats.loadsPending = pending;
+}
+
+void TextureStreamer::LoadMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_requestReady.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if (m_stop)
+        {
+            return;
+        }
+
+        LoadRequest request = std::move(m_queue.front());
+        m_queue.erase(m_queue.begin());
+        m_reading = true;
+        lock.unlock();
+
+        LoadResult result = { request.texture, request.generation, request.mip, false, TextureData() };
+        std::string error;
+        try
+        {
+            result.data = LoadDDSMipsFromFile(request.path, request.mip);
+        }
+        catch (const std::exception& e)
+        {
+            result.failed = true;
+            error = e.what();
+        }
+
+        lock.lock();
+        if (result.failed)
+        {
+            m_lastError = error;
+        }
+        m_results.push_back(std::move(result));
+        m_reading = false;
+        m_loadFinished.notify_all();
+    }
+}
+
+void TextureStreamer::WaitForLoads()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_loadFinished.wait(lock, [this]() { return m_queue.empty() && !m_reading; });
+}
+
+TextureHandle TextureStreamer::GetTexture(StreamedTextureHandle texture) const
+{
+    if (texture == 0 || texture > m_textures.size())
+    {
+        throw std::runtime_error("TextureStreamer::GetTexture: invalid handle");
+    }
+    return m_textures[texture - 1].gpu;
+}
+
+uint32_t TextureStreamer::GetResidentMip(StreamedTextureHandle texture) const
+{
+    if (texture == 0 || texture > m_textures.size())
+    {
+        throw std::runtime_error("TextureStreamer::GetResidentMip: invalid handle");
+    }
+    return m_textures[texture - 1].residentMip;
+}
+
+uint32_t TextureStreamer::GetDesiredMip(StreamedTextureHandle texture) const
+{
+    if (texture == 0 || texture > m_textures.size())
+    {
+        throw std::runtime_error("TextureStreamer::GetDesiredMip: invalid handle");
+    }
+    return m_textures[texture - 1].desiredMip;
+}
+
+void TextureStreamer::ReleaseResources(IGraphicsBackend& backend)
+{
+    for (Texture& texture : m_textures)
+    {
+        backend.DestroyTexture(texture.gpu);
+        texture.gpu = InvalidHandle;
+        texture.uploaded = false;
+    }
+}
+
+std::string TextureStreamer::GetLastError() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
@@ -0,0 +1,188 @@
+//
+// TextureStreamer.h - Mip levels chosen from each texture's projected size
+// on screen and streamed from DDS files under one memory budget
+//
+
+#pragma once
+
+#include "CpuMath.h"
+#include "GraphicsBackend.h"
+#include "TextureData.h"
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace DX
+{
+    // Zero is never a valid handle.
+    typedef uint32_t StreamedTextureHandle;
+
+    struct StreamingView
+    {
+        Float3      cameraPosition;
+        float       projectionScale;    // The projection's [1][1]: cot of half the vertical field of view.
+        uint32_t    viewportHeight;
+    };
+
+    // Running totals, except the first four, which describe the last Update.
+    struct TextureStreamingStats
+    {
+        uint64_t residentBytes;
+        uint64_t wantedBytes;               // What the desired mips would take, budget aside.
+        uint32_t texturesBelowDesired;      // Coarser than their screen size asks for.
+        uint32_t loadsPending;              // Queued, being read, or read and not yet installed.
+        uint32_t loadsCompleted;
+        uint32_t loadsDiscarded;            // Finished after their texture stopped wanting them.
+        uint32_t loadsFailed;               // See GetLastError.
+        uint32_t mipDrops;                  // Textures cut back, for the budget or because they shrank.
+        uint64_t bytesRead;
+        uint64_t bytesUploaded;
+    };
+
+    // Textures start with their small tail mips, read by Add. Each Update
+    // works out the mip every texture should have from the bounds it was
+    // given, takes mips off the textures with the most texels per pixel
+    // until the budget holds, cuts back at once whatever now has more than
+    // it should, and queues the finer mips still missing for a background
+    // reader, blurriest first. Loaded mips are installed by a later Update.
+    //
+    // The resident mips are kept on the CPU as well, so cutting a texture
+    // back, or recreating it after a lost device, never touches the disk.
+    // Everything but the reader belongs to one thread, normally the render
+    // thread.
+    class TextureStreamer
+    {
+    public:
+        // DDS file names are relative to rootDirectory. The budget covers
+        // the resident mips, tails included, which it never evicts.
+        TextureStreamer(const std::string& rootDirectory, uint64_t budgetBytes);
+        ~TextureStreamer();
+
+        TextureStreamer(TextureStreamer const&) = delete;
+        TextureStreamer& operator=(TextureStreamer const&) = delete;
+
+        // Registers name and reads its tail mips now. Throws
+        // std::runtime_error if it cannot. Adding a name twice returns the
+        // first handle.
+        StreamedTextureHandle Add(const std::string& name);
+
+        // Rereads a file that changed: back to its tail mips, then streamed
+        // up again. Loads of the old file still in flight are discarded.
+        void Reload(StreamedTextureHandle texture);
+
+        // Where the texture is seen this frame, as a world-space sphere it
+        // is mapped across once. A texture on several objects takes the
+        // largest on screen; one given no bounds before an Update falls
+        // back to its tail.
+        void AddUsage(StreamedTextureHandle texture, const Float3& center, float radius);
+
+        // Once a frame: chooses the mips, cuts back, installs finished
+        // loads, queues new ones and uploads whatever changed or was
+        // released.
+        void Update(IGraphicsBackend& backend, const StreamingView& view);
+
+        // Blocks until the reader has finished every load queued so far, so
+        // the next Update installs them all. Lets tests and benchmarks
+        // stream the same way however the reader is scheduled.
+        void WaitForLoads();
+
+        // Invalid until the first Update; replaced whenever the resident
+        // mips change.
+        TextureHandle GetTexture(StreamedTextureHandle texture) const;
+
+        // Mips of the whole file: the first one resident, and the one the
+        // last Update wanted, budget aside.
+        uint32_t GetResidentMip(StreamedTextureHandle texture) const;
+        uint32_t GetDesiredMip(StreamedTextureHandle texture) const;
+
+        // Destroys the backend textures and keeps the CPU copies; the next
+        // Update recreates them.
+        void ReleaseResources(IGraphicsBackend& backend);
+
+        void SetBudget(uint64_t bytes)                      { m_budget = bytes; }
+        uint64_t GetBudget() const                          { return m_budget; }
+        bool IsLoading() const                              { return m_stats.loadsPending != 0; }
+        const TextureStreamingStats& GetStats() const       { return m_stats; }
+        std::string GetLastError() const;
+
+    private:
+        static const uint32_t NoLoad = ~0u;
+
+        struct Texture
+        {
+            std::string             name;
+            TextureDesc             desc;           // The whole file.
+            std::vector<uint64_t>   bytesFromMip;   // Every slice, that mip and smaller.
+            uint32_t                tailMip;        // Always resident.
+            TextureData             resident;       // From residentMip down.
+            uint32_t                residentMip;
+            uint32_t                desiredMip;
+            uint32_t                targetMip;      // Desired, after the budget.
+            uint32_t                loadingMip;     // NoLoad if nothing is on its way.
+            uint32_t                generation;     // Bumped by Reload.
+            float                   screenSize;     // Pixels across this frame; zero if unused.
+            TextureHandle           gpu;
+            bool                    uploaded;
+        };
+
+        struct Usage
+        {
+            StreamedTextureHandle   texture;
+            Float3                  center;
+            float                   radius;
+        };
+
+        struct LoadRequest
+        {
+            StreamedTextureHandle   texture;
+            uint32_t                generation;
+            uint32_t                mip;
+            float                   priority;       // Screen pixels per resident texel.
+            std::string             path;
+        };
+
+        struct LoadResult
+        {
+            StreamedTextureHandle   texture;
+            uint32_t                generation;
+            uint32_t                mip;
+            bool                    failed;
+            TextureData             data;
+        };
+
+        void ReadTail(Texture& texture);
+        void SetResident(Texture& texture, TextureData data, uint32_t mip);
+        void ChooseTargets(const StreamingView& view);
+        void InstallLoads();
+        void QueueLoads();
+        void LoadMain();
+
+        std::string                 m_root;
+        uint64_t                    m_budget;
+        std::vector<Texture>        m_textures;     // Handle - 1.
+        TextureStreamingStats       m_stats;
+
+        std::vector<Usage>          m_usages;       // Since the last Update.
+
+        // Update scratch.
+        std::vector<std::pair<float, uint32_t>> m_candidates;
+        std::vector<LoadResult>                 m_finished;
+
+        std::thread                 m_reader;       // Started by the first load.
+
+        mutable std::mutex          m_mutex;        // Guards everything below.
+        std::condition_variable     m_requestReady;
+        std::condition_variable     m_loadFinished;
+        std::vector<LoadRequest>    m_queue;        // Highest priority first.
+        std::vector<LoadResult>     m_results;
+        bool                        m_reading;      // A request is off the queue but not yet in m_results.
+        std::string                 m_lastError;
+        bool                        m_stop;
+    };
+}
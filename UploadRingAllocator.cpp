@@ -0,0 +1,129 @@
+//
+// UploadRingAllocator.cpp
+//
+
+#include "UploadRingAllocator.h"
+
+#include <stdexcept>
+
+using namespace DX;
+
+UploadRingAllocator::UploadRingAllocator(uint32_t capacityBytes, uint32_t maxFramesInFlight, uint32_t alignment) :
+    m_capacity(capacityBytes),
+    m_alignment(alignment),
+    m_head(0),
+    m_tail(0),
+    m_used(0),
+    m_frameBytes(0),
+    m_frames(maxFramesInFlight ? maxFramesInFlight : 1),
+    m_firstFrame(0),
+    m_frameCount(0),
+    m_stats{}
+{
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        throw std::runtime_error("UploadRingAllocator: alignment must be a power of two");
+    }
+}
+
+uint32_t UploadRingAllocator::Allocate(uint32_t sizeBytes)
+{
+    const uint32_t size = (sizeBytes + m_alignment - 1) & ~(m_alignment - 1);
+
+    // An empty ring restarts at zero so small frames never straddle the end.
+    if (m_used == 0)
+    {
+        m_head = m_tail = 0;
+    }
+
+    if (size == 0 || size > m_capacity - m_used)
+    {
+        ++m_stats.failures;
+        return InvalidOffset;
+    }
+
+    uint32_t offset;
+    uint32_t consumed = size;
+
+    if (m_head >= m_tail)
+    {
+        // Free space is [head, capacity) followed by [0, tail).
+        if (m_capacity - m_head >= size)
+        {
+            offset = m_head;
+        }
+        else if (m_tail >= size)
+        {
+            // Skip the remainder; it is released with this frame.
+            consumed += m_capacity - m_head;
+            offset = 0;
+            ++m_stats.wraps;
+        }
+        else
+        {
+            ++m_stats.failures;
+            return InvalidOffset;
+        }
+    }
+    else
+    {
+        // Free space is [head, tail).
+        if (m_tail - m_head >= size)
+        {
+            offset = m_head;
+        }
+        else
+        {
+            ++m_stats.failures;
+            return InvalidOffset;
+        }
+    }
+
+    m_head = offset + size;
+    m_used += consumed;
+    m_frameBytes += consumed;
+
+    ++m_stats.allocations;
+    m_stats.bytesAllocated += consumed;
+    return offset;
+}
+
+void UploadRingAllocator::EndFrame(uint64_t fenceValue)
+{
+    if (m_frameCount == m_frames.size())
+    {
+        throw std::runtime_error("UploadRingAllocator: too many frames in flight");
+    }
+
+    uint32_t index = (m_firstFrame + m_frameCount) % uint32_t(m_frames.size());
+    m_frames[index] = Frame{ fenceValue, m_head, m_frameBytes };
+    ++m_frameCount;
+    m_frameBytes = 0;
+}
+
+void UploadRingAllocator::Retire(uint64_t completedFence)
+{
+    while (m_frameCount > 0)
+    {
+        const Frame& frame = m_frames[m_firstFrame];
+        if (frame.fence > completedFence)
+        {
+            break;
+        }
+
+        // Empty frames own no range; their end may predate a restart at zero.
+        if (frame.size > 0)
+        {
+            m_tail = frame.end;
+            m_used -= frame.size;
+        }
+
+        m_firstFrame = (m_firstFrame + 1) % uint32_t(m_frames.size());
+        --m_frameCount;
+    }
+}
+
+uint64_t UploadRingAllocator::GetOldestFence() const
+{
+    return m_frameCount ? m_frames[m_firstFrame].fence : 0;
+}
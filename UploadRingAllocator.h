@@ -0,0 +1,77 @@
+//
+// UploadRingAllocator.h - Offset bookkeeping for a ring-buffered upload heap
+// shared by several frames in flight
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace DX
+{
+    struct UploadRingStats
+    {
+        uint64_t allocations;
+        uint64_t bytesAllocated;        // Including alignment and wrap padding.
+        uint64_t wraps;
+        uint64_t failures;              // Requests refused because the GPU still owned the space.
+    };
+
+    // Hands out aligned ranges of one large buffer. Allocations made between
+    // two EndFrame calls belong to that frame and stay reserved until Retire
+    // is called with a fence value at least as large as the frame's. The
+    // allocator never touches memory itself, so the same logic serves any
+    // API and can be exercised without a device.
+    class UploadRingAllocator
+    {
+    public:
+        static const uint32_t InvalidOffset = 0xFFFFFFFF;
+
+        // alignment must be a power of two; 256 matches D3D11.1 constant
+        // buffer offsets (16 constants).
+        UploadRingAllocator(uint32_t capacityBytes, uint32_t maxFramesInFlight, uint32_t alignment = 256);
+
+        // Returns InvalidOffset when the free space is still in flight; the
+        // caller should wait on its oldest fence, Retire and try again.
+        uint32_t Allocate(uint32_t sizeBytes);
+
+        // Closes the current frame. Throws std::runtime_error if more than
+        // maxFramesInFlight frames are still unretired.
+        void EndFrame(uint64_t fenceValue);
+
+        // Releases every closed frame whose fence value is <= completedFence.
+        void Retire(uint64_t completedFence);
+
+        // Fence of the oldest unretired frame, or zero if there is none.
+        uint64_t GetOldestFence() const;
+
+        uint32_t GetCapacity() const            { return m_capacity; }
+        uint32_t GetAlignment() const           { return m_alignment; }
+        uint32_t GetUsedBytes() const           { return m_used; }
+        uint32_t GetFramesInFlight() const      { return m_frameCount; }
+        const UploadRingStats& GetStats() const { return m_stats; }
+
+    private:
+        struct Frame
+        {
+            uint64_t fence;
+            uint32_t end;           // Head offset when the frame closed.
+            uint32_t size;          // Bytes the frame holds, padding included.
+        };
+
+        uint32_t            m_capacity;
+        uint32_t            m_alignment;
+        uint32_t            m_head;
+        uint32_t            m_tail;
+        uint32_t            m_used;
+        uint32_t            m_frameBytes;
+
+        // Fixed circular queue of closed frames, so steady state never allocates.
+        std::vector<Frame>  m_frames;
+        uint32_t            m_firstFrame;
+        uint32_t            m_frameCount;
+
+        UploadRingStats     m_stats;
+    };
+}